@@ -7,6 +7,7 @@
 
 #include "shapes/shape.h"
 #include "view/component.h"
+#include "view/shape_index.h"
 
 namespace USTC_CG
 {
@@ -73,6 +74,10 @@ class Canvas : public Component
     bool draw_filled = false;        // Whether the shape to be drawn is filled.
     float image_size = 1;            // The size of the image to be drawn.
     float image_bia[2] = { 0.5f, 0.5f };  // The bia of image from the center.
+    float freehand_tolerance = 1.0f;  // Largest distance of a simplified
+                                      // freehand stroke from the mouse.
+    bool freehand_compact = true;  // Whether finished freehand strokes are
+                                   // stored delta-encoded.
 
     bool select_mode = false;  // Is the user currently selecting a shape. Set
                                 // as public to change UI on drawing buttons.
@@ -94,6 +99,9 @@ class Canvas : public Component
                               // current shape.
     void mouse_release_event();  // Used to draw freehand shapes.
 
+    // Adds a finished shape on top of the shape list.
+    void add_shape(const std::shared_ptr<Shape>& shape);
+
     // Calculates mouse's relative position in the canvas.
     ImVec2 mouse_pos_in_canvas() const;
 
@@ -121,6 +129,9 @@ class Canvas : public Component
 
     // List of shapes drawn on the canvas.
     std::vector<std::shared_ptr<Shape>> shape_list_;
+    // Grid over the bounding boxes of shape_list_, for selecting and culling.
+    ShapeIndex shape_index_;
+    std::vector<const Shape*> visible_shapes_;  // Shapes drawn this frame.
 };
 
 }  // namespace USTC_CG
@@ -1,6 +1,11 @@
 #pragma once
 
-#include <memory>     // For std::unique_ptr
+#include <algorithm>
+#include <array>
+#include <cstring>  // For std::memcpy
+#include <initializer_list>
+#include <memory>  // For std::unique_ptr
+#include <span>
 #include <stdexcept>  // For exceptions
 #include <vector>
 
@@ -103,35 +108,118 @@ class Image
         return image_data_.get();
     }
 
-    std::vector<unsigned char> get_pixel(int x, int y) const
+    // Zero-copy access. Pixels are stored row by row, channels() bytes each,
+    // without padding. Unlike get_pixel() and set_pixel(), the functions below
+    // don't check their arguments.
+
+    // Pointer to the first channel of row y.
+    unsigned char* row(int y)
     {
-        if (x < 0 || x >= width_ || y < 0 || y >= height_)
+        return image_data_.get() + pixel_index(0, y);
+    }
+    const unsigned char* row(int y) const
+    {
+        return image_data_.get() + pixel_index(0, y);
+    }
+    // The width() * channels() bytes of row y.
+    std::span<unsigned char> row_span(int y)
+    {
+        return { row(y), static_cast<std::size_t>(width_) * channels_ };
+    }
+    std::span<const unsigned char> row_span(int y) const
+    {
+        return { row(y), static_cast<std::size_t>(width_) * channels_ };
+    }
+    // Pointer to the first channel of pixel (x, y).
+    unsigned char* pixel_ptr(int x, int y)
+    {
+        return image_data_.get() + pixel_index(x, y);
+    }
+    const unsigned char* pixel_ptr(int x, int y) const
+    {
+        return image_data_.get() + pixel_index(x, y);
+    }
+
+    // The first N channels of pixel (x, y), N <= channels().
+    template<int N>
+    std::array<unsigned char, N> get_pixel_array(int x, int y) const
+    {
+        std::array<unsigned char, N> values;
+        std::memcpy(values.data(), pixel_ptr(x, y), N);
+        return values;
+    }
+    // Set the first N channels of pixel (x, y), N <= channels(). As with
+    // set_pixel(), an RGB value leaves the alpha of an RGBA image unchanged.
+    template<int N>
+    void set_pixel_array(
+        int x,
+        int y,
+        const std::array<unsigned char, N>& values)
+    {
+        std::memcpy(pixel_ptr(x, y), values.data(), N);
+    }
+
+    // Copy pixel (src_x, src_y) of src to (x, y). Only the channels both images
+    // have are copied.
+    void copy_pixel(int x, int y, const Image& src, int src_x, int src_y)
+    {
+        std::memcpy(
+            pixel_ptr(x, y),
+            src.pixel_ptr(src_x, src_y),
+            std::min(channels_, src.channels_));
+    }
+    // Copy row src_y of src, which has the same width and channels, to row y.
+    void copy_row(int y, const Image& src, int src_y)
+    {
+        std::memcpy(row(y), src.row(src_y), row_span(y).size());
+    }
+
+    // Set every pixel of row y, or of the image, to values, which holds at
+    // least channels() values; the extra ones are ignored.
+    void fill_row(int y, std::initializer_list<unsigned char> values)
+    {
+        check_fill_values(values);
+        unsigned char* dst = row(y);
+        std::memcpy(dst, values.begin(), channels_);
+        // Double the filled part with each copy.
+        std::size_t filled = channels_, size = row_span(y).size();
+        while (filled < size)
         {
-            throw std::out_of_range("Pixel coordinates out of bounds");
+            std::size_t count = std::min(filled, size - filled);
+            std::memcpy(dst + filled, dst, count);
+            filled += count;
         }
-        std::vector<unsigned char> pixelValues(channels_);
-        std::size_t index =
-            static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
-            static_cast<std::size_t>(x);
-        index *= static_cast<std::size_t>(channels_);
-        for (int channel = 0; channel < channels_; ++channel)
+    }
+    void fill(std::initializer_list<unsigned char> values)
+    {
+        if (width_ == 0 || height_ == 0)
         {
-            pixelValues[channel] = image_data_[index + channel];
+            return;
         }
-        return pixelValues;
+        fill_row(0, values);
+        for (int y = 1; y < height_; ++y)
+        {
+            std::memcpy(row(y), row(0), row_span(0).size());
+        }
+    }
+
+    // Checked access, copying the channels of a pixel. The loops over whole
+    // images should prefer the functions above.
+    std::vector<unsigned char> get_pixel(int x, int y) const
+    {
+        check_coordinates(x, y);
+        const unsigned char* pixel = pixel_ptr(x, y);
+        return std::vector<unsigned char>(pixel, pixel + channels_);
     }
 
     inline unsigned char get_pixel_unsafe(int x, int y, int channel) const
     {
-        return image_data_[(y * width_ + x) * channels_ + channel];
+        return image_data_[pixel_index(x, y) + channel];
     }
 
     void set_pixel(int x, int y, const std::vector<unsigned char>& values)
     {
-        if (x < 0 || x >= width_ || y < 0 || y >= height_)
-        {
-            throw std::out_of_range("Pixel coordinates out of bounds");
-        }
+        check_coordinates(x, y);
         // Allow 3 channel input when channels.size()==4 (RGB -> RGBA)
         // In this case, leave the alpha channel unchanged
         size_t channels_reset = channels_;
@@ -144,13 +232,30 @@ class Image
             throw std::invalid_argument(
                 "Number of values does not match the number of channels");
         }
+        std::memcpy(pixel_ptr(x, y), values.data(), channels_reset);
+    }
+
+   private:
+    std::size_t pixel_index(int x, int y) const
+    {
         std::size_t index =
             static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
             static_cast<std::size_t>(x);
-        index *= static_cast<std::size_t>(channels_);
-        for (int channel = 0; channel < channels_reset; ++channel)
+        return index * static_cast<std::size_t>(channels_);
+    }
+    void check_coordinates(int x, int y) const
+    {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_)
         {
-            image_data_[index + channel] = values[channel];
+            throw std::out_of_range("Pixel coordinates out of bounds");
+        }
+    }
+    void check_fill_values(std::initializer_list<unsigned char> values) const
+    {
+        if (values.size() < static_cast<size_t>(channels_))
+        {
+            throw std::invalid_argument(
+                "Number of values is less than the number of channels");
         }
     }
 
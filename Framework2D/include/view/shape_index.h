@@ -0,0 +1,64 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "shapes/shape.h"
+
+namespace USTC_CG
+{
+
+// Uniform grid over the bounding boxes of the shapes on a canvas, to find the
+// shapes near a point without visiting all of them. The canvas owns the shapes
+// and tells the index whenever one is added, changed, reordered or removed, so
+// that the index also knows the position of every shape in the canvas' list.
+class ShapeIndex
+{
+   public:
+    explicit ShapeIndex(float cell_size = 64.0f);
+
+    // Add a shape on top of all the others, at the end of the list.
+    void insert(const Shape* shape);
+    // Remove a shape, moving the ones above it down the list.
+    void remove(const Shape* shape);
+    // Recompute the bounding box of a shape after it has changed.
+    void update(const Shape* shape);
+    // Exchange the drawing order of two shapes.
+    void swap_order(const Shape* a, const Shape* b);
+    // Remove all the shapes.
+    void clear();
+
+    // The list position of the topmost shape selected by the point, or -1.
+    int pick(float x, float y) const;
+    // The shapes whose bounding boxes overlap the box, in drawing order.
+    void query(const Shape::Bounds& bounds, std::vector<const Shape*>& shapes)
+        const;
+
+   private:
+    // Shapes covering more cells than this are kept in one list instead.
+    static constexpr float kMaxCells = 1024;
+
+    struct Entry
+    {
+        Shape::Bounds bounds;
+        int position = 0;  // Position in the list, the larger drawn on top.
+        int cell_min[2] = { 0, 0 }, cell_max[2] = { 0, 0 };
+        bool large = false;  // Whether it is in large_shapes_.
+        mutable unsigned visit = 0;  // The last query that found it.
+    };
+
+    static long long cell_key(int x, int y);
+    // Compute the cells covered by the bounding box of the entry.
+    void locate(Entry& entry) const;
+    void link(const Shape* shape, const Entry& entry);
+    void unlink(const Shape* shape, const Entry& entry);
+
+    float cell_size_;
+    mutable unsigned query_count_ = 0;
+    std::unordered_map<const Shape*, Entry> entries_;
+    // Shapes whose bounding boxes overlap every cell.
+    std::unordered_map<long long, std::vector<const Shape*>> cells_;
+    std::vector<const Shape*> large_shapes_;
+};
+
+}  // namespace USTC_CG
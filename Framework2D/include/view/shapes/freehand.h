@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "shape.h"
@@ -11,13 +12,12 @@ class Freehand : public Shape
    public:
     Freehand() = default;
 
-    // Initializing with start coordinates
-    Freehand(float point_x, float point_y)
+    // Initializing with start coordinates, and the largest distance the
+    // simplified stroke may keep from the mouse (0 keeps every point)
+    Freehand(float point_x, float point_y, float tolerance = 0.0f)
+        : tolerance_(tolerance)
     {
-        points_x_.clear();
-        points_y_.clear();
-        points_x_.push_back(point_x);
-        points_y_.push_back(point_y);
+        add_point(point_x, point_y);
     }
 
     virtual ~Freehand() = default;
@@ -36,8 +36,48 @@ class Freehand : public Shape
 
     bool is_select_on(float x, float y) const override;
 
+    Bounds get_bounds() const override;
+
+    // Ends the drawing, and stores the points delta-encoded if compact
+    void finish(bool compact);
+
    private:
+    // Number of segments in a chunk
+    static constexpr int kChunkSize = 16;
+    // Deltas of the compact storage are in 1 / kDeltaScale pixels
+    static constexpr float kDeltaScale = 8.0f;
+    // Largest number of mouse samples replaced by one segment
+    static constexpr int kMaxSamples = 256;
+
+    // Append a point and grow the bounding boxes
+    void add_point(float x, float y);
+    // Move the last point and grow the bounding boxes
+    void move_last_point(float x, float y);
+    // Number of points, in either storage
+    int size() const;
+    // Append the coordinates (x, y, x, y...) of the points of a chunk
+    void get_chunk(int chunk, std::vector<float>& xy) const;
+    // Fit the bounding boxes to the points again
+    void compute_bounds();
+
     // A series of points that make up the freehand shape
     std::vector<float> points_x_, points_y_;
+    // Bounding box of all the points
+    Bounds bounds_;
+    // Bounding box of every chunk of kChunkSize segments, so that drawing and
+    // selecting skip the chunks far away. Chunk i holds the segments from
+    // point i * kChunkSize to point (i + 1) * kChunkSize.
+    std::vector<Bounds> chunk_bounds_;
+
+    // Simplification while drawing: the mouse samples after the second last
+    // point, all within tolerance_ of the last segment
+    float tolerance_ = 0.0f;
+    std::vector<float> samples_x_, samples_y_;
+
+    // Compact storage of a finished stroke, used instead of points_x_ and
+    // points_y_ when not empty: the first point of every chunk, and the
+    // offset of every other point from the previous one
+    std::vector<float> chunk_starts_;
+    std::vector<std::int16_t> deltas_;
 };
 }  // namespace USTC_CG
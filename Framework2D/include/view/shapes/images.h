@@ -35,6 +35,8 @@ class Images : public Shape
 
     bool is_select_on(float x, float y) const override;
 
+    Bounds get_bounds() const override;
+
    protected:
     std::string filename_;                 // Path to the image file.
     unsigned char* image_data_ = nullptr;  // Raw pixel data of the image.
@@ -38,6 +38,8 @@ class Line : public Shape
     
     bool is_select_on(float x, float y) const override;
 
+    Bounds get_bounds() const override;
+
    private:
     // Start and end coordinates of the line
     float start_point_x_, start_point_y_, end_point_x_, end_point_y_;
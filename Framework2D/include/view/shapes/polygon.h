@@ -42,6 +42,8 @@ class Polygon : public Shape
 
     bool is_select_on(float x, float y) const override;
 
+    Bounds get_bounds() const override;
+
    private:
     std::vector<float> points_x_,
         points_y_;  // A series of points that make up the polygon
@@ -39,6 +39,8 @@ class Rect : public Shape
 
     bool is_select_on(float x, float y) const override;
 
+    Bounds get_bounds() const override;
+
    private:
     // Coordinates of the top-left and bottom-right corners of the rectangle
     float start_point_x_ = 0.0f, start_point_y_ = 0.0f;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cmath>
+
 namespace USTC_CG
 {
 class Shape
@@ -26,6 +28,41 @@ class Shape
         float time = 0;
     } conf;
 
+    // Axis-aligned bounding box in canvas coordinates
+    struct Bounds
+    {
+        float min[2] = { 0.f, 0.f };
+        float max[2] = { 0.f, 0.f };
+
+        // Whether the point is in the box
+        bool contains(float x, float y) const
+        {
+            return min[0] <= x && x <= max[0] && min[1] <= y && y <= max[1];
+        }
+        // Whether the two boxes overlap
+        bool overlaps(const Bounds& other) const
+        {
+            return min[0] <= other.max[0] && other.min[0] <= max[0] &&
+                   min[1] <= other.max[1] && other.min[1] <= max[1];
+        }
+        // Grow the box to contain the point
+        void expand(float x, float y)
+        {
+            min[0] = x < min[0] ? x : min[0];
+            min[1] = y < min[1] ? y : min[1];
+            max[0] = x > max[0] ? x : max[0];
+            max[1] = y > max[1] ? y : max[1];
+        }
+        // Grow the box by the margin on every side
+        void inflate(float margin)
+        {
+            min[0] -= margin;
+            min[1] -= margin;
+            max[0] += margin;
+            max[1] += margin;
+        }
+    };
+
    public:
     virtual ~Shape() = default;
 
@@ -68,5 +105,28 @@ class Shape
      * @param x, y The point to be checked.
      */
     virtual bool is_select_on(float x, float y) const = 0;
+
+    /**
+     * Get the bounding box of the shape.
+     * The box contains everything the shape draws and every point on which
+     * is_select_on() returns true, so the canvas can skip the shape when a
+     * point or the visible area is outside of it.
+     *
+     * @return The bounding box in canvas coordinates.
+     */
+    virtual Bounds get_bounds() const = 0;
+
+   protected:
+    /**
+     * Get the distance within which a point selects the outline.
+     * It is wider than half of a thin line, so that thin lines are easy to
+     * select.
+     */
+    float select_tolerance() const
+    {
+        return conf.line_thickness * 0.5f *
+               (1.0f + 9 * std::exp(-(conf.line_thickness - 1.0f) *
+                                    (conf.line_thickness - 1.0f) / 4));
+    }
 };
 }  // namespace USTC_CG
\ No newline at end of file
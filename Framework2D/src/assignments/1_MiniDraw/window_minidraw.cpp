@@ -213,6 +213,26 @@ void MiniDraw::draw_canvas()
             p_canvas_->draw_filled = false;
         }
 
+        // 自由绘制时，设置简化笔画的宽容范围（0为不简化）和是否压缩存储
+        if (!p_canvas_->select_mode &&
+            p_canvas_->get_shape_type() == Canvas::ShapeType::kFreehand)
+        {
+            ImGui::SetNextItemWidth(0.4f * ImGui::GetColumnWidth());
+            ImGui::DragFloat(
+                "Tolerance",
+                &p_canvas_->freehand_tolerance,
+                0.01f,
+                0.0f,
+                10.0f,
+                "%.2f",
+                ImGuiSliderFlags_AlwaysClamp);
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(0.025f * ImGui::GetColumnWidth());
+            ImGui::Text("     ");
+            ImGui::SameLine();
+            ImGui::Checkbox("Compact", &p_canvas_->freehand_compact);
+        }
+
         // 对图像对象，若选中，设置图像大小和位置
         if (p_canvas_->select_mode &&
             p_canvas_->get_shape_type() == Canvas::ShapeType::kImage)
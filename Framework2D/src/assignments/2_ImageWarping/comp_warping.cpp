@@ -139,6 +139,20 @@ void CompWarping::set_warping_method(int method)
         case 2: warping_ = std::make_shared<WarpingRBF>(); break;
         default: warping_ = std::make_shared<WarpingFishEye>(); break;
     }
+    apply_rbf_options();
+}
+
+/**
+ * @brief Pass the RBF options to the current warping, if it is the RBF one, so
+ * that changing them takes effect on the next warping
+ */
+void CompWarping::apply_rbf_options()
+{
+    if (auto rbf = std::dynamic_pointer_cast<WarpingRBF>(warping_))
+    {
+        rbf->set_solver(rbf_solver);
+        rbf->set_support(rbf_support);
+    }
 }
 
 /**
@@ -158,14 +172,10 @@ void CompWarping::warping()
     // Create a new image to store the result
     Image warped_image(width, height, data_->channels());
     // Initialize the color of result image
-    for (int x = 0; x < width; x++)
-    {
-        for (int y = 0; y < height; y++)
-        {
-            warped_image.set_pixel(x, y, { 0, 0, 0, 255 });
-        }
-    }
+    warped_image.fill({ 0, 0, 0, 255 });
     // Apply warping function and store the result in warped_image
+    warping_->set_sampling(sampling);
+    warping_->set_grid_step(grid_step);
     warping_->warping(
         data_,
         warped_image,
@@ -173,7 +183,8 @@ void CompWarping::warping()
         end_points_,
         inverse_flag,
         fixgap_flag_ann,
-        fixgap_flag_neighbour);
+        fixgap_flag_neighbour,
+        fixgap_flag_push_pull);
     *data_ = std::move(warped_image);
     update();
 }
@@ -2,6 +2,7 @@
 
 #include "view/comp_image.h"
 #include "warping.h"
+#include "warping_rbf.h"
 
 namespace USTC_CG
 {
@@ -29,12 +30,24 @@ class CompWarping : public ImageEditor
 
     // Set warping method
     void set_warping_method(int method);
+    // Pass rbf_solver and rbf_support to the RBF warping, if it is the current
+    // method
+    void apply_rbf_options();
 
     // Whether to use the inverse warping function, default is false.
     bool inverse_flag = false;
     // Whether to fix the gaps in normal mode, default is false.
     bool fixgap_flag_ann = false;
     bool fixgap_flag_neighbour = false;
+    bool fixgap_flag_push_pull = false;
+    // How the inverse warping samples the original image
+    WarpEngine::Sampling sampling = WarpEngine::Sampling::kBilinear;
+    // Distance in pixels between the points where the mapping is evaluated
+    int grid_step = 8;
+    // How the RBF warping solves for its coefficients, and the radius of the
+    // compactly supported kernels in average spacings of the points
+    WarpingRBF::Solver rbf_solver = WarpingRBF::Solver::kAuto;
+    float rbf_support = 6.0f;
 
     // Whether to show the points
     bool flag_enable_selecting_points_ = false;
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "imgui.h"
+#include "view/image.h"
+
+namespace USTC_CG
+{
+// Resamples an image through a point mapping, shared by the IDW and RBF
+// warpings.
+//
+// The mapping is only evaluated on a coarse grid of nodes, every grid_step
+// pixels, and bilinearly interpolated in between: the IDW and RBF mappings
+// cost O(n) per evaluation and vary slowly, so this is much cheaper than one
+// evaluation per pixel and hardly visible. The rows are processed in parallel
+// when OpenMP is available.
+class WarpEngine
+{
+   public:
+    enum class Sampling
+    {
+        kNearest,
+        kBilinear,
+        kBicubic
+    };
+
+    // Maps a pixel position to another one, in pixels.
+    using Mapping = std::function<ImVec2(double, double)>;
+
+    // Mapped positions of the pixels of a width * height image.
+    class Field
+    {
+       public:
+        Field(int width, int height, int step, const Mapping& map)
+            : width_(width),
+              height_(height),
+              step_(std::max(step, 1)),
+              cols_(node_count(width, step_)),
+              rows_(node_count(height, step_)),
+              nodes_((std::size_t)cols_ * rows_)
+        {
+#pragma omp parallel for schedule(dynamic)
+            for (int j = 0; j < rows_; j++)
+            {
+                for (int i = 0; i < cols_; i++)
+                {
+                    nodes_[(std::size_t)j * cols_ + i] = map(
+                        node_position(i, width_), node_position(j, height_));
+                }
+            }
+        }
+
+        // Mapped positions of the width pixels of row y, interpolated between
+        // the nodes around them.
+        void row(int y, ImVec2* positions) const
+        {
+            int j0 = y / step_;
+            int j1 = std::min(j0 + 1, rows_ - 1);
+            float ty = weight(y, j0, j1, height_);
+            const ImVec2* top = &nodes_[(std::size_t)j0 * cols_];
+            const ImVec2* bottom = &nodes_[(std::size_t)j1 * cols_];
+            ImVec2 left(
+                top[0].x + (bottom[0].x - top[0].x) * ty,
+                top[0].y + (bottom[0].y - top[0].y) * ty);
+            for (int i = 0; i + 1 < cols_; i++)
+            {
+                ImVec2 right(
+                    top[i + 1].x + (bottom[i + 1].x - top[i + 1].x) * ty,
+                    top[i + 1].y + (bottom[i + 1].y - top[i + 1].y) * ty);
+                int x0 = node_position(i, width_);
+                int x1 = node_position(i + 1, width_);
+                float scale = 1.0f / (float)(x1 - x0);
+                for (int x = x0; x < x1; x++)
+                {
+                    float tx = (float)(x - x0) * scale;
+                    positions[x] = ImVec2(
+                        left.x + (right.x - left.x) * tx,
+                        left.y + (right.y - left.y) * tx);
+                }
+                left = right;
+            }
+            positions[width_ - 1] = left;
+        }
+
+       private:
+        // Nodes at 0, step, 2 * step, ..., and on the last pixel.
+        static int node_count(int size, int step)
+        {
+            return size <= 1 ? 1 : (size - 2) / step + 2;
+        }
+        int node_position(int i, int size) const
+        {
+            return std::min(i * step_, std::max(size - 1, 0));
+        }
+        float weight(int p, int i0, int i1, int size) const
+        {
+            int p0 = node_position(i0, size), p1 = node_position(i1, size);
+            return p1 > p0 ? (float)(p - p0) / (float)(p1 - p0) : 0.0f;
+        }
+
+        int width_, height_, step_, cols_, rows_;
+        std::vector<ImVec2> nodes_;
+    };
+
+    void set_sampling(Sampling sampling)
+    {
+        sampling_ = sampling;
+    }
+    Sampling sampling() const
+    {
+        return sampling_;
+    }
+    // Distance between the nodes where the mapping is evaluated, 1 evaluates
+    // it on every pixel.
+    void set_grid_step(int step)
+    {
+        grid_step_ = std::max(step, 1);
+    }
+    int grid_step() const
+    {
+        return grid_step_;
+    }
+
+    // Mapped positions of the pixels of a width * height image.
+    Field field(int width, int height, const Mapping& map) const
+    {
+        return Field(width, height, grid_step_, map);
+    }
+
+    /**
+     * @brief Inverse warping: every pixel p of dst is sampled from src at
+     * map(p). Pixels mapped outside of src are left unchanged.
+     * @param src The original image.
+     * @param dst The result image. Only the channels both images have are
+     * written.
+     * @param map The mapping from result to original pixel positions.
+     */
+    void warp(const Image& src, Image& dst, const Mapping& map) const
+    {
+        Field positions = field(dst.width(), dst.height(), map);
+        int width = dst.width();
+        int height = dst.height();
+        int channels = std::min(src.channels(), dst.channels());
+
+#pragma omp parallel
+        {
+            std::vector<ImVec2> row(width);
+#pragma omp for schedule(dynamic)
+            for (int y = 0; y < height; y++)
+            {
+                positions.row(y, row.data());
+                unsigned char* pixel = dst.row(y);
+                for (int x = 0; x < width; x++, pixel += dst.channels())
+                {
+                    const ImVec2& p = row[x];
+                    if (p.x >= 0 && p.x < src.width() && p.y >= 0 &&
+                        p.y < src.height())
+                    {
+                        sample(src, p.x, p.y, pixel, channels);
+                    }
+                }
+            }
+        }
+    }
+
+   private:
+    // Sample the first channels of src at (x, y) into pixel. The pixel centers
+    // are at integer positions, and (x, y) is inside of the image.
+    void sample(
+        const Image& src,
+        float x,
+        float y,
+        unsigned char* pixel,
+        int channels) const
+    {
+        switch (sampling_)
+        {
+            case Sampling::kNearest:
+            {
+                // Truncated, as the forward warping does.
+                const unsigned char* source = src.pixel_ptr((int)x, (int)y);
+                std::copy(source, source + channels, pixel);
+                break;
+            }
+            case Sampling::kBilinear:
+                sample_bilinear(src, x, y, pixel, channels);
+                break;
+            case Sampling::kBicubic:
+                sample_bicubic(src, x, y, pixel, channels);
+                break;
+        }
+    }
+
+    static void sample_bilinear(
+        const Image& src,
+        float x,
+        float y,
+        unsigned char* pixel,
+        int channels)
+    {
+        int x0 = (int)x, y0 = (int)y;
+        int x1 = std::min(x0 + 1, src.width() - 1);
+        int y1 = std::min(y0 + 1, src.height() - 1);
+        float tx = x - x0, ty = y - y0;
+        const unsigned char* p00 = src.pixel_ptr(x0, y0);
+        const unsigned char* p10 = src.pixel_ptr(x1, y0);
+        const unsigned char* p01 = src.pixel_ptr(x0, y1);
+        const unsigned char* p11 = src.pixel_ptr(x1, y1);
+        for (int c = 0; c < channels; c++)
+        {
+            float top = p00[c] + (p10[c] - p00[c]) * tx;
+            float bottom = p01[c] + (p11[c] - p01[c]) * tx;
+            pixel[c] = (unsigned char)(top + (bottom - top) * ty + 0.5f);
+        }
+    }
+
+    // Catmull-Rom spline through the 4 * 4 nearest pixels, clamped at the
+    // borders of the image.
+    static void sample_bicubic(
+        const Image& src,
+        float x,
+        float y,
+        unsigned char* pixel,
+        int channels)
+    {
+        int x0 = (int)x, y0 = (int)y;
+        float wx[4], wy[4];
+        catmull_rom_weights(x - x0, wx);
+        catmull_rom_weights(y - y0, wy);
+        int xs[4], ys[4];
+        for (int k = 0; k < 4; k++)
+        {
+            xs[k] = std::clamp(x0 - 1 + k, 0, src.width() - 1);
+            ys[k] = std::clamp(y0 - 1 + k, 0, src.height() - 1);
+        }
+        for (int c = 0; c < channels; c++)
+        {
+            float value = 0;
+            for (int j = 0; j < 4; j++)
+            {
+                float row = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    row += wx[i] * src.pixel_ptr(xs[i], ys[j])[c];
+                }
+                value += wy[j] * row;
+            }
+            pixel[c] = (unsigned char)std::clamp(value + 0.5f, 0.0f, 255.0f);
+        }
+    }
+
+    static void catmull_rom_weights(float t, float w[4])
+    {
+        float t2 = t * t, t3 = t2 * t;
+        w[0] = 0.5f * (-t3 + 2 * t2 - t);
+        w[1] = 0.5f * (3 * t3 - 5 * t2 + 2);
+        w[2] = 0.5f * (-3 * t3 + 4 * t2 + t);
+        w[3] = 0.5f * (t3 - t2);
+    }
+
+    Sampling sampling_ = Sampling::kBilinear;
+    int grid_step_ = 8;
+};
+}  // namespace USTC_CG
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cmath>
 #include <memory>
 #include <vector>
 
+#include "annoylib.h"
 #include "imgui.h"
+#include "kissrandom.h"
 #include "view/image.h"
+#include "warp_engine.h"
 
 namespace USTC_CG
 {
@@ -23,6 +27,421 @@ class Warping
         std::vector<ImVec2> &end_points,
         bool Inverse_Flag = false,
         bool Fixgap_Flag_ANN = false,
-        bool Fixgap_Flag_Neighbour = false) = 0;
+        bool Fixgap_Flag_Neighbour = false,
+        bool Fixgap_Flag_PushPull = false) = 0;
+
+    // How the inverse warping samples the original image
+    void set_sampling(WarpEngine::Sampling sampling)
+    {
+        engine_.set_sampling(sampling);
+    }
+    // Distance in pixels between the points where the mapping is evaluated
+    void set_grid_step(int step)
+    {
+        engine_.set_grid_step(step);
+    }
+
+   protected:
+    /**
+     * @brief Forward warping: copy every pixel p of src to map(p) in dst.
+     * @param src The original image.
+     * @param dst The result image.
+     * @param map The mapping from original to result pixel positions.
+     * @param painted Set to whether each pixel of dst was written, row by row.
+     */
+    void scatter(
+        const Image &src,
+        Image &dst,
+        const WarpEngine::Mapping &map,
+        std::vector<bool> &painted) const
+    {
+        int width = dst.width();
+        int height = dst.height();
+        painted.assign((std::size_t)width * height, false);
+
+        WarpEngine::Field positions =
+            engine_.field(src.width(), src.height(), map);
+        std::vector<ImVec2> row(src.width());
+        // Serial, since several pixels may land on the same one.
+        for (int old_y = 0; old_y < src.height(); old_y++)
+        {
+            positions.row(old_y, row.data());
+            for (int old_x = 0; old_x < src.width(); old_x++)
+            {
+                const ImVec2 &p = row[old_x];
+                if (p.x >= 0 && p.x < width && p.y >= 0 && p.y < height)
+                {
+                    dst.copy_pixel((int)p.x, (int)p.y, src, old_x, old_y);
+                    painted[(int)p.y * width + (int)p.x] = true;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief The distance to search for painted pixels when fixing the gaps,
+     * to avoid painting areas out of sight. Choose the maximum distance as the
+     * zoom ratio.
+     */
+    static double gap_distance(
+        const std::vector<ImVec2> &start_points,
+        const std::vector<ImVec2> &end_points,
+        int width,
+        int height)
+    {
+        int n = (int)start_points.size();
+        double oldmindis = (width > height ? width : height), newmaxdis = 0;
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                double dis = std::sqrt(
+                    std::pow(start_points[i].x - start_points[j].x, 2) +
+                    std::pow(start_points[i].y - start_points[j].y, 2));
+                if (dis != 0 && dis < oldmindis)
+                {
+                    oldmindis = dis;
+                }
+            }
+        }
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                double dis = std::sqrt(
+                    std::pow(end_points[i].x - end_points[j].x, 2) +
+                    std::pow(end_points[i].y - end_points[j].y, 2));
+                if (dis > newmaxdis)
+                {
+                    newmaxdis = dis;
+                }
+            }
+        }
+        return newmaxdis / oldmindis;
+    }
+
+    /**
+     * @brief Fill the pixels the forward warping didn't paint with the most
+     * frequent color of the painted pixels around them.
+     * @param image The result image of scatter().
+     * @param painted Whether each pixel of image was painted.
+     * @param max_distance How far to search for painted pixels.
+     * @param Fixgap_Flag_ANN Whether to search the 3 nearest painted pixels.
+     * @param Fixgap_Flag_Neighbour Whether to search all painted pixels in a
+     * square of size max_distance.
+     * @param Fixgap_Flag_PushPull Whether to use push_pull() instead.
+     */
+    static void fix_gaps(
+        Image &image,
+        const std::vector<bool> &painted,
+        double max_distance,
+        bool Fixgap_Flag_ANN,
+        bool Fixgap_Flag_Neighbour,
+        bool Fixgap_Flag_PushPull)
+    {
+        if (Fixgap_Flag_PushPull)
+        {
+            push_pull(image, painted, max_distance);
+            return;
+        }
+
+        int width = image.width();
+        int height = image.height();
+
+        // Count the colors of the found pixels, and give the most frequent one
+        // to the gap pixel
+        std::vector<unsigned char> red, green, blue;
+        std::vector<int> cnt;
+        auto count_color = [&](const unsigned char *pixel)
+        {
+            for (std::size_t m = 0; m < cnt.size(); m++)
+            {
+                if (pixel[0] == red[m] && pixel[1] == green[m] &&
+                    pixel[2] == blue[m])
+                {
+                    cnt[m]++;
+                    return;
+                }
+            }
+            red.push_back(pixel[0]);
+            green.push_back(pixel[1]);
+            blue.push_back(pixel[2]);
+            cnt.push_back(1);
+        };
+        auto paint_most_frequent = [&](int x, int y)
+        {
+            int maxcnt = 0, maxindex = -1;
+            for (std::size_t l = 0; l < cnt.size(); l++)
+            {
+                if (cnt[l] > maxcnt)
+                {
+                    maxcnt = cnt[l];
+                    maxindex = (int)l;
+                }
+            }
+            if (maxindex != -1)
+            {
+                image.set_pixel_array<3>(
+                    x, y, { red[maxindex], green[maxindex], blue[maxindex] });
+            }
+            red.clear();
+            green.clear();
+            blue.clear();
+            cnt.clear();
+        };
+
+        // Fix the gap by ann method
+        if (Fixgap_Flag_ANN)
+        {
+            Annoy::AnnoyIndex<
+                int,
+                float,
+                Annoy::Euclidean,
+                Annoy::Kiss32Random,
+                Annoy::AnnoyIndexSingleThreadedBuildPolicy>
+                index(2);
+            int indexcnt = 0;
+            for (int j = 0; j < height; j++)
+            {
+                for (int i = 0; i < width; i++)
+                {
+                    if (painted[j * width + i])
+                    {
+                        // Choose id as y * width + x, to easily find out the
+                        // pixel by id
+                        float p[2] = { (float)i, (float)j };
+                        index.add_item(j * width + i, p);
+                        indexcnt++;
+                    }
+                }
+            }
+            if (indexcnt)
+            {
+                // Build the index, the height of the tree is log2(indexcnt)
+                index.build((int)log2(indexcnt));
+
+                int k = 3;  // search k nearest points
+                std::vector<int> closest_points;
+                std::vector<float> distances;
+                for (int i = 0; i < width; i++)
+                {
+                    for (int j = 0; j < height; j++)
+                    {
+                        if (painted[j * width + i])
+                        {
+                            continue;
+                        }
+                        float p[2] = { (float)i, (float)j };
+                        index.get_nns_by_vector(
+                            p, k, -1, &closest_points, &distances);
+                        for (std::size_t l = 0; l < distances.size(); l++)
+                        {
+                            if (distances[l] > max_distance)
+                            {
+                                break;
+                            }
+                            count_color(image.pixel_ptr(
+                                closest_points[l] % width,
+                                closest_points[l] / width));
+                        }
+                        paint_most_frequent(i, j);
+                        closest_points.clear();
+                        distances.clear();
+                    }
+                }
+            }
+            index.unbuild();
+            index.reinitialize();
+        }
+
+        if (Fixgap_Flag_Neighbour)
+        {
+            int radius = (int)(max_distance / 2);
+            for (int i = 0; i < width; i++)
+            {
+                for (int j = 0; j < height; j++)
+                {
+                    if (painted[j * width + i])
+                    {
+                        continue;
+                    }
+                    // Search the painted pixels within the max_distance
+                    for (int x = std::max(i - radius, 0);
+                         x <= std::min(i + radius, width - 1);
+                         x++)
+                    {
+                        for (int y = std::max(j - radius, 0);
+                             y <= std::min(j + radius, height - 1);
+                             y++)
+                        {
+                            if (painted[y * width + x])
+                            {
+                                count_color(image.pixel_ptr(x, y));
+                            }
+                        }
+                    }
+                    paint_most_frequent(i, j);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Fill the gaps in linear time, with a pyramid of the painted
+     * pixels: every level averages the painted pixels of 2 * 2 pixels of the
+     * level below ("pull"), then the gaps take their color from the coarsest
+     * level that has one, down to the original size ("push").
+     *
+     * The pyramid has just enough levels for gaps of max_distance pixels, so
+     * that the areas out of sight are left black, as with the other methods.
+     * Only the pyramid above the image is stored, a third of its pixels.
+     * @param image The result image of scatter().
+     * @param painted Whether each pixel of image was painted.
+     * @param max_distance The size of the largest gaps to fill.
+     */
+    static void push_pull(
+        Image &image,
+        const std::vector<bool> &painted,
+        double max_distance)
+    {
+        int channels = image.channels();
+        int depth = 1 + (int)std::ceil(std::log2(std::max(max_distance, 1.0)));
+
+        // Average color and min(1, sum of the weights) of the pixels of a
+        // level, row by row. 0 weight means no painted pixel below.
+        struct Level
+        {
+            Level(int width, int height, int channels)
+                : width(width),
+                  height(height),
+                  color((std::size_t)width * height * channels, 0.0f),
+                  weight((std::size_t)width * height, 0.0f)
+            {
+            }
+            int width, height;
+            std::vector<float> color, weight;
+        };
+        std::vector<Level> levels;
+
+        // Pull: level 0 is the image, painted pixels have weight 1
+        int width = image.width(), height = image.height();
+        for (int k = 0; k < depth && (width > 1 || height > 1); k++)
+        {
+            Level level((width + 1) / 2, (height + 1) / 2, channels);
+            const Level *below = levels.empty() ? nullptr : &levels.back();
+
+#pragma omp parallel for
+            for (int y = 0; y < level.height; y++)
+            {
+                std::vector<float> sum(channels);
+                for (int x = 0; x < level.width; x++)
+                {
+                    std::fill(sum.begin(), sum.end(), 0.0f);
+                    float weight = 0;
+                    int y_end = std::min(2 * y + 2, height);
+                    int x_end = std::min(2 * x + 2, width);
+                    for (int cy = 2 * y; cy < y_end; cy++)
+                    {
+                        for (int cx = 2 * x; cx < x_end; cx++)
+                        {
+                            std::size_t child = (std::size_t)cy * width + cx;
+                            if (below == nullptr)
+                            {
+                                if (!painted[child])
+                                {
+                                    continue;
+                                }
+                                const unsigned char *pixel =
+                                    image.pixel_ptr(cx, cy);
+                                for (int c = 0; c < channels; c++)
+                                {
+                                    sum[c] += pixel[c];
+                                }
+                                weight += 1;
+                            }
+                            else
+                            {
+                                float w = below->weight[child];
+                                for (int c = 0; c < channels; c++)
+                                {
+                                    sum[c] +=
+                                        w * below->color[child * channels + c];
+                                }
+                                weight += w;
+                            }
+                        }
+                    }
+                    std::size_t index = (std::size_t)y * level.width + x;
+                    if (weight > 0)
+                    {
+                        for (int c = 0; c < channels; c++)
+                        {
+                            level.color[index * channels + c] = sum[c] / weight;
+                        }
+                    }
+                    level.weight[index] = std::min(weight, 1.0f);
+                }
+            }
+            width = level.width;
+            height = level.height;
+            levels.push_back(std::move(level));
+        }
+
+        // Push: blend every pixel that isn't fully covered with its parent,
+        // when the parent has a color
+        for (int k = (int)levels.size() - 2; k >= 0; k--)
+        {
+            Level &level = levels[k];
+            const Level &parent = levels[k + 1];
+#pragma omp parallel for
+            for (int y = 0; y < level.height; y++)
+            {
+                for (int x = 0; x < level.width; x++)
+                {
+                    std::size_t index = (std::size_t)y * level.width + x;
+                    std::size_t up =
+                        (std::size_t)(y / 2) * parent.width + x / 2;
+                    float w = level.weight[index];
+                    if (w >= 1 || parent.weight[up] == 0)
+                    {
+                        continue;
+                    }
+                    for (int c = 0; c < channels; c++)
+                    {
+                        float &color = level.color[index * channels + c];
+                        color = w * color +
+                                (1 - w) * parent.color[up * channels + c];
+                    }
+                    level.weight[index] = 1;
+                }
+            }
+        }
+        if (levels.empty())
+        {
+            return;
+        }
+        const Level &parent = levels.front();
+#pragma omp parallel for
+        for (int y = 0; y < image.height(); y++)
+        {
+            for (int x = 0; x < image.width(); x++)
+            {
+                std::size_t up = (std::size_t)(y / 2) * parent.width + x / 2;
+                if (painted[(std::size_t)y * image.width() + x] ||
+                    parent.weight[up] == 0)
+                {
+                    continue;
+                }
+                unsigned char *pixel = image.pixel_ptr(x, y);
+                for (int c = 0; c < channels; c++)
+                {
+                    pixel[c] =
+                        (unsigned char)(parent.color[up * channels + c] + 0.5f);
+                }
+            }
+        }
+    }
+
+    WarpEngine engine_;
 };
-}  // namespace USTC_CG
\ No newline at end of file
+}  // namespace USTC_CG
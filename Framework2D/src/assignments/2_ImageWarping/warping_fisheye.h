@@ -2,8 +2,6 @@
 
 #include <cmath>
 
-#include "annoylib.h"
-#include "kissrandom.h"
 #include "warping.h"
 
 namespace USTC_CG
@@ -25,6 +23,7 @@ class WarpingFishEye : public Warping
      * @param Inverse_Flag Whether to use the inverse warping function.
      * @param Fixgap_Flag_ANN Whether to fix the gaps using ann method.
      * @param Fixgap_Flag_Neighbour Whether to fix the gaps using neighbour
+     * @param Fixgap_Flag_PushPull Whether to fix the gaps using push-pull
      */
     void warping(
         std::shared_ptr<Image> &data_,
@@ -33,7 +32,8 @@ class WarpingFishEye : public Warping
         std::vector<ImVec2> &end_points,
         bool Inverse_Flag = false,
         bool Fixgap_Flag_ANN = false,
-        bool Fixgap_Flag_Neighbour = false) override
+        bool Fixgap_Flag_Neighbour = false,
+        bool Fixgap_Flag_PushPull = false) override
     {
         // Example: (simplified) "fish-eye" warping
         // For each (x, y) from the input image, the "fish-eye" warping transfer
@@ -44,16 +44,6 @@ class WarpingFishEye : public Warping
         int width = data_->width();
         int height = data_->height();
 
-        // Fix the gap by ann method
-        Annoy::AnnoyIndex<
-            int,
-            float,
-            Annoy::Euclidean,
-            Annoy::Kiss32Random,
-            Annoy::AnnoyIndexSingleThreadedBuildPolicy>
-            index(2);
-        int indexcnt = 0;
-
         // Detect which new pixel is painted
         std::vector<bool> painted(width * height, false);
 
@@ -96,15 +86,6 @@ class WarpingFishEye : public Warping
                         warped_image.set_pixel(
                             new_x, new_y, data_->get_pixel(old_x, old_y));
                         painted[new_y * width + new_x] = true;
-                        if (Fixgap_Flag_ANN == true)
-                        {
-                            float p[2] = { (float)new_x, (float)new_y };
-                            // Add the painted pixel to the index. Choose id
-                            // as y * width + x, to easily find out the
-                            // pixel by id
-                            index.add_item(new_y * width + new_x, p);
-                            indexcnt++;
-                        }
                     }
                 }
                 else
@@ -136,165 +117,17 @@ class WarpingFishEye : public Warping
             }
         }
 
-        // Fix the gap using ann method
-        if (Fixgap_Flag_ANN == true && indexcnt)
+        // Fix the gaps of the forward warping, searching 2 pixels away at most
+        // to avoid painting at non-sight area
+        if (Inverse_Flag == false)
         {
-            // Build the index, the height of the tree is log2(indexcnt)
-            index.build((int)log2(indexcnt));
-
-            float max_distance = 2.0f;
-            // max distance to search, avoid paint at non-sight area
-
-            int k = 3;  // search k nearest points
-            std::vector<int> closest_points;
-            std::vector<float> distances;
-            for (int i = 0; i < width; i++)
-            {
-                for (int j = 0; j < height; j++)
-                {
-                    if (painted[j * width + i])
-                    {
-                        // Painted, continue
-                        continue;
-                    }
-
-                    // search the k nearest points for each new pixel
-                    float p[2] = { (float)i, (float)j };
-                    index.get_nns_by_vector(
-                        p, k, -1, &closest_points, &distances);
-
-                    std::vector<unsigned char> red(0), green(0), blue(0);
-                    std::vector<int> cnt(0);
-                    for (int l = 0; l < distances.size(); l++)
-                    {
-                        if (distances[l] > max_distance)
-                        {
-                            break;
-                        }
-                        // Within the max distance, count the color
-                        std::vector<unsigned char> pixel =
-                            warped_image.get_pixel(
-                                closest_points[l] % width,
-                                closest_points[l] / width);
-                        bool flag = false;
-                        for (int m = 0; m < cnt.size(); m++)
-                        {
-                            if (pixel[0] == red[m] && pixel[1] == green[m] &&
-                                pixel[2] == blue[m])
-                            {
-                                flag = true;
-                                cnt[m]++;
-                                break;
-                            }
-                        }
-                        if (flag == false)
-                        {
-                            red.push_back(pixel[0]);
-                            green.push_back(pixel[1]);
-                            blue.push_back(pixel[2]);
-                            cnt.push_back(1);
-                        }
-                    }
-
-                    // find the most frequent color and give it to the gap pixel
-                    int maxcnt = 0, maxindex = -1;
-                    for (int l = 0; l < cnt.size(); l++)
-                    {
-                        if (cnt[l] > maxcnt)
-                        {
-                            maxcnt = cnt[l];
-                            maxindex = l;
-                        }
-                    }
-                    if (maxindex != -1)
-                    {
-                        std::vector<unsigned char> pixel = { red[maxindex],
-                                                             green[maxindex],
-                                                             blue[maxindex] };
-                        warped_image.set_pixel(i, j, pixel);
-                    }
-                    closest_points.clear();
-                    distances.clear();
-                }
-            }
-        }
-        index.unbuild();
-        index.reinitialize();
-
-        if (Fixgap_Flag_Neighbour == true)
-        {
-            int max_distance = 2;
-            for (int i = 0; i < width; i++)
-            {
-                for (int j = 0; j < height; j++)
-                {
-                    if (painted[j * width + i])
-                    {
-                        continue;
-                    }
-                    std::vector<unsigned char> red(0), green(0), blue(0);
-                    std::vector<int> cnt(0);
-
-                    // Search the painted pixels within the max_distance
-                    for (int x = i - max_distance / 2;
-                         x <= i + max_distance / 2;
-                         x++)
-                    {
-                        for (int y = j - max_distance / 2;
-                             y <= j + max_distance / 2;
-                             y++)
-                        {
-                            if (x < 0 || x >= width || y < 0 || y >= height)
-                            {
-                                continue;
-                            }
-                            if (painted[y * width + x])
-                            {
-                                std::vector<unsigned char> pixel =
-                                    warped_image.get_pixel(x, y);
-                                bool flag = false;
-                                for (int m = 0; m < cnt.size(); m++)
-                                {
-                                    if (pixel[0] == red[m] &&
-                                        pixel[1] == green[m] &&
-                                        pixel[2] == blue[m])
-                                    {
-                                        flag = true;
-                                        cnt[m]++;
-                                        break;
-                                    }
-                                }
-                                if (flag == false)
-                                {
-                                    red.push_back(pixel[0]);
-                                    green.push_back(pixel[1]);
-                                    blue.push_back(pixel[2]);
-                                    cnt.push_back(1);
-                                }
-                            }
-                        }
-                    }
-
-                    // find the most frequent color and give it to the gap
-                    // pixel
-                    int maxcnt = 0, maxindex = -1;
-                    for (int l = 0; l < cnt.size(); l++)
-                    {
-                        if (cnt[l] > maxcnt)
-                        {
-                            maxcnt = cnt[l];
-                            maxindex = l;
-                        }
-                    }
-                    if (maxindex != -1)
-                    {
-                        std::vector<unsigned char> pixel = { red[maxindex],
-                                                             green[maxindex],
-                                                             blue[maxindex] };
-                        warped_image.set_pixel(i, j, pixel);
-                    }
-                }
-            }
+            fix_gaps(
+                warped_image,
+                painted,
+                2.0,
+                Fixgap_Flag_ANN,
+                Fixgap_Flag_Neighbour,
+                Fixgap_Flag_PushPull);
         }
     }
 };
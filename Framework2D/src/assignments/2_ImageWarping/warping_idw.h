@@ -22,6 +22,7 @@ class WarpingIDW : public Warping
      * @param Inverse_Flag Whether to use the inverse warping function.
      * @param Fixgap_Flag_ANN Whether to fix the gaps using ann method.
      * @param Fixgap_Flag_Neighbour Whether to fix the gaps using neighbour
+     * @param Fixgap_Flag_PushPull Whether to fix the gaps using push-pull
      */
     void warping(
         std::shared_ptr<Image> &data_,
@@ -30,7 +31,8 @@ class WarpingIDW : public Warping
         std::vector<ImVec2> &end_points,
         bool Inverse_Flag = false,
         bool Fixgap_Flag_ANN = false,
-        bool Fixgap_Flag_Neighbour = false) override
+        bool Fixgap_Flag_Neighbour = false,
+        bool Fixgap_Flag_PushPull = false) override
     {
         /**
          * Given f(p_i) = (q_i), Use f(p) = Sum_i (w_i(p) * f_i(p)).
@@ -84,23 +86,69 @@ class WarpingIDW : public Warping
          * Having D_i, we can calculate f(p), which is the result of warping.
          */
 
-        // Calculate a function that maps the end points to the start points,
-        // for Inverse_Flag
-        if (Inverse_Flag)
-        {
-            std::swap(start_points, end_points);
-        }
 
         int n = (int)start_points.size();
-        int width = data_->width();
-        int height = data_->height();
-        double mu = 2;
 
         // If no start points, return the original image
         if (n == 0)
         {
             warped_image = *data_;
+            return;
+        }
+
+        // Calculate a function that maps the end points to the start points,
+        // for Inverse_Flag. With two points the gaps are fixed by inverse
+        // method, the result is identical to ANN or Neighbour theoretically.
+        bool fix_gaps_flag =
+            Fixgap_Flag_ANN || Fixgap_Flag_Neighbour || Fixgap_Flag_PushPull;
+        bool inverse = Inverse_Flag || (n == 2 && fix_gaps_flag);
+        if (inverse)
+        {
+            std::swap(start_points, end_points);
+        }
+
+        WarpEngine::Mapping map = fit(start_points, end_points);
+        if (inverse)
+        {
+            // The difference of inverse: calculate what pixel the new one is
+            // originated from.
+            engine_.warp(*data_, warped_image, map);
+            std::swap(start_points, end_points);
+        }
+        else
+        {
+            std::vector<bool> painted;
+            scatter(*data_, warped_image, map, painted);
+            // Only more than two points may leave gaps
+            if (n > 2)
+            {
+                fix_gaps(
+                    warped_image,
+                    painted,
+                    gap_distance(
+                        start_points,
+                        end_points,
+                        data_->width(),
+                        data_->height()),
+                    Fixgap_Flag_ANN,
+                    Fixgap_Flag_Neighbour,
+                    Fixgap_Flag_PushPull);
+            }
         }
+    }
+
+   private:
+    /**
+     * @brief Compute f, which maps the start points to the end points.
+     * @param start_points The start points p_i, at least one.
+     * @param end_points The end points q_i.
+     */
+    static WarpEngine::Mapping fit(
+        const std::vector<ImVec2> &start_points,
+        const std::vector<ImVec2> &end_points)
+    {
+        int n = (int)start_points.size();
+        double mu = 2;
 
         // If there is only one start point: w_1(p) = 1, f_1(p) = q_1 + D_1(p -
         // p_1), f(p) = f_1(p), nothing to minimize. In this situation, we can
@@ -109,38 +157,17 @@ class WarpingIDW : public Warping
         // If following steps below, we can get D_1 = 0, not suitable.
         // For it is an identity transformation, there is no need to fix the
         // gap.
-        else if (n == 1)
+        if (n == 1)
         {
-            for (int old_x = 0; old_x < width; old_x++)
-            {
-                for (int old_y = 0; old_y < height; old_y++)
-                {
-                    int new_x =
-                        (int)(old_x + end_points[0].x - start_points[0].x);
-                    int new_y =
-                        (int)(old_y + end_points[0].y - start_points[0].y);
-                    if (Inverse_Flag == false)
-                    {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                new_x, new_y, data_->get_pixel(old_x, old_y));
-                        }
-                    }
-                    else
-                    {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                old_x, old_y, data_->get_pixel(new_x, new_y));
-                        }
-                    }
-                }
-            }
+            double dx = end_points[0].x - start_points[0].x;
+            double dy = end_points[0].y - start_points[0].y;
+            return [dx, dy](double x, double y)
+            { return ImVec2((float)(x + dx), (float)(y + dy)); };
         }
 
+        // Copies, for the mapping outlives the arguments
+        std::vector<ImVec2> p = start_points, q = end_points;
+
         // If there are only two start points, D_1 = D_2 are not unique, leading
         // to a line shape. So we can set D_1 = D_2 = diag(d_1, d_2), where d_1
         // and d_2 are calculated by minimizing the square error. Minimize
@@ -159,76 +186,12 @@ class WarpingIDW : public Warping
         // + sigma_2(p)).
         // For there are maybe some expanded pixels, we need to fix the gap.
         // Inverse way would be effective.
-        else if (n == 2)
+        std::vector<Eigen::Matrix2d> d_matrix(n, Eigen::Matrix2d::Zero());
+        if (n == 2)
         {
-            // Fix the gap by inverse method, the result is identical to ANN or
-            // Neighbour theoretically
-            if ((Fixgap_Flag_ANN == true || Fixgap_Flag_Neighbour == true) &&
-                Inverse_Flag == false)
-            {
-                std::swap(start_points, end_points);
-            }
-
-            double d_1 = (end_points[1].x - end_points[0].x) /
-                         (start_points[1].x - start_points[0].x);
-            double d_2 = (end_points[1].y - end_points[0].y) /
-                         (start_points[1].y - start_points[0].y);
-            for (int old_x = 0; old_x < width; old_x++)
-            {
-                for (int old_y = 0; old_y < height; old_y++)
-                {
-                    double sigma_1 =
-                        1 / std::pow(
-                                std::sqrt(
-                                    std::pow(old_x - start_points[0].x, 2) +
-                                    std::pow(old_y - start_points[0].y, 2)),
-                                mu);
-                    double sigma_2 =
-                        1 / std::pow(
-                                std::sqrt(
-                                    std::pow(old_x - start_points[1].x, 2) +
-                                    std::pow(old_y - start_points[1].y, 2)),
-                                mu);
-                    int new_x = (int)(sigma_1 / (sigma_1 + sigma_2) *
-                                          (end_points[0].x +
-                                           d_1 * (old_x - start_points[0].x)) +
-                                      sigma_2 / (sigma_1 + sigma_2) *
-                                          (end_points[1].x +
-                                           d_1 * (old_x - start_points[1].x)));
-                    int new_y = (int)(sigma_1 / (sigma_1 + sigma_2) *
-                                          (end_points[0].y +
-                                           d_2 * (old_y - start_points[0].y)) +
-                                      sigma_2 / (sigma_1 + sigma_2) *
-                                          (end_points[1].y +
-                                           d_2 * (old_y - start_points[1].y)));
-
-                    if (Inverse_Flag == true || Fixgap_Flag_ANN == true ||
-                        Fixgap_Flag_Neighbour == true)
-                    {
-                        // Inverse way
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                old_x, old_y, data_->get_pixel(new_x, new_y));
-                        }
-                    }
-                    else
-                    {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                new_x, new_y, data_->get_pixel(old_x, old_y));
-                        }
-                    }
-                }
-            }
-            if ((Fixgap_Flag_ANN == true || Fixgap_Flag_Neighbour == true) &&
-                Inverse_Flag == false)
-            {
-                std::swap(start_points, end_points);
-            }
+            double d_1 = (q[1].x - q[0].x) / (p[1].x - p[0].x);
+            double d_2 = (q[1].y - q[0].y) / (p[1].y - p[0].y);
+            d_matrix[0] = d_matrix[1] = Eigen::Vector2d(d_1, d_2).asDiagonal();
         }
 
         // If there are more than two points, there is no need to specially deal
@@ -238,411 +201,74 @@ class WarpingIDW : public Warping
         // picture. This shows the difference between normal and inverse way.
         else
         {
-            // Fix the gap by ann method
-            Annoy::AnnoyIndex<
-                int,
-                float,
-                Annoy::Euclidean,
-                Annoy::Kiss32Random,
-                Annoy::AnnoyIndexSingleThreadedBuildPolicy>
-                index(2);
-            int indexcnt = 0;
-
-            // Calculate the distance between start points (p_i, p_j)
-            Eigen::MatrixXd distance_matrix(n, n);
-            for (int i = 0; i < n; ++i)
-            {
-                for (int j = 0; j < n; ++j)
-                {
-                    distance_matrix(i, j) = std::sqrt(
-                        std::pow(start_points[i].x - start_points[j].x, 2) +
-                        std::pow(start_points[i].y - start_points[j].y, 2));
-                }
-            }
-
             // Calculate sigma_i(p_j) = 1 / ||p_j - p_i||^mu
             Eigen::MatrixXd sigma_matrix(n, n);
             for (int i = 0; i < n; ++i)
             {
                 for (int j = 0; j < n; ++j)
                 {
-                    if (distance_matrix(i, j) == 0)
-                    {
-                        sigma_matrix(i, j) = 0;
-                        // Avoid division by zero
-                    }
-                    else
-                    {
-                        sigma_matrix(i, j) =
-                            1 / std::pow(distance_matrix(i, j), mu);
-                    }
+                    double distance = std::sqrt(
+                        std::pow(p[i].x - p[j].x, 2) +
+                        std::pow(p[i].y - p[j].y, 2));
+                    // Avoid division by zero
+                    sigma_matrix(i, j) =
+                        distance == 0 ? 0 : 1 / std::pow(distance, mu);
                 }
             }
 
-            // Calculate the D matrix
-            std::vector<Eigen::MatrixXd> d_matrix(
-                n, Eigen::MatrixXd::Zero(2, 2));
             for (int i = 0; i < n; i++)
             {
                 // Calculate D_i matrix by solving linear equations of four
                 // variables, D_i_11, D_i_12, D_i_21, D_i_22
-
-                // Calculate A matrix
                 Eigen::MatrixXd A = Eigen::MatrixXd::Zero(4, 4);
-                for (int j = 0; j < n; j++)
-                {
-                    A(0, 0) +=
-                        sigma_matrix(i, j) *
-                        std::pow(start_points[j].x - start_points[i].x, 2);
-                    A(0, 1) += sigma_matrix(i, j) *
-                               (start_points[j].x - start_points[i].x) *
-                               (start_points[j].y - start_points[i].y);
-                    A(1, 0) += sigma_matrix(i, j) *
-                               (start_points[j].x - start_points[i].x) *
-                               (start_points[j].y - start_points[i].y);
-                    A(1, 1) +=
-                        sigma_matrix(i, j) *
-                        std::pow(start_points[j].y - start_points[i].y, 2);
-                    A(2, 2) +=
-                        sigma_matrix(i, j) *
-                        std::pow(start_points[j].x - start_points[i].x, 2);
-                    A(2, 3) += sigma_matrix(i, j) *
-                               (start_points[j].x - start_points[i].x) *
-                               (start_points[j].y - start_points[i].y);
-                    A(3, 2) += sigma_matrix(i, j) *
-                               (start_points[j].x - start_points[i].x) *
-                               (start_points[j].y - start_points[i].y);
-                    A(3, 3) +=
-                        sigma_matrix(i, j) *
-                        std::pow(start_points[j].y - start_points[i].y, 2);
-                }
-
-                // Calculate b matrix
                 Eigen::VectorXd b = Eigen::VectorXd::Zero(4);
                 for (int j = 0; j < n; j++)
                 {
-                    b(0) += sigma_matrix(i, j) *
-                            (start_points[j].x - start_points[i].x) *
-                            (end_points[j].x - end_points[i].x);
-                    b(1) += sigma_matrix(i, j) *
-                            (start_points[j].y - start_points[i].y) *
-                            (end_points[j].x - end_points[i].x);
-                    b(2) += sigma_matrix(i, j) *
-                            (start_points[j].x - start_points[i].x) *
-                            (end_points[j].y - end_points[i].y);
-                    b(3) += sigma_matrix(i, j) *
-                            (start_points[j].y - start_points[i].y) *
-                            (end_points[j].y - end_points[i].y);
+                    double dpx = p[j].x - p[i].x, dpy = p[j].y - p[i].y;
+                    double dqx = q[j].x - q[i].x, dqy = q[j].y - q[i].y;
+                    double sigma = sigma_matrix(i, j);
+                    A(0, 0) += sigma * dpx * dpx;
+                    A(0, 1) += sigma * dpx * dpy;
+                    A(1, 0) += sigma * dpx * dpy;
+                    A(1, 1) += sigma * dpy * dpy;
+                    b(0) += sigma * dpx * dqx;
+                    b(1) += sigma * dpy * dqx;
+                    b(2) += sigma * dpx * dqy;
+                    b(3) += sigma * dpy * dqy;
                 }
+                A.block<2, 2>(2, 2) = A.block<2, 2>(0, 0);
 
                 // Solve the linear equations A * x = b
                 Eigen::VectorXd x = A.colPivHouseholderQr().solve(b);
-
-                // Store the result to D matrix
-                d_matrix[i](0, 0) = x(0);
-                d_matrix[i](0, 1) = x(1);
-                d_matrix[i](1, 0) = x(2);
-                d_matrix[i](1, 1) = x(3);
-            }
-
-            // Detect which new pixel is painted
-            std::vector<bool> painted(width * height, false);
-
-            // Got D matrix, calculate f(p) for each pixel
-            for (int old_x = 0; old_x < width; old_x++)
-            {
-                for (int old_y = 0; old_y < height; old_y++)
-                {
-                    double new_x = 0;
-                    double new_y = 0;
-
-                    // Answer shows as sum of w_i(p) * f_i(p)
-                    for (int i = 0; i < n; i++)
-                    {
-                        // Calculate w_i(p) = sigma_i(p) / (Sum_j sigma_j(p)),
-                        // where p = (old_x, old_y)
-                        double sigmasum = 0;
-                        for (int j = 0; j < n; j++)
-                        {
-                            if (old_x != start_points[j].x ||
-                                old_y != start_points[j].y)
-                            {
-                                // Avoid division by zero
-                                sigmasum +=
-                                    1 /
-                                    std::pow(
-                                        std::sqrt(
-                                            std::pow(
-                                                old_x - start_points[j].x, 2) +
-                                            std::pow(
-                                                old_y - start_points[j].y, 2)),
-                                        mu);
-                            }
-                        }
-                        double w;
-                        if (old_x == start_points[i].x &&
-                            old_y == start_points[i].y)
-                        {
-                            // Avoid division by zero
-                            w = 1;
-                        }
-                        else
-                        {
-                            w = 1 /
-                                std::pow(
-                                    std::sqrt(
-                                        std::pow(old_x - start_points[i].x, 2) +
-                                        std::pow(old_y - start_points[i].y, 2)),
-                                    mu) /
-                                sigmasum;
-                        }
-
-                        // Calculate f_i(p) = q_i + D_i(p - p_i) and sum them up
-                        new_x +=
-                            w *
-                            (end_points[i].x +
-                             d_matrix[i](0, 0) * (old_x - start_points[i].x) +
-                             d_matrix[i](0, 1) * (old_y - start_points[i].y));
-                        new_y +=
-                            w *
-                            (end_points[i].y +
-                             d_matrix[i](1, 0) * (old_x - start_points[i].x) +
-                             d_matrix[i](1, 1) * (old_y - start_points[i].y));
-                    }
-
-                    // Set the color of the new pixel
-                    if (Inverse_Flag == false)
-                    {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                (int)new_x,
-                                (int)new_y,
-                                data_->get_pixel(old_x, old_y));
-                            painted[(int)new_y * width + (int)new_x] = true;
-                            if (Fixgap_Flag_ANN == true)
-                            {
-                                float p[2] = { (float)(int)new_x,
-                                               (float)(int)new_y };
-                                // Add the painted pixel to the index. Choose id
-                                // as y * width + x, to easily find out the
-                                // pixel by id
-                                index.add_item(
-                                    (int)new_y * width + (int)new_x, p);
-                                indexcnt++;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            // The difference of inverse: calculate what pixel
-                            // is the new one originated from.
-                            warped_image.set_pixel(
-                                old_x,
-                                old_y,
-                                data_->get_pixel((int)new_x, (int)new_y));
-                        }
-                    }
-                }
+                d_matrix[i] << x(0), x(1), x(2), x(3);
             }
+        }
 
-            // Calculate the max distance to search, avoid paint at non-sight
-            // area. Choose the maximum distance as the zoom ratio.
-            double oldmindis = distance_matrix(0, 1), newmaxdis = 0;
-            for (int i = 0; i < n; i++)
-            {
-                for (int j = 0; j < n; j++)
-                {
-                    if (distance_matrix(i, j) != 0 &&
-                        distance_matrix(i, j) < oldmindis)
-                    {
-                        oldmindis = distance_matrix(i, j);
-                    }
-                }
-            }
+        // f(p) = Sum_i (w_i(p) * f_i(p)), f_i(p) = q_i + D_i(p - p_i). The
+        // sigma_i(p) are computed once for both the weights and their sum.
+        return [p = std::move(p), q = std::move(q), d_matrix, mu](
+                   double x, double y)
+        {
+            int n = (int)p.size();
+            double sigmasum = 0, new_x = 0, new_y = 0;
             for (int i = 0; i < n; i++)
             {
-                for (int j = 0; j < n; j++)
-                {
-                    double dis = std::sqrt(
-                        std::pow(end_points[i].x - end_points[j].x, 2) +
-                        std::pow(end_points[i].y - end_points[j].y, 2));
-                    if (dis > newmaxdis)
-                    {
-                        newmaxdis = dis;
-                    }
-                }
-            }
-            double max_distance = newmaxdis / oldmindis;
-
-            // Fix the gap by ann method
-            if (Fixgap_Flag_ANN == true && indexcnt)
-            {
-                // Build the index, the height of the tree is log2(indexcnt)
-                index.build((int)log2(indexcnt));
-
-                int k = 3;  // search k nearest points
-                std::vector<int> closest_points;
-                std::vector<float> distances;
-                for (int i = 0; i < width; i++)
+                double dx = x - p[i].x, dy = y - p[i].y;
+                double distance2 = dx * dx + dy * dy;
+                if (distance2 == 0)
                 {
-                    for (int j = 0; j < height; j++)
-                    {
-                        if (painted[j * width + i] == true)
-                        {
-                            // Painted, continue
-                            continue;
-                        }
-
-                        // search the k nearest points for each new pixel
-                        float p[2] = { (float)i, (float)j };
-                        index.get_nns_by_vector(
-                            p, k, -1, &closest_points, &distances);
-
-                        std::vector<unsigned char> red(0), green(0), blue(0);
-                        std::vector<int> cnt(0);
-                        for (int l = 0; l < distances.size(); l++)
-                        {
-                            if (distances[l] > max_distance)
-                            {
-                                break;
-                            }
-                            // Within the max distance, count the color
-                            std::vector<unsigned char> pixel =
-                                warped_image.get_pixel(
-                                    closest_points[l] % width,
-                                    closest_points[l] / width);
-                            bool flag = false;
-                            for (int m = 0; m < cnt.size(); m++)
-                            {
-                                if (pixel[0] == red[m] &&
-                                    pixel[1] == green[m] && pixel[2] == blue[m])
-                                {
-                                    flag = true;
-                                    cnt[m]++;
-                                    break;
-                                }
-                            }
-                            if (flag == false)
-                            {
-                                red.push_back(pixel[0]);
-                                green.push_back(pixel[1]);
-                                blue.push_back(pixel[2]);
-                                cnt.push_back(1);
-                            }
-                        }
-
-                        // find the most frequent color and give it to the gap
-                        // pixel
-                        int maxcnt = 0, maxindex = -1;
-                        for (int l = 0; l < cnt.size(); l++)
-                        {
-                            if (cnt[l] > maxcnt)
-                            {
-                                maxcnt = cnt[l];
-                                maxindex = l;
-                            }
-                        }
-                        if (maxindex != -1)
-                        {
-                            std::vector<unsigned char> pixel = {
-                                red[maxindex], green[maxindex], blue[maxindex]
-                            };
-                            warped_image.set_pixel(i, j, pixel);
-                        }
-                        closest_points.clear();
-                        distances.clear();
-                    }
+                    // w_i(p_i) = 1 and f(p_i) = q_i
+                    return q[i];
                 }
+                double sigma = 1 / std::pow(distance2, mu / 2);
+                sigmasum += sigma;
+                new_x += sigma * (q[i].x + d_matrix[i](0, 0) * dx +
+                                  d_matrix[i](0, 1) * dy);
+                new_y += sigma * (q[i].y + d_matrix[i](1, 0) * dx +
+                                  d_matrix[i](1, 1) * dy);
             }
-            index.unbuild();
-            index.reinitialize();
-
-            if (Fixgap_Flag_Neighbour == true)
-            {
-                for (int i = 0; i < width; i++)
-                {
-                    for (int j = 0; j < height; j++)
-                    {
-                        if (painted[j * width + i])
-                        {
-                            continue;
-                        }
-                        std::vector<unsigned char> red(0), green(0), blue(0);
-                        std::vector<int> cnt(0);
-
-                        // Search the painted pixels within the max_distance
-                        for (int x = i - (int)(max_distance / 2);
-                             x <= i + (int)(max_distance / 2);
-                             x++)
-                        {
-                            for (int y = j - (int)(max_distance / 2);
-                                 y <= j + (int)(max_distance / 2);
-                                 y++)
-                            {
-                                if (x < 0 || x >= width || y < 0 || y >= height)
-                                {
-                                    continue;
-                                }
-                                if (painted[y * width + x])
-                                {
-                                    std::vector<unsigned char> pixel =
-                                        warped_image.get_pixel(x, y);
-                                    bool flag = false;
-                                    for (int m = 0; m < cnt.size(); m++)
-                                    {
-                                        if (pixel[0] == red[m] &&
-                                            pixel[1] == green[m] &&
-                                            pixel[2] == blue[m])
-                                        {
-                                            flag = true;
-                                            cnt[m]++;
-                                            break;
-                                        }
-                                    }
-                                    if (flag == false)
-                                    {
-                                        red.push_back(pixel[0]);
-                                        green.push_back(pixel[1]);
-                                        blue.push_back(pixel[2]);
-                                        cnt.push_back(1);
-                                    }
-                                }
-                            }
-                        }
-
-                        // find the most frequent color and give it to the gap
-                        // pixel
-                        int maxcnt = 0, maxindex = -1;
-                        for (int l = 0; l < cnt.size(); l++)
-                        {
-                            if (cnt[l] > maxcnt)
-                            {
-                                maxcnt = cnt[l];
-                                maxindex = l;
-                            }
-                        }
-                        if (maxindex != -1)
-                        {
-                            std::vector<unsigned char> pixel = {
-                                red[maxindex], green[maxindex], blue[maxindex]
-                            };
-                            warped_image.set_pixel(i, j, pixel);
-                        }
-                    }
-                }
-            }
-        }
-
-        // Get it back for further use
-        if (Inverse_Flag)
-        {
-            std::swap(start_points, end_points);
-        }
+            return ImVec2((float)(new_x / sigmasum), (float)(new_y / sigmasum));
+        };
     }
 };
-}  // namespace USTC_CG
\ No newline at end of file
+}  // namespace USTC_CG
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <algorithm>
 #include <cmath>
 
 #include "annoylib.h"
@@ -15,6 +17,33 @@ class WarpingRBF : public Warping
     WarpingRBF() = default;
     virtual ~WarpingRBF() noexcept = default;
 
+    // Above this number of points, compactly supported kernels are used
+    static constexpr int kDenseLimit = 256;
+    // Added to the diagonal of the sparse T
+    static constexpr double kSmoothing = 1e-4;
+
+    // How the coefficients of f are solved for
+    enum class Solver
+    {
+        kAuto,     // Compact above kDenseLimit points, dense otherwise
+        kDense,    // Multiquadric kernels, every point moves every pixel
+        kCompact,  // Compactly supported kernels, see set_support
+    };
+
+    void set_solver(Solver solver)
+    {
+        solver_ = solver;
+    }
+
+    // Radius of the compactly supported kernels, in average spacings of the
+    // start points. Areas farther than that from every point only follow the
+    // affine part, so larger is closer to the dense solution, but the solve
+    // and every evaluation get slower.
+    void set_support(double support)
+    {
+        support_ = std::max(support, 1.0);
+    }
+
     /**
      * @brief Radial Basis Function (RBF) warping function.
      * @param data_ The original image data.
@@ -24,6 +53,7 @@ class WarpingRBF : public Warping
      * @param Inverse_Flag Whether to use the inverse warping function.
      * @param Fixgap_Flag_ANN Whether to fix the gaps using ann method.
      * @param Fixgap_Flag_Neighbour Whether to fix the gaps using neighbour
+     * @param Fixgap_Flag_PushPull Whether to fix the gaps using push-pull
      */
     void warping(
         std::shared_ptr<Image> &data_,
@@ -32,7 +62,8 @@ class WarpingRBF : public Warping
         std::vector<ImVec2> &end_points,
         bool Inverse_Flag = false,
         bool Fixgap_Flag_ANN = false,
-        bool Fixgap_Flag_Neighbour = false) override
+        bool Fixgap_Flag_Neighbour = false,
+        bool Fixgap_Flag_PushPull = false) override
     {
         /**
          * We follow the formulas in homework guide.
@@ -60,23 +91,68 @@ class WarpingRBF : public Warping
          * Solve the linear equation, we can get a_i, A, b, and f(p).
          */
 
-        // Calculate a function that maps the end points to the start points,
-        // for Inverse_Flag
-        if (Inverse_Flag)
-        {
-            std::swap(start_points, end_points);
-        }
 
         int n = (int)start_points.size();
-        int width = data_->width();
-        int height = data_->height();
-        double mu = 1.0f;
 
         // If no start points, return the original image
         if (n == 0)
         {
             warped_image = *data_;
+            return;
+        }
+
+        // Calculate a function that maps the end points to the start points,
+        // for Inverse_Flag. With two points the gaps are fixed by inverse
+        // method, the result is identical to ANN or Neighbour theoretically.
+        bool fix_gaps_flag =
+            Fixgap_Flag_ANN || Fixgap_Flag_Neighbour || Fixgap_Flag_PushPull;
+        bool inverse = Inverse_Flag || (n == 2 && fix_gaps_flag);
+        if (inverse)
+        {
+            std::swap(start_points, end_points);
+        }
+
+        WarpEngine::Mapping map = fit(start_points, end_points);
+        if (inverse)
+        {
+            // The difference of inverse: calculate what pixel the new one is
+            // originated from.
+            engine_.warp(*data_, warped_image, map);
+            std::swap(start_points, end_points);
+        }
+        else
+        {
+            std::vector<bool> painted;
+            scatter(*data_, warped_image, map, painted);
+            // Only more than two points may leave gaps
+            if (n > 2)
+            {
+                fix_gaps(
+                    warped_image,
+                    painted,
+                    gap_distance(
+                        start_points,
+                        end_points,
+                        data_->width(),
+                        data_->height()),
+                    Fixgap_Flag_ANN,
+                    Fixgap_Flag_Neighbour,
+                    Fixgap_Flag_PushPull);
+            }
         }
+    }
+
+    /**
+     * @brief Compute f, which maps the start points to the end points.
+     * @param start_points The start points p_i, at least one.
+     * @param end_points The end points q_i.
+     */
+    WarpEngine::Mapping fit(
+        const std::vector<ImVec2> &start_points,
+        const std::vector<ImVec2> &end_points) const
+    {
+        int n = (int)start_points.size();
+        double mu = 1.0f;
 
         // If there is only one start point: no r_min any more. Assume R(||p -
         // p_i||) = ||p - p_i||^2. We have: T = {{0, p_1, p_2, 1}, {p_1, 0, 0,
@@ -84,36 +160,12 @@ class WarpingRBF : public Warping
         // {0, 0}}. We can get that a_1 = a_2 = 0, which means the radial item
         // disappeared. Then A*p + b = q. For convinence, we can choose A = I, b
         // = q - p. Thus, f(p) = p + q_1 - p_1, which is the same as IDW.
-        else if (n == 1)
+        if (n == 1)
         {
-            for (int old_x = 0; old_x < width; old_x++)
-            {
-                for (int old_y = 0; old_y < height; old_y++)
-                {
-                    int new_x =
-                        (int)(old_x + end_points[0].x - start_points[0].x);
-                    int new_y =
-                        (int)(old_y + end_points[0].y - start_points[0].y);
-                    if (Inverse_Flag == false)
-                    {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                new_x, new_y, data_->get_pixel(old_x, old_y));
-                        }
-                    }
-                    else
-                    {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                old_x, old_y, data_->get_pixel(new_x, new_y));
-                        }
-                    }
-                }
-            }
+            double dx = end_points[0].x - start_points[0].x;
+            double dy = end_points[0].y - start_points[0].y;
+            return [dx, dy](double x, double y)
+            { return ImVec2((float)(x + dx), (float)(y + dy)); };
         }
 
         // If there are only two start points, R_i(p) = ||p - p_i||^2 + ||p_1 -
@@ -138,396 +190,311 @@ class WarpingRBF : public Warping
         //
         // The situation is the same as IDW. It is a linear transformation. We
         // use inverse method to fix the gap.
-        else if (n == 2)
+        if (n == 2)
         {
-            // Fix the gap by inverse method, the result is identical to ANN or
-            // Neighbour theoretically
-            if ((Fixgap_Flag_ANN == true || Fixgap_Flag_Neighbour == true) &&
-                Inverse_Flag == false)
-            {
-                std::swap(start_points, end_points);
-            }
-
             double d_1 = (end_points[1].x - end_points[0].x) /
                          (start_points[1].x - start_points[0].x);
             double d_2 = (end_points[1].y - end_points[0].y) /
                          (start_points[1].y - start_points[0].y);
             double b_1 = end_points[0].x - start_points[0].x * d_1;
             double b_2 = end_points[0].y - start_points[0].y * d_2;
-            for (int old_x = 0; old_x < width; old_x++)
-            {
-                for (int old_y = 0; old_y < height; old_y++)
-                {
-                    int new_x = (int)(d_1 * old_x + b_1);
-                    int new_y = (int)(d_2 * old_y + b_2);
+            return [d_1, d_2, b_1, b_2](double x, double y)
+            { return ImVec2((float)(d_1 * x + b_1), (float)(d_2 * y + b_2)); };
+        }
 
-                    if (Inverse_Flag == true || Fixgap_Flag_ANN == true ||
-                        Fixgap_Flag_Neighbour == true)
-                    {
-                        // Inverse way
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                old_x, old_y, data_->get_pixel(new_x, new_y));
-                        }
-                    }
-                    else
-                    {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                new_x, new_y, data_->get_pixel(old_x, old_y));
-                        }
-                    }
-                }
-            }
-            if ((Fixgap_Flag_ANN == true || Fixgap_Flag_Neighbour == true) &&
-                Inverse_Flag == false)
+        // If there are more than two points, there is no need to specially deal
+        // with it, for a_i may not all be 0 for usual situation.
+
+        // With many points, solving the dense T (O(n^3)) and evaluating all the
+        // R_i for every pixel are too slow.
+        if (solver_ == Solver::kCompact ||
+            (solver_ == Solver::kAuto && n > kDenseLimit))
+        {
+            WarpEngine::Mapping map =
+                fit_compact(start_points, end_points, support_);
+            if (map)
             {
-                std::swap(start_points, end_points);
+                return map;
             }
+            // Fall back to the dense solve if the sparse one fails
         }
 
-        // If there are more than two points, there is no need to specially deal
-        // with it, for a_i may not all be 0 for usual situation.
-        else
+        // Calculate r_min_i = min_(j!=i) ||p_j - p_i||, use ann method
+        Annoy::AnnoyIndex<
+            int,
+            float,
+            Annoy::Euclidean,
+            Annoy::Kiss32Random,
+            Annoy::AnnoyIndexSingleThreadedBuildPolicy>
+            index(2);
+        for (int i = 0; i < n; i++)
         {
-            // Calculate r_min_i = min_(j!=i) ||p_j - p_i||, use ann method
-            Annoy::AnnoyIndex<
-                int,
-                float,
-                Annoy::Euclidean,
-                Annoy::Kiss32Random,
-                Annoy::AnnoyIndexSingleThreadedBuildPolicy>
-                index(2);
-            for (int i = 0; i < n; i++)
+            float p[2] = { (float)start_points[i].x, (float)start_points[i].y };
+            index.add_item(i, p);
+        }
+        // Build the index, the height of the tree is log2(n)
+        index.build((int)log2(n));
+        std::vector<float> r_min(n);
+        std::vector<int> closest_items;
+        std::vector<float> distances;
+        for (int i = 0; i < n; i++)
+        {
+            float p[2] = { start_points[i].x, start_points[i].y };
+            index.get_nns_by_vector(p, 2, -1, &closest_items, &distances);
+            r_min[i] = distances[1];
+
+            closest_items.clear();
+            distances.clear();
+        }
+        index.unbuild();
+        index.reinitialize();
+
+        // Calculate T and y
+        Eigen::MatrixXd T = Eigen::MatrixXd::Zero(n + 3, n + 3);
+        Eigen::MatrixXd y = Eigen::MatrixXd::Zero(n + 3, 2);
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
             {
-                float p[2] = { (float)start_points[i].x,
-                               (float)start_points[i].y };
-                index.add_item(i, p);
+                T(i, j) =
+                    pow(pow(start_points[i].x - start_points[j].x, 2) +
+                            pow(start_points[i].y - start_points[j].y, 2) +
+                            pow(r_min[j], 2),
+                        mu / 2);
             }
-            // Build the index, the height of the tree is log2(n)
-            index.build((int)log2(n));
-            std::vector<float> r_min(n);
-            std::vector<int> closest_items;
-            std::vector<float> distances;
+            T(i, n) = start_points[i].x;
+            T(i, n + 1) = start_points[i].y;
+            T(i, n + 2) = 1;
+            y(i, 0) = end_points[i].x;
+            y(i, 1) = end_points[i].y;
+        }
+        for (int j = 0; j < n; j++)
+        {
+            T(n, j) = start_points[j].x;
+            T(n + 1, j) = start_points[j].y;
+            T(n + 2, j) = 1;
+        }
+
+        // Solve the linear equation
+        Eigen::MatrixXd x = T.colPivHouseholderQr().solve(y);
+
+        // x(i, 0) and x(i, 1) are the coefficients a_i, x(n, 0), x(n, 1),
+        // x(n+1, 0), x(n+1, 1) are the coefficients A^T, x(n+2, 0) and x(n+2,
+        // 1) are the coefficients b
+        std::vector<ImVec2> p = start_points;
+        return [p = std::move(p), r_min = std::move(r_min), x, mu](
+                   double old_x, double old_y)
+        {
+            int n = (int)p.size();
+            double new_x = 0;
+            double new_y = 0;
             for (int i = 0; i < n; i++)
             {
-                float p[2] = { start_points[i].x, start_points[i].y };
-                index.get_nns_by_vector(p, 2, -1, &closest_items, &distances);
-                r_min[i] = distances[1];
-
-                closest_items.clear();
-                distances.clear();
+                double r = pow(pow(old_x - p[i].x, 2) + pow(old_y - p[i].y, 2) +
+                                   pow(r_min[i], 2),
+                               mu / 2);
+                new_x += x(i, 0) * r;
+                new_y += x(i, 1) * r;
             }
-            index.unbuild();
-            index.reinitialize();
+            new_x += old_x * x(n, 0) + old_y * x(n + 1, 0) + x(n + 2, 0);
+            new_y += old_x * x(n, 1) + old_y * x(n + 1, 1) + x(n + 2, 1);
+            return ImVec2((float)new_x, (float)new_y);
+        };
+    }
 
-            // Calculate T and y
-            Eigen::MatrixXd T = Eigen::MatrixXd::Zero(n + 3, n + 3);
-            Eigen::MatrixXd y = Eigen::MatrixXd::Zero(n + 3, 2);
-            for (int i = 0; i < n; i++)
+   private:
+    // Start points sorted into square cells, to find the ones closer than a
+    // cell size quickly
+    struct CenterGrid
+    {
+        CenterGrid(const std::vector<ImVec2> &points, double cell_size)
+            : cell(cell_size)
+        {
+            x0 = x1 = points[0].x;
+            y0 = y1 = points[0].y;
+            for (const ImVec2 &p : points)
             {
-                for (int j = 0; j < n; j++)
-                {
-                    T(i, j) =
-                        pow(pow(start_points[i].x - start_points[j].x, 2) +
-                                pow(start_points[i].y - start_points[j].y, 2) +
-                                pow(r_min[j], 2),
-                            mu / 2);
-                }
-                T(i, n) = start_points[i].x;
-                T(i, n + 1) = start_points[i].y;
-                T(i, n + 2) = 1;
-                y(i, 0) = end_points[i].x;
-                y(i, 1) = end_points[i].y;
+                x0 = std::min(x0, (double)p.x);
+                x1 = std::max(x1, (double)p.x);
+                y0 = std::min(y0, (double)p.y);
+                y1 = std::max(y1, (double)p.y);
             }
-            for (int j = 0; j < n; j++)
+            cols = (int)((x1 - x0) / cell) + 1;
+            rows = (int)((y1 - y0) / cell) + 1;
+
+            // Count the points of every cell, then put their indices in order
+            start.assign((std::size_t)cols * rows + 1, 0);
+            for (const ImVec2 &p : points)
             {
-                T(n, j) = start_points[j].x;
+                start[cell_of(p.x, p.y) + 1]++;
             }
-            for (int j = 0; j < n; j++)
+            for (std::size_t c = 1; c < start.size(); c++)
             {
-                T(n + 1, j) = start_points[j].y;
+                start[c] += start[c - 1];
             }
-            for (int j = 0; j < n; j++)
+            items.resize(points.size());
+            std::vector<int> next(start.begin(), start.end() - 1);
+            for (int i = 0; i < (int)points.size(); i++)
             {
-                T(n + 2, j) = 1;
+                items[next[cell_of(points[i].x, points[i].y)]++] = i;
             }
+        }
 
-            // Solve the linear equation
-            Eigen::MatrixXd x = T.colPivHouseholderQr().solve(y);
-
-            // Now use index to fix the gap
-            int indexcnt = 0;
-
-            // Detect which new pixel is painted
-            std::vector<bool> painted(width * height, false);
+        std::size_t cell_of(double x, double y) const
+        {
+            int i = std::clamp((int)((x - x0) / cell), 0, cols - 1);
+            int j = std::clamp((int)((y - y0) / cell), 0, rows - 1);
+            return (std::size_t)j * cols + i;
+        }
 
-            // Calculate the warped image. x(i, 0) and x(i, 1) are the
-            // coefficients a_i, x(n, 0), x(n, 1), x(n+1, 0), x(n+1, 1) are the
-            // coefficients A^T, x(n+2, 0) and x(n+2, 1) are the coefficients b
-            for (int old_x = 0; old_x < width; old_x++)
+        // Call fn(i) for the points i of the cells around (x, y), which hold
+        // all the points closer than cell_size
+        template<typename Function>
+        void for_each_near(double x, double y, Function &&fn) const
+        {
+            int i = (int)std::floor((x - x0) / cell);
+            int j = (int)std::floor((y - y0) / cell);
+            for (int cj = std::max(j - 1, 0); cj <= std::min(j + 1, rows - 1);
+                 cj++)
             {
-                for (int old_y = 0; old_y < height; old_y++)
+                for (int ci = std::max(i - 1, 0);
+                     ci <= std::min(i + 1, cols - 1);
+                     ci++)
                 {
-                    double new_x = 0;
-                    double new_y = 0;
-
-                    // Calculate the new position of the pixel
-                    for (int i = 0; i < n; i++)
-                    {
-                        new_x += x(i, 0) *
-                                 pow(pow(old_x - start_points[i].x, 2) +
-                                         pow(old_y - start_points[i].y, 2) +
-                                         pow(r_min[i], 2),
-                                     mu / 2);
-                        new_y += x(i, 1) *
-                                 pow(pow(old_x - start_points[i].x, 2) +
-                                         pow(old_y - start_points[i].y, 2) +
-                                         pow(r_min[i], 2),
-                                     mu / 2);
-                    }
-                    new_x +=
-                        old_x * x(n, 0) + old_y * x(n + 1, 0) + x(n + 2, 0);
-                    new_y +=
-                        old_x * x(n, 1) + old_y * x(n + 1, 1) + x(n + 2, 1);
-                    // Set the color of the new pixel
-                    if (Inverse_Flag == false)
-                    {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            warped_image.set_pixel(
-                                (int)new_x,
-                                (int)new_y,
-                                data_->get_pixel(old_x, old_y));
-                            painted[(int)new_y * width + (int)new_x] = true;
-                            if (Fixgap_Flag_ANN == true)
-                            {
-                                float p[2] = { (float)(int)new_x,
-                                               (float)(int)new_y };
-                                // Add the painted pixel to the index. Choose id
-                                // as y * width + x, to easily find out the
-                                // pixel by id
-                                index.add_item(
-                                    (int)new_y * width + (int)new_x, p);
-                                indexcnt++;
-                            }
-                        }
-                    }
-                    else
+                    std::size_t c = (std::size_t)cj * cols + ci;
+                    for (int k = start[c]; k < start[c + 1]; k++)
                     {
-                        if (new_x >= 0 && new_x < width && new_y >= 0 &&
-                            new_y < height)
-                        {
-                            // The difference of inverse: calculate what pixel
-                            // is the new one originated from.
-                            warped_image.set_pixel(
-                                old_x,
-                                old_y,
-                                data_->get_pixel((int)new_x, (int)new_y));
-                        }
+                        fn(items[k]);
                     }
                 }
             }
+        }
 
-            // Calculate the max distance to search, avoid paint at non-sight
-            // area. Choose the maximum distance as the zoom ratio.
-            double oldmindis = (width > height ? width : height), newmaxdis = 0;
-            for (int i = 0; i < n; i++)
-            {
-                for (int j = 0; j < n; j++)
-                {
-                    double dis = std::sqrt(
-                        std::pow(start_points[i].x - start_points[j].x, 2) +
-                        std::pow(start_points[i].y - start_points[j].y, 2));
-                    if (i != j && dis < oldmindis)
-                    {
-                        oldmindis = dis;
-                    }
-                }
-            }
-            for (int i = 0; i < n; i++)
-            {
-                for (int j = 0; j < n; j++)
-                {
-                    double dis = std::sqrt(
-                        std::pow(end_points[i].x - end_points[j].x, 2) +
-                        std::pow(end_points[i].y - end_points[j].y, 2));
-                    if (dis > newmaxdis)
-                    {
-                        newmaxdis = dis;
-                    }
-                }
-            }
-            double max_distance = newmaxdis / oldmindis;
+        double x0, y0, x1, y1, cell;
+        int cols, rows;
+        // Points of cell c are items[start[c]] ... items[start[c + 1] - 1]
+        std::vector<int> start, items;
+    };
 
-            // Fix the gap by ann method
-            if (Fixgap_Flag_ANN == true && indexcnt)
-            {
-                // Build the index, the height of the tree is log2(indexcnt)
-                index.build((int)log2(indexcnt));
+    /**
+     * @brief Compute f with the compactly supported Wendland kernel R(d) =
+     * (1 - d/s)^4 (4d/s + 1) for d < s, 0 beyond, instead of the
+     * multiquadric. s is support times the average spacing of the start
+     * points, so that T is sparse and f(p) only sums the R_i of the points
+     * around p.
+     *
+     * With T = {{Phi, P}, {P^T, 0}}, where P has the rows (p_i_1, p_i_2, 1),
+     * Phi (SPD) is factored once: Phi a + P c = q and P^T a = 0 give
+     * (P^T Phi^-1 P) c = P^T Phi^-1 q, then a = Phi^-1 (q - P c).
+     * @return An empty mapping if Phi can't be factored.
+     */
+    static WarpEngine::Mapping fit_compact(
+        const std::vector<ImVec2> &start_points,
+        const std::vector<ImVec2> &end_points,
+        double support)
+    {
+        int n = (int)start_points.size();
 
-                int k = 3;  // search k nearest points
-                std::vector<int> closest_points;
-                std::vector<float> distances;
-                for (int i = 0; i < width; i++)
-                {
-                    for (int j = 0; j < height; j++)
-                    {
-                        if (painted[j * width + i])
-                        {
-                            // Painted, continue
-                            continue;
-                        }
-
-                        // search the k nearest points for each new pixel
-                        float p[2] = { (float)i, (float)j };
-                        index.get_nns_by_vector(
-                            p, k, -1, &closest_points, &distances);
-
-                        std::vector<unsigned char> red(0), green(0), blue(0);
-                        std::vector<int> cnt(0);
-                        for (int l = 0; l < distances.size(); l++)
-                        {
-                            if (distances[l] > max_distance)
-                            {
-                                break;
-                            }
-                            // Within the max distance, count the color
-                            std::vector<unsigned char> pixel =
-                                warped_image.get_pixel(
-                                    closest_points[l] % width,
-                                    closest_points[l] / width);
-                            bool flag = false;
-                            for (int m = 0; m < cnt.size(); m++)
-                            {
-                                if (pixel[0] == red[m] &&
-                                    pixel[1] == green[m] && pixel[2] == blue[m])
-                                {
-                                    flag = true;
-                                    cnt[m]++;
-                                    break;
-                                }
-                            }
-                            if (flag == false)
-                            {
-                                red.push_back(pixel[0]);
-                                green.push_back(pixel[1]);
-                                blue.push_back(pixel[2]);
-                                cnt.push_back(1);
-                            }
-                        }
-
-                        // find the most frequent color and give it to the gap
-                        // pixel
-                        int maxcnt = 0, maxindex = -1;
-                        for (int l = 0; l < cnt.size(); l++)
-                        {
-                            if (cnt[l] > maxcnt)
-                            {
-                                maxcnt = cnt[l];
-                                maxindex = l;
-                            }
-                        }
-                        if (maxindex != -1)
-                        {
-                            std::vector<unsigned char> pixel = {
-                                red[maxindex], green[maxindex], blue[maxindex]
-                            };
-                            warped_image.set_pixel(i, j, pixel);
-                        }
-                        closest_points.clear();
-                        distances.clear();
-                    }
-                }
+        // Average spacing of the points over their bounding box
+        double min_x = start_points[0].x, max_x = min_x;
+        double min_y = start_points[0].y, max_y = min_y;
+        for (const ImVec2 &p : start_points)
+        {
+            min_x = std::min(min_x, (double)p.x);
+            max_x = std::max(max_x, (double)p.x);
+            min_y = std::min(min_y, (double)p.y);
+            max_y = std::max(max_y, (double)p.y);
+        }
+        double area = (max_x - min_x) * (max_y - min_y);
+        double spacing = area > 0
+                             ? std::sqrt(area / n)
+                             : std::max(max_x - min_x, max_y - min_y) / n;
+        double s = support * std::max(spacing, 1.0);
+        // R of the squared distance, to skip the square root beyond s
+        auto kernel = [s](double d2)
+        {
+            if (d2 >= s * s)
+            {
+                return 0.0;
             }
-            index.unbuild();
-            index.reinitialize();
+            double t = std::sqrt(d2) / s;
+            double u = (1 - t) * (1 - t);
+            return u * u * (4 * t + 1);
+        };
 
-            if (Fixgap_Flag_Neighbour == true)
-            {
-                for (int i = 0; i < width; i++)
+        CenterGrid grid(start_points, s);
+        std::vector<Eigen::Triplet<double>> triplets;
+        for (int i = 0; i < n; i++)
+        {
+            grid.for_each_near(
+                start_points[i].x,
+                start_points[i].y,
+                [&](int j)
                 {
-                    for (int j = 0; j < height; j++)
+                    double dx = start_points[i].x - start_points[j].x;
+                    double dy = start_points[i].y - start_points[j].y;
+                    double r = kernel(dx * dx + dy * dy);
+                    if (r > 0)
                     {
-                        if (painted[j * width + i])
-                        {
-                            continue;
-                        }
-                        std::vector<unsigned char> red(0), green(0), blue(0);
-                        std::vector<int> cnt(0);
-
-                        // Search the painted pixels within the max_distance
-                        for (int x = i - (int)(max_distance / 2);
-                             x <= i + (int)(max_distance / 2);
-                             x++)
-                        {
-                            for (int y = j - (int)(max_distance / 2);
-                                 y <= j + (int)(max_distance / 2);
-                                 y++)
-                            {
-                                if (x < 0 || x >= width || y < 0 || y >= height)
-                                {
-                                    continue;
-                                }
-                                if (painted[y * width + x])
-                                {
-                                    std::vector<unsigned char> pixel =
-                                        warped_image.get_pixel(x, y);
-                                    bool flag = false;
-                                    for (int m = 0; m < cnt.size(); m++)
-                                    {
-                                        if (pixel[0] == red[m] &&
-                                            pixel[1] == green[m] &&
-                                            pixel[2] == blue[m])
-                                        {
-                                            flag = true;
-                                            cnt[m]++;
-                                            break;
-                                        }
-                                    }
-                                    if (flag == false)
-                                    {
-                                        red.push_back(pixel[0]);
-                                        green.push_back(pixel[1]);
-                                        blue.push_back(pixel[2]);
-                                        cnt.push_back(1);
-                                    }
-                                }
-                            }
-                        }
-
-                        // find the most frequent color and give it to the gap
-                        // pixel
-                        int maxcnt = 0, maxindex = -1;
-                        for (int l = 0; l < cnt.size(); l++)
-                        {
-                            if (cnt[l] > maxcnt)
-                            {
-                                maxcnt = cnt[l];
-                                maxindex = l;
-                            }
-                        }
-                        if (maxindex != -1)
-                        {
-                            std::vector<unsigned char> pixel = {
-                                red[maxindex], green[maxindex], blue[maxindex]
-                            };
-                            warped_image.set_pixel(i, j, pixel);
-                        }
+                        triplets.emplace_back(i, j, r);
                     }
-                }
-            }
+                });
         }
-        // Get it back for further use
-        if (Inverse_Flag)
+        // A slight smoothing on the diagonal keeps close points with different
+        // end points from blowing up a_i, and lets duplicated points through
+        for (int i = 0; i < n; i++)
         {
-            std::swap(start_points, end_points);
+            triplets.emplace_back(i, i, kSmoothing);
+        }
+        Eigen::SparseMatrix<double> phi(n, n);
+        phi.setFromTriplets(triplets.begin(), triplets.end());
+        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver(phi);
+        if (solver.info() != Eigen::Success)
+        {
+            return {};
         }
+
+        Eigen::MatrixXd P(n, 3), q(n, 2);
+        for (int i = 0; i < n; i++)
+        {
+            P.row(i) << start_points[i].x, start_points[i].y, 1;
+            q.row(i) << end_points[i].x, end_points[i].y;
+        }
+        Eigen::MatrixXd phi_inv_P = solver.solve(P);
+        Eigen::MatrixXd phi_inv_q = solver.solve(q);
+        Eigen::MatrixXd c = (P.transpose() * phi_inv_P)
+                                .colPivHouseholderQr()
+                                .solve(P.transpose() * phi_inv_q);
+        Eigen::MatrixXd a = phi_inv_q - phi_inv_P * c;
+        if (!a.allFinite() || !c.allFinite())
+        {
+            return {};
+        }
+
+        std::vector<ImVec2> p = start_points;
+        return [p = std::move(p),
+                grid = std::move(grid),
+                a = std::move(a),
+                c = std::move(c),
+                kernel](double x, double y)
+        {
+            double new_x = x * c(0, 0) + y * c(1, 0) + c(2, 0);
+            double new_y = x * c(0, 1) + y * c(1, 1) + c(2, 1);
+            grid.for_each_near(
+                x,
+                y,
+                [&](int i)
+                {
+                    double dx = x - p[i].x, dy = y - p[i].y;
+                    double r = kernel(dx * dx + dy * dy);
+                    new_x += a(i, 0) * r;
+                    new_y += a(i, 1) * r;
+                });
+            return ImVec2((float)new_x, (float)new_y);
+        };
     }
+
+    Solver solver_ = Solver::kAuto;
+    double support_ = 6.0;
 };
-}  // namespace USTC_CG
\ No newline at end of file
+}  // namespace USTC_CG
@@ -149,6 +149,48 @@ void ImageWarping::draw_toolbar()
                     p_image_->enable_selecting(false);
                     p_image_->warping();
                 }
+                if (ImGui::BeginMenu("RBF solver"))
+                {
+                    bool changed = false;
+                    if (ImGui::RadioButton(
+                            "Auto",
+                            p_image_->rbf_solver == WarpingRBF::Solver::kAuto))
+                    {
+                        p_image_->rbf_solver = WarpingRBF::Solver::kAuto;
+                        changed = true;
+                    }
+                    if (ImGui::RadioButton(
+                            "Dense",
+                            p_image_->rbf_solver == WarpingRBF::Solver::kDense))
+                    {
+                        p_image_->rbf_solver = WarpingRBF::Solver::kDense;
+                        changed = true;
+                    }
+                    if (ImGui::RadioButton(
+                            "Compact",
+                            p_image_->rbf_solver ==
+                                WarpingRBF::Solver::kCompact))
+                    {
+                        p_image_->rbf_solver = WarpingRBF::Solver::kCompact;
+                        changed = true;
+                    }
+                    // The support only matters to the compact kernels
+                    if (p_image_->rbf_solver != WarpingRBF::Solver::kDense)
+                    {
+                        changed |= ImGui::SliderFloat(
+                            "Support",
+                            &p_image_->rbf_support,
+                            1.0f,
+                            20.0f,
+                            "%.1f",
+                            ImGuiSliderFlags_AlwaysClamp);
+                    }
+                    if (changed)
+                    {
+                        p_image_->apply_rbf_options();
+                    }
+                    ImGui::EndMenu();
+                }
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu("Fix gaps"))
@@ -156,12 +198,20 @@ void ImageWarping::draw_toolbar()
                 ImGui::Checkbox("Inverse Warping", &p_image_->inverse_flag);
                 if (p_image_->inverse_flag == false)
                 {
-                    if (!p_image_->fixgap_flag_ann)
+                    if (!p_image_->fixgap_flag_ann &&
+                        !p_image_->fixgap_flag_neighbour)
+                    {
+                        ImGui::Checkbox(
+                            "Push-pull", &p_image_->fixgap_flag_push_pull);
+                    }
+                    if (!p_image_->fixgap_flag_ann &&
+                        !p_image_->fixgap_flag_push_pull)
                     {
                         ImGui::Checkbox(
                             "Neighbour", &p_image_->fixgap_flag_neighbour);
                     }
-                    if (!p_image_->fixgap_flag_neighbour)
+                    if (!p_image_->fixgap_flag_neighbour &&
+                        !p_image_->fixgap_flag_push_pull)
                     {
                         ImGui::Checkbox(
                             "ANN (very slow)", &p_image_->fixgap_flag_ann);
@@ -171,7 +221,40 @@ void ImageWarping::draw_toolbar()
                 {
                     p_image_->fixgap_flag_ann = false;
                     p_image_->fixgap_flag_neighbour = false;
+                    p_image_->fixgap_flag_push_pull = false;
+                    ImGui::Separator();
+                    if (ImGui::RadioButton(
+                            "Nearest",
+                            p_image_->sampling ==
+                                WarpEngine::Sampling::kNearest))
+                    {
+                        p_image_->sampling = WarpEngine::Sampling::kNearest;
+                    }
+                    if (ImGui::RadioButton(
+                            "Bilinear",
+                            p_image_->sampling ==
+                                WarpEngine::Sampling::kBilinear))
+                    {
+                        p_image_->sampling = WarpEngine::Sampling::kBilinear;
+                    }
+                    if (ImGui::RadioButton(
+                            "Bicubic",
+                            p_image_->sampling ==
+                                WarpEngine::Sampling::kBicubic))
+                    {
+                        p_image_->sampling = WarpEngine::Sampling::kBicubic;
+                    }
                 }
+                // The mapping is interpolated between the grid nodes, 1
+                // evaluates it on every pixel
+                ImGui::Separator();
+                ImGui::SliderInt(
+                    "Grid step",
+                    &p_image_->grid_step,
+                    1,
+                    32,
+                    "%d",
+                    ImGuiSliderFlags_AlwaysClamp);
                 ImGui::EndMenu();
             }
             ImGui::Separator();
@@ -1,8 +1,8 @@
 #include "comp_source_image.h"
 
 #include <algorithm>
+#include <climits>
 #include <cmath>
-#include <queue>
 
 namespace USTC_CG
 {
@@ -138,7 +138,7 @@ void CompSourceImage::select_region()
                 start = clock();
 
                 // Update the selected region.
-                init_selections();
+                init_selections(edge_points_);
                 init_id();
                 init_matrix();
 
@@ -165,27 +165,20 @@ void CompSourceImage::select_region()
             // For polygon or freehand regions, you should inplement the
             // "scanning line" algorithm, which is a well-known algorithm in CG.
 
-            for (int i = 0; i < selected_region_->width(); ++i)
+            std::vector<ImVec2> rect;
+            if (start_.x < end_.x && start_.y < end_.y)
             {
-                for (int j = 0; j < selected_region_->height(); ++j)
-                {
-                    selected_region_->set_pixel(i, j, { 0 });
-                }
-            }
-            for (int i = (int)(start_.x); i < (int)(end_.x); ++i)
-            {
-                for (int j = (int)(start_.y); j < (int)(end_.y); ++j)
-                {
-                    selected_region_->set_pixel(i, j, { 255 });
-                    // Select the region by setting the pixel value to
-                    // 255.
-                }
+                rect = { start_,
+                         ImVec2(end_.x, start_.y),
+                         end_,
+                         ImVec2(start_.x, end_.y) };
             }
 
             // Start the timer
             clock_t start, end;
             start = clock();
 
+            init_selections(rect);
             init_id();
             init_matrix();
 
@@ -229,7 +222,7 @@ void CompSourceImage::select_region()
                 start = clock();
 
                 // Update the selected region.
-                init_selections();
+                init_selections(edge_points_);
                 init_id();
                 init_matrix();
 
@@ -345,7 +338,8 @@ void CompSourceImage::select_region()
 
 /**
  * @brief Get the selected region.
- * @return The Image selected_region_ with binary values (0 or 255).
+ * @return The Image selected_region_ with binary values (0 or 255), or the
+ * coverage of the pixels with antialiasing.
  */
 std::shared_ptr<Image> CompSourceImage::get_region()
 {
@@ -361,6 +355,15 @@ std::shared_ptr<Image> CompSourceImage::get_data()
     return data_;
 }
 
+/**
+ * @brief Set whether the selected region is antialiased, so the mask stores the
+ * coverage of the pixels on its edge instead of 0 or 255.
+ */
+void CompSourceImage::set_antialiasing(bool flag)
+{
+    rasterizer_.set_antialiasing(flag);
+}
+
 /**
  * @brief Get the start position of the source image.
  * @return The start position of the source image, in the form of ImVec2.
@@ -372,153 +375,49 @@ ImVec2 CompSourceImage::get_position() const
 
 /**
  * @brief Scanning line algorithm to fill the selected region.
+ * @param polygon The vertices of the region, the last one connected to the
+ * first one.
  */
-void CompSourceImage::init_selections()
+void CompSourceImage::init_selections(const std::vector<ImVec2>& polygon)
 {
-    for (int i = 0; i < selected_region_->width(); ++i)
-    {
-        for (int j = 0; j < selected_region_->height(); ++j)
-        {
-            selected_region_->set_pixel(i, j, { 0 });
-        }
-    }
-    // edge_points_.push_back(edge_points_[1]);  // For easy iteration
-    std::vector<
-        std::priority_queue<float, std::vector<float>, std::greater<float>>>
-        point_table(selected_region_->height());
-    /*
-    for (int i = 1; i < edge_points_.size() - 1; i++)
-    {
-        // Tackle with each point.
-        if ((edge_points_[i - 1].y - edge_points_[i].y) *
-                (edge_points_[i + 1].y - edge_points_[i].y) <
-            0)
-        {
-            // In different sides of the horizontal line.
-            point_table[(int)edge_points_[i].y].push(edge_points_[i].x);
-        }
-        // Tackle with horizontal line. There are four cases.
-        else if (
-            (edge_points_[i - 1].y == edge_points_[i].y &&
-             edge_points_[i + 1].y < edge_points_[i].y) ||
-            (edge_points_[i - 1].y < edge_points_[i].y &&
-             edge_points_[i + 1].y == edge_points_[i].y))
-        {
-            point_table[(int)edge_points_[i].y].push(edge_points_[i].x);
-        }
-        // If edge_points_[i - 1].y == edge_points_[i].y and edge_points_[i +
-        // 1].y == edge_points_[i].y, do nothing.
-    }
-    edge_points_.pop_back();
-    for (int i = 0; i < edge_points_.size() - 1; i++)
-    {
-        // Tackle with each line.
-        float k = (edge_points_[i + 1].y - edge_points_[i].y) /
-                  (edge_points_[i + 1].x - edge_points_[i].x);
-        float b = edge_points_[i].y - k * edge_points_[i].x;
-        float y1 = edge_points_[i].y, y2 = edge_points_[i + 1].y;
-        if (y1 > y2)
-        {
-            std::swap(y1, y2);
-        }
-        for (int y = (int)y1 + 1; y < (int)y2; y++)
-        {
-            float x = (y - b) / k;
-            x = std::clamp(x, 0.0f, (float)selected_region_->width());
-            point_table[y].push(x);
-        }
-    }
-    */
-
-    // Consider that y may not be integer, the method above considering
-    // intersection at point may not work. Add 0.1 to each y to make sure that
-    // every y is float.
-    float d = 0.1f;
-    for (int i = 0; i < edge_points_.size(); i++)
-    {
-        edge_points_[i].y += d;
-    }
-    // For each edge, we add intersections with horizontal lines.
-    for (int i = 0; i < edge_points_.size() - 1; i++)
-    {
-        float y1 = edge_points_[i].y, y2 = edge_points_[i + 1].y;
-        if (y1 > y2)
-        {
-            std::swap(y1, y2);
-        }
-        if (edge_points_[i + 1].x == edge_points_[i].x)
-        {
-            for (int y = (int)y1 + 1; y <= (int)y2; y++)
-            {
-                point_table[y].push(edge_points_[i].x);
-            }
-        }
-        else
-        {
-            float k = (edge_points_[i + 1].y - edge_points_[i].y) /
-                      (edge_points_[i + 1].x - edge_points_[i].x);
-            float b = edge_points_[i].y - k * edge_points_[i].x;
-            for (int y = (int)y1 + 1; y <= (int)y2; y++)
-            {
-                float x = (y - b) / k;
-                point_table[y].push(x);
-            }
-        }
-    }
-    for (int i = 0; i < edge_points_.size(); i++)
-    {
-        edge_points_[i].y -= d;
-    }
-
-    // Point table is ready. Now fill the region.
-    for (int i = (int)start_.y; i <= end_.y; i++)
-    {
-        while (!point_table[i].empty())
-        {
-            int x_1 = (int)point_table[i].top();
-            point_table[i].pop();
-            if (point_table[i].empty())
-            {
-                throw std::exception(
-                    "Bug: point_table[%d] only have odd number of elements", i);
-            }
-            int x_2 = (int)point_table[i].top();
-            point_table[i].pop();
-            x_1 = std::clamp(x_1, 0, selected_region_->width() - 1);
-            x_2 = std::clamp(x_2, 0, selected_region_->width() - 1);
-            for (int j = x_1; j <= x_2; j++)
-            {
-                selected_region_->set_pixel(j, i, { 255 });
-            }
-        }
-    }
+    rasterizer_.rasterize(polygon, *selected_region_);
     return;
 }
 
 /**
- * @brief Initialize the selected region by giving every point an id.
+ * @brief Initialize the selected region by giving every point an id. The
+ * points come from the rasterizer, row by row. The map from points to ids
+ * only covers their bounding box, so a small selection in a large image stays
+ * cheap.
  */
 void CompSourceImage::init_id()
 {
-    point_to_id_.clear();
-    id_to_point_.clear();
-    point_to_id_.resize(selected_region_->width());
-    for (int i = 0; i < selected_region_->width(); i++)
+    id_to_point_ = rasterizer_.points();
+    if (id_to_point_.empty())
     {
-        point_to_id_[i].resize(selected_region_->height());
+        point_to_id_.clear();
+        id_min_x_ = id_min_y_ = id_width_ = id_height_ = 0;
+        return;
     }
-    int id = 1;
-    for (int i = 0; i < selected_region_->width(); i++)
+
+    int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+    for (const ImVec2& point : id_to_point_)
     {
-        for (int j = 0; j < selected_region_->height(); j++)
-        {
-            if (selected_region_->get_pixel(i, j)[0] > 0)
-            {
-                point_to_id_[i][j] = id;
-                id_to_point_.push_back(ImVec2((float)i, (float)j));
-                id++;
-            }
-        }
+        min_x = std::min(min_x, (int)point.x);
+        min_y = std::min(min_y, (int)point.y);
+        max_x = std::max(max_x, (int)point.x);
+        max_y = std::max(max_y, (int)point.y);
+    }
+    id_min_x_ = min_x;
+    id_min_y_ = min_y;
+    id_width_ = max_x - min_x + 1;
+    id_height_ = max_y - min_y + 1;
+    point_to_id_.assign((std::size_t)id_width_ * id_height_, 0);
+    for (int i = 0; i < (int)id_to_point_.size(); i++)
+    {
+        int x = (int)id_to_point_[i].x - id_min_x_;
+        int y = (int)id_to_point_[i].y - id_min_y_;
+        point_to_id_[(std::size_t)y * id_width_ + x] = i + 1;
     }
 }
 
@@ -530,10 +429,11 @@ void CompSourceImage::init_id()
  */
 int CompSourceImage::get_id(ImVec2 point)
 {
-    if (point.x >= 0 && point.x < selected_region_->width() && point.y >= 0 &&
-        point.y < selected_region_->height())
+    int x = (int)point.x - id_min_x_, y = (int)point.y - id_min_y_;
+    if (point.x >= 0 && point.y >= 0 && x >= 0 && x < id_width_ && y >= 0 &&
+        y < id_height_)
     {
-        return point_to_id_[(int)point.x][(int)point.y];
+        return point_to_id_[(std::size_t)y * id_width_ + x];
     }
     return 0;
 }
@@ -562,59 +462,22 @@ int CompSourceImage::get_point_num()
 }
 
 /**
- * @brief Initialize matrix A in advance.
+ * @brief Initialize the equations of the selected region in advance.
  */
 void CompSourceImage::init_matrix()
 {
-    // We have formula: 4*f_p - Sum_{q in N(p) and Omega} f_q = Sum_{q
-    // in N(p) and NonOmega} f_q + 4*g_p - Sum_{q in N(p)} g_q, where
-    // g_p is the source image and f_p is the target image.
-
-    // Things in the left side of the equation are variables.
-
-    int point_num = (int)id_to_point_.size();
-
-    // Sparse matrix A and Triplet to build A.
-    A_.resize(point_num, point_num);
-    // Each point has 5 coefficients at most.
-    std::vector<Eigen::Triplet<float>> triplet;
-    triplet.reserve(point_num * 5);
-
-    for (int i = 0; i < point_num; i++)
+    if (id_to_point_.empty())
     {
-        // Make the formula coefficient No. i
-        int src_x = (int)id_to_point_[i].x;
-        int src_y = (int)id_to_point_[i].y;
-
-        // For each neighbor of the point
-        for (int j = -1; j <= 1; j++)
-        {
-            for (int k = -1; k <= 1; k++)
-            {
-                if ((abs(j) + abs(k) != 1) || src_x + j < 0 ||
-                    src_x + j >= data_->width() || src_y + k < 0 ||
-                    src_y + k >= data_->height())
-                {
-                    // Only consider 4 neighbors within the image
-                    continue;
-                }
-                int id = get_id(ImVec2((float)(src_x + j), (float)(src_y + k)));
-                if (id != 0)
-                {
-                    // Coefficient of f_q is -1
-                    triplet.push_back(Eigen::Triplet<float>(i, id - 1, -1));
-                }
-                // Add coefficient of f_i
-                triplet.push_back(Eigen::Triplet<float>(i, i, 1));
-            }
-        }
+        // Nothing is selected
+        flag_solver_ready_ = false;
+        return;
     }
-    A_.setFromTriplets(triplet.begin(), triplet.end());
 
-    solver_.compute(A_);
-    if (solver_.info() != Eigen::Success)
+    poisson_clone_.init(
+        *data_, *selected_region_, id_to_point_, rasterizer_.boundary());
+    if (!poisson_clone_.is_ready())
     {
-        // Decomposition failed
+        // No boundary condition, the region is the whole image
         throw std::exception("Decomposition failed");
     }
     flag_solver_ready_ = true;
@@ -622,19 +485,12 @@ void CompSourceImage::init_matrix()
 }
 
 /**
- * @brief The solver of A.
- * @param b The right-hand side of the equation.
- * @param x The solution of the equation.
+ * @brief Get the equations of the selected region.
+ * @return The equations, ready when is_solver_ready() is true.
  */
-void CompSourceImage::solver(Eigen::VectorXf& b, Eigen::VectorXf& x)
+const PoissonClone& CompSourceImage::get_poisson_clone() const
 {
-    x = solver_.solve(b);
-    if (solver_.info() != Eigen::Success)
-    {
-        // Solve failed
-        throw std::exception("Solve failed");
-    }
-    return;
+    return poisson_clone_;
 }
 
 /**
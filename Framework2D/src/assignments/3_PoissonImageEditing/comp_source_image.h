@@ -1,7 +1,7 @@
 #pragma once
 
-#include <Eigen/Sparse>
-
+#include "poisson_clone.h"
+#include "scanline_rasterizer.h"
 #include "view/comp_image.h"
 
 namespace USTC_CG
@@ -29,7 +29,10 @@ class CompSourceImage : public ImageEditor
     void enable_selecting(bool flag);
     void set_region_type(RegionType type);
     void select_region();
-    // Get the selected region in the source image, this would be a binary mask
+    // Store the coverage of the pixels on the edge in the mask
+    void set_antialiasing(bool flag);
+    // Get the selected region in the source image, this would be a binary mask,
+    // or the coverage of the pixels with antialiasing
     std::shared_ptr<Image> get_region();
     // Get the image data
     std::shared_ptr<Image> get_data();
@@ -37,7 +40,7 @@ class CompSourceImage : public ImageEditor
     ImVec2 get_position() const;
 
     // Scanning line algorithm to fill the selected region
-    void init_selections();
+    void init_selections(const std::vector<ImVec2>& polygon);
 
     // Initialize the selected region by giving every point an id
     void init_id();
@@ -48,11 +51,11 @@ class CompSourceImage : public ImageEditor
     // Get the number of points in the selected region
     int get_point_num();
 
-    // Initialize matrix A in advance
+    // Initialize the equations of the selected region in advance
     void init_matrix();
-    // The solver of A
-    void solver(Eigen::VectorXf& b, Eigen::VectorXf& x);
     bool is_solver_ready();
+    // The equations of the selected region, to clone it onto the target image
+    const PoissonClone& get_poisson_clone() const;
 
    private:
     RegionType region_type_ = kDefault;
@@ -66,13 +69,17 @@ class CompSourceImage : public ImageEditor
     bool flag_enable_selecting_region_ = false;
     bool draw_status_ = false;
 
-    // Calculate the id of a point in the selected region
-    std::vector<std::vector<int>> point_to_id_;
+    // Fill the polygon of the selected region
+    ScanlineRasterizer rasterizer_;
+
+    // Calculate the id of a point in the selected region. point_to_id_ only
+    // covers the bounding box of the region, row by row.
+    std::vector<int> point_to_id_;
+    int id_min_x_ = 0, id_min_y_ = 0, id_width_ = 0, id_height_ = 0;
     std::vector<ImVec2> id_to_point_;
 
-    // Store matrix A and solver
-    Eigen::SparseMatrix<float> A_;
-    Eigen::SimplicialLLT<Eigen::SparseMatrix<float>> solver_;
+    // Equations of the selected region
+    PoissonClone poisson_clone_;
 
     bool flag_solver_ready_ = false;
 };
@@ -1,7 +1,8 @@
 #include "comp_target_image.h"
 
-#include <Eigen/Sparse>
+#include <climits>
 #include <cmath>
+#include <cstring>
 
 namespace USTC_CG
 {
@@ -80,6 +81,8 @@ void CompTargetImage::set_realtime(bool flag)
 void CompTargetImage::restore()
 {
     *data_ = *back_up_;
+    cloned_min_x_ = cloned_min_y_ = INT_MAX;
+    cloned_max_x_ = cloned_max_y_ = INT_MIN;
     update();
 }
 
@@ -128,31 +131,40 @@ void CompTargetImage::clone()
     }
     std::shared_ptr<Image> mask = source_image_->get_region();
 
-    const int channel_num = 3;
-
     switch (clone_type_)
     {
         case USTC_CG::CompTargetImage::kDefault: break;
         case USTC_CG::CompTargetImage::kPaste:
         {
-            restore();
+            restore_cloned();
 
-            for (int i = 0; i < mask->width(); ++i)
+            const Image& src_data = *source_image_->get_data();
+            int bias_x =
+                (int)(mouse_position_.x - source_image_->get_position().x);
+            int bias_y =
+                (int)(mouse_position_.y - source_image_->get_position().y);
+            int channels = std::min(data_->channels(), src_data.channels());
+            // Only the selected points, rather than the whole mask
+            for (int i = 0; i < source_image_->get_point_num(); i++)
             {
-                for (int j = 0; j < mask->height(); ++j)
+                ImVec2 point = source_image_->get_point(i);
+                int tar_x = (int)point.x + bias_x;
+                int tar_y = (int)point.y + bias_y;
+                if (0 <= tar_x && tar_x < image_width_ && 0 <= tar_y &&
+                    tar_y < image_height_)
                 {
-                    int tar_x = i + (int)(mouse_position_.x -
-                                          source_image_->get_position().x);
-                    int tar_y = j + (int)(mouse_position_.y -
-                                          source_image_->get_position().y);
-                    if (0 <= tar_x && tar_x < image_width_ && 0 <= tar_y &&
-                        tar_y < image_height_ && mask->get_pixel(i, j)[0] > 0)
+                    const unsigned char* src =
+                        src_data.pixel_ptr((int)point.x, (int)point.y);
+                    unsigned char* c = data_->pixel_ptr(tar_x, tar_y);
+                    // With antialiasing, blend the edge by its coverage
+                    int alpha = mask->pixel_ptr((int)point.x, (int)point.y)[0];
+                    for (int l = 0; l < channels; l++)
                     {
-                        data_->set_pixel(
-                            tar_x,
-                            tar_y,
-                            source_image_->get_data()->get_pixel(i, j));
+                        c[l] = (unsigned char)(
+                            (src[l] * alpha + c[l] * (255 - alpha) + 127) /
+                            255);
                     }
+                    mark_cloned(tar_x, tar_y);
                 }
             }
             break;
@@ -163,107 +175,14 @@ void CompTargetImage::clone()
             clock_t start, end;
             start = clock();
 
-            // You should delete this block and implement your own seamless
-            // cloning. For each pixel in the selected region, calculate the
-            // final RGB color by solving Poisson Equations.
-            restore();
-
+            // For each pixel in the selected region, calculate the final RGB
+            // color by solving Poisson Equations, from the last solution.
+            restore_cloned();
             if (!source_image_->is_solver_ready())
             {
                 break;
             }
-
-            int point_num = source_image_->get_point_num();
-            std::shared_ptr<Image> src_data = source_image_->get_data();
-
-            // Calculate br, bg, bb and ba, which are the right sides of the
-            // equation.
-            Eigen::VectorXf b[channel_num];
-            for (int i = 0; i < channel_num; i++)
-            {
-                b[i] = Eigen::VectorXf::Zero(point_num);
-            }
-
-            int bias_x =
-                (int)(mouse_position_.x - source_image_->get_position().x);
-            int bias_y =
-                (int)(mouse_position_.y - source_image_->get_position().y);
-
-            for (int i = 0; i < point_num; i++)
-            {
-                // Make the formula No. i. Point is in the coordinate of the
-                // source image.
-                int src_x = (int)source_image_->get_point(i).x;
-                int src_y = (int)source_image_->get_point(i).y;
-                int tar_x = src_x + bias_x;
-                int tar_y = src_y + bias_y;
-
-                // For each neighbor of the point
-                for (int j = -1; j <= 1; j++)
-                {
-                    for (int k = -1; k <= 1; k++)
-                    {
-                        if ((abs(j) + abs(k) != 1) || src_x + j < 0 ||
-                            src_x + j >= src_data->width() || src_y + k < 0 ||
-                            src_y + k >= src_data->height())
-                        {
-                            // Only consider 4 neighbors within the image
-                            continue;
-                        }
-                        if (mask->get_pixel_unsafe(src_x + j, src_y + k, 0) ==
-                            0)
-                        {
-                            // Add f_q to the right side, which is the edge of
-                            // the target image
-                            int tarq_x =
-                                std::clamp<int>(tar_x + j, 0, image_width_ - 1);
-                            int tarq_y = std::clamp<int>(
-                                tar_y + k, 0, image_height_ - 1);
-                            for (int l = 0; l < channel_num; l++)
-                            {
-                                b[l](i) +=
-                                    data_->get_pixel_unsafe(tarq_x, tarq_y, l);
-                            }
-                        }
-                        // Add g_q to the right side, which represents the
-                        // gradient of the source image
-                        for (int l = 0; l < channel_num; l++)
-                        {
-                            b[l](i) +=
-                                (src_data->get_pixel_unsafe(src_x, src_y, l) -
-                                 src_data->get_pixel_unsafe(
-                                     src_x + j, src_y + k, l));
-                        }
-                    }
-                }
-            }
-
-            // Then solve the linear system
-            Eigen::VectorXf x[channel_num];
-            for (int i = 0; i < channel_num; i++)
-            {
-                source_image_->solver(b[i], x[i]);
-            }
-
-            // Set the result to the target image
-            for (int i = 0; i < point_num; i++)
-            {
-                int src_x = (int)source_image_->get_point(i).x;
-                int src_y = (int)source_image_->get_point(i).y;
-                int tar_x = src_x + bias_x;
-                int tar_y = src_y + bias_y;
-                if (0 <= tar_x && tar_x < image_width_ && 0 <= tar_y &&
-                    tar_y < image_height_)
-                {
-                    std::vector<unsigned char> c(channel_num);
-                    for (int l = 0; l < channel_num; l++)
-                    {
-                        c[l] = (unsigned char)std::clamp<float>(
-                            x[l](i), 0.0f, 255.0f);
-                    }
-                    data_->set_pixel(tar_x, tar_y, c);
-                }
-            }
+            clone_seamless(false);
 
             // End the timer
             end = clock();
@@ -279,137 +198,12 @@ void CompTargetImage::clone()
             clock_t start, end;
             start = clock();
 
-            restore();
-
+            restore_cloned();
             if (!source_image_->is_solver_ready())
             {
                 break;
             }
-
-            int point_num = source_image_->get_point_num();
-            std::shared_ptr<Image> src_data = source_image_->get_data();
-
-            // Calculate br, bg, bb and ba, which are the right sides of the
-            // equation.
-            Eigen::VectorXf b[channel_num];
-            for (int i = 0; i < channel_num; i++)
-            {
-                b[i] = Eigen::VectorXf::Zero(point_num);
-            }
-
-            int bias_x =
-                (int)(mouse_position_.x - source_image_->get_position().x);
-            int bias_y =
-                (int)(mouse_position_.y - source_image_->get_position().y);
-
-            for (int i = 0; i < point_num; i++)
-            {
-                // Make the formula No. i. Point is in the coordinate of the
-                // source image.
-                int src_x = (int)source_image_->get_point(i).x;
-                int src_y = (int)source_image_->get_point(i).y;
-                int tar_x = src_x + bias_x;
-                int tar_y = src_y + bias_y;
-
-                // For each neighbor of the point
-                for (int j = -1; j <= 1; j++)
-                {
-                    for (int k = -1; k <= 1; k++)
-                    {
-                        if ((abs(j) + abs(k) != 1) || src_x + j < 0 ||
-                            src_x + j >= src_data->width() || src_y + k < 0 ||
-                            src_y + k >= src_data->height())
-                        {
-                            // Only consider 4 neighbors within the image
-                            continue;
-                        }
-                        if (mask->get_pixel_unsafe(src_x + j, src_y + k, 0) ==
-                            0)
-                        {
-                            // Add f_q to the right side, which is the edge of
-                            // the target image
-                            int tarq_x =
-                                std::clamp<int>(tar_x + j, 0, image_width_ - 1);
-                            int tarq_y = std::clamp<int>(
-                                tar_y + k, 0, image_height_ - 1);
-                            for (int l = 0; l < channel_num; l++)
-                            {
-                                b[l](i) +=
-                                    data_->get_pixel_unsafe(tarq_x, tarq_y, l);
-                            }
-                        }
-                        // Add g_q to the right side, which represents the
-                        // gradient of the source image.
-
-                        // For mixed situation, we choose the bigger one of the
-                        // two gradients, as described in the paper.
-                        int tarq_x =
-                            std::clamp<int>(tar_x + j, 0, image_width_ - 1);
-                        int tarq_y =
-                            std::clamp<int>(tar_y + k, 0, image_height_ - 1);
-                        int tarp_x =
-                            std::clamp<int>(tar_x, 0, image_width_ - 1);
-                        int tarp_y =
-                            std::clamp<int>(tar_y, 0, image_height_ - 1);
-                        for (int l = 0; l < channel_num; l++)
-                        {
-                            // For each point pair (p, q), we choose the one
-                            // with bigger gradient.
-                            if (fabs(
-                                    data_->get_pixel_unsafe(tarp_x, tarp_y, l) -
-                                    data_->get_pixel_unsafe(
-                                        tarq_x, tarq_y, l)) >
-                                fabs(
-                                    src_data->get_pixel_unsafe(
-                                        src_x, src_y, l) -
-                                    src_data->get_pixel_unsafe(
-                                        src_x + j, src_y + k, l)))
-                            {
-                                b[l](i) +=
-                                    (data_->get_pixel_unsafe(
-                                         tarp_x, tarp_y, l) -
-                                     data_->get_pixel_unsafe(
-                                         tarq_x, tarq_y, l));
-                            }
-                            else
-                            {
-                                b[l](i) +=
-                                    (src_data->get_pixel_unsafe(
-                                         src_x, src_y, l) -
-                                     src_data->get_pixel_unsafe(
-                                         src_x + j, src_y + k, l));
-                            }
-                        }
-                    }
-                }
-            }
-
-            // Then solve the linear system
-            Eigen::VectorXf x[channel_num];
-            for (int i = 0; i < channel_num; i++)
-            {
-                source_image_->solver(b[i], x[i]);
-            }
-
-            // Set the result to the target image
-            for (int i = 0; i < point_num; i++)
-            {
-                int src_x = (int)source_image_->get_point(i).x;
-                int src_y = (int)source_image_->get_point(i).y;
-                int tar_x = src_x + bias_x;
-                int tar_y = src_y + bias_y;
-                if (0 <= tar_x && tar_x < image_width_ && 0 <= tar_y &&
-                    tar_y < image_height_)
-                {
-                    std::vector<unsigned char> c(channel_num);
-                    for (int l = 0; l < channel_num; l++)
-                    {
-                        c[l] = (unsigned char)std::clamp<float>(
-                            x[l](i), 0.0f, 255.0f);
-                    }
-                    data_->set_pixel(tar_x, tar_y, c);
-                }
-            }
+            clone_seamless(true);
 
             // End the timer
             end = clock();
@@ -424,4 +218,58 @@ void CompTargetImage::clone()
 
     update();
 };
+
+/**
+ * @brief Restore the rectangle written by the last clone, so the cost does not
+ * grow with the size of the target image.
+ */
+void CompTargetImage::restore_cloned()
+{
+    if (cloned_min_x_ > cloned_max_x_)
+    {
+        return;
+    }
+    std::size_t offset = (std::size_t)cloned_min_x_ * data_->channels();
+    std::size_t size =
+        (std::size_t)(cloned_max_x_ - cloned_min_x_ + 1) * data_->channels();
+    for (int y = cloned_min_y_; y <= cloned_max_y_; y++)
+    {
+        std::memcpy(data_->row(y) + offset, back_up_->row(y) + offset, size);
+    }
+    cloned_min_x_ = cloned_min_y_ = INT_MAX;
+    cloned_max_x_ = cloned_max_y_ = INT_MIN;
+}
+
+/**
+ * @brief Record that pixel (x, y) of the target image is written by the clone.
+ */
+void CompTargetImage::mark_cloned(int x, int y)
+{
+    cloned_min_x_ = std::min(cloned_min_x_, x);
+    cloned_min_y_ = std::min(cloned_min_y_, y);
+    cloned_max_x_ = std::max(cloned_max_x_, x);
+    cloned_max_y_ = std::max(cloned_max_y_, y);
+}
+
+/**
+ * @brief Clone the selected region by solving the Poisson equations at the
+ * mouse position, and record the pixels written.
+ * @param mixed Whether to use the larger of the source and target gradients.
+ */
+void CompTargetImage::clone_seamless(bool mixed)
+{
+    const PoissonClone& poisson_clone = source_image_->get_poisson_clone();
+    int bias_x = (int)(mouse_position_.x - source_image_->get_position().x);
+    int bias_y = (int)(mouse_position_.y - source_image_->get_position().y);
+    poisson_clone.clone(*back_up_, *data_, bias_x, bias_y, mixed, solution_);
+
+    ImVec2 min_point = poisson_clone.min_point();
+    ImVec2 max_point = poisson_clone.max_point();
+    mark_cloned(
+        std::clamp((int)min_point.x + bias_x, 0, image_width_ - 1),
+        std::clamp((int)min_point.y + bias_y, 0, image_height_ - 1));
+    mark_cloned(
+        std::clamp((int)max_point.x + bias_x, 0, image_width_ - 1),
+        std::clamp((int)max_point.y + bias_y, 0, image_height_ - 1));
+}
 }  // namespace USTC_CG
\ No newline at end of file
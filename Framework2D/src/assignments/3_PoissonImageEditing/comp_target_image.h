@@ -1,5 +1,7 @@
 #pragma once
 
+#include <climits>
+
 #include "comp_source_image.h"
 #include "view/comp_image.h"
 
@@ -37,11 +39,22 @@ class CompTargetImage : public ImageEditor
     void clone();
 
    private:
+    // Restore the pixels written by the last clone
+    void restore_cloned();
+    void mark_cloned(int x, int y);
+    // Solve the Poisson equations of the region at the mouse position
+    void clone_seamless(bool mixed);
+
     // Store the original image data
     std::shared_ptr<Image> back_up_;
     // Source image
     std::shared_ptr<CompSourceImage> source_image_;
     CloneType clone_type_ = kDefault;
+    // The last solution of the seamless cloning, to start the next one from
+    PoissonSolver::Values solution_;
+    // Bounding box of the pixels written by the last clone
+    int cloned_min_x_ = INT_MAX, cloned_min_y_ = INT_MAX;
+    int cloned_max_x_ = INT_MIN, cloned_max_y_ = INT_MIN;
 
     ImVec2 mouse_position_;
     bool edit_status_ = false;
@@ -0,0 +1,244 @@
+#include "poisson_clone.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace USTC_CG
+{
+/**
+ * @brief Set up the equations of a region.
+ * @param source The source image.
+ * @param mask The region, where the first channel of the pixels inside is not
+ * 0, of the size of the source image.
+ * @param points The pixels of the region, which number the unknowns.
+ * @param boundary Indices in points of the pixels with a 4-neighbor outside of
+ * the region.
+ */
+void PoissonClone::init(
+    const Image& source,
+    const Image& mask,
+    const std::vector<ImVec2>& points,
+    const std::vector<int>& boundary)
+{
+    points_ = points;
+    guidance_.clear();
+    neighbors_.clear();
+    neighbor_start_.clear();
+    boundary_.clear();
+    boundary_point_.clear();
+    // Things in the left side of the equation are variables
+    solver_.init(points_, source.width(), source.height());
+    if (!solver_.is_ready())
+    {
+        return;
+    }
+
+    // The neighbors and g_p - g_q don't change while the region is moved on
+    // the target image
+    int point_num = (int)points_.size();
+    int channel_num = std::min(source.channels(), kChannels);
+    min_point_ = max_point_ = points_.front();
+    guidance_.assign(point_num, Eigen::Array4f::Zero());
+    neighbors_.reserve(point_num * 4);
+    neighbor_start_.resize(point_num + 1);
+    for (int i = 0; i < point_num; i++)
+    {
+        neighbor_start_[i] = (int)neighbors_.size();
+        int src_x = (int)points_[i].x;
+        int src_y = (int)points_[i].y;
+        min_point_.x = std::min(min_point_.x, points_[i].x);
+        min_point_.y = std::min(min_point_.y, points_[i].y);
+        max_point_.x = std::max(max_point_.x, points_[i].x);
+        max_point_.y = std::max(max_point_.y, points_[i].y);
+        const unsigned char* p = source.pixel_ptr(src_x, src_y);
+
+        // For each neighbor of the point
+        for (int j = -1; j <= 1; j++)
+        {
+            for (int k = -1; k <= 1; k++)
+            {
+                if ((abs(j) + abs(k) != 1) || src_x + j < 0 ||
+                    src_x + j >= source.width() || src_y + k < 0 ||
+                    src_y + k >= source.height())
+                {
+                    // Only consider 4 neighbors within the image
+                    continue;
+                }
+                Neighbor neighbor;
+                neighbor.dx = j;
+                neighbor.dy = k;
+                neighbor.boundary = false;
+                neighbor.gradient = Eigen::Array4f::Zero();
+                const unsigned char* q = source.pixel_ptr(src_x + j, src_y + k);
+                for (int l = 0; l < channel_num; l++)
+                {
+                    neighbor.gradient[l] = (float)p[l] - (float)q[l];
+                }
+                guidance_[i] += neighbor.gradient;
+                neighbors_.push_back(neighbor);
+            }
+        }
+    }
+    neighbor_start_[point_num] = (int)neighbors_.size();
+
+    // Only the points on the boundary of the region have neighbors outside of
+    // it
+    for (int i : boundary)
+    {
+        int src_x = (int)points_[i].x;
+        int src_y = (int)points_[i].y;
+        for (int k = neighbor_start_[i]; k < neighbor_start_[i + 1]; k++)
+        {
+            Neighbor& neighbor = neighbors_[k];
+            if (mask.pixel_ptr(src_x + neighbor.dx, src_y + neighbor.dy)[0] ==
+                0)
+            {
+                neighbor.boundary = true;
+                boundary_.push_back(k);
+                boundary_point_.push_back(i);
+            }
+        }
+    }
+}
+
+bool PoissonClone::is_ready() const
+{
+    return solver_.is_ready();
+}
+
+int PoissonClone::size() const
+{
+    return (int)points_.size();
+}
+
+ImVec2 PoissonClone::min_point() const
+{
+    return min_point_;
+}
+
+ImVec2 PoissonClone::max_point() const
+{
+    return max_point_;
+}
+
+/**
+ * @brief Clone the region onto the target image, moved by (bias_x, bias_y).
+ * @param target The image giving the boundary condition, and the gradients of
+ * mixed cloning.
+ * @param result The image to write the region into, of the size of target. It
+ * may be target itself.
+ * @param mixed Whether to use the larger of the source and target gradients.
+ * @param x The initial guess, usually the last solution; the solution.
+ * @return The number of iterations of the solver.
+ */
+int PoissonClone::clone(
+    const Image& target,
+    Image& result,
+    int bias_x,
+    int bias_y,
+    bool mixed,
+    PoissonSolver::Values& x) const
+{
+    if (!is_ready())
+    {
+        return 0;
+    }
+    PoissonSolver::Values b;
+    right_side(target, bias_x, bias_y, mixed, b);
+    int iterations = solver_.solve(b, x);
+
+    // Set the result to the target image
+    int channel_num = std::min(result.channels(), kChannels);
+    int point_num = size();
+#pragma omp parallel for
+    for (int i = 0; i < point_num; i++)
+    {
+        int tar_x = (int)points_[i].x + bias_x;
+        int tar_y = (int)points_[i].y + bias_y;
+        if (0 <= tar_x && tar_x < result.width() && 0 <= tar_y &&
+            tar_y < result.height())
+        {
+            unsigned char* c = result.pixel_ptr(tar_x, tar_y);
+            for (int l = 0; l < channel_num; l++)
+            {
+                c[l] = (unsigned char)std::clamp<float>(x[i][l], 0.0f, 255.0f);
+            }
+        }
+    }
+    return iterations;
+}
+
+// Calculate b, the right sides of the equation of every channel
+void PoissonClone::right_side(
+    const Image& target,
+    int bias_x,
+    int bias_y,
+    bool mixed,
+    PoissonSolver::Values& b) const
+{
+    int width = target.width(), height = target.height();
+    int channel_num = std::min(target.channels(), kChannels);
+    if (!mixed)
+    {
+        // Sum_{q in N(p)} g_p - g_q only depends on the source image, so only
+        // f_q on the boundary of the region is added here.
+        b = guidance_;
+        for (std::size_t k = 0; k < boundary_.size(); k++)
+        {
+            const Neighbor& neighbor = neighbors_[boundary_[k]];
+            int i = boundary_point_[k];
+            int tarq_x = std::clamp<int>(
+                (int)points_[i].x + bias_x + neighbor.dx, 0, width - 1);
+            int tarq_y = std::clamp<int>(
+                (int)points_[i].y + bias_y + neighbor.dy, 0, height - 1);
+            const unsigned char* c = target.pixel_ptr(tarq_x, tarq_y);
+            for (int l = 0; l < channel_num; l++)
+            {
+                b[i][l] += c[l];
+            }
+        }
+        return;
+    }
+
+    int point_num = size();
+    b.assign(point_num, Eigen::Array4f::Zero());
+#pragma omp parallel for
+    for (int i = 0; i < point_num; i++)
+    {
+        int tar_x = (int)points_[i].x + bias_x;
+        int tar_y = (int)points_[i].y + bias_y;
+        const unsigned char* tarp = target.pixel_ptr(
+            std::clamp<int>(tar_x, 0, width - 1),
+            std::clamp<int>(tar_y, 0, height - 1));
+
+        // For each neighbor of the point
+        for (int k = neighbor_start_[i]; k < neighbor_start_[i + 1]; k++)
+        {
+            const Neighbor& neighbor = neighbors_[k];
+            const unsigned char* tarq = target.pixel_ptr(
+                std::clamp<int>(tar_x + neighbor.dx, 0, width - 1),
+                std::clamp<int>(tar_y + neighbor.dy, 0, height - 1));
+            for (int l = 0; l < channel_num; l++)
+            {
+                if (neighbor.boundary)
+                {
+                    // Add f_q to the right side, which is the edge of the
+                    // target image
+                    b[i][l] += tarq[l];
+                }
+                // For mixed situation, we choose the bigger one of the two
+                // gradients, as described in the paper.
+                float gradient = (float)tarp[l] - (float)tarq[l];
+                if (fabs(gradient) > fabs(neighbor.gradient[l]))
+                {
+                    b[i][l] += gradient;
+                }
+                else
+                {
+                    b[i][l] += neighbor.gradient[l];
+                }
+            }
+        }
+    }
+}
+}  // namespace USTC_CG
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+
+#include "imgui.h"
+#include "poisson_solver.h"
+#include "view/image.h"
+
+namespace USTC_CG
+{
+// The Poisson equations of seamless cloning for a region of a source image:
+// 4*f_p - Sum_{q in N(p) and Omega} f_q = Sum_{q in N(p) and NonOmega} f_q +
+// 4*g_p - Sum_{q in N(p)} g_q, where g_p is the source image and f_p is the
+// target image.
+//
+// Everything only depending on the source image is computed once for the
+// region, so cloning it at another position only gathers the target pixels
+// around it. It doesn't depend on the GUI, and is shared by the editor and the
+// command line tool.
+class PoissonClone
+{
+   public:
+    // The RGB channels are cloned, the alpha channel of the target is kept
+    static constexpr int kChannels = 3;
+
+    /**
+     * @brief Set up the equations of a region.
+     * @param source The source image.
+     * @param mask The region, where the first channel of the pixels inside is
+     * not 0, of the size of the source image.
+     * @param points The pixels of the region, which number the unknowns.
+     * @param boundary Indices in points of the pixels with a 4-neighbor outside
+     * of the region.
+     */
+    void init(
+        const Image& source,
+        const Image& mask,
+        const std::vector<ImVec2>& points,
+        const std::vector<int>& boundary);
+    // False if the region is empty, or has no boundary condition
+    bool is_ready() const;
+    int size() const;
+    // Bounding box of the region in the source image
+    ImVec2 min_point() const;
+    ImVec2 max_point() const;
+
+    /**
+     * @brief Clone the region onto the target image, moved by (bias_x,
+     * bias_y).
+     * @param target The image giving the boundary condition, and the gradients
+     * of mixed cloning.
+     * @param result The image to write the region into, of the size of target.
+     * It may be target itself.
+     * @param mixed Whether to use the larger of the source and target
+     * gradients.
+     * @param x The initial guess, usually the last solution; the solution.
+     * @return The number of iterations of the solver.
+     */
+    int clone(
+        const Image& target,
+        Image& result,
+        int bias_x,
+        int bias_y,
+        bool mixed,
+        PoissonSolver::Values& x) const;
+
+   private:
+    // A 4-neighbor q of pixel p in the region, both inside of the image,
+    // which gives a term in the equation of p
+    struct Neighbor
+    {
+        // Offset from p to q
+        int dx, dy;
+        // Whether q is outside of the region, on its boundary
+        bool boundary;
+        // g_p - g_q of the source image
+        Eigen::Array4f gradient;
+    };
+
+    void right_side(
+        const Image& target,
+        int bias_x,
+        int bias_y,
+        bool mixed,
+        PoissonSolver::Values& b) const;
+
+    std::vector<ImVec2> points_;
+    ImVec2 min_point_, max_point_;
+    PoissonSolver solver_;
+    // Sum_{q in N(p)} g_p - g_q of every point
+    PoissonSolver::Values guidance_;
+    // Neighbors of point i are neighbors_[neighbor_start_[i]] to
+    // neighbors_[neighbor_start_[i + 1] - 1]
+    std::vector<Neighbor> neighbors_;
+    std::vector<int> neighbor_start_;
+    // Indices of the neighbors on the boundary of the region, and their points
+    std::vector<int> boundary_, boundary_point_;
+};
+}  // namespace USTC_CG
@@ -0,0 +1,340 @@
+#include "poisson_solver.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace USTC_CG
+{
+// Levels with at most this number of unknowns are factored
+static constexpr int kCoarsestSize = 512;
+// Jacobi sweeps before and after the coarse correction
+static constexpr int kSmoothSteps = 2;
+static constexpr float kJacobiWeight = 0.8f;
+// Merging pixels into blocks makes the coarse correction about half as large
+// as it should be, so it is doubled
+static constexpr float kCoarseWeight = 2.0f;
+static constexpr int kMaxIterations = 500;
+
+static Eigen::Array4f dot(
+    const PoissonSolver::Values& a,
+    const PoissonSolver::Values& b)
+{
+    Eigen::Array4f sum = Eigen::Array4f::Zero();
+    for (std::size_t i = 0; i < a.size(); i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// a / b, 0 for the channels where b is 0
+static Eigen::Array4f safe_divide(
+    const Eigen::Array4f& a,
+    const Eigen::Array4f& b)
+{
+    return (b != 0).select(a / b, Eigen::Array4f::Zero());
+}
+
+/**
+ * @brief Set up the levels for the given pixels.
+ * @param points The pixels of the region, whose order numbers the unknowns.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ */
+void PoissonSolver::init(
+    const std::vector<ImVec2>& points,
+    int width,
+    int height)
+{
+    levels_.clear();
+    if (points.empty())
+    {
+        return;
+    }
+
+    // The finest level is the 5-point Laplacian of the region
+    int n = (int)points.size();
+    Level finest;
+    finest.x.resize(n);
+    finest.y.resize(n);
+    int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+    for (int i = 0; i < n; i++)
+    {
+        finest.x[i] = (int)points[i].x;
+        finest.y[i] = (int)points[i].y;
+        min_x = std::min(min_x, finest.x[i]);
+        min_y = std::min(min_y, finest.y[i]);
+        max_x = std::max(max_x, finest.x[i]);
+        max_y = std::max(max_y, finest.y[i]);
+    }
+    // The maps from pixels to unknowns only cover the bounding box of the
+    // region, so a small region in a large image stays cheap
+    int box_width = max_x - min_x + 1, box_height = max_y - min_y + 1;
+    std::vector<int> id((std::size_t)box_width * box_height, -1);
+    for (int i = 0; i < n; i++)
+    {
+        id[(std::size_t)(finest.y[i] - min_y) * box_width + finest.x[i] -
+           min_x] = i;
+    }
+    std::vector<Eigen::Triplet<float>> triplets;
+    triplets.reserve((std::size_t)n * 5);
+    const int dx[4] = { -1, 1, 0, 0 }, dy[4] = { 0, 0, -1, 1 };
+    for (int i = 0; i < n; i++)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            int x = finest.x[i] + dx[k], y = finest.y[i] + dy[k];
+            if (x < 0 || x >= width || y < 0 || y >= height)
+            {
+                // Only consider 4 neighbors within the image
+                continue;
+            }
+            triplets.emplace_back(i, i, 1.0f);
+            if (x < min_x || x > max_x || y < min_y || y > max_y)
+            {
+                continue;
+            }
+            int j = id[(std::size_t)(y - min_y) * box_width + x - min_x];
+            if (j >= 0)
+            {
+                triplets.emplace_back(i, j, -1.0f);
+            }
+        }
+    }
+    finest.A.resize(n, n);
+    finest.A.setFromTriplets(triplets.begin(), triplets.end());
+    levels_.push_back(std::move(finest));
+
+    // Merge 2 * 2 blocks until the level is small enough
+    while (levels_.back().A.rows() > kCoarsestSize)
+    {
+        Level& fine = levels_.back();
+        int fine_n = (int)fine.A.rows();
+        min_x /= 2;
+        min_y /= 2;
+        max_x /= 2;
+        max_y /= 2;
+        box_width = max_x - min_x + 1;
+        box_height = max_y - min_y + 1;
+        std::vector<int> coarse_id((std::size_t)box_width * box_height, -1);
+        Level coarse;
+        fine.parent.resize(fine_n);
+        for (int i = 0; i < fine_n; i++)
+        {
+            int x = fine.x[i] / 2, y = fine.y[i] / 2;
+            int& c =
+                coarse_id[(std::size_t)(y - min_y) * box_width + x - min_x];
+            if (c < 0)
+            {
+                c = (int)coarse.x.size();
+                coarse.x.push_back(x);
+                coarse.y.push_back(y);
+            }
+            fine.parent[i] = c;
+        }
+        int coarse_n = (int)coarse.x.size();
+        if (coarse_n == fine_n)
+        {
+            // Scattered pixels don't merge any more, factor this level
+            fine.parent.clear();
+            break;
+        }
+
+        // A_c(I, J) = Sum_{i in I, j in J} A(i, j)
+        triplets.clear();
+        for (int i = 0; i < fine_n; i++)
+        {
+            for (Eigen::SparseMatrix<float, Eigen::RowMajor>::InnerIterator it(
+                     fine.A, i);
+                 it;
+                 ++it)
+            {
+                triplets.emplace_back(
+                    fine.parent[i], fine.parent[it.col()], it.value());
+            }
+        }
+        coarse.A.resize(coarse_n, coarse_n);
+        coarse.A.setFromTriplets(triplets.begin(), triplets.end());
+        levels_.push_back(std::move(coarse));
+    }
+
+    for (Level& level : levels_)
+    {
+        level.inv_diag = level.A.diagonal().cwiseInverse();
+    }
+    coarsest_.compute(Eigen::SparseMatrix<float>(levels_.back().A));
+    if (coarsest_.info() != Eigen::Success)
+    {
+        // The region covers the whole image, no boundary condition
+        levels_.clear();
+    }
+}
+
+/**
+ * @brief Check if the solver is ready.
+ */
+bool PoissonSolver::is_ready() const
+{
+    return !levels_.empty();
+}
+
+/**
+ * @brief The number of unknowns.
+ */
+int PoissonSolver::size() const
+{
+    return levels_.empty() ? 0 : (int)levels_.front().A.rows();
+}
+
+void PoissonSolver::set_tolerance(float tolerance)
+{
+    tolerance_ = tolerance;
+}
+
+/**
+ * @brief Solve A x = b, starting from x.
+ * @param b The right-hand side of the equation.
+ * @param x The initial guess, reset to 0 if its size is not size(); the
+ * solution.
+ * @return The number of iterations.
+ */
+int PoissonSolver::solve(const Values& b, Values& x) const
+{
+    int n = size();
+    if ((int)x.size() != n)
+    {
+        x.assign(n, Eigen::Array4f::Zero());
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    const Level& finest = levels_.front();
+    Values r(n), z(n), p(n), Ap(n);
+    multiply(finest, x, Ap);
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+    {
+        r[i] = b[i] - Ap[i];
+    }
+    Eigen::Array4f threshold = dot(b, b) * (tolerance_ * tolerance_);
+
+    v_cycle(0, r, z);
+    p = z;
+    Eigen::Array4f rz = dot(r, z);
+    int iteration = 0;
+    for (; iteration < kMaxIterations; iteration++)
+    {
+        if ((dot(r, r) <= threshold).all())
+        {
+            break;
+        }
+        multiply(finest, p, Ap);
+        Eigen::Array4f alpha = safe_divide(rz, dot(p, Ap));
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+        {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+        }
+        v_cycle(0, r, z);
+        Eigen::Array4f rz_new = dot(r, z);
+        Eigen::Array4f beta = safe_divide(rz_new, rz);
+        rz = rz_new;
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+        {
+            p[i] = z[i] + beta * p[i];
+        }
+    }
+    return iteration;
+}
+
+void PoissonSolver::multiply(
+    const Level& level,
+    const Values& x,
+    Values& result) const
+{
+    const int* outer = level.A.outerIndexPtr();
+    const int* inner = level.A.innerIndexPtr();
+    const float* values = level.A.valuePtr();
+    int n = (int)level.A.rows();
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+    {
+        Eigen::Array4f sum = Eigen::Array4f::Zero();
+        for (int k = outer[i]; k < outer[i + 1]; k++)
+        {
+            sum += values[k] * x[inner[k]];
+        }
+        result[i] = sum;
+    }
+}
+
+// Weighted Jacobi, which keeps the V-cycle symmetric as CG needs
+void PoissonSolver::smooth(
+    const Level& level,
+    const Values& b,
+    Values& x,
+    Values& tmp) const
+{
+    int n = (int)level.A.rows();
+    for (int step = 0; step < kSmoothSteps; step++)
+    {
+        multiply(level, x, tmp);
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+        {
+            x[i] += kJacobiWeight * level.inv_diag[i] * (b[i] - tmp[i]);
+        }
+    }
+}
+
+/**
+ * @brief Approximate A^-1 r on level k by a V-cycle starting from 0.
+ */
+void PoissonSolver::v_cycle(int k, const Values& r, Values& z) const
+{
+    const Level& level = levels_[k];
+    int n = (int)level.A.rows();
+    z.assign(n, Eigen::Array4f::Zero());
+
+    if (k + 1 == (int)levels_.size())
+    {
+        Eigen::MatrixXf rhs(n, 4);
+        for (int i = 0; i < n; i++)
+        {
+            rhs.row(i) = r[i].matrix().transpose();
+        }
+        Eigen::MatrixXf solution = coarsest_.solve(rhs);
+        for (int i = 0; i < n; i++)
+        {
+            z[i] = solution.row(i).transpose().array();
+        }
+        return;
+    }
+
+    Values& tmp = level.tmp;
+    tmp.resize(n);
+    smooth(level, r, z, tmp);
+
+    // Restrict the residual, correct with the coarse solution
+    const Level& coarse = levels_[k + 1];
+    multiply(level, z, tmp);
+    coarse.r.assign(coarse.A.rows(), Eigen::Array4f::Zero());
+    for (int i = 0; i < n; i++)
+    {
+        coarse.r[level.parent[i]] += r[i] - tmp[i];
+    }
+    v_cycle(k + 1, coarse.r, coarse.z);
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+    {
+        z[i] += kCoarseWeight * coarse.z[level.parent[i]];
+    }
+
+    smooth(level, r, z, tmp);
+}
+}  // namespace USTC_CG
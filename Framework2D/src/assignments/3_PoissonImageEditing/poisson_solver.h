@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <vector>
+
+#include "imgui.h"
+
+namespace USTC_CG
+{
+// Solver of the Poisson equations of seamless cloning, for all the channels at
+// once: 4*f_p - Sum_{q in N(p) and Omega} f_q = b_p, where the diagonal only
+// counts the neighbors inside of the image.
+//
+// It runs conjugate gradients preconditioned by a multigrid V-cycle. Each
+// coarser level merges the pixels of 2 * 2 blocks, and its matrix is the
+// Galerkin product P^T A P, so any shape of mask works. Unlike a sparse
+// factorization, the memory stays linear in the number of pixels. The solve
+// starts from the given x, so the previous solution makes a good guess while
+// the region is dragged.
+class PoissonSolver
+{
+   public:
+    // One value per unknown, for up to 4 channels
+    using Values = std::vector<Eigen::Array4f>;
+
+    /**
+     * @brief Set up the levels for the given pixels.
+     * @param points The pixels of the region, whose order numbers the unknowns.
+     * @param width The width of the image.
+     * @param height The height of the image.
+     */
+    void init(const std::vector<ImVec2>& points, int width, int height);
+    bool is_ready() const;
+    int size() const;
+
+    /**
+     * @brief Solve A x = b, starting from x.
+     * @param b The right-hand side of the equation.
+     * @param x The initial guess, reset to 0 if its size is not size(); the
+     * solution.
+     * @return The number of iterations.
+     */
+    int solve(const Values& b, Values& x) const;
+
+    // Stop when the residual of every channel is below tolerance * |b|
+    void set_tolerance(float tolerance);
+
+   private:
+    struct Level
+    {
+        // Row major, with the diagonal
+        Eigen::SparseMatrix<float, Eigen::RowMajor> A;
+        Eigen::VectorXf inv_diag;
+        // Position on the grid of the level, half of the finer one
+        std::vector<int> x, y;
+        // Unknown of the coarser level this one is merged into
+        std::vector<int> parent;
+        // Work space of the V-cycle
+        mutable Values r, z, tmp;
+    };
+
+    void multiply(const Level& level, const Values& x, Values& result) const;
+    void smooth(
+        const Level& level,
+        const Values& b,
+        Values& x,
+        Values& tmp) const;
+    // Approximate A^-1 r on level k, into z
+    void v_cycle(int k, const Values& r, Values& z) const;
+
+    std::vector<Level> levels_;
+    // Factorization of the coarsest level
+    Eigen::SimplicialLLT<Eigen::SparseMatrix<float>> coarsest_;
+    float tolerance_ = 1e-4f;
+};
+}  // namespace USTC_CG
@@ -0,0 +1,249 @@
+#include "scanline_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace USTC_CG
+{
+// Scanlines per row of pixels with antialiasing
+static constexpr int kSamples = 4;
+
+void ScanlineRasterizer::set_antialiasing(bool flag)
+{
+    flag_antialiasing_ = flag;
+}
+
+bool ScanlineRasterizer::antialiasing() const
+{
+    return flag_antialiasing_;
+}
+
+const std::vector<ImVec2>& ScanlineRasterizer::points() const
+{
+    return points_;
+}
+
+const std::vector<int>& ScanlineRasterizer::boundary() const
+{
+    return boundary_;
+}
+
+/**
+ * @brief Fill a polygon into a mask.
+ * @param polygon The vertices of the polygon, in pixels. The last one is
+ * connected to the first one. Self-intersections use the even-odd rule.
+ * @param mask A one-channel image, cleared and filled with the coverage of the
+ * pixels.
+ */
+void ScanlineRasterizer::rasterize(
+    const std::vector<ImVec2>& polygon,
+    Image& mask)
+{
+    mask.fill({ 0 });
+    points_.clear();
+    boundary_.clear();
+    int width = mask.width(), height = mask.height();
+    if (polygon.size() < 3 || width == 0 || height == 0)
+    {
+        return;
+    }
+
+    // Sample k is the scanline at y = (k + 0.5) / samples, and an edge from y0
+    // to y1 crosses the samples in [y0, y1), so a vertex shared by two edges
+    // is only counted once.
+    int samples = flag_antialiasing_ ? kSamples : 1;
+    edges_.clear();
+    for (std::size_t i = 0; i < polygon.size(); i++)
+    {
+        ImVec2 p0 = polygon[i];
+        ImVec2 p1 = polygon[(i + 1) % polygon.size()];
+        if (p0.y == p1.y)
+        {
+            // Horizontal edges don't cross any scanline
+            continue;
+        }
+        if (p0.y > p1.y)
+        {
+            std::swap(p0, p1);
+        }
+        Edge edge;
+        edge.first = std::max((int)std::ceil(p0.y * samples - 0.5f), 0);
+        edge.last =
+            std::min((int)std::ceil(p1.y * samples - 0.5f), height * samples);
+        if (edge.first >= edge.last)
+        {
+            continue;
+        }
+        edge.dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+        edge.x = p0.x - p0.y * edge.dxdy;
+        edges_.push_back(edge);
+    }
+    if (edges_.empty())
+    {
+        return;
+    }
+
+    // The edge table, ordered by the first sample of the edges
+    edge_order_.resize(edges_.size());
+    for (std::size_t i = 0; i < edges_.size(); i++)
+    {
+        edge_order_[i] = (int)i;
+    }
+    std::sort(
+        edge_order_.begin(),
+        edge_order_.end(),
+        [this](int a, int b) { return edges_[a].first < edges_[b].first; });
+    int first_sample = edges_[edge_order_.front()].first;
+    int last_sample = 0;
+    for (const Edge& edge : edges_)
+    {
+        last_sample = std::max(last_sample, edge.last);
+    }
+
+    coverage_.assign(width + 1, 0.0f);
+    run_.assign(width + 1, 0.0f);
+    active_.clear();
+    row_start_.clear();
+    first_row_ = first_sample / samples;
+    int last_row = (last_sample - 1) / samples;
+    std::size_t next_edge = 0;
+    for (int y = first_row_; y <= last_row; y++)
+    {
+        unsigned char* row = mask.row(y);
+        int touched_min = width, touched_max = -1;
+        for (int k = y * samples; k < (y + 1) * samples; k++)
+        {
+            // Update the active edges
+            while (next_edge < edge_order_.size() &&
+                   edges_[edge_order_[next_edge]].first <= k)
+            {
+                active_.push_back(edge_order_[next_edge]);
+                next_edge++;
+            }
+            active_.erase(
+                std::remove_if(
+                    active_.begin(),
+                    active_.end(),
+                    [this, k](int e) { return edges_[e].last <= k; }),
+                active_.end());
+            intersect(((float)k + 0.5f) / (float)samples);
+
+            // Fill between the pairs of intersections
+            for (std::size_t i = 0; i + 1 < crossings_.size(); i += 2)
+            {
+                float a = std::clamp(crossings_[i], 0.0f, (float)width);
+                float b = std::clamp(crossings_[i + 1], 0.0f, (float)width);
+                if (!flag_antialiasing_)
+                {
+                    // The pixels whose centers are in [a, b)
+                    int x0 = (int)std::ceil(a - 0.5f);
+                    int x1 = (int)std::ceil(b - 0.5f);
+                    if (x0 < x1)
+                    {
+                        std::memset(row + x0, 255, x1 - x0);
+                        touched_min = std::min(touched_min, x0);
+                        touched_max = std::max(touched_max, x1 - 1);
+                    }
+                    continue;
+                }
+                if (a >= b)
+                {
+                    continue;
+                }
+                // Partly covered pixels at the ends, and the run of fully
+                // covered ones in between
+                int x0 = (int)a, x1 = (int)b;
+                if (x0 == x1)
+                {
+                    coverage_[x0] += b - a;
+                }
+                else
+                {
+                    coverage_[x0] += (float)(x0 + 1) - a;
+                    run_[x0 + 1] += 1.0f;
+                    run_[x1] -= 1.0f;
+                    coverage_[x1] += b - (float)x1;
+                }
+                touched_min = std::min(touched_min, x0);
+                touched_max = std::max(touched_max, x1);
+            }
+        }
+
+        if (flag_antialiasing_)
+        {
+            float run = 0;
+            for (int x = touched_min; x <= touched_max; x++)
+            {
+                run += run_[x];
+                if (x < width)
+                {
+                    float covered = (coverage_[x] + run) / (float)samples;
+                    row[x] = (unsigned char)std::min(
+                        covered * 255.0f + 0.5f, 255.0f);
+                }
+                coverage_[x] = 0;
+                run_[x] = 0;
+            }
+        }
+
+        collect_row(mask, y, touched_min, std::min(touched_max, width - 1));
+        if (y > first_row_)
+        {
+            collect_boundary(mask, y - 1);
+        }
+    }
+    collect_boundary(mask, last_row);
+}
+
+// Add the intersections of the sample at y with the active edges, in order
+void ScanlineRasterizer::intersect(float y)
+{
+    crossings_.clear();
+    for (int e : active_)
+    {
+        crossings_.push_back(edges_[e].x + y * edges_[e].dxdy);
+    }
+    std::sort(crossings_.begin(), crossings_.end());
+}
+
+// List the selected pixels of row y, which are between x_min and x_max
+void ScanlineRasterizer::collect_row(
+    const Image& mask,
+    int y,
+    int x_min,
+    int x_max)
+{
+    row_start_.push_back((int)points_.size());
+    const unsigned char* row = mask.row(y);
+    for (int x = x_min; x <= x_max; x++)
+    {
+        if (row[x] > 0)
+        {
+            points_.push_back(ImVec2((float)x, (float)y));
+        }
+    }
+}
+
+// Find the selected pixels of row y on the boundary, once rows y - 1 to y + 1
+// of the mask are filled
+void ScanlineRasterizer::collect_boundary(const Image& mask, int y)
+{
+    int row = y - first_row_;
+    int begin = row_start_[row];
+    int end = row + 1 < (int)row_start_.size() ? row_start_[row + 1]
+                                               : (int)points_.size();
+    int width = mask.width(), height = mask.height();
+    for (int i = begin; i < end; i++)
+    {
+        int x = (int)points_[i].x;
+        if ((x > 0 && mask.row(y)[x - 1] == 0) ||
+            (x + 1 < width && mask.row(y)[x + 1] == 0) ||
+            (y > 0 && mask.row(y - 1)[x] == 0) ||
+            (y + 1 < height && mask.row(y + 1)[x] == 0))
+        {
+            boundary_.push_back(i);
+        }
+    }
+}
+}  // namespace USTC_CG
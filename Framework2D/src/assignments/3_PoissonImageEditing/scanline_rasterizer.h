@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+#include "imgui.h"
+#include "view/image.h"
+
+namespace USTC_CG
+{
+// Fills closed polygons into region masks with the scanline algorithm. The
+// edges are bucketed by their first scanline, and only the edges crossing the
+// current scanline are kept active, so the cost is bounded by the size of the
+// region and the number of edges rather than the size of the image.
+//
+// The selected pixels are listed row by row while they are filled, together
+// with the ones on the boundary of the region, so the ids of the Poisson
+// equations don't need another scan of the mask.
+class ScanlineRasterizer
+{
+   public:
+    // With antialiasing, every pixel is sampled by several scanlines and the
+    // mask stores how much of it is covered, 1 to 255. Otherwise a pixel is
+    // selected, with 255, when its center is inside of the polygon.
+    void set_antialiasing(bool flag);
+    bool antialiasing() const;
+
+    /**
+     * @brief Fill a polygon into a mask.
+     * @param polygon The vertices of the polygon, in pixels. The last one is
+     * connected to the first one. Self-intersections use the even-odd rule.
+     * @param mask A one-channel image, cleared and filled with the coverage of
+     * the pixels.
+     */
+    void rasterize(const std::vector<ImVec2>& polygon, Image& mask);
+
+    // The pixels selected by the last rasterize(), row by row
+    const std::vector<ImVec2>& points() const;
+    // Indices in points() of the selected pixels with a 4-neighbor inside of
+    // the image but not selected
+    const std::vector<int>& boundary() const;
+
+   private:
+    struct Edge
+    {
+        // The edge covers the samples first to last - 1
+        int first, last;
+        // x at y = 0, and its change per pixel of y
+        float x, dxdy;
+    };
+
+    // Add the intersections of the sample at y with the active edges, in order
+    void intersect(float y);
+    // List the selected pixels of row y, which are between x_min and x_max
+    void collect_row(const Image& mask, int y, int x_min, int x_max);
+    // Find the selected pixels of row y on the boundary, once rows y - 1 to
+    // y + 1 of the mask are filled
+    void collect_boundary(const Image& mask, int y);
+
+    bool flag_antialiasing_ = false;
+    std::vector<ImVec2> points_;
+    std::vector<int> boundary_;
+
+    // Work space, kept between the calls
+    std::vector<Edge> edges_;
+    std::vector<int> edge_order_;
+    std::vector<int> active_;
+    std::vector<float> crossings_;
+    // Coverage of the partly covered pixels of a row, and the changes of the
+    // number of samples fully covering them, from left to right
+    std::vector<float> coverage_, run_;
+    // Index in points_ of the first pixel of every row from first_row_
+    std::vector<int> row_start_;
+    int first_row_ = 0;
+};
+}  // namespace USTC_CG
@@ -101,6 +101,13 @@ void WindowPoisson::draw_toolbar()
                     "On: Enable region selection in the source image. Drag "
                     "left mouse to select rectangle (default) in the source.");
                 p_source_->enable_selecting(selectable);
+
+                static bool antialiasing = false;
+                ImGui::Checkbox("Antialiasing", &antialiasing);
+                add_tooltips(
+                    "On: Store the coverage of the pixels on the edge of the "
+                    "next selected region, and blend them when pasting.");
+                p_source_->set_antialiasing(antialiasing);
             }
             if (p_source_ && selectable)
             {
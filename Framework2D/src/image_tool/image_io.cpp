@@ -0,0 +1,138 @@
+#include "image_io.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+namespace USTC_CG
+{
+static std::string extension(const std::string& filename)
+{
+    std::string ext = std::filesystem::path(filename).extension().string();
+    std::transform(
+        ext.begin(),
+        ext.end(),
+        ext.begin(),
+        [](unsigned char c) { return (char)std::tolower(c); });
+    return ext;
+}
+
+/**
+ * @brief Load an image with 4 channels.
+ * @param filename The path of the image.
+ * @return The image.
+ */
+Image load_image(const std::string& filename)
+{
+    int width = 0, height = 0;
+    unsigned char* data =
+        stbi_load(filename.c_str(), &width, &height, nullptr, 4);
+    if (data == nullptr)
+    {
+        throw std::runtime_error("Failed to load image from file " + filename);
+    }
+    Image image(width, height, 4);
+    std::memcpy(image.data(), data, (std::size_t)width * height * 4);
+    stbi_image_free(data);
+    return image;
+}
+
+/**
+ * @brief Save an image by the extension of the file.
+ * @param filename The path of the image.
+ * @param image The image to save.
+ */
+void save_image(const std::string& filename, const Image& image)
+{
+    std::string ext = extension(filename);
+    int ok;
+    if (ext == ".jpg" || ext == ".jpeg")
+    {
+        ok = stbi_write_jpg(
+            filename.c_str(),
+            image.width(),
+            image.height(),
+            image.channels(),
+            image.data(),
+            95);
+    }
+    else if (ext == ".bmp")
+    {
+        ok = stbi_write_bmp(
+            filename.c_str(),
+            image.width(),
+            image.height(),
+            image.channels(),
+            image.data());
+    }
+    else if (ext == ".tga")
+    {
+        ok = stbi_write_tga(
+            filename.c_str(),
+            image.width(),
+            image.height(),
+            image.channels(),
+            image.data());
+    }
+    else
+    {
+        ok = stbi_write_png(
+            filename.c_str(),
+            image.width(),
+            image.height(),
+            image.channels(),
+            image.data(),
+            image.width() * image.channels());
+    }
+    if (!ok)
+    {
+        throw std::runtime_error("Failed to save image to file " + filename);
+    }
+}
+
+bool is_image_file(const std::string& filename)
+{
+    std::string ext = extension(filename);
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" ||
+           ext == ".tga";
+}
+
+/**
+ * @brief Read all the numbers of a text file.
+ * @param filename The path of the file.
+ * @return The numbers, in order.
+ */
+std::vector<float> read_numbers(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open file " + filename);
+    }
+    std::vector<float> numbers;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream stream(line);
+        float number;
+        while (stream >> number)
+        {
+            numbers.push_back(number);
+        }
+        if (!stream.eof())
+        {
+            throw std::runtime_error("Not a number in file " + filename);
+        }
+    }
+    return numbers;
+}
+}  // namespace USTC_CG
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "view/image.h"
+
+namespace USTC_CG
+{
+// Load an image with 4 channels, as the image editors do. Throws
+// std::runtime_error if the file can't be read.
+Image load_image(const std::string& filename);
+// Save an image as PNG, JPG, BMP or TGA by the extension of the file, PNG for
+// the others. Throws std::runtime_error if the file can't be written.
+void save_image(const std::string& filename, const Image& image);
+// Whether the extension of the file is one of the image formats above
+bool is_image_file(const std::string& filename);
+
+// Read all the numbers of a text file, separated by spaces or lines. Anything
+// after '#' on a line is a comment.
+std::vector<float> read_numbers(const std::string& filename);
+}  // namespace USTC_CG
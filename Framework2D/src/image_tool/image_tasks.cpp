@@ -0,0 +1,129 @@
+#include "image_tasks.h"
+
+#include <stdexcept>
+
+#include "warping_fisheye.h"
+#include "warping_idw.h"
+#include "warping_rbf.h"
+
+namespace USTC_CG
+{
+/**
+ * @brief Warp an image as the Image Warping window does.
+ * @param input The original image.
+ * @param options The method and the control points.
+ * @return The warped image, of the size of the original one.
+ */
+Image warp_image(const Image& input, const WarpOptions& options)
+{
+    std::unique_ptr<Warping> warping;
+    switch (options.method)
+    {
+        case WarpOptions::Method::kIDW:
+            warping = std::make_unique<WarpingIDW>();
+            break;
+        case WarpOptions::Method::kRBF:
+        {
+            auto rbf = std::make_unique<WarpingRBF>();
+            rbf->set_solver(options.rbf_solver);
+            rbf->set_support(options.rbf_support);
+            warping = std::move(rbf);
+            break;
+        }
+        default: warping = std::make_unique<WarpingFishEye>(); break;
+    }
+    warping->set_sampling(options.sampling);
+    warping->set_grid_step(options.grid_step);
+
+    auto data = std::make_shared<Image>(input);
+    std::vector<ImVec2> start_points = options.start_points;
+    std::vector<ImVec2> end_points = options.end_points;
+    // Create a new image to store the result
+    Image warped_image(data->width(), data->height(), data->channels());
+    // Initialize the color of result image
+    warped_image.fill({ 0, 0, 0, 255 });
+    warping->warping(
+        data,
+        warped_image,
+        start_points,
+        end_points,
+        options.inverse,
+        options.fill == WarpOptions::Fill::kANN,
+        options.fill == WarpOptions::Fill::kNeighbour,
+        options.fill == WarpOptions::Fill::kPushPull);
+    return warped_image;
+}
+
+/**
+ * @brief Select the region of the source image.
+ * @param source The source image.
+ * @param options The region and how to clone it.
+ */
+CloneTask::CloneTask(
+    std::shared_ptr<const Image> source,
+    const CloneOptions& options)
+    : source_(std::move(source)),
+      options_(options),
+      mask_(source_->width(), source_->height(), 1)
+{
+    rasterizer_.set_antialiasing(options_.antialiasing);
+    rasterizer_.rasterize(options_.polygon, mask_);
+    if (rasterizer_.points().empty())
+    {
+        throw std::runtime_error("The region is empty");
+    }
+    if (options_.mode != CloneOptions::Mode::kPaste)
+    {
+        poisson_clone_.init(
+            *source_, mask_, rasterizer_.points(), rasterizer_.boundary());
+        if (!poisson_clone_.is_ready())
+        {
+            throw std::runtime_error(
+                "The region has no boundary, it covers the whole image");
+        }
+    }
+}
+
+/**
+ * @brief Clone the region onto the target image.
+ * @param target The target image, changed in place.
+ */
+void CloneTask::clone(Image& target)
+{
+    int bias_x = options_.offset_x, bias_y = options_.offset_y;
+    if (options_.mode != CloneOptions::Mode::kPaste)
+    {
+        // Start from 0 rather than the last target, so the result doesn't
+        // depend on the order of the batch
+        PoissonSolver::Values solution;
+        poisson_clone_.clone(
+            target,
+            target,
+            bias_x,
+            bias_y,
+            options_.mode == CloneOptions::Mode::kMixedSeamless,
+            solution);
+        return;
+    }
+
+    // Blend the edge by its coverage with antialiasing, as the editor does
+    int channels = std::min(target.channels(), source_->channels());
+    for (const ImVec2& point : rasterizer_.points())
+    {
+        int x = (int)point.x, y = (int)point.y;
+        int tar_x = x + bias_x, tar_y = y + bias_y;
+        if (0 <= tar_x && tar_x < target.width() && 0 <= tar_y &&
+            tar_y < target.height())
+        {
+            const unsigned char* src = source_->pixel_ptr(x, y);
+            unsigned char* c = target.pixel_ptr(tar_x, tar_y);
+            int alpha = mask_.pixel_ptr(x, y)[0];
+            for (int l = 0; l < channels; l++)
+            {
+                c[l] = (unsigned char)(
+                    (src[l] * alpha + c[l] * (255 - alpha) + 127) / 255);
+            }
+        }
+    }
+}
+}  // namespace USTC_CG
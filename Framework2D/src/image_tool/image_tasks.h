@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "imgui.h"
+#include "poisson_clone.h"
+#include "scanline_rasterizer.h"
+#include "view/image.h"
+#include "warp_engine.h"
+#include "warping_rbf.h"
+
+namespace USTC_CG
+{
+// The warping of the Image Warping window, with the control points given in
+// advance
+struct WarpOptions
+{
+    enum class Method
+    {
+        kFishEye,
+        kIDW,
+        kRBF
+    };
+    enum class Fill
+    {
+        kNone,
+        kANN,
+        kNeighbour,
+        kPushPull
+    };
+
+    Method method = Method::kIDW;
+    // Point start_points[i] is moved to end_points[i]
+    std::vector<ImVec2> start_points, end_points;
+    bool inverse = false;
+    // How to fill the gaps of the forward warping
+    Fill fill = Fill::kNone;
+    WarpEngine::Sampling sampling = WarpEngine::Sampling::kBilinear;
+    // Distance in pixels between the points where the mapping is evaluated
+    int grid_step = 8;
+    // How the RBF warping solves for its coefficients, and the radius of the
+    // compactly supported kernels in average spacings of the points
+    WarpingRBF::Solver rbf_solver = WarpingRBF::Solver::kAuto;
+    double rbf_support = 6.0;
+};
+
+// Warp an image as the Image Warping window does, the gaps left black.
+Image warp_image(const Image& input, const WarpOptions& options);
+
+// The cloning of the Poisson Image Editing window, with the region given as a
+// polygon in advance
+struct CloneOptions
+{
+    enum class Mode
+    {
+        kPaste,
+        kSeamless,
+        kMixedSeamless
+    };
+
+    Mode mode = Mode::kSeamless;
+    // The vertices of the region in the source image
+    std::vector<ImVec2> polygon;
+    // The region is cloned to the target image moved by (offset_x, offset_y)
+    int offset_x = 0, offset_y = 0;
+    bool antialiasing = false;
+};
+
+// A region of a source image, to clone onto any number of target images. The
+// equations are set up once, but cloning is not thread safe, so every thread
+// needs its own task.
+class CloneTask
+{
+   public:
+    /**
+     * @brief Select the region of the source image.
+     * @param source The source image.
+     * @param options The region and how to clone it.
+     */
+    CloneTask(std::shared_ptr<const Image> source, const CloneOptions& options);
+
+    // Clone the region onto the target image
+    void clone(Image& target);
+
+   private:
+    std::shared_ptr<const Image> source_;
+    CloneOptions options_;
+    ScanlineRasterizer rasterizer_;
+    Image mask_;
+    PoissonClone poisson_clone_;
+};
+}  // namespace USTC_CG
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "image_io.h"
+#include "image_tasks.h"
+
+// Runs the warping and the Poisson cloning of the assignments without a
+// window, on one image or on every image of a directory in parallel.
+
+namespace fs = std::filesystem;
+using namespace USTC_CG;
+
+static const char* kUsage =
+    "Usage:\n"
+    "  image_tool warp <fisheye|idw|rbf> -i INPUT -o OUTPUT [options]\n"
+    "      -p POINTS          Control points, a line \"x0 y0 x1 y1\" for\n"
+    "                         each point moved from (x0, y0) to (x1, y1).\n"
+    "      --inverse          Inverse warping.\n"
+    "      --fill <ann|neighbour|push-pull>\n"
+    "                         Fill the gaps of the forward warping.\n"
+    "      --sampling <nearest|bilinear|bicubic>\n"
+    "                         Sampling of the inverse warping.\n"
+    "      --grid-step N      Evaluate the mapping every N pixels and\n"
+    "                         interpolate in between (default 8, 1 for\n"
+    "                         every pixel).\n"
+    "      --rbf-solver <auto|dense|compact>\n"
+    "                         How the RBF warping solves for its\n"
+    "                         coefficients, compact above 256 points\n"
+    "                         by default.\n"
+    "      --rbf-support S    Radius of the compact RBF kernels, in\n"
+    "                         average spacings of the points (default 6).\n"
+    "  image_tool clone <paste|seamless|mixed> -s SOURCE -i TARGET\n"
+    "                   -o OUTPUT -m POLYGON [options]\n"
+    "      -m POLYGON         Region in the source image, a line \"x y\" for\n"
+    "                         each vertex.\n"
+    "      --offset X Y       Move the region by (X, Y) in the target.\n"
+    "      --antialiasing     Blend the edge of the region when pasting.\n"
+    "  Common options:\n"
+    "      --repeat N         Run the algorithm N times, for benchmarks.\n"
+    "  If INPUT is a directory, every image in it is processed in parallel\n"
+    "  and written to the directory OUTPUT with the same name.\n";
+
+struct Arguments
+{
+    std::string command, method;
+    std::string input, output, source, points, polygon;
+    std::vector<std::string> flags;
+    std::string fill, sampling, rbf_solver;
+    int offset_x = 0, offset_y = 0;
+    int grid_step = 0;  // 0 keeps the default of the warping
+    double rbf_support = 0;  // 0 keeps the default of the warping
+    int repeat = 1;
+};
+
+static Arguments parse_arguments(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        throw std::invalid_argument("Missing command or method");
+    }
+    Arguments args;
+    args.command = argv[1];
+    args.method = argv[2];
+    for (int i = 3; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        // The value of an option
+        auto value = [&]() -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Missing value of " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "-i")
+            args.input = value();
+        else if (arg == "-o")
+            args.output = value();
+        else if (arg == "-s")
+            args.source = value();
+        else if (arg == "-p")
+            args.points = value();
+        else if (arg == "-m")
+            args.polygon = value();
+        else if (arg == "--fill")
+            args.fill = value();
+        else if (arg == "--sampling")
+            args.sampling = value();
+        else if (arg == "--grid-step")
+        {
+            args.grid_step = std::stoi(value());
+            if (args.grid_step < 1)
+            {
+                throw std::invalid_argument("--grid-step must be at least 1");
+            }
+        }
+        else if (arg == "--rbf-solver")
+            args.rbf_solver = value();
+        else if (arg == "--rbf-support")
+        {
+            args.rbf_support = std::stod(value());
+            if (!(args.rbf_support >= 1))
+            {
+                throw std::invalid_argument("--rbf-support must be at least 1");
+            }
+        }
+        else if (arg == "--offset")
+        {
+            args.offset_x = std::stoi(value());
+            args.offset_y = std::stoi(value());
+        }
+        else if (arg == "--repeat")
+            args.repeat = std::max(std::stoi(value()), 1);
+        else if (arg == "--inverse" || arg == "--antialiasing")
+            args.flags.push_back(arg);
+        else
+            throw std::invalid_argument("Unknown option " + arg);
+    }
+    if (args.input.empty() || args.output.empty())
+    {
+        throw std::invalid_argument("Missing -i or -o");
+    }
+    return args;
+}
+
+static bool has_flag(const Arguments& args, const std::string& flag)
+{
+    return std::find(args.flags.begin(), args.flags.end(), flag) !=
+           args.flags.end();
+}
+
+static WarpOptions warp_options(const Arguments& args)
+{
+    WarpOptions options;
+    if (args.method == "fisheye")
+        options.method = WarpOptions::Method::kFishEye;
+    else if (args.method == "idw")
+        options.method = WarpOptions::Method::kIDW;
+    else if (args.method == "rbf")
+        options.method = WarpOptions::Method::kRBF;
+    else
+        throw std::invalid_argument("Unknown warping method " + args.method);
+
+    if (!args.points.empty())
+    {
+        std::vector<float> numbers = read_numbers(args.points);
+        if (numbers.size() % 4 != 0)
+        {
+            throw std::invalid_argument(
+                "Control points need 4 numbers each: " + args.points);
+        }
+        for (std::size_t i = 0; i < numbers.size(); i += 4)
+        {
+            options.start_points.push_back(
+                ImVec2(numbers[i], numbers[i + 1]));
+            options.end_points.push_back(
+                ImVec2(numbers[i + 2], numbers[i + 3]));
+        }
+    }
+    else if (options.method != WarpOptions::Method::kFishEye)
+    {
+        throw std::invalid_argument("Missing -p for " + args.method);
+    }
+
+    options.inverse = has_flag(args, "--inverse");
+    if (args.fill == "ann")
+        options.fill = WarpOptions::Fill::kANN;
+    else if (args.fill == "neighbour")
+        options.fill = WarpOptions::Fill::kNeighbour;
+    else if (args.fill == "push-pull")
+        options.fill = WarpOptions::Fill::kPushPull;
+    else if (!args.fill.empty())
+        throw std::invalid_argument("Unknown gap filling " + args.fill);
+    if (args.sampling == "nearest")
+        options.sampling = WarpEngine::Sampling::kNearest;
+    else if (args.sampling == "bicubic")
+        options.sampling = WarpEngine::Sampling::kBicubic;
+    else if (args.sampling != "bilinear" && !args.sampling.empty())
+        throw std::invalid_argument("Unknown sampling " + args.sampling);
+    if (args.grid_step > 0)
+        options.grid_step = args.grid_step;
+    if (args.rbf_solver == "dense")
+        options.rbf_solver = WarpingRBF::Solver::kDense;
+    else if (args.rbf_solver == "compact")
+        options.rbf_solver = WarpingRBF::Solver::kCompact;
+    else if (args.rbf_solver != "auto" && !args.rbf_solver.empty())
+        throw std::invalid_argument("Unknown RBF solver " + args.rbf_solver);
+    if (args.rbf_support > 0)
+        options.rbf_support = args.rbf_support;
+    return options;
+}
+
+static CloneOptions clone_options(const Arguments& args)
+{
+    CloneOptions options;
+    if (args.method == "paste")
+        options.mode = CloneOptions::Mode::kPaste;
+    else if (args.method == "seamless")
+        options.mode = CloneOptions::Mode::kSeamless;
+    else if (args.method == "mixed")
+        options.mode = CloneOptions::Mode::kMixedSeamless;
+    else
+        throw std::invalid_argument("Unknown cloning method " + args.method);
+
+    if (args.source.empty() || args.polygon.empty())
+    {
+        throw std::invalid_argument("Missing -s or -m");
+    }
+    std::vector<float> numbers = read_numbers(args.polygon);
+    if (numbers.size() % 2 != 0 || numbers.size() < 6)
+    {
+        throw std::invalid_argument(
+            "The polygon needs 3 vertices of 2 numbers: " + args.polygon);
+    }
+    for (std::size_t i = 0; i < numbers.size(); i += 2)
+    {
+        options.polygon.push_back(ImVec2(numbers[i], numbers[i + 1]));
+    }
+    options.offset_x = args.offset_x;
+    options.offset_y = args.offset_y;
+    options.antialiasing = has_flag(args, "--antialiasing");
+    return options;
+}
+
+// The pairs of input and output files, a single one unless the input is a
+// directory
+static std::vector<std::pair<std::string, std::string>> list_files(
+    const Arguments& args)
+{
+    std::vector<std::pair<std::string, std::string>> files;
+    if (!fs::is_directory(args.input))
+    {
+        files.emplace_back(args.input, args.output);
+        return files;
+    }
+    fs::create_directories(args.output);
+    for (const fs::directory_entry& entry : fs::directory_iterator(args.input))
+    {
+        if (entry.is_regular_file() && is_image_file(entry.path().string()))
+        {
+            files.emplace_back(
+                entry.path().string(),
+                (fs::path(args.output) / entry.path().filename()).string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        Arguments args = parse_arguments(argc, argv);
+        bool warp = args.command == "warp";
+        if (!warp && args.command != "clone")
+        {
+            throw std::invalid_argument("Unknown command " + args.command);
+        }
+        WarpOptions warp_opts;
+        CloneOptions clone_opts;
+        std::shared_ptr<const Image> source;
+        if (warp)
+        {
+            warp_opts = warp_options(args);
+        }
+        else
+        {
+            clone_opts = clone_options(args);
+            source = std::make_shared<Image>(load_image(args.source));
+        }
+        std::vector<std::pair<std::string, std::string>> files =
+            list_files(args);
+
+        int failed = 0;
+        auto start = std::chrono::steady_clock::now();
+        // A single image uses the threads inside of the algorithms instead
+#pragma omp parallel reduction(+ : failed) if (files.size() > 1)
+        {
+            // The equations of the region are set up once for every thread
+            std::unique_ptr<CloneTask> clone_task;
+#pragma omp for schedule(dynamic)
+            for (int i = 0; i < (int)files.size(); i++)
+            {
+                const auto& [input, output] = files[i];
+                try
+                {
+                    Image image = load_image(input);
+                    auto run_start = std::chrono::steady_clock::now();
+                    if (warp)
+                    {
+                        Image result = warp_image(image, warp_opts);
+                        for (int r = 1; r < args.repeat; r++)
+                        {
+                            result = warp_image(image, warp_opts);
+                        }
+                        image = std::move(result);
+                    }
+                    else
+                    {
+                        if (!clone_task)
+                        {
+                            clone_task =
+                                std::make_unique<CloneTask>(source, clone_opts);
+                        }
+                        Image target = image;
+                        for (int r = 0; r < args.repeat; r++)
+                        {
+                            target = image;
+                            clone_task->clone(target);
+                        }
+                        image = std::move(target);
+                    }
+                    double time = milliseconds_since(run_start) / args.repeat;
+                    save_image(output, image);
+                    printf("%s: %.2f ms\n", input.c_str(), time);
+                }
+                catch (const std::exception& e)
+                {
+                    fprintf(stderr, "%s: %s\n", input.c_str(), e.what());
+                    failed++;
+                }
+            }
+        }
+        printf(
+            "%d of %d images in %.2f s\n",
+            (int)files.size() - failed,
+            (int)files.size(),
+            milliseconds_since(start) / 1000.0);
+        return failed == 0 ? 0 : 1;
+    }
+    catch (const std::invalid_argument& e)
+    {
+        fprintf(stderr, "Error: %s\n%s", e.what(), kUsage);
+        return 1;
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+}
@@ -128,6 +128,7 @@ void Canvas::set_delete()
 {
     if (!draw_status_ && !shape_list_.empty())
     {
+        shape_index_.remove(shape_list_.back().get());
         shape_list_.pop_back();
     }
     draw_status_ = false;
@@ -140,6 +141,7 @@ void Canvas::set_reset()
 {
     draw_status_ = false;
     shape_list_.clear();
+    shape_index_.clear();
 }
 
 /**
@@ -190,6 +192,7 @@ void Canvas::set_select_delete()
         selected_shape_index_ < shape_list_.size())
     {
         selected_shape_->conf.time = 0;  // 删除前恢复图形的颜色。
+        shape_index_.remove(selected_shape_.get());
         selected_shape_.reset();
         shape_list_.erase(shape_list_.begin() + selected_shape_index_);
         selected_shape_index_ = -1;
@@ -232,6 +235,9 @@ void Canvas::set_goup()
 {
     if (selected_shape_ && selected_shape_index_ < shape_list_.size() - 1)
     {
+        shape_index_.swap_order(
+            shape_list_[selected_shape_index_].get(),
+            shape_list_[selected_shape_index_ + 1].get());
         std::swap(
             shape_list_[selected_shape_index_],
             shape_list_
@@ -248,6 +254,9 @@ void Canvas::set_godown()
 {
     if (selected_shape_ && selected_shape_index_ > 0)
     {
+        shape_index_.swap_order(
+            shape_list_[selected_shape_index_].get(),
+            shape_list_[selected_shape_index_ - 1].get());
         std::swap(
             shape_list_[selected_shape_index_],
             shape_list_[selected_shape_index_ - 1]);
@@ -261,6 +270,7 @@ void Canvas::set_godown()
 void Canvas::clear_shape_list()
 {
     shape_list_.clear();
+    shape_index_.clear();
 }
 
 /**
@@ -327,9 +337,15 @@ void Canvas::draw_shapes()
         selected_shape_->conf.time += 0.05f;
     }
 
+    // 画布坐标下的可见范围，多留1个像素给抗锯齿的边缘。
+    Shape::Bounds visible = { { 0, 0 }, { canvas_size_.x, canvas_size_.y } };
+    visible.inflate(1.0f);
+
     // ClipRect can hide the drawing content outside of the rectangular area
     draw_list->PushClipRect(canvas_min_, canvas_max_, true);
-    for (const auto& shape : shape_list_)
+    // 通过网格索引只取出包围盒在画布之内的图形，按绘制顺序排列。
+    shape_index_.query(visible, visible_shapes_);
+    for (const Shape* shape : visible_shapes_)
     {
         shape->draw(s);
         // 对每一个图形使用相同的调用方式进行绘制。
@@ -368,7 +384,7 @@ void Canvas::draw_open_image_file_dialog()
         flag_open_file_dialog_ = false;
         if (current_shape_)
         {
-            shape_list_.push_back(current_shape_);
+            add_shape(current_shape_);
             current_shape_.reset();
         }
         shape_type_ = kDefault;
@@ -391,16 +407,13 @@ void Canvas::mouse_click_event()
             selected_shape_.reset();
         }
 
-        // 遍历所有图形，找到鼠标点击的图形。
+        // 通过网格索引找到鼠标点击的最上层图形，只检查鼠标附近的图形。
         ImVec2 mouse_pos = mouse_pos_in_canvas();
-        for (int i = (int)shape_list_.size() - 1; i >= 0; i--)
+        int picked = shape_index_.pick(mouse_pos.x, mouse_pos.y);
+        if (picked >= 0)
         {
-            if (shape_list_[i]->is_select_on(mouse_pos.x, mouse_pos.y))
-            {
-                selected_shape_ = shape_list_[i];
-                selected_shape_index_ = i;
-                break;
-            }
+            selected_shape_ = shape_list_[picked];
+            selected_shape_index_ = picked;
         }
 
         // 更新UI，参数调节处设置为选中图形的参数。
@@ -456,8 +469,8 @@ void Canvas::mouse_click_event()
             }
             case USTC_CG::Canvas::kFreehand:
             {
-                current_shape_ =
-                    std::make_shared<Freehand>(start_point_.x, start_point_.y);
+                current_shape_ = std::make_shared<Freehand>(
+                    start_point_.x, start_point_.y, freehand_tolerance);
                 break;
             }
             case USTC_CG::Canvas::kImage:
@@ -475,7 +488,7 @@ void Canvas::mouse_click_event()
             shape_type_ !=
                 kFreehand)  // Freehand类型的图形在鼠标释放时结束绘制。
         {
-            shape_list_.push_back(current_shape_);
+            add_shape(current_shape_);
             current_shape_.reset();
         }
     }
@@ -496,7 +509,7 @@ void Canvas::mouse_right_click_event()
             current_shape_->update(
                 start_point_.x,
                 start_point_.y);  // end_point_不计入多边形的点集。
-            shape_list_.push_back(current_shape_);
+            add_shape(current_shape_);
             current_shape_.reset();
         }
     }
@@ -540,6 +553,8 @@ void Canvas::mouse_move_event()
             selected_shape_->conf.image_size = image_size;
             selected_shape_->conf.image_bia[0] = image_bia[0];
             selected_shape_->conf.image_bia[1] = image_bia[1];
+            // 线宽和图片的大小、偏移量会改变包围盒。
+            shape_index_.update(selected_shape_.get());
         }
     }
 }
@@ -552,13 +567,26 @@ void Canvas::mouse_release_event()
     // HW1_TODO: Drawing rule for more primitives
     if (draw_status_ && current_shape_ && shape_type_ == kFreehand)
     {
-        // 对于自由绘制，鼠标释放表示结束绘制
+        // 对于自由绘制，鼠标释放表示结束绘制，此时可以压缩存储点集
         draw_status_ = false;
-        shape_list_.push_back(current_shape_);
+        std::static_pointer_cast<Freehand>(current_shape_)
+            ->finish(freehand_compact);
+        add_shape(current_shape_);
         current_shape_.reset();
     }
 }
 
+/**
+ * @brief 将完成绘制的图形加入图形列表的最上层，并加入网格索引。
+ *
+ * @param shape 完成绘制的图形。
+ */
+void Canvas::add_shape(const std::shared_ptr<Shape>& shape)
+{
+    shape_list_.push_back(shape);
+    shape_index_.insert(shape.get());
+}
+
 /**
  * @brief 计算鼠标在画布中的相对位置。
  *
@@ -0,0 +1,319 @@
+#include "view/shape_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace USTC_CG
+{
+
+/**
+ * @brief 创建空的网格索引。
+ *
+ * @param cell_size 网格单元的边长（像素）。
+ */
+ShapeIndex::ShapeIndex(float cell_size) : cell_size_(cell_size)
+{
+}
+
+/**
+ * @brief 添加图形，置于所有图形之上。
+ *
+ * @param shape 要添加的图形。
+ */
+void ShapeIndex::insert(const Shape* shape)
+{
+    Entry& entry = entries_[shape];
+    entry.bounds = shape->get_bounds();
+    entry.position = (int)entries_.size() - 1;
+    locate(entry);
+    link(shape, entry);
+}
+
+/**
+ * @brief 删除图形，其上的图形在列表中的位置减一。
+ *
+ * 与从列表中删除元素一样需要线性时间，但删除最后一个图形（撤销）不需要。
+ *
+ * @param shape 要删除的图形。
+ */
+void ShapeIndex::remove(const Shape* shape)
+{
+    auto it = entries_.find(shape);
+    if (it == entries_.end())
+    {
+        return;
+    }
+    int position = it->second.position;
+    unlink(shape, it->second);
+    entries_.erase(it);
+    if (position == (int)entries_.size())
+    {
+        return;
+    }
+    for (auto& [other, entry] : entries_)
+    {
+        if (entry.position > position)
+        {
+            entry.position--;
+        }
+    }
+}
+
+/**
+ * @brief 图形的点或参数改变后，重新计算包围盒。
+ *
+ * 覆盖的网格单元不变时只更新包围盒，避免每帧都移动选中的图形。
+ *
+ * @param shape 改变的图形。
+ */
+void ShapeIndex::update(const Shape* shape)
+{
+    auto it = entries_.find(shape);
+    if (it == entries_.end())
+    {
+        return;
+    }
+    Entry& entry = it->second;
+    Entry moved = entry;
+    moved.bounds = shape->get_bounds();
+    locate(moved);
+    if (moved.large == entry.large &&
+        (moved.large || (moved.cell_min[0] == entry.cell_min[0] &&
+                         moved.cell_min[1] == entry.cell_min[1] &&
+                         moved.cell_max[0] == entry.cell_max[0] &&
+                         moved.cell_max[1] == entry.cell_max[1])))
+    {
+        entry.bounds = moved.bounds;
+        return;
+    }
+    unlink(shape, entry);
+    entry = moved;
+    link(shape, entry);
+}
+
+/**
+ * @brief 交换两个图形在列表中的位置，即绘制顺序。
+ *
+ * @param a 第一个图形。
+ * @param b 第二个图形。
+ */
+void ShapeIndex::swap_order(const Shape* a, const Shape* b)
+{
+    std::swap(entries_.at(a).position, entries_.at(b).position);
+}
+
+/**
+ * @brief 删除所有图形。
+ */
+void ShapeIndex::clear()
+{
+    entries_.clear();
+    cells_.clear();
+    large_shapes_.clear();
+}
+
+/**
+ * @brief 找到点选中的最上层图形。
+ *
+ * 只检查点所在网格单元中的图形（以及覆盖范围过大的图形），且先用包围盒排除，
+ * 最后才调用图形的is_select_on。
+ *
+ * @param x X坐标
+ * @param y Y坐标
+ * @return 选中的图形在列表中的位置，没有选中时为-1。
+ */
+int ShapeIndex::pick(float x, float y) const
+{
+    int top = -1;
+    auto test = [&](const Shape* shape)
+    {
+        const Entry& entry = entries_.at(shape);
+        if (entry.position > top && entry.bounds.contains(x, y) &&
+            shape->is_select_on(x, y))
+        {
+            top = entry.position;
+        }
+    };
+
+    for (const Shape* shape : large_shapes_)
+    {
+        test(shape);
+    }
+    auto cell = cells_.find(cell_key(
+        (int)std::floor(x / cell_size_), (int)std::floor(y / cell_size_)));
+    if (cell != cells_.end())
+    {
+        for (const Shape* shape : cell->second)
+        {
+            test(shape);
+        }
+    }
+    return top;
+}
+
+/**
+ * @brief 找到包围盒与给定矩形相交的所有图形，按绘制顺序排列，用于只绘制可见的图形。
+ *
+ * 只访问与矩形相交的网格单元；矩形覆盖的单元比非空的单元还多时，改为遍历非空的单元。
+ * 跨越多个单元的图形用查询序号去重。
+ *
+ * @param bounds 矩形，例如画布的可见范围。
+ * @param shapes 输出的图形，从下到上。
+ */
+void ShapeIndex::query(
+    const Shape::Bounds& bounds,
+    std::vector<const Shape*>& shapes) const
+{
+    shapes.clear();
+    unsigned visit = ++query_count_;
+    std::vector<std::pair<int, const Shape*>> found;
+    auto test = [&](const Shape* shape)
+    {
+        const Entry& entry = entries_.at(shape);
+        if (entry.visit != visit && entry.bounds.overlaps(bounds))
+        {
+            entry.visit = visit;
+            found.emplace_back(entry.position, shape);
+        }
+    };
+
+    for (const Shape* shape : large_shapes_)
+    {
+        test(shape);
+    }
+    float min_x = std::floor(bounds.min[0] / cell_size_);
+    float min_y = std::floor(bounds.min[1] / cell_size_);
+    float max_x = std::floor(bounds.max[0] / cell_size_);
+    float max_y = std::floor(bounds.max[1] / cell_size_);
+    if ((max_x - min_x + 1) * (max_y - min_y + 1) <= (float)cells_.size())
+    {
+        for (int y = (int)min_y; y <= (int)max_y; y++)
+        {
+            for (int x = (int)min_x; x <= (int)max_x; x++)
+            {
+                auto cell = cells_.find(cell_key(x, y));
+                if (cell != cells_.end())
+                {
+                    for (const Shape* shape : cell->second)
+                    {
+                        test(shape);
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        // 包围盒的测试已经排除了矩形外的单元中的图形
+        for (const auto& cell : cells_)
+        {
+            for (const Shape* shape : cell.second)
+            {
+                test(shape);
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    for (const auto& [position, shape] : found)
+    {
+        shapes.push_back(shape);
+    }
+}
+
+/**
+ * @brief 将网格单元的坐标组合为一个键。
+ */
+long long ShapeIndex::cell_key(int x, int y)
+{
+    return ((long long)x << 32) ^ (unsigned int)y;
+}
+
+/**
+ * @brief 计算包围盒覆盖的网格单元范围。
+ *
+ * 覆盖的单元过多（例如放大的图片）或包围盒无效时，图形放入单独的列表。
+ *
+ * @param entry 包围盒已经设置的图形记录。
+ */
+void ShapeIndex::locate(Entry& entry) const
+{
+    float min_x = std::floor(entry.bounds.min[0] / cell_size_);
+    float min_y = std::floor(entry.bounds.min[1] / cell_size_);
+    float max_x = std::floor(entry.bounds.max[0] / cell_size_);
+    float max_y = std::floor(entry.bounds.max[1] / cell_size_);
+    // 包围盒含NaN时比较为false，同样放入单独的列表
+    entry.large = !((max_x - min_x + 1) * (max_y - min_y + 1) <= kMaxCells);
+    if (!entry.large)
+    {
+        entry.cell_min[0] = (int)min_x;
+        entry.cell_min[1] = (int)min_y;
+        entry.cell_max[0] = (int)max_x;
+        entry.cell_max[1] = (int)max_y;
+    }
+}
+
+/**
+ * @brief 将图形加入它覆盖的网格单元。
+ *
+ * @param shape 图形。
+ * @param entry 图形的记录，网格单元范围已经计算。
+ */
+void ShapeIndex::link(const Shape* shape, const Entry& entry)
+{
+    if (entry.large)
+    {
+        large_shapes_.push_back(shape);
+        return;
+    }
+    for (int y = entry.cell_min[1]; y <= entry.cell_max[1]; y++)
+    {
+        for (int x = entry.cell_min[0]; x <= entry.cell_max[0]; x++)
+        {
+            cells_[cell_key(x, y)].push_back(shape);
+        }
+    }
+}
+
+/**
+ * @brief 将图形移出它覆盖的网格单元，删除变空的单元。
+ *
+ * @param shape 图形。
+ * @param entry 图形的记录。
+ */
+void ShapeIndex::unlink(const Shape* shape, const Entry& entry)
+{
+    // 与最后一个元素交换后删除，单元内的顺序无关紧要
+    auto erase = [shape](std::vector<const Shape*>& shapes)
+    {
+        auto it = std::find(shapes.begin(), shapes.end(), shape);
+        if (it != shapes.end())
+        {
+            *it = shapes.back();
+            shapes.pop_back();
+        }
+    };
+
+    if (entry.large)
+    {
+        erase(large_shapes_);
+        return;
+    }
+    for (int y = entry.cell_min[1]; y <= entry.cell_max[1]; y++)
+    {
+        for (int x = entry.cell_min[0]; x <= entry.cell_max[0]; x++)
+        {
+            auto cell = cells_.find(cell_key(x, y));
+            if (cell != cells_.end())
+            {
+                erase(cell->second);
+                if (cell->second.empty())
+                {
+                    cells_.erase(cell);
+                }
+            }
+        }
+    }
+}
+
+}  // namespace USTC_CG
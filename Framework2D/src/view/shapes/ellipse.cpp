@@ -142,4 +142,32 @@ bool Ellipse::is_select_on(float x, float y) const
         }
     }
 }
+
+/**
+ * @brief 获取椭圆的包围盒。
+ *
+ * 未填充时，is_select_on 允许 result 最大为 1 + 宽容范围 / min(a, b)，
+ * 对于扁的椭圆这超出了长轴端点外一个宽容范围，因此按该比例放大椭圆。
+ *
+ * @return 椭圆的包围盒。
+ */
+Shape::Bounds Ellipse::get_bounds() const
+{
+    float a = fabs((start_point_x_ - end_point_x_) / 2);
+    float b = fabs((start_point_y_ - end_point_y_) / 2);
+    float h = (start_point_x_ + end_point_x_) / 2;
+    float k = (start_point_y_ + end_point_y_) / 2;
+    float tolerance = select_tolerance();
+
+    // 退化的椭圆（a或b为0）无法被选中，只需包含绘制的线条
+    float scale = 1.0f;
+    if (!conf.filled && a > 0 && b > 0)
+    {
+        scale += tolerance / (a < b ? a : b);
+    }
+    Bounds bounds = { { h - a * scale, k - b * scale },
+                      { h + a * scale, k + b * scale } };
+    bounds.inflate(tolerance);
+    return bounds;
+}
 }  // namespace USTC_CG
\ No newline at end of file
@@ -2,35 +2,79 @@
 
 #include <imgui.h>
 
+#include <cmath>
+
 namespace USTC_CG
 {
+/**
+ * @brief 计算点到线段的距离。
+ */
+static float distance_to_segment(
+    float x,
+    float y,
+    float x0,
+    float y0,
+    float x1,
+    float y1)
+{
+    float dx = x1 - x0, dy = y1 - y0;
+    float length2 = dx * dx + dy * dy;
+    float t = length2 > 0 ? ((x - x0) * dx + (y - y0) * dy) / length2 : 0;
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    return std::hypot(x - x0 - t * dx, y - y0 - t * dy);
+}
+
 /**
  * @brief 绘制自由手绘图形，图形由一系列线段组成。
  *
+ * 连续的可见线段块合并为一条折线，用AddPolyline一次提交，绘制的开销取决于简化后的点数。
+ *
  * @param config 绘制配置，包含偏移量、线条颜色和线条粗细等。
  */
 void Freehand::draw(const Config& config) const
 {
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImU32 color = IM_COL32(
+        conf.line_color[0],
+        conf.line_color[1],
+        conf.line_color[2],
+        (unsigned char)((0.5f + 0.5f * cos(conf.time) * cos(conf.time)) *
+                        conf.line_color[3]));  // 实现A通道正弦函数变化，范围为0.5倍-1倍
+
+    // 裁剪矩形转换到画布坐标，跳过完全在裁剪矩形外的线段块
+    ImVec2 clip_min = draw_list->GetClipRectMin();
+    ImVec2 clip_max = draw_list->GetClipRectMax();
+    Bounds visible = { { clip_min.x - config.bias[0],
+                         clip_min.y - config.bias[1] },
+                       { clip_max.x - config.bias[0],
+                         clip_max.y - config.bias[1] } };
+    visible.inflate(conf.line_thickness * 0.5f + 1.0f);
 
-    for (int i = 0; i < points_x_.size() - 1; i++)
+    std::vector<float> xy;
+    std::vector<ImVec2> polyline;
+    for (int c = 0; c <= chunk_bounds_.size(); c++)
     {
-        draw_list->AddLine(
-            ImVec2(
-                config.bias[0] + points_x_.at(i),
-                config.bias[1] + points_y_.at(i)),
-            ImVec2(
-                config.bias[0] + points_x_.at(i + 1),
-                config.bias[1] + points_y_.at(i + 1)),
-            IM_COL32(
-                conf.line_color[0],
-                conf.line_color[1],
-                conf.line_color[2],
-                (unsigned char)((0.5f +
-                                 0.5f * cos(conf.time) * cos(conf.time)) *
-                                conf.line_color
-                                    [3])),  // 实现A通道正弦函数变化，范围为0.5倍-1倍
-            conf.line_thickness);
+        if (c < chunk_bounds_.size() && chunk_bounds_[c].overlaps(visible))
+        {
+            // 相邻的块共用端点，接在折线后面时跳过第一个点
+            xy.clear();
+            get_chunk(c, xy);
+            for (int i = polyline.empty() ? 0 : 2; i < xy.size(); i += 2)
+            {
+                polyline.push_back(ImVec2(
+                    config.bias[0] + xy[i], config.bias[1] + xy[i + 1]));
+            }
+        }
+        else if (!polyline.empty())
+        {
+            draw_list->AddPolyline(
+                polyline.data(),
+                (int)polyline.size(),
+                color,
+                ImDrawFlags_None,
+                conf.line_thickness);
+            polyline.clear();
+        }
     }
 }
 
@@ -39,17 +83,218 @@ void Freehand::draw(const Config& config) const
  *
  * 这个函数会在新点与上一个点的差异大于5时调用，将新点添加到自由手绘图形的点集中。
  *
+ * 设置了宽容范围时在线简化（Douglas-Peucker的分割判据）：最后一个点是暂定的，
+ * 若上一个固定点到新点的线段与其间所有采样点的距离都不超过宽容范围，则把最后一个点移到新点，
+ * 否则固定最后一个点，再添加新点。
+ *
  * @param x X坐标
  * @param y Y坐标
  */
 void Freehand::update(float x, float y)
 {
+    if (!deltas_.empty())
+    {
+        return;  // 已经结束绘制并压缩
+    }
     if (abs(x - points_x_.at(points_x_.size() - 1)) > 5 ||
         abs(y - points_y_.at(points_y_.size() - 1)) > 5)
     {
         // 两点之间的距离大于5时，添加新点，避免过于密集
-        points_x_.push_back(x);
-        points_y_.push_back(y);
+        int n = (int)points_x_.size();
+        if (tolerance_ > 0 && n >= 2 && samples_x_.size() < kMaxSamples)
+        {
+            bool fit = true;
+            for (int i = 0; fit && i < samples_x_.size(); i++)
+            {
+                fit = distance_to_segment(
+                          samples_x_[i],
+                          samples_y_[i],
+                          points_x_[n - 2],
+                          points_y_[n - 2],
+                          x,
+                          y) <= tolerance_;
+            }
+            if (fit)
+            {
+                move_last_point(x, y);
+                samples_x_.push_back(x);
+                samples_y_.push_back(y);
+                return;
+            }
+        }
+        add_point(x, y);
+        samples_x_.assign(1, x);
+        samples_y_.assign(1, y);
+    }
+}
+
+/**
+ * @brief 结束绘制，释放简化用的采样点，可选地压缩存储点集。
+ *
+ * 压缩存储时，每块的第一个点保存为浮点数，其余的点保存为与前一个点的差，
+ * 以1/kDeltaScale像素为单位的16位整数，每个点占4字节而不是8字节，误差不超过1/16像素。
+ * 差是相对于还原后的前一个点计算的，因此误差不会累积。
+ * 有相邻两点相距超过4096像素时保持浮点存储。
+ *
+ * @param compact 是否压缩存储。
+ */
+void Freehand::finish(bool compact)
+{
+    samples_x_.clear();
+    samples_x_.shrink_to_fit();
+    samples_y_.clear();
+    samples_y_.shrink_to_fit();
+    points_x_.shrink_to_fit();
+    points_y_.shrink_to_fit();
+    if (!compact || !deltas_.empty() || points_x_.size() < 2)
+    {
+        compute_bounds();
+        return;
+    }
+
+    int n = (int)points_x_.size();
+    std::vector<float> starts = { points_x_[0], points_y_[0] };
+    std::vector<std::int16_t> deltas;
+    deltas.reserve(2 * (n - 1));
+    float x = points_x_[0], y = points_y_[0];
+    for (int i = 1; i < n; i++)
+    {
+        float dx = std::round((points_x_[i] - x) * kDeltaScale);
+        float dy = std::round((points_y_[i] - y) * kDeltaScale);
+        if (!(std::fabs(dx) <= INT16_MAX && std::fabs(dy) <= INT16_MAX))
+        {
+            compute_bounds();
+            return;
+        }
+        deltas.push_back((std::int16_t)dx);
+        deltas.push_back((std::int16_t)dy);
+        // 与get_chunk中还原的计算相同，结果完全一致
+        x += deltas[2 * i - 2] / kDeltaScale;
+        y += deltas[2 * i - 1] / kDeltaScale;
+        if (i % kChunkSize == 0 && i < n - 1)
+        {
+            starts.push_back(x);
+            starts.push_back(y);
+        }
+    }
+    chunk_starts_ = std::move(starts);
+    deltas_ = std::move(deltas);
+    points_x_ = std::vector<float>();
+    points_y_ = std::vector<float>();
+    compute_bounds();
+}
+
+/**
+ * @brief 在点集末尾添加一个点，并更新包围盒。
+ *
+ * 每kChunkSize条线段组成一块，新的线段属于最后一块，块满时开始新的一块。
+ *
+ * @param x X坐标
+ * @param y Y坐标
+ */
+void Freehand::add_point(float x, float y)
+{
+    points_x_.push_back(x);
+    points_y_.push_back(y);
+    int n = (int)points_x_.size();
+    if (n == 1)
+    {
+        bounds_ = { { x, y }, { x, y } };
+        return;
+    }
+    bounds_.expand(x, y);
+
+    // 新线段连接第n-2和第n-1个点
+    if ((n - 2) % kChunkSize == 0)
+    {
+        chunk_bounds_.push_back({ { points_x_[n - 2], points_y_[n - 2] },
+                                  { points_x_[n - 2], points_y_[n - 2] } });
+    }
+    chunk_bounds_.back().expand(x, y);
+}
+
+/**
+ * @brief 移动最后一个点，并更新包围盒。
+ *
+ * 包围盒只扩大不缩小，绘制时仍包含所有的点，结束绘制时再重新计算。
+ *
+ * @param x X坐标
+ * @param y Y坐标
+ */
+void Freehand::move_last_point(float x, float y)
+{
+    points_x_.back() = x;
+    points_y_.back() = y;
+    bounds_.expand(x, y);
+    chunk_bounds_.back().expand(x, y);
+}
+
+/**
+ * @brief 获取点的个数。
+ */
+int Freehand::size() const
+{
+    return deltas_.empty() ? (int)points_x_.size()
+                           : (int)deltas_.size() / 2 + 1;
+}
+
+/**
+ * @brief 将一块线段的所有点的坐标依次添加到xy中。
+ *
+ * @param chunk 块的序号。
+ * @param xy 坐标，按x, y, x, y...的顺序。
+ */
+void Freehand::get_chunk(int chunk, std::vector<float>& xy) const
+{
+    int first = chunk * kChunkSize;
+    int last = (chunk + 1) * kChunkSize < size() - 1 ? (chunk + 1) * kChunkSize
+                                                     : size() - 1;
+    if (deltas_.empty())
+    {
+        for (int i = first; i <= last; i++)
+        {
+            xy.push_back(points_x_[i]);
+            xy.push_back(points_y_[i]);
+        }
+        return;
+    }
+    float x = chunk_starts_[2 * chunk], y = chunk_starts_[2 * chunk + 1];
+    xy.push_back(x);
+    xy.push_back(y);
+    for (int i = first + 1; i <= last; i++)
+    {
+        x += deltas_[2 * i - 2] / kDeltaScale;
+        y += deltas_[2 * i - 1] / kDeltaScale;
+        xy.push_back(x);
+        xy.push_back(y);
+    }
+}
+
+/**
+ * @brief 按当前的点重新计算所有包围盒。
+ */
+void Freehand::compute_bounds()
+{
+    std::vector<float> xy;
+    for (int c = 0; c < chunk_bounds_.size(); c++)
+    {
+        xy.clear();
+        get_chunk(c, xy);
+        Bounds bounds = { { xy[0], xy[1] }, { xy[0], xy[1] } };
+        for (int i = 2; i < xy.size(); i += 2)
+        {
+            bounds.expand(xy[i], xy[i + 1]);
+        }
+        chunk_bounds_[c] = bounds;
+        if (c == 0)
+        {
+            bounds_ = bounds;
+        }
+        else
+        {
+            bounds_.expand(bounds.min[0], bounds.min[1]);
+            bounds_.expand(bounds.max[0], bounds.max[1]);
+        }
     }
 }
 
@@ -65,26 +310,50 @@ bool Freehand::is_select_on(float x, float y) const
 {
     // 线段的处理方式：绘制垂直线，若距离小于线宽且交点在线段上（与两端点差值之积小于等于0），则认为点在图形上。
     // 引入正态分布函数，使得线宽越小判断越宽松，线宽越大判断越严格，便于用户操作。
-    for (int i = 0; i < points_x_.size() - 1; i++)
+    // 点到线段的距离小于宽容范围时，点必在线段块的包围盒向外扩展宽容范围之内，因此先跳过其余的块。
+    float tolerance = select_tolerance();
+    std::vector<float> xy;
+    for (int c = 0; c < chunk_bounds_.size(); c++)
     {
-        double k1 = (points_y_.at(i + 1) - points_y_.at(i)) /
-                    (points_x_.at(i + 1) - points_x_.at(i));
-        double b1 = points_y_.at(i) - k1 * points_x_.at(i);
-        double k2 = -1 / k1;
-        double b2 = y - k2 * x;
-        double cross_x = (b2 - b1) / (k1 - k2);
-        double dis = sqrt(
-            (cross_x - x) * (cross_x - x) +
-            (k1 * cross_x + b1 - y) * (k1 * cross_x + b1 - y));
-        if (dis < conf.line_thickness * 0.5f *
-                      (1.0f + 9 * exp(-(conf.line_thickness - 1.0f) *
-                                      (conf.line_thickness - 1.0f) / 4)) &&
-            ((cross_x - points_x_.at(i)) * (cross_x - points_x_.at(i + 1))) <=
-                0)
+        Bounds bounds = chunk_bounds_[c];
+        bounds.inflate(tolerance);
+        if (!bounds.contains(x, y))
+        {
+            continue;
+        }
+        xy.clear();
+        get_chunk(c, xy);
+        for (int i = 0; i + 3 < xy.size(); i += 2)
         {
-            return true;
+            double k1 = (xy[i + 3] - xy[i + 1]) / (xy[i + 2] - xy[i]);
+            double b1 = xy[i + 1] - k1 * xy[i];
+            double k2 = -1 / k1;
+            double b2 = y - k2 * x;
+            double cross_x = (b2 - b1) / (k1 - k2);
+            double dis = sqrt(
+                (cross_x - x) * (cross_x - x) +
+                (k1 * cross_x + b1 - y) * (k1 * cross_x + b1 - y));
+            if (dis < tolerance &&
+                ((cross_x - xy[i]) * (cross_x - xy[i + 2])) <= 0)
+            {
+                return true;
+            }
         }
     }
     return false;
 }
+
+/**
+ * @brief 获取自由手绘图形的包围盒。
+ *
+ * 所有点的范围向外扩展选择的宽容范围，宽容范围不小于线宽的一半。
+ *
+ * @return 自由手绘图形的包围盒。
+ */
+Shape::Bounds Freehand::get_bounds() const
+{
+    Bounds bounds = bounds_;
+    bounds.inflate(select_tolerance());
+    return bounds;
+}
 }  // namespace USTC_CG
\ No newline at end of file
@@ -145,4 +145,24 @@ bool Images::is_select_on(float x, float y) const
         return false;
     }
 }
+
+/**
+ * @brief 获取图像的包围盒。
+ *
+ * 图像的范围再向外扩展2个像素，包含选中时绘制的边框（粗细为3）。
+ *
+ * @return 图像的包围盒。
+ */
+Shape::Bounds Images::get_bounds() const
+{
+    float min_x =
+        conf.image_bia[0] * canvas_size_x_ - conf.image_size * image_width_ / 2;
+    float min_y = conf.image_bia[1] * canvas_size_y_ -
+                  conf.image_size * image_height_ / 2;
+    Bounds bounds = { { min_x, min_y },
+                      { min_x + conf.image_size * image_width_,
+                        min_y + conf.image_size * image_height_ } };
+    bounds.inflate(2.0f);
+    return bounds;
+}
 }  // namespace USTC_CG
\ No newline at end of file
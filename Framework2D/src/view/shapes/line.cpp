@@ -70,4 +70,20 @@ bool Line::is_select_on(float x, float y) const
     }
     return false;
 }
+
+/**
+ * @brief 获取直线的包围盒。
+ *
+ * 端点的范围向外扩展选择的宽容范围，宽容范围不小于线宽的一半，因此也包含了绘制的线条。
+ *
+ * @return 直线的包围盒。
+ */
+Shape::Bounds Line::get_bounds() const
+{
+    Bounds bounds = { { start_point_x_, start_point_y_ },
+                      { start_point_x_, start_point_y_ } };
+    bounds.expand(end_point_x_, end_point_y_);
+    bounds.inflate(select_tolerance());
+    return bounds;
+}
 }  // namespace USTC_CG
\ No newline at end of file
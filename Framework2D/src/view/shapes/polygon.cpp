@@ -154,4 +154,23 @@ bool Polygon::is_select_on(float x, float y) const
     }
     return false;
 }
+
+/**
+ * @brief 获取多边形的包围盒。
+ *
+ * 顶点（包括终点）的范围向外扩展选择的宽容范围，宽容范围不小于线宽的一半。
+ *
+ * @return 多边形的包围盒。
+ */
+Shape::Bounds Polygon::get_bounds() const
+{
+    Bounds bounds = { { end_point_x_, end_point_y_ },
+                      { end_point_x_, end_point_y_ } };
+    for (int i = 0; i < points_x_.size(); i++)
+    {
+        bounds.expand(points_x_[i], points_y_[i]);
+    }
+    bounds.inflate(select_tolerance());
+    return bounds;
+}
 }  // namespace USTC_CG
\ No newline at end of file
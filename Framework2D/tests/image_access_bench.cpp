@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "view/image.h"
+#include "warping_rbf.h"
+
+// Times the checked per-pixel access of Image (get_pixel() and set_pixel(),
+// which the warpings and the cloning used) against the row and span functions
+// that replaced it, on the loops the assignments run. Both paths must give the
+// same bytes, so it also runs as a test.
+//
+// Usage: image_access_bench [WIDTH HEIGHT [REPEAT]], 1024 768 5 by default.
+
+using namespace USTC_CG;
+
+// Best time of repeat runs, in milliseconds
+static double best_time(int repeat, const std::function<void()>& run)
+{
+    double best = INFINITY;
+    for (int i = 0; i < repeat; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+static bool same_pixels(const Image& a, const Image& b)
+{
+    return std::memcmp(
+               a.data(),
+               b.data(),
+               static_cast<std::size_t>(a.width()) * a.height() *
+                   a.channels()) == 0;
+}
+
+/**
+ * @brief Time both versions of a loop and check that they agree.
+ * @param name Name of the loop, for the report.
+ * @param repeat How many times each version runs, the best time is reported.
+ * @param before The loop over get_pixel() and set_pixel(), writing to the
+ * first image.
+ * @param after The loop over the new functions, writing to the second image.
+ * @return Whether both versions wrote the same pixels.
+ */
+static bool compare(
+    const char* name,
+    int repeat,
+    Image& before_image,
+    Image& after_image,
+    const std::function<void()>& before,
+    const std::function<void()>& after)
+{
+    double before_time = best_time(repeat, before);
+    double after_time = best_time(repeat, after);
+    bool passed = same_pixels(before_image, after_image);
+    printf(
+        "%-28s %8.2f ms -> %8.2f ms  (%.1fx)%s\n",
+        name,
+        before_time,
+        after_time,
+        before_time / after_time,
+        passed ? "" : "  FAILED: the outputs differ");
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    int width = 1024, height = 768, repeat = 5;
+    if (argc >= 3)
+    {
+        width = std::max(1, atoi(argv[1]));
+        height = std::max(1, atoi(argv[2]));
+    }
+    if (argc >= 4)
+    {
+        repeat = std::max(1, atoi(argv[3]));
+    }
+
+    // An RGBA image with some structure in every channel
+    Image source(width, height, 4);
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char* row = source.row(y);
+        for (int x = 0; x < width; x++)
+        {
+            row[4 * x + 0] = static_cast<unsigned char>(x * 7 + y);
+            row[4 * x + 1] = static_cast<unsigned char>(x ^ y);
+            row[4 * x + 2] = static_cast<unsigned char>(y * 3);
+            row[4 * x + 3] = 255;
+        }
+    }
+
+    // The inverse RBF mapping of 5 control points, evaluated once: only the
+    // pixel access is timed
+    float w = static_cast<float>(width), h = static_cast<float>(height);
+    std::vector<ImVec2> start_points = { ImVec2(0.2f * w, 0.2f * h),
+                                         ImVec2(0.8f * w, 0.2f * h),
+                                         ImVec2(0.5f * w, 0.5f * h),
+                                         ImVec2(0.2f * w, 0.8f * h),
+                                         ImVec2(0.8f * w, 0.8f * h) };
+    std::vector<ImVec2> end_points = start_points;
+    end_points[2] = ImVec2(0.6f * w, 0.4f * h);
+    end_points[4] = ImVec2(0.75f * w, 0.9f * h);
+    WarpEngine::Mapping map = WarpingRBF().fit(end_points, start_points);
+    std::vector<int> source_index(static_cast<std::size_t>(width) * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            ImVec2 p = map(x, y);
+            int sx = static_cast<int>(std::lround(p.x));
+            int sy = static_cast<int>(std::lround(p.y));
+            bool inside = sx >= 0 && sx < width && sy >= 0 && sy < height;
+            source_index[static_cast<std::size_t>(y) * width + x] =
+                inside ? sy * width + sx : -1;
+        }
+    }
+
+    Image before_image(width, height, 4), after_image(width, height, 4);
+    bool passed = true;
+
+    passed &= compare(
+        "fill",
+        repeat,
+        before_image,
+        after_image,
+        [&]()
+        {
+            for (int x = 0; x < width; x++)
+            {
+                for (int y = 0; y < height; y++)
+                {
+                    before_image.set_pixel(x, y, { 0, 0, 0, 255 });
+                }
+            }
+        },
+        [&]() { after_image.fill({ 0, 0, 0, 255 }); });
+
+    passed &= compare(
+        "copy rows",
+        repeat,
+        before_image,
+        after_image,
+        [&]()
+        {
+            for (int x = 0; x < width; x++)
+            {
+                for (int y = 0; y < height; y++)
+                {
+                    before_image.set_pixel(x, y, source.get_pixel(x, y));
+                }
+            }
+        },
+        [&]()
+        {
+            for (int y = 0; y < height; y++)
+            {
+                after_image.copy_row(y, source, y);
+            }
+        });
+
+    // Nearest sampling of the inverse warping, the black background is kept
+    // where the mapping leaves the image
+    before_image.fill({ 0, 0, 0, 255 });
+    after_image.fill({ 0, 0, 0, 255 });
+    passed &= compare(
+        "inverse warping, nearest",
+        repeat,
+        before_image,
+        after_image,
+        [&]()
+        {
+            for (int x = 0; x < width; x++)
+            {
+                for (int y = 0; y < height; y++)
+                {
+                    int index =
+                        source_index[static_cast<std::size_t>(y) * width + x];
+                    if (index >= 0)
+                    {
+                        before_image.set_pixel(
+                            x,
+                            y,
+                            source.get_pixel(index % width, index / width));
+                    }
+                }
+            }
+        },
+        [&]()
+        {
+            for (int y = 0; y < height; y++)
+            {
+                const int* row_index =
+                    source_index.data() + static_cast<std::size_t>(y) * width;
+                for (int x = 0; x < width; x++)
+                {
+                    if (row_index[x] >= 0)
+                    {
+                        after_image.copy_pixel(
+                            x,
+                            y,
+                            source,
+                            row_index[x] % width,
+                            row_index[x] / width);
+                    }
+                }
+            }
+        });
+
+    // RGB reads into an RGBA image, leaving the alpha channel alone, as the
+    // seamless cloning writes its result back
+    passed &= compare(
+        "RGB write-back",
+        repeat,
+        before_image,
+        after_image,
+        [&]()
+        {
+            for (int x = 0; x < width; x++)
+            {
+                for (int y = 0; y < height; y++)
+                {
+                    auto pixel = source.get_pixel(x, y);
+                    before_image.set_pixel(
+                        x, y, { pixel[2], pixel[1], pixel[0] });
+                }
+            }
+        },
+        [&]()
+        {
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    auto pixel = source.get_pixel_array<3>(x, y);
+                    after_image.set_pixel_array<3>(
+                        x, y, { pixel[2], pixel[1], pixel[0] });
+                }
+            }
+        });
+
+    return passed ? 0 : 1;
+}
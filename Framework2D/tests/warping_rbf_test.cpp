@@ -0,0 +1,150 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "warping_rbf.h"
+
+// Fits the same control points with the dense and the compactly supported RBF
+// solvers, and checks that the two mappings stay close.
+
+using namespace USTC_CG;
+
+// Displacement of the control points, smooth and a few pixels large
+static ImVec2 displaced(const ImVec2& p)
+{
+    return ImVec2(
+        p.x + 6.0f * std::sin(p.x / 80.0f) * std::cos(p.y / 70.0f),
+        p.y + 5.0f * std::cos(p.x / 90.0f) * std::sin(p.y / 60.0f));
+}
+
+// Largest distance between the two mappings over the positions
+static double max_difference(
+    const WarpEngine::Mapping& a,
+    const WarpEngine::Mapping& b,
+    const std::vector<ImVec2>& positions)
+{
+    double largest = 0;
+    for (const ImVec2& p : positions)
+    {
+        ImVec2 pa = a(p.x, p.y), pb = b(p.x, p.y);
+        double d = std::hypot(pa.x - pb.x, pa.y - pb.y);
+        if (!std::isfinite(d))
+        {
+            return INFINITY;
+        }
+        largest = std::max(largest, d);
+    }
+    return largest;
+}
+
+// Largest distance of the mapped control points from their end points
+static double max_residual(
+    const WarpEngine::Mapping& map,
+    const std::vector<ImVec2>& start_points,
+    const std::vector<ImVec2>& end_points)
+{
+    double largest = 0;
+    for (std::size_t i = 0; i < start_points.size(); i++)
+    {
+        ImVec2 p = map(start_points[i].x, start_points[i].y);
+        double d = std::hypot(p.x - end_points[i].x, p.y - end_points[i].y);
+        if (!std::isfinite(d))
+        {
+            return INFINITY;
+        }
+        largest = std::max(largest, d);
+    }
+    return largest;
+}
+
+/**
+ * @brief Fit the points with both solvers and compare the mappings.
+ * @param name Name of the case, for the report.
+ * @param start_points The start points.
+ * @param positions Where to compare the mappings.
+ * @param bound The largest difference allowed, in pixels.
+ * @return Whether the case passed.
+ */
+static bool compare(
+    const char* name,
+    const std::vector<ImVec2>& start_points,
+    const std::vector<ImVec2>& positions,
+    double bound)
+{
+    std::vector<ImVec2> end_points;
+    for (const ImVec2& p : start_points)
+    {
+        end_points.push_back(displaced(p));
+    }
+
+    WarpingRBF rbf;
+    rbf.set_solver(WarpingRBF::Solver::kDense);
+    WarpEngine::Mapping dense = rbf.fit(start_points, end_points);
+    rbf.set_solver(WarpingRBF::Solver::kCompact);
+    WarpEngine::Mapping compact = rbf.fit(start_points, end_points);
+
+    double difference = max_difference(dense, compact, positions);
+    double dense_residual = max_residual(dense, start_points, end_points);
+    double compact_residual = max_residual(compact, start_points, end_points);
+    // Both interpolate the control points, up to the smoothing
+    bool passed = difference <= bound && dense_residual <= 0.05 &&
+                  compact_residual <= 0.05;
+    printf(
+        "%-10s %s: difference %.4f (bound %.2f), residuals %.4f %.4f\n",
+        name,
+        passed ? "passed" : "FAILED",
+        difference,
+        bound,
+        dense_residual,
+        compact_residual);
+    return passed;
+}
+
+int main()
+{
+    // Control points on a jittered grid over a 400 * 300 image
+    std::vector<ImVec2> grid_points;
+    for (int j = 0; j < 6; j++)
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            grid_points.push_back(ImVec2(
+                20.0f + 72.0f * i + 9.0f * std::sin(3.0f * i + 7.0f * j),
+                15.0f + 54.0f * j + 7.0f * std::cos(5.0f * i + 2.0f * j)));
+        }
+    }
+    std::vector<ImVec2> grid_positions;
+    for (int y = 20; y <= 280; y += 4)
+    {
+        for (int x = 25; x <= 375; x += 4)
+        {
+            grid_positions.push_back(ImVec2((float)x, (float)y));
+        }
+    }
+
+    // The same, with some of the points selected twice
+    std::vector<ImVec2> duplicate_points = grid_points;
+    for (int i : { 0, 7, 14, 35 })
+    {
+        duplicate_points.push_back(grid_points[i]);
+    }
+
+    // Points along a line, compared on the line only: across it neither
+    // solver knows how to move the pixels
+    std::vector<ImVec2> line_points, line_positions;
+    for (int i = 0; i < 12; i++)
+    {
+        float t = 30.0f * i + 5.0f * std::sin(1.7f * i);
+        line_points.push_back(ImVec2(20.0f + t, 40.0f + 0.5f * t));
+    }
+    for (float t = 0; t <= 330; t += 1.0f)
+    {
+        line_positions.push_back(ImVec2(20.0f + t, 40.0f + 0.5f * t));
+    }
+
+    bool passed = true;
+    passed &= compare("grid", grid_points, grid_positions, 0.5);
+    passed &= compare("duplicate", duplicate_points, grid_positions, 0.5);
+    passed &= compare("collinear", line_points, line_positions, 0.5);
+    return passed ? 0 : 1;
+}
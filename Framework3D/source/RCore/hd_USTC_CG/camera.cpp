@@ -1,5 +1,8 @@
 #include "camera.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "config.h"
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using namespace pxr;
@@ -19,7 +22,7 @@ void Hd_USTC_CG_Camera::Sync(
 
 GfRay Hd_USTC_CG_Camera::generateRay(
     GfVec2f pixel_center,
-    const std::function<float()>& uniform_float) const
+    PixelSampler& uniform_float) const
 {
     const unsigned int minX = _dataWindow.GetMinX();
     unsigned int minY = _dataWindow.GetMinY();
@@ -30,7 +33,7 @@ GfRay Hd_USTC_CG_Camera::generateRay(
     float y = pixel_center[1];
     GfVec2f jitter(0.0f, 0.0f);
     if (Hd_USTC_CG_Config::GetInstance().jitterCamera) {
-        jitter = GfVec2f(uniform_float() - 0.5, uniform_float() - 0.5);
+        jitter = uniform_float.Get2D() - GfVec2f(0.5f);
     }
 
     // Un-transform the pixel's NDC coordinates through the
@@ -66,6 +69,18 @@ GfRay Hd_USTC_CG_Camera::generateRay(
     return { origin, dir };
 }
 
+float Hd_USTC_CG_Camera::pixelSpreadAngle() const
+{
+    const bool isOrthographic = round(_projMatrix[3][3]) == 1;
+    if (isOrthographic) {
+        return 0;
+    }
+    const float w(_dataWindow.GetWidth());
+    const GfVec3f center = _inverseProjMatrix.Transform(GfVec3f(0, 0, -1)).GetNormalized();
+    const GfVec3f next = _inverseProjMatrix.Transform(GfVec3f(2 / w, 0, -1)).GetNormalized();
+    return std::acos(std::clamp(GfDot(center, next), -1.0f, 1.0f));
+}
+
 static GfRect2i _GetDataWindow(const HdRenderPassStateSharedPtr& renderPassState)
 {
     const CameraUtilFraming& framing = renderPassState->GetFraming();
@@ -1,6 +1,7 @@
 #pragma once
 #include "USTC_CG.h"
 
+#include "pixelSampler.h"
 #include "renderBuffer.h"
 #include "pxr/pxr.h"
 #include "pxr/base/gf/ray.h"
@@ -23,7 +24,9 @@ public:
         HdDirtyBits* dirtyBits) override;
     virtual GfRay generateRay(
         GfVec2f pixel_center,
-        const std::function<float()>& function) const;
+        PixelSampler& function) const;
+    // Angle between the rays through two neighboring pixels, 0 for orthographic cameras.
+    float pixelSpreadAngle() const;
 
     void update(const HdRenderPassStateSharedPtr& renderPassState) const;
 
@@ -1,6 +1,164 @@
 #pragma once
 #include "USTC_CG.h"
 #include "pxr/base/gf/vec3f.h"
+#include "pxr/base/gf/vec4f.h"
+
+// Color4 uses SSE where the target has it. Define USTC_CG_SCALAR_COLOR to build the scalar
+// version instead, which gives the same bits when neither is compiled with floating point
+// contraction (the HD_USTC_CG_DETERMINISTIC CMake option).
+#if !defined(USTC_CG_SCALAR_COLOR) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define USTC_CG_SIMD_COLOR 1
+#include <immintrin.h>
+#endif
+
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using Color = pxr::GfVec3f;
-USTC_CG_NAMESPACE_CLOSE_SCOPE
\ No newline at end of file
+
+inline float Luminance(const Color& color)
+{
+    return 0.2126f * color[0] + 0.7152f * color[1] + 0.0722f * color[2];
+}
+
+/**
+ * \brief RGBA color held in one SSE register, for the radiance sums of the integrators and the
+ * film. Every lane goes through the same single precision IEEE operation as the scalar version
+ * (no approximate reciprocal), so both give bitwise identical images.
+ */
+class alignas(16) Color4 {
+   public:
+    Color4() : Color4(0.0f)
+    {
+    }
+    explicit Color4(float value) : Color4(value, value, value, value)
+    {
+    }
+    Color4(float r, float g, float b, float a) : v_{ r, g, b, a }
+    {
+    }
+    explicit Color4(const Color& color, float alpha = 0)
+        : Color4(color[0], color[1], color[2], alpha)
+    {
+    }
+    explicit Color4(const pxr::GfVec4f& color) : Color4(color[0], color[1], color[2], color[3])
+    {
+    }
+
+    float operator[](int i) const
+    {
+        return v_[i];
+    }
+    Color GetRGB() const
+    {
+        return Color(v_[0], v_[1], v_[2]);
+    }
+    pxr::GfVec4f GetRGBA() const
+    {
+        return pxr::GfVec4f(v_[0], v_[1], v_[2], v_[3]);
+    }
+    float MaxRGB() const
+    {
+        float m = v_[0] > v_[1] ? v_[0] : v_[1];
+        return m > v_[2] ? m : v_[2];
+    }
+
+#ifdef USTC_CG_SIMD_COLOR
+    Color4& operator+=(const Color4& other)
+    {
+        _mm_store_ps(v_, _mm_add_ps(_mm_load_ps(v_), _mm_load_ps(other.v_)));
+        return *this;
+    }
+    Color4& operator-=(const Color4& other)
+    {
+        _mm_store_ps(v_, _mm_sub_ps(_mm_load_ps(v_), _mm_load_ps(other.v_)));
+        return *this;
+    }
+    // Componentwise.
+    Color4& operator*=(const Color4& other)
+    {
+        _mm_store_ps(v_, _mm_mul_ps(_mm_load_ps(v_), _mm_load_ps(other.v_)));
+        return *this;
+    }
+    Color4& operator*=(float s)
+    {
+        _mm_store_ps(v_, _mm_mul_ps(_mm_load_ps(v_), _mm_set1_ps(s)));
+        return *this;
+    }
+    Color4& operator/=(float s)
+    {
+        _mm_store_ps(v_, _mm_div_ps(_mm_load_ps(v_), _mm_set1_ps(s)));
+        return *this;
+    }
+#else
+    Color4& operator+=(const Color4& other)
+    {
+        for (int i = 0; i < 4; ++i) {
+            v_[i] += other.v_[i];
+        }
+        return *this;
+    }
+    Color4& operator-=(const Color4& other)
+    {
+        for (int i = 0; i < 4; ++i) {
+            v_[i] -= other.v_[i];
+        }
+        return *this;
+    }
+    // Componentwise.
+    Color4& operator*=(const Color4& other)
+    {
+        for (int i = 0; i < 4; ++i) {
+            v_[i] *= other.v_[i];
+        }
+        return *this;
+    }
+    Color4& operator*=(float s)
+    {
+        for (int i = 0; i < 4; ++i) {
+            v_[i] *= s;
+        }
+        return *this;
+    }
+    Color4& operator/=(float s)
+    {
+        for (int i = 0; i < 4; ++i) {
+            v_[i] /= s;
+        }
+        return *this;
+    }
+#endif
+
+    friend Color4 operator+(Color4 a, const Color4& b)
+    {
+        return a += b;
+    }
+    friend Color4 operator-(Color4 a, const Color4& b)
+    {
+        return a -= b;
+    }
+    friend Color4 operator*(Color4 a, const Color4& b)
+    {
+        return a *= b;
+    }
+    friend Color4 operator*(Color4 a, float s)
+    {
+        return a *= s;
+    }
+    friend Color4 operator*(float s, Color4 a)
+    {
+        return a *= s;
+    }
+    friend Color4 operator/(Color4 a, float s)
+    {
+        return a /= s;
+    }
+
+   private:
+    alignas(16) float v_[4];
+};
+
+inline float Luminance(const Color4& color)
+{
+    return 0.2126f * color[0] + 0.7152f * color[1] + 0.0722f * color[2];
+}
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -53,6 +53,11 @@ TF_DEFINE_ENV_SETTING(
     "Ambient occlusion samples per camera ray (must be >= 0; a value of 0 disables ambient occlusion)")
 ;
 
+TF_DEFINE_ENV_SETTING(
+    HDEMBREE_DIRECT_LIGHT_SAMPLES,
+    4,
+    "Light and BRDF sample pairs per camera ray of the direct lighting mode (must be >= 1)");
+
 TF_DEFINE_ENV_SETTING(
     HDEMBREE_JITTER_CAMERA,
     1,
@@ -68,6 +73,46 @@ TF_DEFINE_ENV_SETTING(
     300,
     "Intensity of the camera light, specified as a percentage of <1,1,1>.");
 
+TF_DEFINE_ENV_SETTING(
+    HDEMBREE_SAMPLER,
+    "sobol",
+    "Sampler of the path tracer (independent, stratified, sobol or bluenoise)");
+
+TF_DEFINE_ENV_SETTING(
+    HDEMBREE_RANDOM_SEED,
+    0,
+    "Seed of the path tracer's sampler (must be >= 0)");
+
+TF_DEFINE_ENV_SETTING(
+    HDEMBREE_ADAPTIVE_ERROR_THRESHOLD,
+    0,
+    "Relative error (in thousandths) under which a pixel stops being sampled (0 disables adaptive sampling)");
+
+TF_DEFINE_ENV_SETTING(
+    HDEMBREE_DENOISE,
+    0,
+    "Should Hd_USTC_CG_ denoise the color output? (values > 0 are true)");
+
+TF_DEFINE_ENV_SETTING(
+    HDEMBREE_PASS_TIME_BUDGET,
+    0,
+    "Milliseconds a render pass may take before it stops adding samples (0 disables the budget)");
+
+TF_DEFINE_ENV_SETTING(
+    HDEMBREE_TEXTURE_CACHE_SIZE,
+    1024,
+    "Memory budget of the texture cache in MB (must be >= 0)");
+
+TF_DEFINE_ENV_SETTING(
+    HDEMBREE_BVH_QUALITY,
+    "auto",
+    "BVH build quality of meshes (static, dynamic or auto)");
+
+TF_DEFINE_ENV_SETTING(
+    HDEMBREE_PRINT_STATISTICS,
+    0,
+    "Should Hd_USTC_CG_ print BVH and trace timings? (values > 0 are true)");
+
 TF_DEFINE_ENV_SETTING(
     HDEMBREE_PRINT_CONFIGURATION,
     0,
@@ -85,12 +130,31 @@ Hd_USTC_CG_Config::Hd_USTC_CG_Config()
     ambientOcclusionSamples = std::max(
         0,
         TfGetEnvSetting(HDEMBREE_AMBIENT_OCCLUSION_SAMPLES));
+    directLightSamples = std::max(
+        1,
+        TfGetEnvSetting(HDEMBREE_DIRECT_LIGHT_SAMPLES));
     jitterCamera = (TfGetEnvSetting(HDEMBREE_JITTER_CAMERA) > 0);
     useFaceColors = (TfGetEnvSetting(HDEMBREE_USE_FACE_COLORS) > 0);
     cameraLightIntensity = (std::max(
                                 100,
                                 TfGetEnvSetting(
                                     HDEMBREE_CAMERA_LIGHT_INTENSITY)) / 100.0f);
+    samplerType = TfGetEnvSetting(HDEMBREE_SAMPLER);
+    randomSeed = std::max(
+        0,
+        TfGetEnvSetting(HDEMBREE_RANDOM_SEED));
+    adaptiveErrorThreshold = std::max(
+        0,
+        TfGetEnvSetting(HDEMBREE_ADAPTIVE_ERROR_THRESHOLD)) / 1000.0f;
+    denoise = TfGetEnvSetting(HDEMBREE_DENOISE) > 0;
+    passTimeBudget = std::max(
+        0,
+        TfGetEnvSetting(HDEMBREE_PASS_TIME_BUDGET)) / 1000.0f;
+    textureCacheSize = std::max(
+        0,
+        TfGetEnvSetting(HDEMBREE_TEXTURE_CACHE_SIZE));
+    bvhQuality = TfGetEnvSetting(HDEMBREE_BVH_QUALITY);
+    printStatistics = TfGetEnvSetting(HDEMBREE_PRINT_STATISTICS) > 0;
 
     if (TfGetEnvSetting(HDEMBREE_PRINT_CONFIGURATION) > 0)
     {
@@ -102,12 +166,30 @@ Hd_USTC_CG_Config::Hd_USTC_CG_Config()
             << tileSize << "\n"
             << "  ambientOcclusionSamples    = "
             << ambientOcclusionSamples << "\n"
+            << "  directLightSamples         = "
+            << directLightSamples << "\n"
             << "  jitterCamera               = "
             << jitterCamera << "\n"
             << "  useFaceColors              = "
             << useFaceColors << "\n"
             << "  cameraLightIntensity      = "
-            << cameraLightIntensity << "\n";
+            << cameraLightIntensity << "\n"
+            << "  samplerType                = "
+            << samplerType << "\n"
+            << "  randomSeed                 = "
+            << randomSeed << "\n"
+            << "  adaptiveErrorThreshold     = "
+            << adaptiveErrorThreshold << "\n"
+            << "  denoise                    = "
+            << denoise << "\n"
+            << "  passTimeBudget             = "
+            << passTimeBudget << "\n"
+            << "  textureCacheSize           = "
+            << textureCacheSize << "\n"
+            << "  bvhQuality                 = "
+            << bvhQuality << "\n"
+            << "  printStatistics            = "
+            << printStatistics << "\n";
     }
 }
 
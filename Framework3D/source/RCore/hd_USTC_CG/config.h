@@ -24,6 +24,8 @@
 #ifndef PXR_IMAGING_PLUGIN_HD_EMBREE_CONFIG_H
 #define PXR_IMAGING_PLUGIN_HD_EMBREE_CONFIG_H
 
+#include <string>
+
 #include "USTC_CG.h"
 #include "pxr/pxr.h"
 #include "pxr/base/tf/singleton.h"
@@ -67,6 +69,12 @@ public:
     /// Override with *HDEMBREE_AMBIENT_OCCLUSION_SAMPLES*.
     unsigned int ambientOcclusionSamples;
 
+    /// How many light samples, each paired with a BRDF sample, should the
+    /// direct lighting mode take per camera ray?
+    ///
+    /// Override with *HDEMBREE_DIRECT_LIGHT_SAMPLES*.
+    unsigned int directLightSamples;
+
     /// Should the renderpass jitter camera rays for antialiasing?
     ///
     /// Override with *HDEMBREE_JITTER_CAMERA*. Integer values greater than
@@ -86,6 +94,55 @@ public:
     /// Override with *HDEMBREE_CAMERA_LIGHT_INTENSITY*.
     float cameraLightIntensity;
 
+    /// Which sampler generates the random numbers of the path tracer?
+    /// One of "independent", "stratified", "sobol" and "bluenoise".
+    ///
+    /// Override with *HDEMBREE_SAMPLER*.
+    std::string samplerType;
+
+    /// Seed of the sampler. Renders are deterministic for a given seed.
+    ///
+    /// Override with *HDEMBREE_RANDOM_SEED*.
+    unsigned int randomSeed;
+
+    /// Relative error of the pixel mean under which adaptive sampling stops
+    /// sampling a pixel. Adaptive sampling is off when this is 0.
+    ///
+    /// Override with *HDEMBREE_ADAPTIVE_ERROR_THRESHOLD*, in thousandths.
+    float adaptiveErrorThreshold;
+
+    /// Should the color output be denoised?
+    ///
+    /// Override with *HDEMBREE_DENOISE*.
+    bool denoise;
+
+    /// How many seconds may a render pass take? Once they are spent, the
+    /// pass stops adding samples, so its pixels may get fewer than
+    /// samplesToConvergence. 0 means no limit.
+    ///
+    /// Override with *HDEMBREE_PASS_TIME_BUDGET*, in milliseconds.
+    float passTimeBudget;
+
+    /// Memory (in MB) the texture cache may keep for textures no material
+    /// or light uses any more.
+    ///
+    /// Override with *HDEMBREE_TEXTURE_CACHE_SIZE*.
+    unsigned int textureCacheSize;
+
+    /// How are the mesh BVHs built? "static" builds high quality BVHs,
+    /// "dynamic" builds low quality BVHs that are refit when only the points
+    /// change, and "auto" switches a mesh to "dynamic" once its points change.
+    ///
+    /// Override with *HDEMBREE_BVH_QUALITY*.
+    std::string bvhQuality;
+
+    /// Should Hd_USTC_CG_ print BVH build and trace timings after each render
+    /// pass?
+    ///
+    /// Override with *HDEMBREE_PRINT_STATISTICS*. Integer values greater than
+    /// zero are true.
+    bool printStatistics;
+
 private:
     // The constructor initializes the config variables with their
     // default or environment-provided override, and optionally prints
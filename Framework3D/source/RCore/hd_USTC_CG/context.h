@@ -25,12 +25,20 @@
 #define PXR_IMAGING_PLUGIN_HD_EMBREE_CONTEXT_H
 #include <embree4/rtcore.h>
 
+#include <vector>
+
 #include "USTC_CG.h"
-#include "pxr/base/gf/matrix4f.h"
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/gf/vec3f.h"
 #include "pxr/base/vt/array.h"
 #include "pxr/pxr.h"
 #include "sampler.h"
 
+// Instances are stored as Embree instance arrays (Embree 4.3+).
+#if !defined(RTC_GEOMETRY_INSTANCE_ARRAY)
+#error "Hd_USTC_CG_ needs Embree built with EMBREE_GEOMETRY_INSTANCE_ARRAY"
+#endif
+
 PXR_NAMESPACE_OPEN_SCOPE
 class HdRprim;
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -50,22 +58,73 @@ struct Hd_USTC_CG_PrototypeContext {
     TfHashMap<TfToken, Hd_USTC_CG_PrimvarSampler *, TfToken::HashFunctor> primvarMap;
     /// A copy of the primitive params for this rprim.
     VtIntArray primitiveParams;
+
+    // Bindings resolved at Sync time, so that a hit doesn't need any lookup.
+    /// Index of the material in Hd_USTC_CG_RenderParam::materialTable.
+    unsigned materialIndex = 0;
+    /// The "normals" primvar sampler, or nullptr.
+    Hd_USTC_CG_PrimvarSampler *normalSampler = nullptr;
+    /// Sampler of the texcoord primvar named texcoordName, which the material
+    /// reads, or nullptr.
+    Hd_USTC_CG_PrimvarSampler *texcoordSampler = nullptr;
+    TfToken texcoordName;
+};
+
+///
+/// \struct Hd_USTC_CG_InstanceTransform
+///
+/// The transforms of one instance. objectToWorld is the column-major 3x4
+/// matrix (RTC_FORMAT_FLOAT3X4_COLUMN_MAJOR) that an Embree instance array
+/// reads in place: the images of the x, y and z axes, then the translation.
+/// normalToWorld holds the columns of the inverse transpose of its linear
+/// part, so that normals stay normal under non-uniform scales.
+///
+struct Hd_USTC_CG_InstanceTransform {
+    GfVec3f objectToWorld[4];
+    GfVec3f normalToWorld[3];
+
+    void Set(const GfMatrix4d &matrix)
+    {
+        // Gf matrices transform row vectors, so their rows are our columns.
+        for (int i = 0; i < 4; ++i) {
+            objectToWorld[i] = GfVec3f(matrix[i][0], matrix[i][1], matrix[i][2]);
+        }
+        const GfVec3f &x = objectToWorld[0], &y = objectToWorld[1], &z = objectToWorld[2];
+        // The inverse transpose of [x y z] is [y^z z^x x^y] / det.
+        const float det = GfDot(x, GfCross(y, z));
+        const float scale = det != 0 ? 1 / det : 1;
+        normalToWorld[0] = GfCross(y, z) * scale;
+        normalToWorld[1] = GfCross(z, x) * scale;
+        normalToWorld[2] = GfCross(x, y) * scale;
+    }
+
+    GfVec3f TransformDir(const GfVec3f &dir) const
+    {
+        return objectToWorld[0] * dir[0] + objectToWorld[1] * dir[1] +
+               objectToWorld[2] * dir[2];
+    }
+
+    GfVec3f TransformNormal(const GfVec3f &normal) const
+    {
+        return normalToWorld[0] * normal[0] + normalToWorld[1] * normal[1] +
+               normalToWorld[2] * normal[2];
+    }
 };
 
 ///
 /// \class Hd_USTC_CG_InstanceContext
 ///
-/// A small bit of state attached to each bit of instanced geometry in embree,
-/// for the benefit of Hd_USTC_CG_Renderer::_TraceRay.
+/// A small bit of state attached to the instance array of each prototype in
+/// embree, for the benefit of Hd_USTC_CG_Renderer::_TraceRay. A hit's
+/// instPrimID indexes the transforms.
 ///
 struct Hd_USTC_CG_InstanceContext {
-    /// The object-to-world transform, for transforming normals to worldspace.
-    GfMatrix4f objectToWorldMatrix;
+    /// The transforms of the instances, which the instance array geometry
+    /// shares, for transforming normals to worldspace.
+    std::vector<Hd_USTC_CG_InstanceTransform> transforms;
     /// The scene the prototype geometry lives in, for passing to
     /// rtcInterpolate.
     RTCScene rootScene;
-    /// The instance id of this instance.
-    int32_t instanceId;
 };
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,107 @@
+#include "denoiser.h"
+
+#include <cmath>
+#include <vector>
+
+#include "pxr/base/work/loops.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+// Filter the incident light rather than the color, so that textures are not blurred.
+static GfVec3f _Demodulate(const GfVec4f& color, const GfVec3f& albedo)
+{
+    GfVec3f result;
+    for (int c = 0; c < 3; ++c) {
+        result[c] = albedo[c] > 1e-3f ? color[c] / albedo[c] : color[c];
+    }
+    return result;
+}
+
+// Compress the dynamic range, so that the color weight does not depend on the exposure.
+static GfVec3f _ToneMap(const GfVec3f& color)
+{
+    return { color[0] / (1.f + color[0]),
+             color[1] / (1.f + color[1]),
+             color[2] / (1.f + color[2]) };
+}
+
+void Denoiser::Execute(
+    const GfVec4f* color,
+    const GfVec3f* albedo,
+    const GfVec3f* normal,
+    int width,
+    int height,
+    GfVec4f* output) const
+{
+    static const float kernel[5] = { 1.f / 16, 1.f / 4, 3.f / 8, 1.f / 4, 1.f / 16 };
+
+    const size_t count = size_t(width) * height;
+    std::vector<GfVec3f> current(count), next(count);
+    for (size_t i = 0; i < count; ++i) {
+        current[i] = _Demodulate(color[i], albedo[i]);
+    }
+
+    for (unsigned iteration = 0; iteration < iterations; ++iteration) {
+        const int step = 1 << iteration;
+        // Later passes compare smoother colors, so they can be stricter.
+        const float color_sigma2 = color_sigma * color_sigma / float(step);
+
+        WorkParallelForN(height, [&](size_t begin, size_t end) {
+            for (int y = int(begin); y < int(end); ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const size_t p = size_t(y) * width + x;
+                    const GfVec3f c_p = _ToneMap(current[p]);
+
+                    GfVec3f sum(0.f);
+                    float weight_sum = 0.f;
+                    for (int j = -2; j <= 2; ++j) {
+                        const int qy = y + j * step;
+                        if (qy < 0 || qy >= height) {
+                            continue;
+                        }
+                        for (int i = -2; i <= 2; ++i) {
+                            const int qx = x + i * step;
+                            if (qx < 0 || qx >= width) {
+                                continue;
+                            }
+                            const size_t q = size_t(qy) * width + qx;
+
+                            float w_color =
+                                std::exp(-(_ToneMap(current[q]) - c_p).GetLengthSq() / color_sigma2);
+                            float w_albedo = std::exp(
+                                -(albedo[q] - albedo[p]).GetLengthSq() /
+                                (albedo_sigma * albedo_sigma));
+                            // Background pixels have no normal and only match each other.
+                            bool has_normal_p = normal[p] != GfVec3f(0.f);
+                            bool has_normal_q = normal[q] != GfVec3f(0.f);
+                            float w_normal =
+                                has_normal_p && has_normal_q
+                                    ? std::pow(std::max(0.f, GfDot(normal[p], normal[q])), normal_power)
+                                    : float(has_normal_p == has_normal_q);
+
+                            float w = kernel[i + 2] * kernel[j + 2] * w_color * w_albedo * w_normal;
+                            sum += w * current[q];
+                            weight_sum += w;
+                        }
+                    }
+                    // The center tap always has a positive weight.
+                    next[p] = sum / weight_sum;
+                }
+            }
+        });
+        std::swap(current, next);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        GfVec3f result = current[i];
+        for (int c = 0; c < 3; ++c) {
+            if (albedo[i][c] > 1e-3f) {
+                result[c] *= albedo[i][c];
+            }
+        }
+        output[i] = GfVec4f(result[0], result[1], result[2], color[i][3]);
+    }
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
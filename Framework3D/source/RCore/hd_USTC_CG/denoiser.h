@@ -0,0 +1,35 @@
+#pragma once
+#include "USTC_CG.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/gf/vec4f.h"
+#include "pxr/pxr.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) guided by the first-hit albedo
+ * and normal. The interface follows OIDN's "RT" filter (color + albedo + normal in, color out), so
+ * a learned denoiser can be dropped in later.
+ *
+ * All images are width * height, row by row. Alpha is passed through untouched.
+ */
+class Denoiser {
+   public:
+    // Number of a-trous passes. The footprint of the filter is 4 * 2^iterations pixels wide.
+    unsigned iterations = 5;
+    // Tolerances of the edge-stopping functions.
+    float color_sigma = 0.5f;
+    float albedo_sigma = 0.1f;
+    float normal_power = 64.f;
+
+    void Execute(
+        const GfVec4f* color,
+        const GfVec3f* albedo,
+        const GfVec3f* normal,
+        int width,
+        int height,
+        GfVec4f* output) const;
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -24,11 +24,16 @@
 
 #include "mesh.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <iostream>
 
 #include "USTC_CG.h"
+#include "config.h"
 #include "context.h"
 #include "instancer.h"
+#include "material.h"
 #include "meshSamplers.h"
 #include "pxr/imaging/hd/extComputationUtils.h"
 #include "pxr/imaging/hd/instancer.h"
@@ -45,9 +50,15 @@ Hd_USTC_CG_Mesh::Hd_USTC_CG_Mesh(const SdfPath& id)
       _doubleSided(false),
       _smoothNormals(false),
       _rtcMeshId(RTC_INVALID_GEOMETRY_ID),
+      _rtcInstanceArray(nullptr),
+      _rtcInstanceArrayId(RTC_INVALID_GEOMETRY_ID),
       _normalsValid(false),
       _adjacencyValid(false),
-      _refined(false)
+      _refined(false),
+      _deforming(false),
+      _dynamicBvh(false),
+      _vertices(nullptr),
+      _vertexCount(0)
 {
 }
 
@@ -259,9 +270,6 @@ RTCGeometry Hd_USTC_CG_Mesh::_CreateEmbreeSubdivMesh(RTCScene scene, RTCDevice d
     // Note this geometry is committed outside this function, but that
     // is not "enforced"
     RTCGeometry geom = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_SUBDIVISION);
-
-    // Uses a BVH refitting approach when changing only the vertex buffer.
-    rtcSetGeometryBuildQuality(geom, RTC_BUILD_QUALITY_REFIT);
     rtcSetGeometryTimeStepCount(geom, 1);
     _rtcMeshId = rtcAttachGeometry(scene, geom);
 
@@ -395,8 +403,6 @@ RTCGeometry Hd_USTC_CG_Mesh::_CreateEmbreeTriangleMesh(RTCScene scene, RTCDevice
     // Create the new mesh.
     // geometry will be committed in the calling function
     RTCGeometry geom = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_TRIANGLE);
-    // Uses a BVH refitting approach when changing only the vertex buffer.
-    rtcSetGeometryBuildQuality(geom, RTC_BUILD_QUALITY_REFIT);
     rtcSetGeometryTimeStepCount(geom, 1);
     _rtcMeshId = rtcAttachGeometry(scene, geom);
 
@@ -426,7 +432,8 @@ void Hd_USTC_CG_Mesh::_PopulateRtMesh(
     RTCScene scene,
     RTCDevice device,
     HdDirtyBits* dirtyBits,
-    const HdMeshReprDesc& desc)
+    const HdMeshReprDesc& desc,
+    Hd_USTC_CG_RenderStatistics& statistics)
 {
     HD_TRACE_FUNCTION();
     HF_MALLOC_TAG_FUNCTION();
@@ -465,7 +472,7 @@ void Hd_USTC_CG_Mesh::_PopulateRtMesh(
     }
 
     if (HdChangeTracker::IsTransformDirty(*dirtyBits, id)) {
-        _transform = GfMatrix4f(sceneDelegate->GetTransform(id));
+        _transform = sceneDelegate->GetTransform(id);
     }
 
     if (HdChangeTracker::IsVisibilityDirty(*dirtyBits, id)) {
@@ -543,19 +550,10 @@ void Hd_USTC_CG_Mesh::_PopulateRtMesh(
             _rtcMeshId = RTC_INVALID_GEOMETRY_ID;
         }
 
-        // Create the prototype mesh scene, if it doesn't exist yet.
+        // Create the prototype mesh scene, if it doesn't exist yet. Its
+        // build quality is set by _UpdateBuildQuality() below.
         if (_rtcMeshScene == nullptr) {
             _rtcMeshScene = rtcNewScene(device);
-            // RTC_SCENE_FLAG_DYNAMIC: Provides better build performance for
-            // dynamic scenes (but also higher memory consumption).
-            rtcSetSceneFlags(_rtcMeshScene, RTC_SCENE_FLAG_DYNAMIC);
-
-            // RTC_BUILD_QUALITY_LOW: Create lower quality data structures,
-            // e.g. for dynamic scenes. A two-level spatial index structure
-            // is built when enabling this mode, which supports fast partial
-            // scene updates, and allows for setting a per-geometry build
-            // quality through the rtcSetGeometryBuildQuality function.
-            rtcSetSceneBuildQuality(_rtcMeshScene, RTC_BUILD_QUALITY_LOW);
         }
 
         // Populate either a subdiv or a triangle mesh object. The helper
@@ -588,6 +586,20 @@ void Hd_USTC_CG_Mesh::_PopulateRtMesh(
         // Force the smooth normals code to rebuild the "normals" primvar
         // the next time smooth normals is enabled.
         _normalsValid = false;
+        // The vertex buffer belongs to the old geometry.
+        _vertices = nullptr;
+    }
+
+    // Points changing on their own (simulation playback, skinning...) mark
+    // the mesh as deforming, from then on its BVH is refit.
+    const bool pointsDirty = HdChangeTracker::IsPrimvarDirty(*dirtyBits, id, HdTokens->points);
+    bool rebuildBvh = newMesh;
+    if (!newMesh && pointsDirty && !_deforming) {
+        _deforming = true;
+        rebuildBvh = true;
+    }
+    if (rebuildBvh) {
+        _UpdateBuildQuality();
     }
 
     // If the refine level changed or the mesh was recreated, we need to
@@ -678,19 +690,24 @@ void Hd_USTC_CG_Mesh::_PopulateRtMesh(
         }
     }
 
-    // Populate points in the RTC mesh.
-    if (newMesh || HdChangeTracker::IsPrimvarDirty(*dirtyBits, id, HdTokens->points)) {
-        rtcSetSharedGeometryBuffer(
-            _geometry,
-            RTC_BUFFER_TYPE_VERTEX,
-            0,
-            /* unsigned int slot */
-            RTC_FORMAT_FLOAT3,
-            _points.cdata(),
-            0,
-            /* size_t byteOffset */
-            sizeof(GfVec3f),
-            _points.size());
+    // Populate points in the RTC mesh. The vertex buffer is owned by Embree
+    // (which also pads it for its vector loads), so that a points-only update
+    // is a copy into the existing buffer followed by a refit.
+    if (newMesh || pointsDirty) {
+        if (_vertices == nullptr || _vertexCount != _points.size()) {
+            _vertices = static_cast<GfVec3f*>(rtcSetNewGeometryBuffer(
+                _geometry,
+                RTC_BUFFER_TYPE_VERTEX,
+                0,
+                /* unsigned int slot */
+                RTC_FORMAT_FLOAT3,
+                sizeof(GfVec3f),
+                _points.size()));
+            _vertexCount = _points.size();
+            rebuildBvh = true;
+        }
+        std::copy(_points.cbegin(), _points.cend(), _vertices);
+        rtcUpdateGeometryBuffer(_geometry, RTC_BUFFER_TYPE_VERTEX, 0);
 
         rtcCommitGeometry(_geometry);
     }
@@ -703,7 +720,17 @@ void Hd_USTC_CG_Mesh::_PopulateRtMesh(
         rtcDisableGeometry(_geometry);
     }
 
+    auto commitStart = std::chrono::steady_clock::now();
     rtcCommitScene(_rtcMeshScene);
+    statistics.prototypeBuildTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                                         std::chrono::steady_clock::now() - commitStart)
+                                         .count();
+    if (rebuildBvh || (pointsDirty && !_dynamicBvh)) {
+        statistics.prototypeBuilds++;
+    }
+    else if (pointsDirty) {
+        statistics.prototypeRefits++;
+    }
 
     ////////////////////////////////////////////////////////////////////////
     // 4. Populate embree instance objects.
@@ -713,6 +740,19 @@ void Hd_USTC_CG_Mesh::_PopulateRtMesh(
 
     HdInstancer::_SyncInstancerAndParents(sceneDelegate->GetRenderIndex(), GetInstancerId());
 
+    // All the instances are a single instance array in the top-level scene,
+    // so that a forest of instances costs one geometry and one float 3x4
+    // matrix (plus its normal matrix) per instance.
+    if (_rtcInstanceArray == nullptr) {
+        _rtcInstanceArray = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_INSTANCE_ARRAY);
+        rtcSetGeometryInstancedScene(_rtcInstanceArray, _rtcMeshScene);
+        rtcSetGeometryTimeStepCount(_rtcInstanceArray, 1);
+        auto ctx = new Hd_USTC_CG_InstanceContext;
+        ctx->rootScene = _rtcMeshScene;
+        rtcSetGeometryUserData(_rtcInstanceArray, ctx);
+        _rtcInstanceArrayId = rtcAttachGeometry(scene, _rtcInstanceArray);
+    }
+
     if (HdChangeTracker::IsInstancerDirty(*dirtyBits, id) ||
         HdChangeTracker::IsTransformDirty(*dirtyBits, id)) {
         VtMatrix4dArray transforms;
@@ -729,49 +769,35 @@ void Hd_USTC_CG_Mesh::_PopulateRtMesh(
             transforms.push_back(GfMatrix4d(1.0));
         }
 
-        size_t oldSize = _rtcInstanceIds.size();
-        size_t newSize = transforms.size();
-
-        // Size down (if necessary).
-        for (size_t i = newSize; i < oldSize; ++i) {
-            // Delete instance context first...
-            delete _GetInstanceContext(scene, i);
-            // Then Embree instance.
-            rtcDetachGeometry(scene, _rtcInstanceIds[i]);
-            rtcReleaseGeometry(_rtcInstanceGeometries[i]);
-        }
-        _rtcInstanceIds.resize(newSize);
-        _rtcInstanceGeometries.resize(newSize);
-
-        // Size up (if necessary).
-        for (size_t i = oldSize; i < newSize; ++i) {
-            // Create the new instance.
-            RTCGeometry geom = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_INSTANCE);
-            rtcSetGeometryInstancedScene(geom, _rtcMeshScene);
-            rtcSetGeometryTimeStepCount(geom, 1);
-            _rtcInstanceIds[i] = rtcAttachGeometry(scene, geom);
-
-            // Create the instance context.
-            auto ctx = new Hd_USTC_CG_InstanceContext;
-            ctx->rootScene = _rtcMeshScene;
-            ctx->instanceId = i;
-            rtcSetGeometryUserData(geom, ctx);
-            _rtcInstanceGeometries[i] = geom;
-        }
-
-        // Update transform
+        Hd_USTC_CG_InstanceContext* ctx = _GetInstanceContext();
+        ctx->transforms.resize(transforms.size());
         for (size_t i = 0; i < transforms.size(); ++i) {
             // Combine the local transform and the instance transform.
-            GfMatrix4f matf = _transform * GfMatrix4f(transforms[i]);
-
-            // Update the transform in the BVH.
-            rtcSetGeometryTransform(
-                _rtcInstanceGeometries[i], 0, RTC_FORMAT_FLOAT4X4_COLUMN_MAJOR, matf.GetArray());
-            // // Update the transform in the instance context.
-            _GetInstanceContext(scene, i)->objectToWorldMatrix = matf;
-            // // Mark the instance as updated in the BVH.
-            rtcCommitGeometry(_rtcInstanceGeometries[i]);
+            ctx->transforms[i].Set(_transform * transforms[i]);
+        }
+
+        if (ctx->transforms.empty()) {
+            rtcDisableGeometry(_rtcInstanceArray);
+        }
+        else {
+            // The buffer may have moved, so share it again.
+            rtcSetSharedGeometryBuffer(
+                _rtcInstanceArray,
+                RTC_BUFFER_TYPE_TRANSFORM,
+                0,
+                RTC_FORMAT_FLOAT3X4_COLUMN_MAJOR,
+                ctx->transforms.data(),
+                offsetof(Hd_USTC_CG_InstanceTransform, objectToWorld),
+                sizeof(Hd_USTC_CG_InstanceTransform),
+                ctx->transforms.size());
+            rtcEnableGeometry(_rtcInstanceArray);
         }
+        rtcCommitGeometry(_rtcInstanceArray);
+    }
+    else if (pointsDirty) {
+        // The instanced scene changed bounds, which the top-level scene only
+        // picks up from committed instances.
+        rtcCommitGeometry(_rtcInstanceArray);
     }
 
     *dirtyBits &= ~HdChangeTracker::AllSceneDirtyBits;
@@ -831,10 +857,9 @@ Hd_USTC_CG_PrototypeContext* Hd_USTC_CG_Mesh::_GetPrototypeContext()
     return static_cast<Hd_USTC_CG_PrototypeContext*>(rtcGetGeometryUserData(_geometry));
 }
 
-Hd_USTC_CG_InstanceContext* Hd_USTC_CG_Mesh::_GetInstanceContext(RTCScene scene, size_t i)
+Hd_USTC_CG_InstanceContext* Hd_USTC_CG_Mesh::_GetInstanceContext()
 {
-    return static_cast<Hd_USTC_CG_InstanceContext*>(
-        rtcGetGeometryUserData(_rtcInstanceGeometries[i]));
+    return static_cast<Hd_USTC_CG_InstanceContext*>(rtcGetGeometryUserData(_rtcInstanceArray));
 }
 
 void Hd_USTC_CG_Mesh::_InitRepr(const TfToken& reprToken, HdDirtyBits* dirtyBits)
@@ -876,26 +901,75 @@ void Hd_USTC_CG_Mesh::Sync(
     RTCDevice device = embreeRenderParam->GetEmbreeDevice();
 
     // Create embree geometry objects.
-    _PopulateRtMesh(sceneDelegate, scene, device, dirtyBits, desc);
+    _PopulateRtMesh(
+        sceneDelegate, scene, device, dirtyBits, desc, embreeRenderParam->statistics);
+
+    // Samplers may have been recreated, and the material may have changed.
+    _UpdateBindings(embreeRenderParam);
+}
+
+void Hd_USTC_CG_Mesh::_UpdateBuildQuality()
+{
+    const std::string& policy = Hd_USTC_CG_Config::GetInstance().bvhQuality;
+    const bool dynamic = policy == "dynamic" || (policy != "static" && _deforming);
+
+    if (dynamic) {
+        // RTC_SCENE_FLAG_DYNAMIC: Provides better build performance for
+        // dynamic scenes (but also higher memory consumption).
+        rtcSetSceneFlags(_rtcMeshScene, RTC_SCENE_FLAG_DYNAMIC);
+
+        // RTC_BUILD_QUALITY_LOW: Create lower quality data structures,
+        // e.g. for dynamic scenes. A two-level spatial index structure
+        // is built when enabling this mode, which supports fast partial
+        // scene updates, and allows for setting a per-geometry build
+        // quality through the rtcSetGeometryBuildQuality function.
+        rtcSetSceneBuildQuality(_rtcMeshScene, RTC_BUILD_QUALITY_LOW);
+
+        // Uses a BVH refitting approach when changing only the vertex buffer.
+        rtcSetGeometryBuildQuality(_geometry, RTC_BUILD_QUALITY_REFIT);
+    }
+    else {
+        // Static prototypes are built once and traced many times, so they
+        // get the best (spatial split) BVH.
+        rtcSetSceneFlags(_rtcMeshScene, RTC_SCENE_FLAG_NONE);
+        rtcSetSceneBuildQuality(_rtcMeshScene, RTC_BUILD_QUALITY_HIGH);
+        rtcSetGeometryBuildQuality(_geometry, RTC_BUILD_QUALITY_HIGH);
+    }
+    _dynamicBvh = dynamic;
+}
+
+void Hd_USTC_CG_Mesh::_UpdateBindings(Hd_USTC_CG_RenderParam* renderParam)
+{
+    if (_rtcMeshId == RTC_INVALID_GEOMETRY_ID) {
+        return;
+    }
+    Hd_USTC_CG_PrototypeContext* ctx = _GetPrototypeContext();
+
+    ctx->materialIndex = renderParam->GetMaterialIndex(GetMaterialId());
+    // Materials sync before rprims, so this is the current texcoord name.
+    Hd_USTC_CG_Material* material = renderParam->GetMaterial(ctx->materialIndex);
+    ctx->texcoordName = material ? material->requireTexcoordName() : TfToken();
+
+    auto find = [ctx](const TfToken& name) -> Hd_USTC_CG_PrimvarSampler* {
+        auto it = ctx->primvarMap.find(name);
+        return it != ctx->primvarMap.end() ? it->second : nullptr;
+    };
+    ctx->normalSampler = find(HdTokens->normals);
+    ctx->texcoordSampler = ctx->texcoordName.IsEmpty() ? nullptr : find(ctx->texcoordName);
 }
 
 void Hd_USTC_CG_Mesh::Finalize(HdRenderParam* renderParam)
 {
     RTCScene scene = static_cast<Hd_USTC_CG_RenderParam*>(renderParam)->AcquireSceneForEdit();
-    // Delete any instances of this mesh in the top-level embree scene.
-    for (size_t i = 0; i < _rtcInstanceIds.size(); ++i) {
+    // Delete the instances of this mesh in the top-level embree scene.
+    if (_rtcInstanceArray != nullptr) {
         // Delete the instance context first...
-        delete _GetInstanceContext(scene, i);
-        // ...then the instance object in the top-level scene.
-        //
-        // I think this should probably actually be a detach from the
-        // above scene
-        //
-        rtcDetachGeometry(scene, _rtcInstanceIds[i]);
-        rtcReleaseGeometry(_rtcInstanceGeometries[i]);
-    }
-    _rtcInstanceIds.clear();
-    _rtcInstanceGeometries.clear();
+        delete _GetInstanceContext();
+        // ...then the instance array in the top-level scene.
+        rtcDetachGeometry(scene, _rtcInstanceArrayId);
+        rtcReleaseGeometry(_rtcInstanceArray);
+        _rtcInstanceArray = nullptr;
+    }
 
     // Delete the prototype geometry and the prototype scene.
     if (_rtcMeshScene != nullptr) {
@@ -25,9 +25,10 @@
 #define EXTRAS_IMAGING_EXAMPLES_HD_TINY_MESH_H
 
 #include "context.h"
+#include "renderParam.h"
 #include "embree4/rtcore.h"
 #include "meshSamplers.h"
-#include "pxr/base/gf/matrix4f.h"
+#include "pxr/base/gf/matrix4d.h"
 #include "pxr/imaging/hd/mesh.h"
 #include "pxr/imaging/hd/vertexAdjacency.h"
 #include "pxr/pxr.h"
@@ -128,9 +129,16 @@ class Hd_USTC_CG_Mesh final : public HdMesh {
         RTCScene scene,
         RTCDevice device,
         HdDirtyBits* dirtyBits,
-        const HdMeshReprDesc& desc);
+        const HdMeshReprDesc& desc,
+        Hd_USTC_CG_RenderStatistics& statistics);
+    // Set the build quality of the prototype scene and geometry from the
+    // configured policy and whether the mesh deforms. Takes effect on the
+    // next geometry commit.
+    void _UpdateBuildQuality();
     Hd_USTC_CG_PrototypeContext* _GetPrototypeContext();
-    Hd_USTC_CG_InstanceContext* _GetInstanceContext(RTCScene scene, size_t i);
+    Hd_USTC_CG_InstanceContext* _GetInstanceContext();
+    // Resolve the material and primvar samplers the integrator needs on a hit.
+    void _UpdateBindings(Hd_USTC_CG_RenderParam* renderParam);
 
     // Cached scene data. VtArrays are reference counted, so as long as we
     // only call const accessors keeping them around doesn't incur a buffer
@@ -139,18 +147,17 @@ class Hd_USTC_CG_Mesh final : public HdMesh {
     RTCScene _rtcMeshScene;
 
     HdMeshTopology _topology;
-    GfMatrix4f _transform;
+    GfMatrix4d _transform;
     VtVec3fArray _points;
     HdCullStyle _cullStyle;
     bool _doubleSided;
     bool _smoothNormals;
     unsigned _rtcMeshId;
 
-    // Each instance of the mesh in the top-level scene is stored in
-    // _rtcInstanceIds.
-    std::vector<unsigned> _rtcInstanceIds;
-
-    std::vector<RTCGeometry> _rtcInstanceGeometries;
+    // All the instances of the mesh are one instance array geometry in the
+    // top-level scene, which shares the transforms of its instance context.
+    RTCGeometry _rtcInstanceArray;
+    unsigned _rtcInstanceArrayId;
 
     // Derived scene data:
     // - _triangulatedIndices holds a triangulation of the source topology,
@@ -179,6 +186,14 @@ class Hd_USTC_CG_Mesh final : public HdMesh {
     bool _adjacencyValid;
     bool _refined;
 
+    // Set once the points change without a topology change; deforming meshes
+    // get a BVH that is refit instead of rebuilt.
+    bool _deforming;
+    bool _dynamicBvh;
+    // The Embree owned vertex buffer, which points-only updates write into.
+    GfVec3f* _vertices;
+    size_t _vertexCount;
+
     // An embree intersection filter callback, for doing backface culling.
     static void _EmbreeCullFaces(const RTCFilterFunctionNArguments* args);
 
@@ -31,7 +31,8 @@
 #include "pxr/base/gf/vec4f.h"
 #include "pxr/base/gf/matrix4d.h"
 #include "pxr/base/gf/rotation.h"
-#include "pxr/base/gf/quaternion.h"
+#include "pxr/base/gf/quatd.h"
+#include "pxr/base/gf/quath.h"
 #include "pxr/base/tf/staticTokens.h"
 
 USTC_CG_NAMESPACE_OPEN_SCOPE
@@ -64,6 +65,13 @@ Hd_USTC_CG_Instancer::Sync(
     {
         _SyncPrimvars(delegate, *dirtyBits);
     }
+
+    // Sync only runs when something changed: the transform, the primvars or
+    // the instance indices. Any of them invalidates the cached transforms,
+    // of this instancer and of the instancers nested in it.
+    std::lock_guard<std::mutex> lock(_transformCacheMutex);
+    _transformCache.clear();
+    ++_version;
 }
 
 void
@@ -97,12 +105,50 @@ Hd_USTC_CG_Instancer::_SyncPrimvars(
     }
 }
 
+size_t
+Hd_USTC_CG_Instancer::_GetVersion()
+{
+    size_t version = _version;
+    if (!GetParentId().IsEmpty())
+    {
+        HdInstancer* parentInstancer =
+            GetDelegate()->GetRenderIndex().GetInstancer(GetParentId());
+        if (parentInstancer)
+        {
+            version += static_cast<Hd_USTC_CG_Instancer*>(parentInstancer)->
+                _GetVersion();
+        }
+    }
+    return version;
+}
+
 VtMatrix4dArray
 Hd_USTC_CG_Instancer::ComputeInstanceTransforms(const SdfPath& prototypeId)
 {
     HD_TRACE_FUNCTION();
     HF_MALLOC_TAG_FUNCTION();
 
+    // Prototypes sync in parallel, and may share this instancer.
+    const size_t version = _GetVersion();
+    {
+        std::lock_guard<std::mutex> lock(_transformCacheMutex);
+        auto it = _transformCache.find(prototypeId);
+        if (it != _transformCache.end() && it->second.version == version)
+        {
+            return it->second.transforms;
+        }
+    }
+
+    VtMatrix4dArray transforms = _ComputeInstanceTransforms(prototypeId);
+
+    std::lock_guard<std::mutex> lock(_transformCacheMutex);
+    _transformCache[prototypeId] = { transforms, version };
+    return transforms;
+}
+
+VtMatrix4dArray
+Hd_USTC_CG_Instancer::_ComputeInstanceTransforms(const SdfPath& prototypeId)
+{
     // The transforms for this level of instancer are computed by:
     // foreach(index : indices) {
     //     instancerTransform
@@ -124,6 +170,79 @@ Hd_USTC_CG_Instancer::ComputeInstanceTransforms(const SdfPath& prototypeId)
         transforms[i] = instancerTransform;
     }
 
+    // "hydra:instanceTranslations" holds a translation vector for each index.
+    if (_primvarMap.count(HdInstancerTokens->instanceTranslations) > 0)
+    {
+        Hd_USTC_CG_BufferSampler sampler(
+            *_primvarMap[HdInstancerTokens->instanceTranslations]);
+        for (size_t i = 0; i < instanceIndices.size(); ++i)
+        {
+            GfVec3f translate;
+            if (sampler.Sample(instanceIndices[i], &translate))
+            {
+                GfMatrix4d translateMat(1);
+                translateMat.SetTranslate(GfVec3d(translate));
+                transforms[i] = translateMat * transforms[i];
+            }
+        }
+    }
+
+    // "hydra:instanceRotations" holds a quaternion for each index, either
+    // as a GfQuath or as a GfVec4f (real part first).
+    if (_primvarMap.count(HdInstancerTokens->instanceRotations) > 0)
+    {
+        Hd_USTC_CG_BufferSampler sampler(
+            *_primvarMap[HdInstancerTokens->instanceRotations]);
+        for (size_t i = 0; i < instanceIndices.size(); ++i)
+        {
+            GfQuath quath;
+            GfVec4f quat;
+            GfMatrix4d rotateMat(1);
+            if (sampler.Sample(instanceIndices[i], &quath))
+            {
+                rotateMat.SetRotate(GfQuatd(quath));
+            }
+            else if (sampler.Sample(instanceIndices[i], &quat))
+            {
+                rotateMat.SetRotate(
+                    GfQuatd(quat[0], quat[1], quat[2], quat[3]));
+            }
+            transforms[i] = rotateMat * transforms[i];
+        }
+    }
+
+    // "hydra:instanceScales" holds an axis-aligned scale vector for each index.
+    if (_primvarMap.count(HdInstancerTokens->instanceScales) > 0)
+    {
+        Hd_USTC_CG_BufferSampler sampler(
+            *_primvarMap[HdInstancerTokens->instanceScales]);
+        for (size_t i = 0; i < instanceIndices.size(); ++i)
+        {
+            GfVec3f scale;
+            if (sampler.Sample(instanceIndices[i], &scale))
+            {
+                GfMatrix4d scaleMat(1);
+                scaleMat.SetScale(GfVec3d(scale));
+                transforms[i] = scaleMat * transforms[i];
+            }
+        }
+    }
+
+    // "hydra:instanceTransforms" holds a 4x4 transform matrix for each index.
+    if (_primvarMap.count(HdInstancerTokens->instanceTransforms) > 0)
+    {
+        Hd_USTC_CG_BufferSampler sampler(
+            *_primvarMap[HdInstancerTokens->instanceTransforms]);
+        for (size_t i = 0; i < instanceIndices.size(); ++i)
+        {
+            GfMatrix4d instanceTransform;
+            if (sampler.Sample(instanceIndices[i], &instanceTransform))
+            {
+                transforms[i] = instanceTransform * transforms[i];
+            }
+        }
+    }
+
     if (GetParentId().IsEmpty())
     {
         return transforms;
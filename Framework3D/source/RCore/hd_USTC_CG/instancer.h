@@ -33,6 +33,9 @@
 #include "pxr/base/tf/hashmap.h"
 #include "pxr/base/tf/token.h"
 
+#include <atomic>
+#include <mutex>
+
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using namespace pxr;
 
@@ -65,7 +68,8 @@ public:
     /// instance primvars "hydra:instanceTransforms",
     /// "hydra:instanceTranslations", "hydra:instanceRotations", and
     /// "hydra:instanceScales". Computes and flattens nested transforms,
-    /// if necessary.
+    /// if necessary. The result is cached until this instancer or one of
+    /// its parents syncs again.
     ///   \param prototypeId The prototype to compute transforms for.
     ///   \return One transform per instance, to apply when drawing.
     VtMatrix4dArray ComputeInstanceTransforms(SdfPath const& prototypeId);
@@ -84,6 +88,23 @@ private:
     // data.  This is a helper function for Sync().
     void _SyncPrimvars(HdSceneDelegate* delegate, HdDirtyBits dirtyBits);
 
+    // Uncached ComputeInstanceTransforms().
+    VtMatrix4dArray _ComputeInstanceTransforms(SdfPath const& prototypeId);
+
+    // Sum of the sync counts of this instancer and its parents, which
+    // changes whenever any of their transforms may have.
+    size_t _GetVersion();
+
+    struct _CachedTransforms
+    {
+        VtMatrix4dArray transforms;
+        size_t version;
+    };
+    // Transforms computed per prototype since the last Sync().
+    TfHashMap<SdfPath, _CachedTransforms, SdfPath::Hash> _transformCache;
+    std::mutex _transformCacheMutex;
+    std::atomic<size_t> _version{ 0 };
+
     // Map of the latest primvar data for this instancer, keyed by
     // primvar name. Primvar values are VtValue, an any-type; they are
     // interpreted at consumption time (here, in ComputeInstanceTransforms).
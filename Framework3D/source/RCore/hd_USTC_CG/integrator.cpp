@@ -1,8 +1,9 @@
 #include "integrator.h"
 
-#include <boost/functional/hash.hpp>
-#include <functional>
-#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
 
 #include "Utils/Logging/Logging.h"
 #include "config.h"
@@ -18,21 +19,10 @@
 #include "surfaceInteraction.h"
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using namespace pxr;
-static unsigned channel(VtValue val)
-{
-    if (val.CanCast<float>()) {
-        return 1;
-    }
-    else if (val.CanCast<GfVec4f>()) {
-        return 4;
-    }
-    else if (val.CanCast<GfVec3f>()) {
-        return 3;
-    }
+// Rays traced by this thread since the last _FlushRayCounts(). Counting locally keeps the shared
+// atomics of Hd_USTC_CG_RenderStatistics out of the inner loop.
+static thread_local uint64_t tls_ray_count = 0;
 
-    TF_CODING_ERROR("val must can cast to those types");
-    return 0;
-}
 /// Fill in an RTCRay structure from the given parameters.
 static void _PopulateRay(
     RTCRay* ray,
@@ -68,12 +58,49 @@ _PopulateRayHit(RTCRayHit* rayHit, const GfVec3d& origin, const GfVec3d& dir, fl
     rayHit->hit.geomID = RTC_INVALID_GEOMETRY_ID;
 }
 
+size_t ShadowRayBatch::Add(const GfVec3f& origin, const GfVec3f& dir, float tfar)
+{
+    const size_t i = count_++;
+    if (i / 16 == packets_.size()) {
+        packets_.emplace_back();
+    }
+    RTCRay16& packet = packets_[i / 16];
+    const size_t lane = i % 16;
+    packet.org_x[lane] = origin[0];
+    packet.org_y[lane] = origin[1];
+    packet.org_z[lane] = origin[2];
+    packet.tnear[lane] = 0.0f;
+    packet.dir_x[lane] = dir[0];
+    packet.dir_y[lane] = dir[1];
+    packet.dir_z[lane] = dir[2];
+    packet.time[lane] = 0.0f;
+    packet.tfar[lane] = tfar;
+    packet.mask[lane] = -1;
+    packet.id[lane] = unsigned(i);
+    packet.flags[lane] = 0;
+    return i;
+}
+
+void ShadowRayBatch::Trace(RTCScene scene)
+{
+    for (size_t begin = 0; begin < count_; begin += 16) {
+        // The last packet may be partially filled; its unused lanes are masked out.
+        alignas(64) int valid[16];
+        for (size_t lane = 0; lane < 16; ++lane) {
+            valid[lane] = begin + lane < count_ ? -1 : 0;
+        }
+        rtcOccluded16(valid, scene, &packets_[begin / 16]);
+    }
+    tls_ray_count += count_;
+}
+
 Color Integrator::SampleLights(
     const GfVec3f& pos,
     GfVec3f& dir,
     GfVec3f& sampled_light_pos,
     float& pdf,
-    const std::function<float()>& uniform_float)
+    PixelSampler& uniform_float,
+    Hd_USTC_CG_Light** sampled_light)
 {
     auto N = render_param->lights->size();
     if (N == 0) {
@@ -85,12 +112,15 @@ Color Integrator::SampleLights(
     // appropriate approach is to sample according to power.
     float select_light_pdf = 1.0f / float(N);
 
-    auto light_id = size_t(std::floor(uniform_float() * N));
+    auto light_id = std::min(size_t(std::floor(uniform_float() * N)), N - 1);
     auto light = (*render_param->lights)[light_id];
 
     float sample_light_pdf;
     auto color = light->Sample(pos, dir, sampled_light_pos, sample_light_pdf, uniform_float);
     pdf = sample_light_pdf * select_light_pdf;
+    if (sampled_light) {
+        *sampled_light = light;
+    }
     return color;
 }
 
@@ -99,6 +129,10 @@ Color Integrator::IntersectLights(const GfRay& ray, GfVec3f& intersectPos)
     float currentDepth = std::numeric_limits<float>::infinity();
     Color color{ 0, 0, 0 };
     for (auto light : (*render_param->lights)) {
+        // The dome light is handled by IntersectDomeLight, and always "hit" at its far depth.
+        if (light->IsDomeLight()) {
+            continue;
+        }
         float depth = std::numeric_limits<float>::infinity();
         auto intersected_radiance = light->Intersect(ray, depth);
         if (depth < currentDepth) {
@@ -122,13 +156,76 @@ Color Integrator::IntersectDomeLight(const GfRay& ray)
     return Color{ 0.0 };
 }
 
-bool Integrator::Intersect(const GfRay& ray, SurfaceInteraction& si)
+Color Integrator::IntersectDomeLight(const GfRay& ray, float& pdf)
+{
+    for (auto light : (*render_param->lights)) {
+        if (light->IsDomeLight()) {
+            auto dome_light = static_cast<Hd_USTC_CG_Dome_Light*>(light);
+            float depth;
+            auto dir = GfVec3f(ray.GetDirection()).GetNormalized();
+            pdf = dome_light->Pdf(dir) / float(render_param->lights->size());
+            return dome_light->Intersect(ray, depth);
+        }
+    }
+
+    pdf = 0;
+    return Color{ 0.0 };
+}
+
+// Width in uv space of a ray cone of the given world space width hitting the surface, from the
+// ratio of uv to world space areas of the surface around the hit ("Improved Shader and Texture
+// Level of Detail Using Ray Cones", Akenine-Moller et al. 2021).
+static float _UVFootprint(
+    const RTCRayHit& rayHit,
+    const Hd_USTC_CG_InstanceContext* instanceContext,
+    const Hd_USTC_CG_PrimvarSampler* texcoordSampler,
+    const GfVec2f& texcoord,
+    float coneWidth,
+    float cosTheta)
+{
+    GfVec3f position, dPdu, dPdv;
+    rtcInterpolate1(
+        rtcGetGeometry(instanceContext->rootScene, rayHit.hit.geomID),
+        rayHit.hit.primID,
+        rayHit.hit.u,
+        rayHit.hit.v,
+        RTC_BUFFER_TYPE_VERTEX,
+        0,
+        position.data(),
+        dPdu.data(),
+        dPdv.data(),
+        3);
+    const Hd_USTC_CG_InstanceTransform& instanceTransform =
+        instanceContext->transforms[rayHit.hit.instPrimID[0]];
+    dPdu = instanceTransform.TransformDir(dPdu);
+    dPdv = instanceTransform.TransformDir(dPdv);
+    const float worldArea = GfCross(dPdu, dPdv).GetLength();
+
+    // Texcoords are interpolated by the primvar sampler, so differentiate them numerically.
+    const float h = 1e-2f;
+    GfVec2f texcoordU, texcoordV;
+    texcoordSampler->Sample(rayHit.hit.primID, rayHit.hit.u + h, rayHit.hit.v, &texcoordU);
+    texcoordSampler->Sample(rayHit.hit.primID, rayHit.hit.u, rayHit.hit.v + h, &texcoordV);
+    const GfVec2f dTdu = (texcoordU - texcoord) / h;
+    const GfVec2f dTdv = (texcoordV - texcoord) / h;
+    const float uvArea = std::abs(dTdu[0] * dTdv[1] - dTdu[1] * dTdv[0]);
+
+    if (worldArea <= 0 || uvArea <= 0) {
+        return 0;
+    }
+    // Grazing angles stretch the footprint, but only along one axis. Clamp so that they don't blur
+    // the whole texture.
+    return coneWidth * std::sqrt(uvArea / worldArea) / std::max(std::abs(cosTheta), 0.1f);
+}
+
+bool Integrator::Intersect(const GfRay& ray, SurfaceInteraction& si, float spread_angle)
 {
     RTCRayHit rayHit;
     rayHit.ray.flags = 0;
     _PopulateRayHit(&rayHit, ray.GetStartPoint(), ray.GetDirection(), 0.0f);
     {
         rtcIntersect1(rtc_scene, &rayHit);
+        ++tls_ray_count;
 
         rayHit.hit.Ng_x = -rayHit.hit.Ng_x;
         rayHit.hit.Ng_y = -rayHit.hit.Ng_y;
@@ -154,29 +251,43 @@ bool Integrator::Intersect(const GfRay& ray, SurfaceInteraction& si)
 
     GfVec3f shadingNormal;
     // Transform the normal from object space to world space.
-    auto it = prototypeContext->primvarMap.find(HdTokens->normals);
-    if (it != prototypeContext->primvarMap.end()) {
-        it->second->Sample(rayHit.hit.primID, rayHit.hit.u, rayHit.hit.v, &shadingNormal);
+    if (prototypeContext->normalSampler) {
+        prototypeContext->normalSampler->Sample(
+            rayHit.hit.primID, rayHit.hit.u, rayHit.hit.v, &shadingNormal);
     }
 
     else {
         shadingNormal = geometricNormal;
     }
-    geometricNormal = instanceContext->objectToWorldMatrix.TransformDir(geometricNormal);
-    shadingNormal = instanceContext->objectToWorldMatrix.TransformDir(shadingNormal);
+    const Hd_USTC_CG_InstanceTransform& instanceTransform =
+        instanceContext->transforms[rayHit.hit.instPrimID[0]];
+    geometricNormal = instanceTransform.TransformNormal(geometricNormal);
+    shadingNormal = instanceTransform.TransformNormal(shadingNormal);
 
     shadingNormal.Normalize();
     geometricNormal.Normalize();
 
-    auto materialId = prototypeContext->rprim->GetMaterialId();
-    si.material = (*render_param->materials)[materialId];
+    si.material = render_param->GetMaterial(prototypeContext->materialIndex);
 
-    auto texcoord_name = si.material->requireTexcoordName();
-    // Transform the normal from object space to world space.
-    it = prototypeContext->primvarMap.find(texcoord_name);
+    const Hd_USTC_CG_PrimvarSampler* texcoordSampler = prototypeContext->texcoordSampler;
+    if (si.material->requireTexcoordName() != prototypeContext->texcoordName) {
+        // The material was edited after the mesh was synced.
+        auto it = prototypeContext->primvarMap.find(si.material->requireTexcoordName());
+        texcoordSampler = it != prototypeContext->primvarMap.end() ? it->second : nullptr;
+    }
     GfVec2f texcoord;
-    if (it != prototypeContext->primvarMap.end()) {
-        it->second->Sample(rayHit.hit.primID, rayHit.hit.u, rayHit.hit.v, &texcoord);
+    float uvFootprint = 0;
+    if (texcoordSampler) {
+        texcoordSampler->Sample(rayHit.hit.primID, rayHit.hit.u, rayHit.hit.v, &texcoord);
+        if (spread_angle > 0) {
+            uvFootprint = _UVFootprint(
+                rayHit,
+                instanceContext,
+                texcoordSampler,
+                texcoord,
+                spread_angle * (hitPos - GfVec3f(ray.GetStartPoint())).GetLength(),
+                GfDot(geometricNormal, GfVec3f(ray.GetDirection().GetNormalized())));
+        }
         texcoord[1] = 1.0f - texcoord[1];
     }
     else {
@@ -188,6 +299,7 @@ bool Integrator::Intersect(const GfRay& ray, SurfaceInteraction& si)
     si.position = hitPos;
     si.barycentric = { rayHit.hit.u, rayHit.hit.v };
     si.texcoord = texcoord;
+    si.uvFootprint = uvFootprint;
     si.PrepareTransforms();
     si.wo = GfVec3f(-ray.GetDirection().GetNormalized());
 
@@ -200,6 +312,7 @@ bool Integrator::VisibilityTest(const GfRay& ray)
     _PopulateRay(&test_ray, ray.GetStartPoint(), ray.GetDirection(), 0);
 
     rtcOccluded1(rtc_scene, &test_ray);
+    ++tls_ray_count;
 
     if (test_ray.tfar > 0) {  // Then this is visible
         return true;
@@ -220,6 +333,7 @@ bool Integrator::VisibilityTest(const GfVec3f& begin, const GfVec3f& end)
         (end - begin).GetLength() - 0.0001f);
 
     rtcOccluded1(rtc_scene, &test_ray);
+    ++tls_ray_count;
 
     if (test_ray.tfar > 0)
         // Hit at nothing, so visible.
@@ -227,6 +341,13 @@ bool Integrator::VisibilityTest(const GfVec3f& begin, const GfVec3f& end)
     return false;
 }
 
+void Integrator::_FlushRayCounts(uint64_t camera_rays)
+{
+    render_param->statistics.cameraRays += camera_rays;
+    render_param->statistics.rays += tls_ray_count;
+    tls_ray_count = 0;
+}
+
 static float PowerHeuristic(float f, float g)
 {
     return f * f / (f * f + g * g);
@@ -234,75 +355,197 @@ static float PowerHeuristic(float f, float g)
 
 Color Integrator::EstimateDirectLight(
     SurfaceInteraction& si,
-    const std::function<float()>& uniform_float)
+    PixelSampler& uniform_float)
 {
     // Estimate direct light
     // Sample the lights.
     GfVec3f wi;
     float sample_light_pdf;
     GfVec3f sampled_light_pos;
+    Hd_USTC_CG_Light* sampled_light = nullptr;
     // Uniformly sample a random light.
-    auto sample_light_luminance =
-        SampleLights(si.position, wi, sampled_light_pos, sample_light_pdf, uniform_float);
-    // Get BRDF value on input direction wi. 
-    auto brdfVal = si.Eval(wi);
+    auto sample_light_luminance = SampleLights(
+        si.position, wi, sampled_light_pos, sample_light_pdf, uniform_float, &sampled_light);
     GfVec3f contribution_by_sample_lights{ 0 };
 
-    if (this->VisibilityTest(si.position + 0.0001f * si.geometricNormal, sampled_light_pos)) {
+    if (sample_light_pdf > 0 &&
+        this->VisibilityTest(si.position + 0.0001f * si.geometricNormal, sampled_light_pos)) {
         // Small offset to avoid self-intersection.
+        // Get BRDF value on input direction wi.
+        auto brdfVal = si.Eval(wi);
+        // Only the dome light can also be hit by the BRDF sampling below, so only its samples
+        // are shared between the two strategies.
+        float mis_weight = 1.0f;
+        if (sampled_light->IsDomeLight()) {
+            mis_weight = PowerHeuristic(sample_light_pdf, si.Pdf(wi));
+        }
         contribution_by_sample_lights = GfCompMult(sample_light_luminance, brdfVal) *
-                                        abs(GfDot(si.shadingNormal, wi)) / sample_light_pdf;
+                                        abs(GfDot(si.shadingNormal, wi)) / sample_light_pdf *
+                                        mis_weight;
         // f = I * BRDF * cos. \int f(x) dx = \int f(x) / p(x) * p(x) dx = E(f(x) / p(x))
     }
 
-    // HW7_TODO: Sample BRDF (optional)
+    // Sample BRDF. Rays leaving the scene pick up the dome light.
+    GfVec3f contribution_by_sample_brdf{ 0 };
+    float sample_brdf_pdf;
+    bool is_delta;
+    auto brdfVal = si.Sample(wi, sample_brdf_pdf, uniform_float, &is_delta);
+    if (sample_brdf_pdf > 0) {
+        GfRay brdf_ray(si.position + 0.0001f * si.geometricNormal, wi);
+        float dome_light_pdf;
+        auto dome_luminance = IntersectDomeLight(brdf_ray, dome_light_pdf);
+        if (dome_light_pdf > 0 && this->VisibilityTest(brdf_ray)) {
+            // Light sampling never produces a delta direction, so such samples keep full weight.
+            float mis_weight =
+                is_delta ? 1.0f : PowerHeuristic(sample_brdf_pdf, dome_light_pdf);
+            contribution_by_sample_brdf = GfCompMult(dome_luminance, brdfVal) *
+                                          abs(GfDot(si.shadingNormal, wi)) / sample_brdf_pdf *
+                                          mis_weight;
+        }
+    }
 
-    return contribution_by_sample_lights;
+    return contribution_by_sample_lights + contribution_by_sample_brdf;
 }
 
-void SamplingIntegrator::_writeBuffer(unsigned x, unsigned y, VtValue color)
+Color Integrator::EstimateDirectLight(
+    SurfaceInteraction& si,
+    PixelSampler& uniform_float,
+    unsigned sample_count)
 {
-    switch (channel(color)) {
-        case 1: camera_->film->Write(GfVec3i(x, y, 1), 1, &color.Get<float>()); break;
-        case 3: camera_->film->Write(GfVec3i(x, y, 1), 3, color.Get<GfVec3f>().data()); break;
-        case 4: camera_->film->Write(GfVec3i(x, y, 1), 4, color.Get<GfVec4f>().data()); break;
-        default:;
+    // Each sample queues up to two shadow rays, one towards a light and one along a BRDF sample
+    // that leaves towards the dome. They are traced together once all samples are drawn, and
+    // their contributions only added for the rays found visible.
+    struct PendingSample {
+        GfVec3f contribution;
+        size_t ray;
+    };
+    static thread_local ShadowRayBatch batch;
+    static thread_local std::vector<PendingSample> pending;
+    batch.Clear();
+    pending.clear();
+
+    const GfVec3f origin = si.position + 0.0001f * si.geometricNormal;  // Avoid self-intersection.
+    for (unsigned i = 0; i < sample_count; ++i) {
+        // Sample the lights.
+        GfVec3f wi;
+        float sample_light_pdf;
+        GfVec3f sampled_light_pos;
+        Hd_USTC_CG_Light* sampled_light = nullptr;
+        // Uniformly sample a random light.
+        auto sample_light_luminance = SampleLights(
+            si.position, wi, sampled_light_pos, sample_light_pdf, uniform_float, &sampled_light);
+        if (sample_light_pdf > 0) {
+            // Get BRDF value on input direction wi.
+            auto brdfVal = si.Eval(wi);
+            // Only the dome light can also be hit by the BRDF sampling below, so only its
+            // samples are shared between the two strategies.
+            float mis_weight = 1.0f;
+            if (sampled_light->IsDomeLight()) {
+                mis_weight = PowerHeuristic(sample_light_pdf, si.Pdf(wi));
+            }
+            // f = I * BRDF * cos. \int f(x) dx = \int f(x) / p(x) * p(x) dx = E(f(x) / p(x))
+            GfVec3f contribution = GfCompMult(sample_light_luminance, brdfVal) *
+                                   abs(GfDot(si.shadingNormal, wi)) / sample_light_pdf *
+                                   mis_weight;
+            GfVec3f to_light = sampled_light_pos - origin;
+            float distance = to_light.GetLength();
+            if (distance > 0.0001f) {
+                size_t ray = batch.Add(origin, to_light / distance, distance - 0.0001f);
+                pending.push_back({ contribution, ray });
+            }
+        }
+
+        // Sample BRDF. Rays leaving the scene pick up the dome light.
+        float sample_brdf_pdf;
+        bool is_delta;
+        auto brdfVal = si.Sample(wi, sample_brdf_pdf, uniform_float, &is_delta);
+        if (sample_brdf_pdf > 0) {
+            float dome_light_pdf;
+            auto dome_luminance = IntersectDomeLight(GfRay(origin, wi), dome_light_pdf);
+            if (dome_light_pdf > 0) {
+                // Light sampling never produces a delta direction, so such samples keep full
+                // weight.
+                float mis_weight =
+                    is_delta ? 1.0f : PowerHeuristic(sample_brdf_pdf, dome_light_pdf);
+                GfVec3f contribution = GfCompMult(dome_luminance, brdfVal) *
+                                       abs(GfDot(si.shadingNormal, wi)) / sample_brdf_pdf *
+                                       mis_weight;
+                pending.push_back({ contribution, batch.Add(origin, wi) });
+            }
+        }
+    }
+
+    batch.Trace(rtc_scene);
+
+    GfVec3f color{ 0 };
+    for (const PendingSample& sample : pending) {
+        if (batch.Visible(sample.ray)) {
+            color += sample.contribution;
+        }
     }
+    return sample_count > 0 ? color / float(sample_count) : color;
 }
 
-void SamplingIntegrator::accumulate_color(VtValue& color, const VtValue& vt_value)
+void SamplingIntegrator::_writeSampleCount(unsigned x, unsigned y, unsigned count)
 {
-    if (color.IsEmpty()) {
-        color = vt_value;
+    if (sample_count_buffer) {
+        float value = float(count);
+        sample_count_buffer->Write(GfVec3i(x, y, 1), 1, &value);
     }
-    else {
-        switch (channel(vt_value)) {
-            case 1: color = VtValue(color.Get<float>() + vt_value.Get<float>()); return;
-            case 3: color = VtValue(color.Get<GfVec3f>() + vt_value.Get<GfVec3f>()); return;
-            case 4: color = VtValue(color.Get<GfVec4f>() + vt_value.Get<GfVec4f>()); return;
-            default:;
-        }
+}
+
+void SamplingIntegrator::_writeFeatures(
+    unsigned x,
+    unsigned y,
+    const GfVec3f& albedo,
+    const GfVec3f& normal)
+{
+    camera_->film->WriteFeatures(GfVec3i(x, y, 1), albedo, normal);
+    if (albedo_buffer) {
+        albedo_buffer->Write(GfVec3i(x, y, 1), 3, albedo.data());
+    }
+    if (normal_buffer) {
+        normal_buffer->Write(GfVec3i(x, y, 1), 3, normal.data());
     }
 }
 
-VtValue SamplingIntegrator::average_samples(const VtValue& color, unsigned spp)
+void SamplingIntegrator::_GetFeatures(const GfRay& ray, GfVec3f& albedo, GfVec3f& normal)
 {
-    assert(!color.IsEmpty());
-    VtValue ret;
+    SurfaceInteraction si;
+    if (!Intersect(ray, si, pixel_spread_angle)) {
+        albedo = GfVec3f(0.f);
+        normal = GfVec3f(0.f);
+        return;
+    }
+    albedo = si.Albedo();
+    normal = GfDot(si.shadingNormal, ray.GetDirection()) > 0 ? -si.shadingNormal : si.shadingNormal;
+}
+
+void SamplingIntegrator::PixelStatistics::Add(const Color4& sample)
+{
+    float luminance = Luminance(sample);
+    ++count;
+    float delta = luminance - mean;
+    mean += delta / count;
+    m2 += delta * (luminance - mean);
+}
 
-    switch (channel(color)) {
-        case 1: ret = VtValue(color.Get<float>() / spp); break;
-        case 3: ret = VtValue(color.Get<GfVec3f>() / spp); break;
-        case 4: ret = VtValue(color.Get<GfVec4f>() / spp); break;
-        default: assert(false);
+float SamplingIntegrator::PixelStatistics::Error() const
+{
+    if (count < 2) {
+        return std::numeric_limits<float>::infinity();
     }
-    return ret;
+    float variance_of_mean = m2 / float(count - 1) / float(count);
+    // Dark pixels are judged by absolute error, or they would never converge.
+    return std::sqrt(variance_of_mean) / std::max(mean, 0.01f);
 }
 
-void SamplingIntegrator::_RenderTiles(
-    HdRenderThread* renderThread,
-    size_t tileStart,
-    size_t tileEnd)
+void SamplingIntegrator::_GetTileBounds(
+    unsigned tile,
+    unsigned& x0,
+    unsigned& y0,
+    unsigned& x1,
+    unsigned& y1) const
 {
     const unsigned int minX = camera_->_dataWindow.GetMinX();
     unsigned int minY = camera_->_dataWindow.GetMinY();
@@ -317,71 +560,283 @@ void SamplingIntegrator::_RenderTiles(
     const unsigned int tileSize = Hd_USTC_CG_Config::GetInstance().tileSize;
     const unsigned int numTilesX = (camera_->_dataWindow.GetWidth() + tileSize - 1) / tileSize;
 
-    // Initialize the RNG for this tile (each tile creates one as
-    // a lazy way to do thread-local RNGs).
-    size_t seed = std::chrono::system_clock::now().time_since_epoch().count();
-    boost::hash_combine(seed, tileStart);
-    std::default_random_engine random(seed);
+    // Compute the pixel location of tile boundaries.
+    const unsigned int tileY = tile / numTilesX;
+    const unsigned int tileX = tile - tileY * numTilesX;
+    // (Above is equivalent to: tileX = tile % numTilesX)
+    x0 = tileX * tileSize + minX;
+    y0 = tileY * tileSize + minY;
+    // Clamp to data window, in case tileSize doesn't
+    // neatly divide its with and height.
+    x1 = std::min(x0 + tileSize, maxX);
+    y1 = std::min(y0 + tileSize, maxY);
+}
+
+void SamplingIntegrator::_RenderTile(
+    const Hd_USTC_CG_TileScheduler::WorkItem& item,
+    unsigned sample_begin,
+    unsigned sample_end,
+    PixelSampler& sampler)
+{
+    // Loop over pixels casting rays.
+    for (unsigned int y = item.y0; y < item.y1; ++y) {
+        for (unsigned int x = item.x0; x < item.x1; ++x) {
+            Color4 color;
+            GfVec3f albedo(0.f), normal(0.f);
+
+            for (unsigned sample = sample_begin; sample < sample_end; ++sample) {
+                sampler.StartPixelSample(GfVec2i(x, y), sample);
+                auto pixel_center_uv = GfVec2f(x, y);
+                auto ray = camera_->generateRay(pixel_center_uv, sampler);
+                color += Li(ray, sampler);
+
+                if (need_features && sample < feature_spp) {
+                    GfVec3f sample_albedo, sample_normal;
+                    _GetFeatures(ray, sample_albedo, sample_normal);
+                    albedo += sample_albedo;
+                    normal += sample_normal;
+                }
+            }
+            camera_->film->AddSample(x, y, color, float(sample_end - sample_begin));
+            _writeSampleCount(x, y, sample_end);
+            // The first round takes all the feature samples.
+            if (need_features && sample_begin == 0) {
+                float feature_count = float(std::min(sample_end, feature_spp));
+                _writeFeatures(x, y, albedo / feature_count, normal / feature_count);
+            }
+        }
+    }
+    camera_->film->ResolveTile(item.x0, item.y0, item.x1, item.y1);
+    const uint64_t pixels = uint64_t(item.x1 - item.x0) * (item.y1 - item.y0);
+    _FlushRayCounts(pixels * (sample_end - sample_begin));
+}
 
-    // Create a uniform distribution for jitter calculations.
-    std::uniform_real_distribution<float> uniform_dist(0.0f, 1.0f);
-    std::function<float()> uniform_float = [&uniform_dist, &random]() {
-        return uniform_dist(random);
+void SamplingIntegrator::_RenderScheduled(Hd_USTC_CG_TileScheduler& scheduler)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const float budget = Hd_USTC_CG_Config::GetInstance().passTimeBudget;
+    auto out_of_time = [&] {
+        return budget > 0 &&
+               std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() >
+                   budget;
     };
+    auto stop_requested = [&] { return render_thread_ && render_thread_->IsStopRequested(); };
+
+    // One sampler per worker. The numbers only depend on the pixel and sample index, so the image
+    // doesn't depend on the scheduling.
+    std::vector<std::unique_ptr<PixelSampler>> samplers(scheduler.GetWorkerCount());
+
+    // Without a budget every pixel takes all its samples at once. With one, the samples are taken
+    // in rounds over the whole image, each as large as all the previous ones, until it is spent.
+    // Every pixel gets the first round whatever the budget.
+    unsigned sample_begin = 0;
+    unsigned sample_end = spp;
+    if (budget > 0) {
+        sample_end = std::max(need_features ? std::min(spp, feature_spp) : 1u, 1u);
+    }
+    while (sample_begin < spp) {
+        const bool first_round = sample_begin == 0;
+        scheduler.Run(
+            sample_end - sample_begin,
+            [&](const Hd_USTC_CG_TileScheduler::WorkItem& item, unsigned worker) {
+                if (!samplers[worker]) {
+                    samplers[worker] = CreatePixelSampler(spp);
+                }
+                _RenderTile(item, sample_begin, sample_end, *samplers[worker]);
+            },
+            [&] { return stop_requested() || (!first_round && out_of_time()); });
 
-    // _RenderTiles gets a range of tiles; iterate through them.
-    for (unsigned int tile = tileStart; tile < tileEnd; ++tile) {
-        // Cancellation point.
-        if (renderThread && renderThread->IsStopRequested()) {
+        if (stop_requested() || out_of_time()) {
             break;
         }
+        sample_begin = sample_end;
+        sample_end = std::min(spp, 2 * sample_end);
+    }
+
+    if (tile_time_buffer) {
+        for (unsigned tile = 0; tile < tile_count; ++tile) {
+            unsigned x0, y0, x1, y1;
+            _GetTileBounds(tile, x0, y0, x1, y1);
+            float time = scheduler.GetTileTime(tile);
+            for (unsigned y = y0; y < y1; ++y) {
+                for (unsigned x = x0; x < x1; ++x) {
+                    tile_time_buffer->Write(GfVec3i(x, y, 1), 1, &time);
+                }
+            }
+        }
+    }
+}
+
+float SamplingIntegrator::_RenderAdaptiveTile(
+    unsigned tile,
+    unsigned sample_count,
+    PixelSampler& sampler,
+    std::atomic<uint64_t>& spent_samples)
+{
+    const unsigned min_spp = std::min(adaptive_min_spp, spp);
+    const unsigned max_spp = spp * adaptive_max_spp_scale;
+
+    unsigned x0, y0, x1, y1;
+    _GetTileBounds(tile, x0, y0, x1, y1);
+
+    float tile_error = 0;
+    uint64_t tile_samples = 0;
+    for (unsigned int y = y0; y < y1; ++y) {
+        for (unsigned int x = x0; x < x1; ++x) {
+            auto& stats = pixel_statistics
+                [(y - statistics_origin[1]) * statistics_width + (x - statistics_origin[0])];
+            if (stats.count >= min_spp && stats.Error() <= error_threshold) {
+                continue;
+            }
 
-        // Compute the pixel location of tile boundaries.
-        const unsigned int tileY = tile / numTilesX;
-        const unsigned int tileX = tile - tileY * numTilesX;
-        // (Above is equivalent to: tileX = tile % numTilesX)
-        const unsigned int x0 = tileX * tileSize + minX;
-        const unsigned int y0 = tileY * tileSize + minY;
-        // Clamp to data window, in case tileSize doesn't
-        // neatly divide its with and height.
-        const unsigned int x1 = std::min(x0 + tileSize, maxX);
-        const unsigned int y1 = std::min(y0 + tileSize, maxY);
-        // Loop over pixels casting rays.
-        for (unsigned int y = y0; y < y1; ++y) {
-            for (unsigned int x = x0; x < x1; ++x) {
-                VtValue color;
-
-                for (int sample = 0; sample < spp; ++sample) {
-                    auto pixel_center_uv = GfVec2f(x, y);
-                    auto ray = camera_->generateRay(pixel_center_uv, uniform_float);
-                    auto sampled_color = Li(ray, random);
-                    accumulate_color(color, sampled_color);
+            const unsigned begin = stats.count;
+            const unsigned end = std::min(begin + sample_count, max_spp);
+            spent_samples += end - begin;
+            tile_samples += end - begin;
+            Color4 color;
+            for (unsigned sample = begin; sample < end; ++sample) {
+                sampler.StartPixelSample(GfVec2i(x, y), sample);
+                auto ray = camera_->generateRay(GfVec2f(x, y), sampler);
+                const Color4 sample_color = Li(ray, sampler);
+                color += sample_color;
+                stats.Add(sample_color);
+
+                if (need_features && sample < feature_spp) {
+                    GfVec3f albedo, normal;
+                    _GetFeatures(ray, albedo, normal);
+                    stats.albedo += albedo;
+                    stats.normal += normal;
                 }
-                color = average_samples(color, spp);
+            }
+            // The film accumulates, so each batch is added as it is taken.
+            camera_->film->AddSample(x, y, color, float(end - begin));
+            _writeSampleCount(x, y, end);
+            if (need_features && begin < feature_spp) {
+                float feature_count = float(std::min(end, feature_spp));
+                _writeFeatures(x, y, stats.albedo / feature_count, stats.normal / feature_count);
+            }
+
+            if (stats.count < max_spp) {
+                tile_error = std::max(tile_error, stats.Error());
+            }
+        }
+    }
+    if (tile_samples > 0) {
+        camera_->film->ResolveTile(x0, y0, x1, y1);
+    }
+    _FlushRayCounts(tile_samples);
+    return tile_error > error_threshold ? tile_error : 0;
+}
 
-                _writeBuffer(x, y, color);
+void SamplingIntegrator::_RenderAdaptive(unsigned numTiles)
+{
+    const unsigned int minX = camera_->_dataWindow.GetMinX();
+    const unsigned int maxX = camera_->_dataWindow.GetMaxX() + 1;
+    const unsigned int height = camera_->film->GetHeight();
+    const unsigned int minY = height - (camera_->_dataWindow.GetMaxY() + 1);
+    const unsigned int maxY = height - camera_->_dataWindow.GetMinY();
+
+    statistics_origin = GfVec2i(minX, minY);
+    statistics_width = maxX - minX;
+    pixel_statistics.assign(size_t(statistics_width) * (maxY - minY), PixelStatistics());
+
+    // The same budget as uniform sampling would spend.
+    const uint64_t budget = uint64_t(spp) * pixel_statistics.size();
+    std::atomic<uint64_t> spent_samples{ 0 };
+
+    std::vector<float> tile_errors(numTiles, std::numeric_limits<float>::infinity());
+    std::vector<unsigned> tiles(numTiles);
+
+    bool first_pass = true;
+    while (spent_samples < budget) {
+        // Tiles with unconverged pixels left, worst first, so that they get the remaining budget.
+        tiles.resize(numTiles);
+        std::iota(tiles.begin(), tiles.end(), 0u);
+        tiles.erase(
+            std::remove_if(
+                tiles.begin(), tiles.end(), [&](unsigned tile) { return tile_errors[tile] == 0; }),
+            tiles.end());
+        if (tiles.empty()) {
+            break;
+        }
+        std::stable_sort(tiles.begin(), tiles.end(), [&](unsigned a, unsigned b) {
+            return tile_errors[a] > tile_errors[b];
+        });
+
+        WorkParallelForN(tiles.size(), [&](size_t begin, size_t end) {
+            auto sampler = CreatePixelSampler(spp * adaptive_max_spp_scale);
+            for (size_t i = begin; i < end; ++i) {
+                // Cancellation point.
+                if (render_thread_ && render_thread_->IsStopRequested()) {
+                    break;
+                }
+                // The first pass must reach every pixel to estimate its error. It takes no more
+                // than spp samples, or a low spp (e.g. interactive passes) would overspend.
+                if (!first_pass && spent_samples >= budget) {
+                    break;
+                }
+                tile_errors[tiles[i]] = _RenderAdaptiveTile(
+                    tiles[i],
+                    first_pass ? std::min(adaptive_min_spp, spp) : adaptive_batch_spp,
+                    *sampler,
+                    spent_samples);
             }
+        });
+
+        if (render_thread_ && render_thread_->IsStopRequested()) {
+            break;
         }
+        first_pass = false;
     }
 }
 
 void SamplingIntegrator::Render()
 {
     camera_->film->Map();
+    const bool denoise = Hd_USTC_CG_Config::GetInstance().denoise;
+    camera_->film->SetDenoising(denoise);
+    need_features = denoise || albedo_buffer || normal_buffer;
+    for (auto buffer : { sample_count_buffer, albedo_buffer, normal_buffer, tile_time_buffer }) {
+        if (buffer) {
+            buffer->Map();
+        }
+    }
     const unsigned int tileSize = Hd_USTC_CG_Config::GetInstance().tileSize;
 
     const unsigned int numTilesX = (camera_->_dataWindow.GetWidth() + tileSize - 1) / tileSize;
     const unsigned int numTilesY = (camera_->_dataWindow.GetHeight() + tileSize - 1) / tileSize;
 
-    WorkParallelForN(
-        numTilesX * numTilesY,
-        std::bind(
-            &SamplingIntegrator::_RenderTiles,
-            this,
-            render_thread_,
-            std::placeholders::_1,
-            std::placeholders::_2));
+    // Align the tiles of the film's accumulation buffer with the ones rendered below.
+    unsigned x0, y0, x1, y1;
+    _GetTileBounds(0, x0, y0, x1, y1);
+    camera_->film->ResetSamples(GfVec2i(x0, y0), tileSize);
 
+    tile_count = numTilesX * numTilesY;
+    error_threshold = Hd_USTC_CG_Config::GetInstance().adaptiveErrorThreshold;
+    if (error_threshold > 0) {
+        _RenderAdaptive(tile_count);
+    }
+    else {
+        // Without a scheduler from the renderer, tile costs aren't kept between passes.
+        Hd_USTC_CG_TileScheduler local_scheduler;
+        Hd_USTC_CG_TileScheduler& scheduler = tile_scheduler ? *tile_scheduler : local_scheduler;
+
+        std::vector<Hd_USTC_CG_TileScheduler::WorkItem> tiles(tile_count);
+        for (unsigned tile = 0; tile < tile_count; ++tile) {
+            auto& bounds = tiles[tile];
+            bounds.tile = tile;
+            _GetTileBounds(tile, bounds.x0, bounds.y0, bounds.x1, bounds.y1);
+        }
+        scheduler.BeginPass(tiles);
+        _RenderScheduled(scheduler);
+    }
+
+    for (auto buffer : { sample_count_buffer, albedo_buffer, normal_buffer, tile_time_buffer }) {
+        if (buffer) {
+            buffer->Unmap();
+            buffer->SetConverged(true);
+        }
+    }
     camera_->film->Unmap();
 
     camera_->film->SetConverged(true);
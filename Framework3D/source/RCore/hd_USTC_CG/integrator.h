@@ -1,19 +1,58 @@
 #pragma once
-#include <random>
+#include <atomic>
+#include <limits>
+#include <vector>
 
 #include "camera.h"
 #include "color.h"
 #include "embree4/rtcore_geometry.h"
+#include "embree4/rtcore_ray.h"
+#include "pixelSampler.h"
 #include "pxr/base/gf/rect2i.h"
 #include "pxr/imaging/hd/renderThread.h"
 #include "pxr/imaging/hd/sceneDelegate.h"
 #include "pxr/pxr.h"
 #include "renderBuffer.h"
+#include "tileScheduler.h"
 
 USTC_CG_NAMESPACE_OPEN_SCOPE
 class Hd_USTC_CG_RenderParam;
+class Hd_USTC_CG_Light;
 class SurfaceInteraction;
 using namespace pxr;
+
+/**
+ * \brief Shadow rays traced together. They are stored in the SoA layout of RTCRay16 as they are
+ * queued, and traced as 16-wide packets with rtcOccluded16, which saves the per-ray overhead of
+ * rtcOccluded1 when a shading point casts many of them.
+ */
+class ShadowRayBatch {
+   public:
+    void Clear()
+    {
+        count_ = 0;
+    }
+    // Queue a ray from origin along dir, up to tfar (in units of dir). Returns its index.
+    size_t Add(
+        const GfVec3f& origin,
+        const GfVec3f& dir,
+        float tfar = std::numeric_limits<float>::infinity());
+    void Trace(RTCScene scene);
+    // Whether ray i reached tfar without hitting anything, once traced.
+    bool Visible(size_t i) const
+    {
+        return packets_[i / 16].tfar[i % 16] >= 0;
+    }
+    size_t Size() const
+    {
+        return count_;
+    }
+
+   private:
+    std::vector<RTCRay16> packets_;
+    size_t count_ = 0;
+};
+
 class Integrator {
    public:
     Integrator(
@@ -24,6 +63,7 @@ class Integrator {
           render_thread_(render_thread)
     {
         camera_->attachFilm(render_buffer);
+        pixel_spread_angle = camera_->pixelSpreadAngle();
     }
 
     virtual ~Integrator() = default;
@@ -41,32 +81,56 @@ class Integrator {
      * \param pos position on an object. Used to calculate pdf.
      * \param dir sampled direction
      * \param pdf returning the pdf of sampling such a direction. could be 0, which stands for delta
-     * lights. \return
+     * lights. \param sampled_light optionally returns the light that was sampled. \return
      */
     Color SampleLights(
         const GfVec3f& pos,
         GfVec3f& dir,
         GfVec3f& sampled_light_pos,
         float& pdf,
-        const std::function<float()>& function);
+        PixelSampler& function,
+        Hd_USTC_CG_Light** sampled_light = nullptr);
 
     /**
      * \brief for now, we only use very limited count of lights, thus we don't use any BVH on lights
      * \param ray the brdf sampled ray
-     * \return
+     * \return the radiance of the closest light hit, other than the dome light
      */
     Color IntersectLights(const GfRay& ray, GfVec3f& intersectPos);
     Color IntersectDomeLight(const GfRay& ray);
+    /**
+     * \brief Same as above, also returning the pdf of SampleLights choosing this direction. pdf is 0
+     * when there is no dome light.
+     */
+    Color IntersectDomeLight(const GfRay& ray, float& pdf);
 
 
-    bool Intersect(const GfRay& ray, SurfaceInteraction& si);
+    /**
+     * \brief spread_angle is the angle of the cone around the ray (ray cone), which gives the uv
+     * footprint used to filter textures. 0 samples them unfiltered.
+     */
+    bool Intersect(const GfRay& ray, SurfaceInteraction& si, float spread_angle = 0);
     bool VisibilityTest(const GfRay& ray);
     bool VisibilityTest(const GfVec3f& begin, const GfVec3f& end);
 
-    Color EstimateDirectLight(SurfaceInteraction& si, const std::function<float()>& uniform_float);
+    Color EstimateDirectLight(SurfaceInteraction& si, PixelSampler& uniform_float);
+    /**
+     * \brief Same as above with sample_count light samples and as many BRDF samples, averaged.
+     * Their shadow rays are traced as one batch.
+     */
+    Color EstimateDirectLight(
+        SurfaceInteraction& si,
+        PixelSampler& uniform_float,
+        unsigned sample_count);
+
+    // Add the rays this thread traced since the last call, and the given number of camera rays, to
+    // render_param->statistics.
+    void _FlushRayCounts(uint64_t camera_rays);
 
     const Hd_USTC_CG_Camera* camera_;
     HdRenderThread* render_thread_;
+    // Spread angle of the camera rays.
+    float pixel_spread_angle = 0;
 };
 
 class SamplingIntegrator : public Integrator {
@@ -79,15 +143,88 @@ class SamplingIntegrator : public Integrator {
     {
     }
 
+    // Optional. Receive the number of samples taken by each pixel, and the first-hit albedo and
+    // normal (which also guide the denoiser).
+    Hd_USTC_CG_RenderBuffer* sample_count_buffer = nullptr;
+    Hd_USTC_CG_RenderBuffer* albedo_buffer = nullptr;
+    Hd_USTC_CG_RenderBuffer* normal_buffer = nullptr;
+    // Optional. Receives the milliseconds spent on the tile of each pixel (float32).
+    Hd_USTC_CG_RenderBuffer* tile_time_buffer = nullptr;
+    // Optional. Keeps the tile costs between render passes to schedule the next ones.
+    Hd_USTC_CG_TileScheduler* tile_scheduler = nullptr;
+
+    void SetSamplesPerPixel(unsigned samples_per_pixel)
+    {
+        spp = samples_per_pixel;
+    }
+
    protected:
     unsigned spp = 256;
 
-    void _writeBuffer(unsigned x, unsigned y, VtValue color);
-
-    virtual VtValue Li(const GfRay& ray, std::default_random_engine& uniform_float) = 0;
-    void accumulate_color(VtValue& color, const VtValue& vt_value);
-    VtValue average_samples(const VtValue& color, unsigned spp);
-    void _RenderTiles(HdRenderThread* renderThread, size_t tileStart, size_t tileEnd);
+    // Adaptive sampling (enabled by Hd_USTC_CG_Config::adaptiveErrorThreshold): every pixel first
+    // takes adaptive_min_spp samples (at most spp), then batches of adaptive_batch_spp until its
+    // error is below the threshold. The samples saved on converged pixels go to the others, but no
+    // pixel takes more than adaptive_max_spp_scale * spp samples.
+    unsigned adaptive_min_spp = 16;
+    unsigned adaptive_batch_spp = 16;
+    unsigned adaptive_max_spp_scale = 4;
+
+    // The first-hit features are averaged over this many samples per pixel.
+    unsigned feature_spp = 4;
+    bool need_features = false;
+
+    struct PixelStatistics {
+        unsigned count = 0;
+        // Running mean and sum of squared deviations of the luminance (Welford's algorithm).
+        float mean = 0;
+        float m2 = 0;
+        // Sums of the first-hit features.
+        GfVec3f albedo{ 0 };
+        GfVec3f normal{ 0 };
+
+        void Add(const Color4& sample);
+        // Relative standard error of the luminance mean.
+        float Error() const;
+    };
+
+    void _writeSampleCount(unsigned x, unsigned y, unsigned count);
+    void _writeFeatures(unsigned x, unsigned y, const GfVec3f& albedo, const GfVec3f& normal);
+    // Albedo and normal at the first hit of a camera ray, zero if it hits nothing.
+    void _GetFeatures(const GfRay& ray, GfVec3f& albedo, GfVec3f& normal);
+
+    // Radiance along a camera ray, as RGBA.
+    virtual Color4 Li(const GfRay& ray, PixelSampler& sampler) = 0;
+    void _GetTileBounds(
+        unsigned tile,
+        unsigned& x0,
+        unsigned& y0,
+        unsigned& x1,
+        unsigned& y1) const;
+    // Adds samples [sample_begin, sample_end) of every pixel of the item to the film.
+    void _RenderTile(
+        const Hd_USTC_CG_TileScheduler::WorkItem& item,
+        unsigned sample_begin,
+        unsigned sample_end,
+        PixelSampler& sampler);
+    // Renders all tiles with uniform sampling, within Hd_USTC_CG_Config::passTimeBudget.
+    void _RenderScheduled(Hd_USTC_CG_TileScheduler& scheduler);
+    unsigned tile_count = 0;
+
+    void _RenderAdaptive(unsigned numTiles);
+    // Takes up to sample_count more samples in each unconverged pixel of the tile, adds them to the
+    // film and resolves the tile, so that the viewport shows the progress. Returns the largest
+    // error left in the tile (0 if there is nothing left to do).
+    float _RenderAdaptiveTile(
+        unsigned tile,
+        unsigned sample_count,
+        PixelSampler& sampler,
+        std::atomic<uint64_t>& spent_samples);
+
+    // Statistics of the pixels in the data window, row by row.
+    std::vector<PixelStatistics> pixel_statistics;
+    GfVec2i statistics_origin{ 0 };
+    unsigned statistics_width = 0;
+    float error_threshold = 0;
 
    public:
     void Render() override;
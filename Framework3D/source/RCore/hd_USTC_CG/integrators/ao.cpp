@@ -10,14 +10,11 @@
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using namespace pxr;
 
-VtValue AOIntegrator::Li(const GfRay& ray, std::default_random_engine& random)
+Color4 AOIntegrator::Li(const GfRay& ray, PixelSampler& uniform_float)
 {
-    std::uniform_real_distribution<float> uniform_dist(0.0f, 1.0f);
-    std::function<float()> uniform_float = std::bind(uniform_dist, random);
-
     SurfaceInteraction si;
-    if (!Intersect(ray, si))
-        return VtValue(GfVec4f{ 0, 0, 0, 1 });
+    if (!Intersect(ray, si, pixel_spread_angle))
+        return Color4(0, 0, 0, 1);
 
     // Flip the normal if opposite
     if (GfDot(si.shadingNormal, ray.GetDirection()) > 0) {
@@ -25,30 +22,46 @@ VtValue AOIntegrator::Li(const GfRay& ray, std::default_random_engine& random)
         si.PrepareTransforms();
     }
 
-    float color = 0.0f;
+    const int sample_count = int(sample_count_);
+    if (sample_count == 0)
+        return Color4(1);
 
-    std::vector<GfVec2f> samples;
-    samples.resize(spp);
-    for (int i = 0; i < spp; ++i) {
-        samples[i][0] = (float(i) + uniform_float()) / spp;
+    static thread_local std::vector<GfVec2f> samples;
+    samples.resize(sample_count);
+    for (int i = 0; i < sample_count; ++i) {
+        samples[i][0] = (float(i) + uniform_float()) / sample_count;
+    }
+    // Shuffle the first dimension (Fisher-Yates) to decorrelate it from the second.
+    for (int i = sample_count - 1; i > 0; --i) {
+        int j = std::min(int(uniform_float() * (i + 1)), i);
+        std::swap(samples[i][0], samples[j][0]);
     }
-    std::shuffle(samples.begin(), samples.end(), random);
-    for (int i = 0; i < spp; ++i) {
-        samples[i][1] = (float(i) + uniform_float()) / spp;
+    for (int i = 0; i < sample_count; ++i) {
+        samples[i][1] = (float(i) + uniform_float()) / sample_count;
     }
 
-    for (int i = 0; i < spp; i++) {
+    // Queue every occlusion ray of the hit, and trace them together.
+    static thread_local ShadowRayBatch batch;
+    static thread_local std::vector<float> weights;
+    batch.Clear();
+    weights.resize(sample_count);
+    const GfVec3f origin = si.position + 0.00001f * si.geometricNormal;
+    for (int i = 0; i < sample_count; i++) {
         float pdf;
         GfVec3f shadowDir = si.TangentToWorld(CosineWeightedDirection(samples[i], pdf));
-        GfRay shadow_ray;
-        shadow_ray.SetPointAndDirection(si.position + 0.00001f * si.geometricNormal, shadowDir);
+        weights[i] = GfDot(shadowDir, si.shadingNormal) / pdf;
+        batch.Add(origin, shadowDir);
+    }
+    batch.Trace(rtc_scene);
 
-        if (VisibilityTest(shadow_ray))
-            color += GfDot(shadowDir, si.shadingNormal) / pdf;
+    float color = 0.0f;
+    for (int i = 0; i < sample_count; i++) {
+        if (batch.Visible(i))
+            color += weights[i];
     }
-    color /= spp;
+    color /= sample_count;
 
-    return VtValue(GfVec4f(color, color, color, 1));
+    return Color4(color, color, color, 1);
 }
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
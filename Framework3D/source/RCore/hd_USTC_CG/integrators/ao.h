@@ -1,7 +1,5 @@
 #pragma once
 
-#include <random>
-
 #include "integrator.h"
 #include "renderParam.h"
 #include "renderer.h"
@@ -22,10 +20,18 @@ public:
     {
     }
 
+    // Occlusion rays per camera ray; 0 disables occlusion, leaving every hit white.
+    void SetSampleCount(unsigned sample_count)
+    {
+        sample_count_ = sample_count;
+    }
+
 protected:
     
-    VtValue Li(const GfRay& ray, std::default_random_engine& uniform_float)
+    Color4 Li(const GfRay& ray, PixelSampler& sampler)
     override;
+
+    unsigned sample_count_ = 16;
 };
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -6,15 +6,11 @@
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using namespace pxr;
 
-VtValue DirectLightIntegrator::Li(const GfRay& ray, std::default_random_engine& random)
+Color4 DirectLightIntegrator::Li(const GfRay& ray, PixelSampler& uniform_float)
 {
-    std::uniform_real_distribution<float> uniform_dist(
-        0.0f, 1.0f - std::numeric_limits<float>::epsilon());
-    std::function<float()> uniform_float = std::bind(uniform_dist, random);
-
     SurfaceInteraction si;
-    if (!Intersect(ray, si))
-        return VtValue(GfVec3f{ 0, 0, 0 });
+    if (!Intersect(ray, si, pixel_spread_angle))
+        return Color4(0, 0, 0, 1);
 
     // Flip the normal if opposite
     if (GfDot(si.shadingNormal, ray.GetDirection()) > 0) {
@@ -22,9 +18,7 @@ VtValue DirectLightIntegrator::Li(const GfRay& ray, std::default_random_engine&
         si.PrepareTransforms();
     }
 
-    GfVec3f color = EstimateDirectLight(si, uniform_float);
-
-    return VtValue(GfVec3f(color[0], color[1], color[2]));
+    return Color4(EstimateDirectLight(si, uniform_float, sample_count_), 1);
 }
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+
 #include "USTC_CG.h"
 #include "integrator.h"
 #include "pxr/pxr.h"
@@ -15,8 +17,17 @@ class DirectLightIntegrator : public SamplingIntegrator {
     {
     }
 
+    // Light samples per camera ray, each paired with a BRDF sample. Their shadow rays are traced
+    // as one batch.
+    void SetSampleCount(unsigned sample_count)
+    {
+        sample_count_ = std::max(sample_count, 1u);
+    }
+
    protected:
-    VtValue Li(const GfRay& ray, std::default_random_engine& uniform_float) override;
+    Color4 Li(const GfRay& ray, PixelSampler& sampler) override;
+
+    unsigned sample_count_ = 4;
 };
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
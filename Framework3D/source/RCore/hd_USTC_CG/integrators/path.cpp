@@ -1,92 +1,95 @@
 #include "path.h"
 
-#include <random>
-
 #include "surfaceInteraction.h"
 #include "utils/sampling.hpp"
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using namespace pxr;
 
-VtValue PathIntegrator::Li(const GfRay& ray, std::default_random_engine& random)
+Color4 PathIntegrator::Li(const GfRay& ray, PixelSampler& sampler)
 {
-    std::uniform_real_distribution<float> uniform_dist(
-        0.0f, 1.0f - std::numeric_limits<float>::epsilon());
-    std::function<float()> uniform_float = std::bind(uniform_dist, random);
-
-    auto color = EstimateOutGoingRadiance(ray, uniform_float, 0);
-
-    return VtValue(GfVec3f(color[0], color[1], color[2]));
+    return EstimateOutGoingRadiance(ray, sampler);
 }
 
-GfVec3f PathIntegrator::EstimateOutGoingRadiance(
-    const GfRay& ray,
-    const std::function<float()>& uniform_float,
-    int recursion_depth)
+Color4 PathIntegrator::EstimateOutGoingRadiance(
+    const GfRay& camera_ray,
+    PixelSampler& uniform_float)
 {
-    if (recursion_depth >= 50) {
-        return {};
-    }
-
-    SurfaceInteraction si;
-    if (!Intersect(ray, si)) {
-        // ray intersects nothing
-        if (recursion_depth == 0) {
-            return IntersectDomeLight(ray);
-            // use dome light for infinite far. This will automatically decide if there is a dome
-            // light.
-            // Only use for the first bounce. It is for easy running.
+    // The radiance terms below have an alpha of 0, leaving the one of the sum.
+    Color4 color(0, 0, 0, 1);
+    // Product of BRDF * cos / pdf along the path so far.
+    Color4 throughput(1);
+    GfRay ray = camera_ray;
+    // Whether the ray was sampled from a delta lobe (a mirror). Light sampling can't find the
+    // lights along such a ray, so their emission is added when the ray hits them.
+    bool delta_bounce = false;
+
+    for (unsigned depth = 0; depth < max_depth; ++depth) {
+        SurfaceInteraction si;
+        // Only camera rays have a known footprint.
+        const bool hit = Intersect(ray, si, depth == 0 ? pixel_spread_angle : 0);
+        if (delta_bounce) {
+            // The dome light is already added at full weight by EstimateDirectLight.
+            GfVec3f light_pos;
+            auto light_color = IntersectLights(ray, light_pos);
+            const GfVec3f origin(ray.GetStartPoint());
+            if (light_color != GfVec3f(0.f) &&
+                (!hit || (light_pos - origin).GetLength() < (si.position - origin).GetLength())) {
+                color += throughput * Color4(light_color);
+                break;
+            }
+        }
+        if (!hit) {
+            // ray intersects nothing
+            if (depth == 0) {
+                color += Color4(IntersectDomeLight(ray));
+                // use dome light for infinite far. This will automatically decide if there is a
+                // dome light.
+            }
+            // For later bounces, the dome light is already accounted for by EstimateDirectLight
+            // (with MIS) at the previous vertex.
+            break;
         }
 
-        return GfVec3f{ 0, 0, 0 };
-    }
+        // ray intersects something, stored in si
 
-    // ray intersects something, stored in si
+        // This can be customized : Do we want to see the lights? (Other than dome lights?)
+        if (depth == 0 && IntersectDomeLight(ray) == GfVec3f(0.f)) {
+            GfVec3f intersecPos;
+            auto light_color = IntersectLights(ray, intersecPos);
+            if (light_color != GfVec3f(0.f)) {
+                return Color4(light_color, 1);
+            }
+        }
 
-    // This can be customized : Do we want to see the lights? (Other than dome lights?)
-    if (recursion_depth == 0 && IntersectDomeLight(ray) == GfVec3f(0.f)) {
-        GfVec3f intersecPos;
-        auto light_color = IntersectLights(ray, intersecPos);
-        if (light_color != GfVec3f(0.f)) {
-            return light_color;
+        // Flip the normal if opposite
+        if (GfDot(si.shadingNormal, ray.GetDirection()) > 0) {
+            si.flipNormal();
+            si.PrepareTransforms();
         }
-    }
 
-    // Flip the normal if opposite
-    if (GfDot(si.shadingNormal, ray.GetDirection()) > 0) {
-        si.flipNormal();
-        si.PrepareTransforms();
-    }
+        color += throughput * Color4(EstimateDirectLight(si, uniform_float));
 
-    GfVec3f color{ 0 };
-    GfVec3f directLight = EstimateDirectLight(si, uniform_float);
+        // Continue the path by sampling the BRDF.
+        GfVec3f wi;
+        float sample_pdf;
+        auto brdfVal = si.Sample(wi, sample_pdf, uniform_float, &delta_bounce);
+        if (sample_pdf <= 0 || brdfVal == GfVec3f(0.f)) {
+            break;
+        }
+        throughput *= Color4(brdfVal) * (std::abs(GfDot(si.shadingNormal, wi)) / sample_pdf);
+
+        // Russian roulette: terminate paths that can only carry little energy.
+        if (depth >= russian_roulette_depth) {
+            float max_throughput = throughput.MaxRGB();
+            float continue_probability = std::min(max_throughput, 0.95f);
+            if (uniform_float() >= continue_probability) {
+                break;
+            }
+            throughput /= continue_probability;
+        }
 
-    // HW7_TODO: Estimate global lighting here.
-    GfVec3f globalLight = GfVec3f(0.f);
-    const float russian_roulette = 0.9;
-    if (uniform_float() > russian_roulette) {
-        // Introduce Russian Roulette by randomly terminate the path
-        return directLight;
+        ray = GfRay(si.position + 0.0001f * si.geometricNormal, wi);
     }
-    // float distance = (si.position - ray.GetStartPoint()).GetLength();
-    // float distance = 1.0f;
-    float sample_pos_pdf;
-    // GfVec3f wi = UniformSampleHemiSphere(GfVec2f(uniform_float(), uniform_float()),
-    // sample_pos_pdf); 
-    // randomly choose input direction with cosine weight and sample_pos_pdf
-
-    GfVec3f wi;
-    GfVec3f wo = si.WorldToTangent(si.wo);
-    wi = UniformSampleHemiSphere(GfVec2f(uniform_float(), uniform_float()), sample_pos_pdf);
-    auto brdfVal = si.Eval(wi);
-    // Sample BRDF
-    // auto brdfVal = si.material->Sample(wo, wi, sample_pos_pdf, si.texcoord, uniform_float);
-    // recursively estimate the outgoing radiance
-    auto L = EstimateOutGoingRadiance(
-        GfRay(si.position, si.TangentToWorld(wi)), uniform_float, recursion_depth + 1);
-    globalLight =
-        GfCompMult(brdfVal, L) * GfDot(si.shadingNormal, wi) / sample_pos_pdf / russian_roulette;
-
-    color = directLight + globalLight;
 
     return color;
 }
@@ -16,12 +16,17 @@ class PathIntegrator : public SamplingIntegrator {
     }
 
    protected:
-    VtValue Li(const GfRay& ray, std::default_random_engine& uniform_float) override;
+    // Paths are cut at this many bounces.
+    unsigned max_depth = 50;
+    // Russian roulette only starts after this many bounces.
+    unsigned russian_roulette_depth = 3;
 
-    GfVec3f EstimateOutGoingRadiance(
+    Color4 Li(const GfRay& ray, PixelSampler& sampler) override;
+
+    // RGBA, with an alpha of 1.
+    Color4 EstimateOutGoingRadiance(
         const GfRay& ray,
-        const std::function<float()>& uniform_float,
-        int recursion_depth);
+        PixelSampler& uniform_float);
 };
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
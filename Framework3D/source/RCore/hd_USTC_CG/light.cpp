@@ -5,6 +5,7 @@
 #include "pxr/base/gf/ray.h"
 #include "pxr/base/gf/rotation.h"
 #include "pxr/base/gf/vec2f.h"
+#include "pxr/base/work/loops.h"
 #include "pxr/imaging/glf/simpleLight.h"
 #include "pxr/imaging/hd/changeTracker.h"
 #include "pxr/imaging/hd/rprimCollection.h"
@@ -108,7 +109,7 @@ Color Hd_USTC_CG_Sphere_Light::Sample(
     GfVec3f& dir,
     GfVec3f& sampled_light_pos,
     float& sample_light_pdf,
-    const std::function<float()>& uniform_float)
+    PixelSampler& uniform_float)
 {
     auto distanceVec = position - pos;
 
@@ -123,7 +124,7 @@ Color Hd_USTC_CG_Sphere_Light::Sample(
     // On known two uniform random variables, we set them as: (theta, r_xy ^ 2), and the pdf is
     // sqrt(1 - r_xy ^ 2) / pi
     auto sampledDir =
-        CosineWeightedDirection(GfVec2f(uniform_float(), uniform_float()), sample_pos_pdf);
+        CosineWeightedDirection(uniform_float.Get2D(), sample_pos_pdf);
     // Using the basis to transform the direction to the world space, with z = normal.
     auto worldSampledDir = basis * sampledDir;
 
@@ -191,15 +192,40 @@ void Hd_USTC_CG_Sphere_Light::Sync(
     // irradiance means power per unit area on the sphere surface.
 }
 
+// The dome texture is mapped with u = (pi + atan2(y, x)) / 2pi and v = (1 - z) / 2. Both are linear
+// in the azimuth and in z, so the mapping preserves area: d\omega = 4pi du dv everywhere.
+static GfVec2f _DirectionToUV(const GfVec3f& dir)
+{
+    return GfVec2f((M_PI + std::atan2(dir[1], dir[0])) / 2.0 / M_PI, 0.5 - dir[2] * 0.5);
+}
+
+static GfVec3f _UVToDirection(const GfVec2f& uv)
+{
+    float phi = uv[0] * 2.0f * M_PI - M_PI;
+    float z = 1.0f - 2.0f * uv[1];
+    float r = sqrtf(std::max(0.0f, 1.0f - z * z));
+    return GfVec3f(r * cosf(phi), r * sinf(phi), z);
+}
+
 Color Hd_USTC_CG_Dome_Light::Sample(
     const GfVec3f& pos,
     GfVec3f& dir,
     GfVec3f& sampled_light_pos,
     float& sample_light_pdf,
-    const std::function<float()>& uniform_float)
+    PixelSampler& uniform_float)
 {
-    // Uniformly sample a point on the sphere with radius 1. 
-    dir = UniformSampleSphere(GfVec2f{ uniform_float(), uniform_float() }, sample_light_pdf);
+    if (distribution != nullptr) {
+        // Sample the texture proportional to its luminance.
+        float uv_pdf;
+        auto uv = distribution->SampleContinuous(
+            uniform_float.Get2D(), uv_pdf);
+        dir = _UVToDirection(uv);
+        sample_light_pdf = uv_pdf / (4.0f * M_PI);
+    }
+    else {
+        // Uniformly sample a point on the sphere with radius 1.
+        dir = UniformSampleSphere(uniform_float.Get2D(), sample_light_pdf);
+    }
     // Assume light is from the infinite distance.
     sampled_light_pos = dir * std::numeric_limits<float>::max() / 100.f;
 
@@ -207,6 +233,14 @@ Color Hd_USTC_CG_Dome_Light::Sample(
     // Color of given texture on dir. 
 }
 
+float Hd_USTC_CG_Dome_Light::Pdf(const GfVec3f& dir)
+{
+    if (distribution != nullptr) {
+        return distribution->Pdf(_DirectionToUV(dir)) / (4.0f * M_PI);
+    }
+    return 1.0f / (4.0f * M_PI);
+}
+
 Color Hd_USTC_CG_Dome_Light::Intersect(const GfRay& ray, float& depth)
 {
     depth = 10000000.f;
@@ -233,6 +267,50 @@ void Hd_USTC_CG_Dome_Light::_PrepareDomeLight(SdfPath const& id, HdSceneDelegate
     }
     auto diffuse = sceneDelegate->GetLightParamValue(id, HdLightTokens->diffuse).Get<float>();
     radiance = sceneDelegate->GetLightParamValue(id, HdLightTokens->color).Get<GfVec3f>() * diffuse;
+
+    _BuildDistribution();
+}
+
+/**
+ * @brief Build a piecewise-constant luminance distribution over the dome texture. Because the
+ * texture mapping is area preserving (see _DirectionToUV), no sin(theta) factor is needed.
+ */
+void Hd_USTC_CG_Dome_Light::_BuildDistribution()
+{
+    distribution = nullptr;
+    if (texture == nullptr) {
+        // A constant dome is already sampled proportional to radiance by uniform sampling.
+        return;
+    }
+
+    // Cap the resolution, finer maps only make sync time worse.
+    const int nu = std::clamp(texture->width(), 1, 1024);
+    const int nv = std::clamp(texture->height(), 1, 512);
+
+    // Evaluate at cell corners. Taking the maximum of the corners keeps the pdf positive wherever
+    // the bilinearly filtered texture is. The lookups are prefiltered to the cell size, so small
+    // bright spots of a texture finer than the grid are not missed.
+    std::vector<float> corners((nu + 1) * (nv + 1));
+    WorkParallelForN(nv + 1, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            for (int u = 0; u <= nu; ++u) {
+                auto uv = GfVec2f(float(u) / nu, float(v) / nv);
+                corners[v * (nu + 1) + u] = Luminance(_Evaluate(uv, 1.0f / nu));
+            }
+        }
+    });
+
+    std::vector<float> func(nu * nv);
+    for (int v = 0; v < nv; ++v) {
+        for (int u = 0; u < nu; ++u) {
+            func[v * nu + u] = std::max(
+                { corners[v * (nu + 1) + u],
+                  corners[v * (nu + 1) + u + 1],
+                  corners[(v + 1) * (nu + 1) + u],
+                  corners[(v + 1) * (nu + 1) + u + 1] });
+        }
+    }
+    distribution = std::make_unique<Distribution2D>(func.data(), nu, nv);
 }
 
 void Hd_USTC_CG_Dome_Light::Sync(
@@ -255,17 +333,7 @@ Color Hd_USTC_CG_Dome_Light::Le(const GfVec3f& dir)
 {
     if (texture != nullptr) {
         // dir should be normalized.
-        auto uv = GfVec2f((M_PI + std::atan2(dir[1], dir[0])) / 2.0 / M_PI, 0.5 - dir[2] * 0.5);
-        // uv means the coordinate of the texture. u = (pi + atan2(y, x)) / 2pi means to map the
-        // angle to [0, 1]. v = 0.5 - z / 2 means to map the z to [0, 1].
-
-        auto value = texture->Evaluate(uv);
-        // Get texture value on the given uv coordinate.
-
-        if (texture->component_conut() >= 3) {
-            return GfCompMult(Color{ value[0], value[1], value[2] }, radiance);
-            // Get the color. Texture * radiance.
-        }
+        return _Evaluate(_DirectionToUV(dir));
     }
     else {
         return radiance;
@@ -273,9 +341,22 @@ Color Hd_USTC_CG_Dome_Light::Le(const GfVec3f& dir)
     }
 }
 
+Color Hd_USTC_CG_Dome_Light::_Evaluate(const GfVec2f& uv, float footprint)
+{
+    auto value = texture->Evaluate(uv, footprint);
+    // Get texture value on the given uv coordinate.
+
+    if (texture->component_conut() >= 3) {
+        return GfCompMult(Color{ value[0], value[1], value[2] }, radiance);
+        // Get the color. Texture * radiance.
+    }
+    return value[0] * radiance;
+}
+
 void Hd_USTC_CG_Dome_Light::Finalize(HdRenderParam* renderParam)
 {
     texture = nullptr;
+    distribution = nullptr;
     Hd_USTC_CG_Light::Finalize(renderParam);
 }
 
@@ -306,10 +387,11 @@ Color Hd_USTC_CG_Distant_Light::Sample(
     GfVec3f& dir,
     GfVec3f& sampled_light_pos,
     float& sample_light_pdf,
-    const std::function<float()>& uniform_float)
+    PixelSampler& uniform_float)
 {
-    float theta = uniform_float() * angle;
-    float phi = uniform_float() * 2 * M_PI;
+    auto u = uniform_float.Get2D();
+    float theta = u[0] * angle;
+    float phi = u[1] * 2 * M_PI;
 
     auto sampled_dir = GfVec3f(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
 
@@ -340,10 +422,11 @@ Color Hd_USTC_CG_Rect_Light::Sample(
     GfVec3f& dir,
     GfVec3f& sampled_light_pos,
     float& sample_light_pdf,
-    const std::function<float()>& uniform_float)
+    PixelSampler& uniform_float)
 {
-    float x = uniform_float();
-    float y = uniform_float();
+    auto u = uniform_float.Get2D();
+    float x = u[0];
+    float y = u[1];
 
     sampled_light_pos = corner0 + (corner2 - corner0) * x + (corner1 - corner0) * y;
 
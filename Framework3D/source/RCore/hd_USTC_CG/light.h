@@ -3,11 +3,13 @@
 
 #include "USTC_CG.h"
 #include "color.h"
+#include "pixelSampler.h"
 #include "pxr/imaging/hd/light.h"
 #include "pxr/imaging/hio/image.h"
 #include "pxr/pxr.h"
 #include "pxr/usd/sdf/assetPath.h"
 #include "texture.h"
+#include "utils/distribution.hpp"
 
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using namespace pxr;
@@ -27,7 +29,7 @@ class Hd_USTC_CG_Light : public HdLight {
         GfVec3f& dir,
         GfVec3f& sampled_light_pos,
         float& sample_light_pdf,
-        const std::function<float()>& uniform_float) = 0;
+        PixelSampler& uniform_float) = 0;
     virtual Color Intersect(const GfRay& ray, float& depth) = 0;
 
     bool IsDomeLight();
@@ -55,7 +57,7 @@ class Hd_USTC_CG_Sphere_Light : public Hd_USTC_CG_Light {
         GfVec3f& dir,
         GfVec3f& sampled_light_pos,
         float& sample_light_pdf,
-        const std::function<float()>& uniform_float) override;
+        PixelSampler& uniform_float) override;
     Color Intersect(const GfRay& ray, float& depth) override;
     void Sync(HdSceneDelegate* sceneDelegate, HdRenderParam* renderParam, HdDirtyBits* dirtyBits)
         override;
@@ -78,19 +80,26 @@ class Hd_USTC_CG_Dome_Light : public Hd_USTC_CG_Light {
         GfVec3f& dir,
         GfVec3f& sampled_light_pos,
         float& sample_light_pdf,
-        const std::function<float()>& uniform_float) override;
+        PixelSampler& uniform_float) override;
     Color Intersect(const GfRay& ray, float& depth) override;
     void _PrepareDomeLight(SdfPath const& id, HdSceneDelegate* scene_delegate);
     void Sync(HdSceneDelegate* sceneDelegate, HdRenderParam* renderParam, HdDirtyBits* dirtyBits)
         override;
 
     Color Le(const GfVec3f& dir);
+    // Pdf (solid angle measure) of Sample() returning the given direction.
+    float Pdf(const GfVec3f& dir);
     void Finalize(HdRenderParam* renderParam) override;
 
    private:
+    Color _Evaluate(const GfVec2f& uv, float footprint = 0);
+    void _BuildDistribution();
+
     SdfAssetPath textureFileName;
     GfVec3f radiance;
     std::unique_ptr<Texture2D> texture = nullptr;
+    // Luminance distribution over the texture, for importance sampling.
+    std::unique_ptr<Distribution2D> distribution = nullptr;
 };
 
 class Hd_USTC_CG_Distant_Light : public Hd_USTC_CG_Light {
@@ -107,7 +116,7 @@ class Hd_USTC_CG_Distant_Light : public Hd_USTC_CG_Light {
         GfVec3f& dir,
         GfVec3f& sampled_light_pos,
         float& sample_light_pdf,
-        const std::function<float()>& uniform_float) override;
+        PixelSampler& uniform_float) override;
     Color Intersect(const GfRay& ray, float& depth) override;
 
    private:
@@ -128,7 +137,7 @@ class Hd_USTC_CG_Rect_Light : public Hd_USTC_CG_Light {
         GfVec3f& dir,
         GfVec3f& sampled_light_pos,
         float& sample_light_pdf,
-        const std::function<float()>& uniform_float) override;
+        PixelSampler& uniform_float) override;
     Color Intersect(const GfRay& ray, float& depth) override;
     void Sync(HdSceneDelegate* sceneDelegate, HdRenderParam* renderParam, HdDirtyBits* dirtyBits)
         override;
@@ -31,11 +31,13 @@ HdMaterialNode2 Hd_USTC_CG_Material::get_input_connection(
     return upstream;
 }
 
-Hd_USTC_CG_Material::MaterialRecord Hd_USTC_CG_Material::SampleMaterialRecord(GfVec2f texcoord)
+Hd_USTC_CG_Material::MaterialRecord Hd_USTC_CG_Material::SampleMaterialRecord(
+    GfVec2f texcoord,
+    float footprint)
 {
     MaterialRecord ret;
     if (diffuseColor.image) {
-        auto val4 = diffuseColor.image->Evaluate(texcoord);
+        auto val4 = diffuseColor.image->Evaluate(texcoord, footprint);
         ret.diffuseColor = { val4[0], val4[1], val4[2] };
     }
     else {
@@ -43,7 +45,7 @@ Hd_USTC_CG_Material::MaterialRecord Hd_USTC_CG_Material::SampleMaterialRecord(Gf
     }
 
     if (roughness.image) {
-        auto val4 = roughness.image->Evaluate(texcoord);
+        auto val4 = roughness.image->Evaluate(texcoord, footprint);
         ret.roughness = val4[1];
     }
     else {
@@ -51,7 +53,7 @@ Hd_USTC_CG_Material::MaterialRecord Hd_USTC_CG_Material::SampleMaterialRecord(Gf
     }
 
     if (ior.image) {
-        auto val4 = ior.image->Evaluate(texcoord);
+        auto val4 = ior.image->Evaluate(texcoord, footprint);
         ret.ior = val4[0];
     }
     else {
@@ -59,7 +61,7 @@ Hd_USTC_CG_Material::MaterialRecord Hd_USTC_CG_Material::SampleMaterialRecord(Gf
     }
 
     if (metallic.image) {
-        auto val4 = metallic.image->Evaluate(texcoord);
+        auto val4 = metallic.image->Evaluate(texcoord, footprint);
         ret.metallic = val4[2];
     }
     else {
@@ -174,6 +176,7 @@ void Hd_USTC_CG_Material::Sync(
     else {
         logging("Not loaded a material", Info);
     }
+    texcoordName = _FindTexcoordName();
     *dirtyBits = Clean;
 }
 
@@ -187,7 +190,7 @@ HdDirtyBits Hd_USTC_CG_Material::GetInitialDirtyBitsMask() const
         return INPUT.uv_primvar_name;       \
     }
 
-TfToken Hd_USTC_CG_Material::requireTexcoordName()
+TfToken Hd_USTC_CG_Material::_FindTexcoordName()
 {
     MACRO_MAP(requireTexCoord, INPUT_LIST)
     return {};
@@ -200,38 +203,86 @@ void Hd_USTC_CG_Material::Finalize(HdRenderParam* renderParam)
     HdMaterial::Finalize(renderParam);
 }
 
+// Three kinds of lobes are supported: a perfect mirror for (nearly) zero roughness, a GGX
+// microfacet reflection for metals, and Lambertian diffuse for the rest.
+static bool IsMirror(float roughness)
+{
+    return roughness < 0.01;
+}
+
 Color Hd_USTC_CG_Material::Sample(
     const GfVec3f& wo,
     GfVec3f& wi,
     float& pdf,
     GfVec2f texcoord,
-    const std::function<float()>& uniform_float)
+    float footprint,
+    PixelSampler& uniform_float,
+    bool* is_delta)
 {
-    auto sample2D = GfVec2f{ uniform_float(), uniform_float() };
-
-    // wi = CosineWeightedDirection(sample2D, pdf);
+    auto sample2D = uniform_float.Get2D();
 
     // Judge the type of the material
-    auto record = SampleMaterialRecord(texcoord);
+    auto record = SampleMaterialRecord(texcoord, footprint);
+    if (is_delta) {
+        *is_delta = IsMirror(record.roughness);
+    }
     // For mirror-like material
-    if (record.roughness < 0.01) {
-        wi = wo - 2 * GfDot(wo, GfVec3f(0, 0, 1)) * GfVec3f(0, 0, 1);
+    if (IsMirror(record.roughness)) {
+        wi = GfVec3f(-wo[0], -wo[1], wo[2]);
         pdf = 1;
+        // Chosen so that f * cos / pdf is the reflectance.
+        return record.diffuseColor / std::max(std::abs(wi[2]), 1e-4f);
     }
     // For metal material
     else if (record.metallic > 0.5) {
-        wi = GGXWeightedDirection(sample2D, record.roughness, pdf);
+        float h_pdf;
+        auto h = GGXWeightedDirection(sample2D, record.roughness, h_pdf);
+        wi = 2 * GfDot(wo, h) * h - wo;
+        if (wi[2] <= 0) {
+            pdf = 0;
+            return Color{ 0 };
+        }
+        // Change of variables from the half vector to wi.
+        pdf = h_pdf / (4 * std::abs(GfDot(wo, h)));
     }
     else {
-        wi = UniformSampleHemiSphere(sample2D, pdf);
+        wi = CosineWeightedDirection(sample2D, pdf);
     }
 
-    return Eval(wi, wo, texcoord);
+    return _Eval(record, wi, wo);
+}
+
+Color Hd_USTC_CG_Material::Eval(GfVec3f wi, GfVec3f wo, GfVec2f texcoord, float footprint)
+{
+    return _Eval(SampleMaterialRecord(texcoord, footprint), wi, wo);
 }
 
-Color Hd_USTC_CG_Material::Eval(GfVec3f wi, GfVec3f wo, GfVec2f texcoord)
+// Pdf of Sample() choosing wi, with wi and wo in tangent space.
+float Hd_USTC_CG_Material::Pdf(GfVec3f wi, GfVec3f wo, GfVec2f texcoord, float footprint)
 {
-    auto record = SampleMaterialRecord(texcoord);
+    return _Pdf(SampleMaterialRecord(texcoord, footprint), wi, wo);
+}
+
+Color Hd_USTC_CG_Material::_Eval(const MaterialRecord& record, const GfVec3f& wi, const GfVec3f& wo)
+{
+    // Mirror reflection is a delta distribution, it is only reachable through Sample().
+    if (wi[2] <= 0 || IsMirror(record.roughness)) {
+        return Color{ 0 };
+    }
+
+    if (record.metallic > 0.5) {
+        if (wo[2] <= 0) {
+            return Color{ 0 };
+        }
+        // Cook-Torrance with GGX distribution, Smith masking and Schlick's Fresnel.
+        float alpha = record.roughness * record.roughness;
+        auto h = (wi + wo).GetNormalized();
+        float D = GGX(h[2], alpha);
+        float G = SmithG1(wi[2], alpha) * SmithG1(wo[2], alpha);
+        float schlick = powf(1.0f - std::clamp(GfDot(wi, h), 0.0f, 1.0f), 5.0f);
+        Color F = record.diffuseColor + (Color(1.0f) - record.diffuseColor) * schlick;
+        return F * D * G / (4 * wi[2] * wo[2]);
+    }
 
     GfVec3f diffuseColor = record.diffuseColor;
 
@@ -240,9 +291,23 @@ Color Hd_USTC_CG_Material::Eval(GfVec3f wi, GfVec3f wo, GfVec2f texcoord)
     return result;
 }
 
-float Hd_USTC_CG_Material::Pdf(GfVec3f wi, GfVec3f wo, GfVec2f texcoord)
+Color Hd_USTC_CG_Material::Albedo(GfVec2f texcoord, float footprint)
 {
-    return 0;
+    return SampleMaterialRecord(texcoord, footprint).diffuseColor;
+}
+
+float Hd_USTC_CG_Material::_Pdf(const MaterialRecord& record, const GfVec3f& wi, const GfVec3f& wo)
+{
+    if (wi[2] <= 0 || IsMirror(record.roughness)) {
+        return 0;
+    }
+
+    if (record.metallic > 0.5) {
+        float alpha = record.roughness * record.roughness;
+        auto h = (wi + wo).GetNormalized();
+        return GGX(h[2], alpha) * h[2] / (4 * std::abs(GfDot(wo, h)));
+    }
+    return wi[2] / M_PI;
 }
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
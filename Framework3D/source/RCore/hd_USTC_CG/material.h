@@ -2,6 +2,7 @@
 
 #include "USTC_CG.h"
 #include "color.h"
+#include "pixelSampler.h"
 #include "pxr/imaging/hd/material.h"
 #include "pxr/imaging/hio/image.h"
 
@@ -38,12 +39,28 @@ class Hd_USTC_CG_Material : public HdMaterial {
 
     HdDirtyBits GetInitialDirtyBitsMask() const override;
 
-    TfToken requireTexcoordName();
+    // Name of the texcoord primvar the textures read, empty if there are none.
+    TfToken requireTexcoordName() const
+    {
+        return texcoordName;
+    }
 
     void Finalize(HdRenderParam* renderParam) override;
-    Color Sample(const GfVec3f& wo, GfVec3f& wi, float& pdf, GfVec2f texcoord, const std::function<float()>& uniform_float);
-    GfVec3f Eval(GfVec3f wi, GfVec3f wo, GfVec2f texcoord);
-    float Pdf(GfVec3f wi, GfVec3f wo, GfVec2f texcoord);
+    // All directions are in tangent space. is_delta is set when wi comes from a delta lobe, which
+    // neither Eval nor Pdf can represent. footprint is the width of the shading point in uv space,
+    // used to filter the textures.
+    Color Sample(
+        const GfVec3f& wo,
+        GfVec3f& wi,
+        float& pdf,
+        GfVec2f texcoord,
+        float footprint,
+        PixelSampler& uniform_float,
+        bool* is_delta = nullptr);
+    GfVec3f Eval(GfVec3f wi, GfVec3f wo, GfVec2f texcoord, float footprint = 0);
+    float Pdf(GfVec3f wi, GfVec3f wo, GfVec2f texcoord, float footprint = 0);
+    // Reflectance of the surface, used as a guide by the denoiser.
+    Color Albedo(GfVec2f texcoord, float footprint = 0);
 
     InputDescriptor diffuseColor;
     InputDescriptor specularColor;
@@ -76,7 +93,11 @@ class Hd_USTC_CG_Material : public HdMaterial {
         float ior;
     };
 
-    MaterialRecord SampleMaterialRecord(GfVec2f texcoord);
+    MaterialRecord SampleMaterialRecord(GfVec2f texcoord, float footprint = 0);
+    TfToken _FindTexcoordName();
+    TfToken texcoordName;
+    Color _Eval(const MaterialRecord& record, const GfVec3f& wi, const GfVec3f& wo);
+    float _Pdf(const MaterialRecord& record, const GfVec3f& wi, const GfVec3f& wo);
     HdMaterialNetwork2 surfaceNetwork;
 
     void TryLoadTexture(
@@ -0,0 +1,32 @@
+#include "pixelSampler.h"
+
+#include "config.h"
+#include "pxr/base/tf/diagnostic.h"
+#include "samplers/blueNoise.h"
+#include "samplers/independent.h"
+#include "samplers/sobol.h"
+#include "samplers/stratified.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+std::unique_ptr<PixelSampler> CreatePixelSampler(unsigned spp)
+{
+    const auto& config = Hd_USTC_CG_Config::GetInstance();
+    const auto& type = config.samplerType;
+    if (type == "independent") {
+        return std::make_unique<IndependentSampler>(spp, config.randomSeed);
+    }
+    if (type == "stratified") {
+        return std::make_unique<StratifiedSampler>(spp, config.randomSeed);
+    }
+    if (type == "bluenoise") {
+        return std::make_unique<BlueNoiseSampler>(spp, config.randomSeed);
+    }
+    if (type != "sobol") {
+        TF_WARN("Unknown sampler '%s', using sobol instead", type.c_str());
+    }
+    return std::make_unique<SobolSampler>(spp, config.randomSeed);
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
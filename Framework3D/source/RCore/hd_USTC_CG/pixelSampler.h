@@ -0,0 +1,59 @@
+#pragma once
+#include <memory>
+
+#include "USTC_CG.h"
+#include "pxr/base/gf/vec2f.h"
+#include "pxr/base/gf/vec2i.h"
+#include "pxr/pxr.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Source of the random numbers of one pixel sample. A value is addressed by (pixel, sample
+ * index, dimension), so a render only depends on the seed and not on how tiles are scheduled.
+ * Each call moves on to the next dimension, so callers must consume numbers in a fixed order.
+ */
+class PixelSampler {
+   public:
+    PixelSampler(unsigned spp, uint64_t seed) : spp(spp), seed(seed)
+    {
+    }
+    virtual ~PixelSampler() = default;
+
+    virtual void StartPixelSample(const GfVec2i& pixel, unsigned sample_index)
+    {
+        this->pixel = pixel;
+        this->sample_index = sample_index;
+        dimension = 0;
+    }
+
+    virtual float Get1D() = 0;
+    virtual GfVec2f Get2D()
+    {
+        float x = Get1D();
+        float y = Get1D();
+        return { x, y };
+    }
+
+    // So that a sampler can be passed wherever a uniform_float functor used to be.
+    float operator()()
+    {
+        return Get1D();
+    }
+
+   protected:
+    unsigned spp;
+    uint64_t seed;
+
+    GfVec2i pixel{ 0 };
+    unsigned sample_index = 0;
+    unsigned dimension = 0;
+};
+
+/**
+ * \brief Create the sampler selected in Hd_USTC_CG_Config, one per rendering thread.
+ */
+std::unique_ptr<PixelSampler> CreatePixelSampler(unsigned spp);
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
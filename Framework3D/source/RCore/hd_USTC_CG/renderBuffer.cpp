@@ -23,6 +23,9 @@
 //
 #include "renderBuffer.h"
 
+#include <algorithm>
+
+#include "denoiser.h"
 #include "pxr/base/gf/half.h"
 #include "renderParam.h"
 
@@ -38,6 +41,11 @@ Hd_USTC_CG_RenderBuffer::Hd_USTC_CG_RenderBuffer(SdfPath const &id)
       _buffer(),
       _sampleBuffer(),
       _sampleCount(),
+      _denoise(false),
+      _denoiseDirty(false),
+      _tileOrigin(0),
+      _tileSize(1),
+      _tilesX(0),
       _mappers(0),
       _converged(false)
 {
@@ -85,6 +93,14 @@ void Hd_USTC_CG_RenderBuffer::_Deallocate()
     _buffer.resize(0);
     _sampleBuffer.resize(0);
     _sampleCount.resize(0);
+    _denoise = false;
+    _noisy.resize(0);
+    _albedo.resize(0);
+    _normal.resize(0);
+    _denoiseDirty.store(false);
+    _sampleSums.resize(0);
+    _sampleWeights.resize(0);
+    _tilesX = 0;
 
     _mappers.store(0);
     _converged.store(false);
@@ -229,6 +245,18 @@ static void _WriteOutput(HdFormat format, uint8_t *dst, size_t valueComponents,
 void Hd_USTC_CG_RenderBuffer::Write(GfVec3i const &pixel, size_t numComponents, float const *value)
 {
     size_t idx = pixel[1] * _width + pixel[0];
+    if (_denoise)
+    {
+        _denoiseDirty.store(true);
+    }
+    if (_denoise && !_multiSampled)
+    {
+        GfVec4f &noisy = _noisy[idx];
+        for (size_t c = 0; c < 4; ++c)
+        {
+            noisy[c] = (c < numComponents) ? value[c] : 1.0f;
+        }
+    }
     if (_multiSampled)
     {
         size_t formatSize = HdDataSizeOfFormat(_GetSampleFormat(_format));
@@ -271,6 +299,19 @@ void Hd_USTC_CG_RenderBuffer::Clear(size_t numComponents, float const *value)
         _WriteOutput(_format, dst, numComponents, value);
     }
 
+    if (_denoise)
+    {
+        GfVec4f noisy(1.0f);
+        for (size_t c = 0; c < std::min<size_t>(numComponents, 4); ++c)
+        {
+            noisy[c] = value[c];
+        }
+        std::fill(_noisy.begin(), _noisy.end(), noisy);
+        std::fill(_albedo.begin(), _albedo.end(), GfVec3f(0.0f));
+        std::fill(_normal.begin(), _normal.end(), GfVec3f(0.0f));
+        _denoiseDirty.store(false);
+    }
+
     if (_multiSampled)
     {
         std::fill(_sampleCount.begin(), _sampleCount.end(), 0);
@@ -294,14 +335,148 @@ void Hd_USTC_CG_RenderBuffer::Clear(size_t numComponents, int const *value)
     }
 }
 
+void Hd_USTC_CG_RenderBuffer::SetDenoising(bool enable)
+{
+    HdFormat componentFormat = HdGetComponentFormat(_format);
+    size_t componentCount = HdGetComponentCount(_format);
+    if (enable && (componentCount < 3 || componentFormat == HdFormatInt32))
+    {
+        TF_WARN(
+            "Render buffer with format %s can't be denoised",
+            TfEnum::GetName(_format).c_str());
+        enable = false;
+    }
+    if (enable == _denoise)
+    {
+        return;
+    }
+
+    _denoise = enable;
+    size_t pixelCount = enable ? size_t(_width) * _height : 0;
+    _noisy.assign(pixelCount, GfVec4f(0.0f));
+    _albedo.assign(pixelCount, GfVec3f(0.0f));
+    _normal.assign(pixelCount, GfVec3f(0.0f));
+    _denoiseDirty.store(false);
+}
+
+void Hd_USTC_CG_RenderBuffer::WriteFeatures(
+    GfVec3i const &pixel,
+    GfVec3f const &albedo,
+    GfVec3f const &normal)
+{
+    if (!_denoise)
+    {
+        return;
+    }
+    size_t idx = pixel[1] * _width + pixel[0];
+    _albedo[idx] = albedo;
+    _normal[idx] = normal;
+}
+
+void Hd_USTC_CG_RenderBuffer::ResetSamples(GfVec2i const &origin, unsigned tileSize)
+{
+    _tileOrigin = GfVec2i(std::min<int>(origin[0], _width), std::min<int>(origin[1], _height));
+    _tileSize = std::max(tileSize, 1u);
+    _tilesX = (_width - _tileOrigin[0] + _tileSize - 1) / _tileSize;
+    unsigned tilesY = (_height - _tileOrigin[1] + _tileSize - 1) / _tileSize;
+
+    size_t sampleCount = size_t(_tilesX) * tilesY * _tileSize * _tileSize;
+    _sampleSums.assign(sampleCount, Color4());
+    _sampleWeights.assign(sampleCount, 0.0f);
+}
+
+void Hd_USTC_CG_RenderBuffer::ResolveTile(unsigned x0, unsigned y0, unsigned x1, unsigned y1)
+{
+    const size_t componentCount = std::min<size_t>(HdGetComponentCount(_format), 4);
+    const size_t formatSize = HdDataSizeOfFormat(_format);
+
+    // The format is dispatched once for the whole tile, not per component.
+    auto convert = [&](auto component, auto toComponent)
+    {
+        using T = decltype(component);
+        for (unsigned y = y0; y < y1; ++y)
+        {
+            for (unsigned x = x0; x < x1; ++x)
+            {
+                size_t sample = _SampleIndex(x, y);
+                float weight = _sampleWeights[sample];
+                // Skip pixels with no samples.
+                if (weight == 0)
+                {
+                    continue;
+                }
+                GfVec4f value = (_sampleSums[sample] / weight).GetRGBA();
+
+                size_t idx = size_t(y) * _width + x;
+                if (_denoise)
+                {
+                    _noisy[idx] = value;
+                }
+                T *dst = reinterpret_cast<T *>(&_buffer[idx * formatSize]);
+                for (size_t c = 0; c < componentCount; ++c)
+                {
+                    dst[c] = toComponent(value[c]);
+                }
+            }
+        }
+    };
+
+    switch (HdGetComponentFormat(_format))
+    {
+        case HdFormatFloat32: convert(float(), [](float v) { return v; }); break;
+        case HdFormatFloat16:
+            convert(uint16_t(), [](float v) { return GfHalf(v).bits(); });
+            break;
+        case HdFormatUNorm8:
+            convert(uint8_t(), [](float v) { return uint8_t(std::clamp(v, 0.0f, 1.0f) * 255.0f); });
+            break;
+        case HdFormatSNorm8:
+            convert(int8_t(), [](float v) { return int8_t(std::clamp(v, -1.0f, 1.0f) * 127.0f); });
+            break;
+        case HdFormatInt32: convert(int32_t(), [](float v) { return int32_t(v); }); break;
+        default: break;
+    }
+
+    if (_denoise)
+    {
+        _denoiseDirty.store(true);
+    }
+}
+
+void Hd_USTC_CG_RenderBuffer::_Denoise()
+{
+    std::vector<GfVec4f> denoised(_noisy.size());
+    Denoiser().Execute(
+        _noisy.data(), _albedo.data(), _normal.data(), _width, _height, denoised.data());
+
+    size_t formatSize = HdDataSizeOfFormat(_format);
+    for (size_t i = 0; i < denoised.size(); ++i)
+    {
+        _WriteOutput(_format, &_buffer[i * formatSize], 4, denoised[i].data());
+    }
+}
+
 /*virtual*/
 void Hd_USTC_CG_RenderBuffer::Resolve()
 {
+    if (_denoise)
+    {
+        // Nothing new to filter.
+        if (!_denoiseDirty.exchange(false))
+        {
+            return;
+        }
+    }
+
     // Resolve the image buffer: find the average value per pixel by
     // dividing the summed value by the number of samples.
 
     if (!_multiSampled)
     {
+        if (_denoise)
+        {
+            _Denoise();
+        }
         return;
     }
 
@@ -321,6 +496,13 @@ void Hd_USTC_CG_RenderBuffer::Resolve()
 
         uint8_t *dst = &_buffer[i * formatSize];
         uint8_t *src = &_sampleBuffer[i * sampleSize];
+        if (_denoise)
+        {
+            for (size_t c = 0; c < 4; ++c)
+            {
+                _noisy[i][c] = (c < componentCount) ? ((float *)src)[c] / sampleCount : 1.0f;
+            }
+        }
         for (size_t c = 0; c < componentCount; ++c)
         {
             if (componentFormat == HdFormatInt32)
@@ -345,6 +527,10 @@ void Hd_USTC_CG_RenderBuffer::Resolve()
             }
         }
     }
+    if (_denoise)
+    {
+        _Denoise();
+    }
 }
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -24,7 +24,11 @@
 #ifndef PXR_IMAGING_PLUGIN_HD_EMBREE_RENDER_BUFFER_H
 #define PXR_IMAGING_PLUGIN_HD_EMBREE_RENDER_BUFFER_H
 #include "USTC_CG.h"
+#include "color.h"
 
+#include "pxr/base/gf/vec2i.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/gf/vec4f.h"
 #include "pxr/imaging/hd/renderBuffer.h"
 #include "pxr/pxr.h"
 
@@ -102,12 +106,44 @@ public:
     void Clear(size_t numComponents, const float* value);
     void Clear(size_t numComponents, const int* value);
 
+    // When denoising, the integrator also writes the first-hit albedo and normal of each pixel,
+    // and Resolve() filters the color with them. Only float and normalized color formats can be
+    // denoised.
+    void SetDenoising(bool enable);
+    void WriteFeatures(const GfVec3i& pixel, const GfVec3f& albedo, const GfVec3f& normal);
+
+    // Float32 RGBA sample accumulation, stored tile by tile so the pixels of a tile are contiguous.
+    // Integrator threads add samples to the pixels of the tiles they own, which needs no locking,
+    // and ResolveTile() converts a finished tile to the buffer format. The tile grid starts at
+    // origin; ResetSamples() must be called before rendering.
+    void ResetSamples(const GfVec2i& origin, unsigned tileSize);
+    // Add the sum of weight samples to a pixel.
+    void AddSample(unsigned x, unsigned y, const Color4& value, float weight = 1)
+    {
+        size_t idx = _SampleIndex(x, y);
+        _sampleSums[idx] += value;
+        _sampleWeights[idx] += weight;
+    }
+    // Write the average of the samples of the pixels in [x0, x1) x [y0, y1) to the buffer.
+    void ResolveTile(unsigned x0, unsigned y0, unsigned x1, unsigned y1);
+
 private:
     // Calculate the needed buffer size, given the allocation parameters.
     static size_t _GetBufferSize(const GfVec2i& dims, HdFormat format);
 
     static HdFormat _GetSampleFormat(HdFormat format);
 
+    void _Denoise();
+
+    size_t _SampleIndex(unsigned x, unsigned y) const
+    {
+        unsigned tx = (x - _tileOrigin[0]) / _tileSize;
+        unsigned ty = (y - _tileOrigin[1]) / _tileSize;
+        unsigned px = x - _tileOrigin[0] - tx * _tileSize;
+        unsigned py = y - _tileOrigin[1] - ty * _tileSize;
+        return (size_t(ty) * _tilesX + tx) * _tileSize * _tileSize + py * _tileSize + px;
+    }
+
     // Release any allocated resources.
     void _Deallocate() override;
 
@@ -127,6 +163,21 @@ private:
     // For multisampled buffers: the sample count buffer.
     std::vector<uint8_t> _sampleCount;
 
+    // For denoised buffers: the color before filtering and the feature buffers.
+    bool _denoise;
+    std::vector<GfVec4f> _noisy;
+    std::vector<GfVec3f> _albedo;
+    std::vector<GfVec3f> _normal;
+    // Whether anything was written since the last denoising.
+    std::atomic<bool> _denoiseDirty;
+
+    // The tile-major sample accumulation buffer, and the sum of sample weights of each pixel.
+    std::vector<Color4> _sampleSums;
+    std::vector<float> _sampleWeights;
+    GfVec2i _tileOrigin;
+    unsigned int _tileSize;
+    unsigned int _tilesX;
+
     // The number of callers mapping this buffer.
     std::atomic<int> _mappers;
     // Whether the buffer has been marked as converged.
@@ -97,6 +97,7 @@ void Hd_USTC_CG_RenderDelegate::_Initialize()
                                VtValue(static_cast<int>(
                                    Hd_USTC_CG_Config::GetInstance().samplesToConvergence)) };
 
+    // 0: path tracing, 1: direct lighting, 2: ambient occlusion.
     _settingDescriptors[4] = { "Render Mode",
                                Hd_USTC_CG_RenderSettingsTokens->renderMode,
                                VtValue(0) };
@@ -105,7 +106,6 @@ void Hd_USTC_CG_RenderDelegate::_Initialize()
     _renderParam = std::make_shared<Hd_USTC_CG_RenderParam>(&_renderThread, &_sceneVersion);
     lights.reserve(16);
     _renderParam->lights = &lights;
-    _renderParam->materials = &materials;
 
     _renderer = std::make_shared<Hd_USTC_CG_Renderer>(_renderParam.get());
 
@@ -137,6 +137,12 @@ HdAovDescriptor Hd_USTC_CG_RenderDelegate::GetDefaultAovDescriptor(const TfToken
     if (name == HdAovTokens->cameraDepth) {
         return HdAovDescriptor(HdFormatFloat32, false, VtValue(0.0f));
     }
+    if (name == Hd_USTC_CG_AovTokens->albedo) {
+        return HdAovDescriptor(HdFormatFloat32Vec3, false, VtValue(GfVec3f(0.0f)));
+    }
+    if (name == Hd_USTC_CG_AovTokens->sampleCount || name == Hd_USTC_CG_AovTokens->tileTime) {
+        return HdAovDescriptor(HdFormatFloat32, false, VtValue(0.0f));
+    }
     if (name == HdAovTokens->primId || name == HdAovTokens->instanceId ||
         name == HdAovTokens->elementId) {
         return HdAovDescriptor(HdFormatInt32, false, VtValue(-1));
@@ -216,7 +222,7 @@ HdSprim* Hd_USTC_CG_RenderDelegate::CreateSprim(const TfToken& typeId, const Sdf
     }
     else if (typeId == HdPrimTypeTokens->material) {
         auto material = new Hd_USTC_CG_Material(sprimId);
-        materials[sprimId] = material;
+        _renderParam->SetMaterial(sprimId, material);
 
         return material;
     }
@@ -262,7 +268,7 @@ HdSprim* Hd_USTC_CG_RenderDelegate::CreateFallbackSprim(const TfToken& typeId)
     }
     else if (typeId == HdPrimTypeTokens->material) {
         auto material = new Hd_USTC_CG_Material(SdfPath::EmptyPath());
-        materials[SdfPath::EmptyPath()] = material;
+        _renderParam->SetMaterial(SdfPath::EmptyPath(), material);
         return material;
     }
     else if (typeId == HdPrimTypeTokens->sphereLight) {
@@ -289,7 +295,9 @@ void Hd_USTC_CG_RenderDelegate::DestroySprim(HdSprim* sPrim)
 {
     logging(sPrim->GetId().GetAsString() + " destroyed", USTC_CG::Info);
     lights.erase(std::remove(lights.begin(), lights.end(), sPrim), lights.end());
-    materials.erase(sPrim->GetId());
+    if (dynamic_cast<Hd_USTC_CG_Material*>(sPrim)) {
+        _renderParam->SetMaterial(sPrim->GetId(), nullptr);
+    }
     delete sPrim;
 }
 
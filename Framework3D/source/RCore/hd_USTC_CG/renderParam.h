@@ -25,6 +25,11 @@
 #define PXR_IMAGING_PLUGIN_HD_EMBREE_RENDER_PARAM_H
 #include <embree4/rtcore.h>
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
 #include "USTC_CG.h"
 #include "pxr/imaging/hd/renderDelegate.h"
 #include "pxr/imaging/hd/renderThread.h"
@@ -35,6 +40,28 @@ class Hd_USTC_CG_Light;
 class Hd_USTC_CG_Material;
 using namespace pxr;
 
+///
+/// \struct Hd_USTC_CG_RenderStatistics
+///
+/// Counters of BVH builds, render passes and traced rays, used to check the
+/// BVH build quality policy (see Hd_USTC_CG_Config::bvhQuality) against the
+/// trace time it buys, and by the benchmark tool. Times are in microseconds.
+///
+struct Hd_USTC_CG_RenderStatistics {
+    /// Prototype BVHs built from scratch.
+    std::atomic<uint64_t> prototypeBuilds{ 0 };
+    /// Prototype BVHs refit after a points-only update.
+    std::atomic<uint64_t> prototypeRefits{ 0 };
+    std::atomic<uint64_t> prototypeBuildTime{ 0 };
+    std::atomic<uint64_t> topLevelBuildTime{ 0 };
+    std::atomic<uint64_t> renderPasses{ 0 };
+    std::atomic<uint64_t> traceTime{ 0 };
+    /// Camera rays traced, one per sample.
+    std::atomic<uint64_t> cameraRays{ 0 };
+    /// All rays traced: camera, bounce and shadow rays.
+    std::atomic<uint64_t> rays{ 0 };
+};
+
 ///
 /// \class Hd_USTC_CG_RenderParam
 ///
@@ -48,6 +75,8 @@ class Hd_USTC_CG_RenderParam final : public HdRenderParam {
         : _renderThread(renderThread),
           _sceneVersion(sceneVersion)
     {
+        // Index 0 is the fallback material.
+        GetMaterialIndex(SdfPath::EmptyPath());
     }
 
     /// Accessor for the top-level embree scene.
@@ -63,8 +92,40 @@ class Hd_USTC_CG_RenderParam final : public HdRenderParam {
         return _device;
     }
 
+    /// Dense index of the material at a path. Indices never change, so rprims
+    /// can resolve their material once in Sync(). Thread safe, since rprims
+    /// sync in parallel.
+    unsigned GetMaterialIndex(const SdfPath &id)
+    {
+        std::lock_guard<std::mutex> lock(_materialMutex);
+        auto it = _materialIndices.find(id);
+        if (it != _materialIndices.end()) {
+            return it->second;
+        }
+        unsigned index = unsigned(materialTable.size());
+        _materialIndices[id] = index;
+        materialTable.push_back(nullptr);
+        return index;
+    }
+
+    /// Register (or with nullptr, unregister) the material at a path.
+    void SetMaterial(const SdfPath &id, Hd_USTC_CG_Material *material)
+    {
+        unsigned index = GetMaterialIndex(id);
+        std::lock_guard<std::mutex> lock(_materialMutex);
+        materialTable[index] = material;
+    }
+
+    /// Bound materials that don't exist (anymore) fall back to index 0.
+    Hd_USTC_CG_Material *GetMaterial(unsigned index) const
+    {
+        Hd_USTC_CG_Material *material = materialTable[index];
+        return material ? material : materialTable[0];
+    }
+
     friend class Hd_USTC_CG_Renderer;
-    pxr::TfHashMap<SdfPath, Hd_USTC_CG_Material *, TfHash> *materials = nullptr;
+    std::vector<Hd_USTC_CG_Material *> materialTable;
+    Hd_USTC_CG_RenderStatistics statistics;
     pxr::VtArray<Hd_USTC_CG_Light *> *lights = nullptr;
 
    private:
@@ -76,6 +137,9 @@ class Hd_USTC_CG_RenderParam final : public HdRenderParam {
     HdRenderThread *_renderThread = nullptr;
     /// A version counter for edits to _scene.
     std::atomic<int> *_sceneVersion;
+
+    std::mutex _materialMutex;
+    pxr::TfHashMap<SdfPath, unsigned, TfHash> _materialIndices;
 };
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
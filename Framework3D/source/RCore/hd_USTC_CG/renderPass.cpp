@@ -28,6 +28,7 @@
 #include <iostream>
 
 #include "renderBuffer.h"
+#include "renderDelegate.h"
 #include "pxr/imaging/hd/renderBuffer.h"
 #include "pxr/imaging/hd/renderDelegate.h"
 
@@ -95,6 +96,21 @@ Hd_USTC_CG_RenderPass::_Execute(
         _renderThread->StopRender();
         _lastSettingsVersion = currentSettingsVersion;
 
+        _renderer->SetSamplesToConvergence(
+            renderDelegate->GetRenderSetting<int>(
+                HdRenderSettingsTokens->convergedSamplesPerPixel, 1));
+        _renderer->SetRenderMode(
+            renderDelegate->GetRenderSetting<int>(
+                Hd_USTC_CG_RenderSettingsTokens->renderMode, 0));
+        // Turning ambient occlusion off leaves the occlusion mode unshadowed.
+        const bool enableAmbientOcclusion = renderDelegate->GetRenderSetting<bool>(
+            Hd_USTC_CG_RenderSettingsTokens->enableAmbientOcclusion, true);
+        _renderer->SetAmbientOcclusionSamples(
+            enableAmbientOcclusion
+                ? renderDelegate->GetRenderSetting<int>(
+                      Hd_USTC_CG_RenderSettingsTokens->ambientOcclusionSamples, 16)
+                : 0);
+
         needStartRender = true;
     }
 
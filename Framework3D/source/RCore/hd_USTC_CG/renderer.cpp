@@ -1,8 +1,14 @@
 #include "renderer.h"
 
+#include <algorithm>
+#include <chrono>
+
+#include "Utils/Logging/Logging.h"
+#include "config.h"
 #include "embree4/rtcore_scene.h"
 #include "integrators/ao.h"
 #include "integrators/direct.h"
+#include "pxr/base/tf/stringUtils.h"
 #include "pxr/imaging/hd/renderBuffer.h"
 #include "pxr/imaging/hd/tokens.h"
 #include "renderBuffer.h"
@@ -12,16 +18,33 @@
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using namespace pxr;
 
+TF_DEFINE_PUBLIC_TOKENS(Hd_USTC_CG_AovTokens, HD_USTC_CG_AOV_TOKENS);
+
+static uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
 Hd_USTC_CG_Renderer::Hd_USTC_CG_Renderer(Hd_USTC_CG_RenderParam* render_param)
-    : render_param(render_param)
+    : _samplesToConvergence(Hd_USTC_CG_Config::GetInstance().samplesToConvergence),
+      _ambientOcclusionSamples(Hd_USTC_CG_Config::GetInstance().ambientOcclusionSamples),
+      render_param(render_param)
 {
     _rtcDevice = rtcNewDevice(nullptr);
     rtcSetDeviceErrorFunction(_rtcDevice, HandleRtcError, NULL);
 
     _rtcScene = rtcNewScene(_rtcDevice);
-    rtcSetSceneFlags(_rtcScene, RTC_SCENE_FLAG_DYNAMIC);
-
-    rtcSetSceneBuildQuality(_rtcScene, RTC_BUILD_QUALITY_LOW);
+    // The top-level scene only holds instances, and is rebuilt whenever one
+    // of them changes, so it favors build speed unless told otherwise.
+    if (Hd_USTC_CG_Config::GetInstance().bvhQuality == "static") {
+        rtcSetSceneBuildQuality(_rtcScene, RTC_BUILD_QUALITY_HIGH);
+    }
+    else {
+        rtcSetSceneFlags(_rtcScene, RTC_SCENE_FLAG_DYNAMIC);
+        rtcSetSceneBuildQuality(_rtcScene, RTC_BUILD_QUALITY_LOW);
+    }
 
     render_param->_scene = _rtcScene;
     render_param->_device = _rtcDevice;
@@ -31,8 +54,12 @@ void Hd_USTC_CG_Renderer::Render(HdRenderThread* renderThread)
 {
     _completedSamples.store(0);
 
+    Hd_USTC_CG_RenderStatistics& statistics = render_param->statistics;
+
     // Commit any pending changes to the scene.
+    auto commitStart = std::chrono::steady_clock::now();
     rtcCommitScene(_rtcScene);
+    statistics.topLevelBuildTime += MicrosecondsSince(commitStart);
 
     if (!_ValidateAovBindings()) {
         // We aren't going to render anything. Just mark all AOVs as converged
@@ -46,13 +73,70 @@ void Hd_USTC_CG_Renderer::Render(HdRenderThread* renderThread)
         return;
     }
 
-    auto integrator = std::make_shared<PathIntegrator>(
-        camera_, static_cast<Hd_USTC_CG_RenderBuffer*>(_aovBindings[0].renderBuffer), renderThread);
+    auto renderBuffer = static_cast<Hd_USTC_CG_RenderBuffer*>(_aovBindings[0].renderBuffer);
+    std::shared_ptr<SamplingIntegrator> integrator;
+    if (_renderMode == 1) {
+        auto direct = std::make_shared<DirectLightIntegrator>(camera_, renderBuffer, renderThread);
+        direct->SetSampleCount(Hd_USTC_CG_Config::GetInstance().directLightSamples);
+        integrator = direct;
+    }
+    else if (_renderMode == 2) {
+        auto ao = std::make_shared<AOIntegrator>(camera_, renderBuffer, renderThread);
+        ao->SetSampleCount(_ambientOcclusionSamples);
+        integrator = ao;
+    }
+    else {
+        integrator = std::make_shared<PathIntegrator>(camera_, renderBuffer, renderThread);
+    }
 
     integrator->rtc_scene = _rtcScene;
+    integrator->SetSamplesPerPixel(_samplesToConvergence);
     integrator->render_param = render_param;
+    integrator->tile_scheduler = &_tileScheduler;
+    for (size_t i = 0; i < _aovBindings.size(); ++i) {
+        auto rb = static_cast<Hd_USTC_CG_RenderBuffer*>(_aovBindings[i].renderBuffer);
+        if (_aovNames[i].name == Hd_USTC_CG_AovTokens->sampleCount) {
+            integrator->sample_count_buffer = rb;
+        }
+        else if (_aovNames[i].name == Hd_USTC_CG_AovTokens->albedo) {
+            integrator->albedo_buffer = rb;
+        }
+        else if (_aovNames[i].name == HdAovTokens->normal) {
+            integrator->normal_buffer = rb;
+        }
+        else if (_aovNames[i].name == Hd_USTC_CG_AovTokens->tileTime) {
+            integrator->tile_time_buffer = rb;
+        }
+    }
 
+    auto traceStart = std::chrono::steady_clock::now();
     integrator->Render();
+    statistics.traceTime += MicrosecondsSince(traceStart);
+    statistics.renderPasses++;
+
+    if (Hd_USTC_CG_Config::GetInstance().printStatistics) {
+        _PrintStatistics();
+    }
+}
+
+void Hd_USTC_CG_Renderer::_PrintStatistics() const
+{
+    const Hd_USTC_CG_RenderStatistics& statistics = render_param->statistics;
+    const double traceSeconds = std::max(statistics.traceTime.load(), uint64_t(1)) * 1e-6;
+    logging(
+        TfStringPrintf(
+            "BVH: %llu prototype builds, %llu refits, %.2f ms prototype build, %.2f ms "
+            "top-level build; %llu render passes, %.2f ms trace, %.2f Mrays/s (%.2f M camera "
+            "rays/s)",
+            (unsigned long long)statistics.prototypeBuilds.load(),
+            (unsigned long long)statistics.prototypeRefits.load(),
+            statistics.prototypeBuildTime.load() / 1000.0,
+            statistics.topLevelBuildTime.load() / 1000.0,
+            (unsigned long long)statistics.renderPasses.load(),
+            statistics.traceTime.load() / 1000.0,
+            statistics.rays.load() / traceSeconds * 1e-6,
+            statistics.cameraRays.load() / traceSeconds * 1e-6),
+        Info);
 }
 
 void Hd_USTC_CG_Renderer::Clear()
@@ -96,6 +180,21 @@ void Hd_USTC_CG_Renderer::SetScene(RTCScene scene)
     _rtcScene = scene;
 }
 
+void Hd_USTC_CG_Renderer::SetSamplesToConvergence(int samplesToConvergence)
+{
+    _samplesToConvergence = unsigned(std::max(samplesToConvergence, 1));
+}
+
+void Hd_USTC_CG_Renderer::SetRenderMode(int renderMode)
+{
+    _renderMode = renderMode;
+}
+
+void Hd_USTC_CG_Renderer::SetAmbientOcclusionSamples(int ambientOcclusionSamples)
+{
+    _ambientOcclusionSamples = unsigned(std::max(ambientOcclusionSamples, 0));
+}
+
 /* static */
 GfVec4f Hd_USTC_CG_Renderer::_GetClearColor(const VtValue& clearValue)
 {
@@ -190,7 +289,10 @@ bool Hd_USTC_CG_Renderer::_ValidateAovBindings()
             _aovNames[i].name != HdAovTokens->depth && _aovNames[i].name != HdAovTokens->primId &&
             _aovNames[i].name != HdAovTokens->instanceId &&
             _aovNames[i].name != HdAovTokens->elementId && _aovNames[i].name != HdAovTokens->Neye &&
-            _aovNames[i].name != HdAovTokens->normal && !_aovNames[i].isPrimvar) {
+            _aovNames[i].name != HdAovTokens->normal &&
+            _aovNames[i].name != Hd_USTC_CG_AovTokens->sampleCount &&
+            _aovNames[i].name != Hd_USTC_CG_AovTokens->tileTime &&
+            _aovNames[i].name != Hd_USTC_CG_AovTokens->albedo && !_aovNames[i].isPrimvar) {
             TF_WARN(
                 "Unsupported attachment with Aov '%s' won't be rendered to",
                 _aovNames[i].name.GetText());
@@ -209,6 +311,17 @@ bool Hd_USTC_CG_Renderer::_ValidateAovBindings()
             _aovBindingsValid = false;
         }
 
+        // sample counts and tile times are only supported for float32 attachments
+        if ((_aovNames[i].name == Hd_USTC_CG_AovTokens->sampleCount ||
+             _aovNames[i].name == Hd_USTC_CG_AovTokens->tileTime) &&
+            format != HdFormatFloat32) {
+            TF_WARN(
+                "Aov '%s' has unsupported format '%s'",
+                _aovNames[i].name.GetText(),
+                TfEnum::GetName(format).c_str());
+            _aovBindingsValid = false;
+        }
+
         // ids are only supported for int32 attachments
         if ((_aovNames[i].name == HdAovTokens->primId ||
              _aovNames[i].name == HdAovTokens->instanceId ||
@@ -221,8 +334,9 @@ bool Hd_USTC_CG_Renderer::_ValidateAovBindings()
             _aovBindingsValid = false;
         }
 
-        // Normal is only supported for vec3 attachments of float.
-        if ((_aovNames[i].name == HdAovTokens->Neye || _aovNames[i].name == HdAovTokens->normal) &&
+        // Normal and albedo are only supported for vec3 attachments of float.
+        if ((_aovNames[i].name == HdAovTokens->Neye || _aovNames[i].name == HdAovTokens->normal ||
+             _aovNames[i].name == Hd_USTC_CG_AovTokens->albedo) &&
             format != HdFormatFloat32Vec3) {
             TF_WARN(
                 "Aov '%s' has unsupported format '%s'",
@@ -2,13 +2,24 @@
 #include "USTC_CG.h"
 #include "camera.h"
 #include "embree4/rtcore_geometry.h"
+#include "pxr/base/tf/staticTokens.h"
 #include "pxr/imaging/hd/aov.h"
 #include "pxr/imaging/hd/renderThread.h"
 #include "pxr/pxr.h"
 #include "renderer.h"
+#include "tileScheduler.h"
 USTC_CG_NAMESPACE_OPEN_SCOPE
 class Hd_USTC_CG_RenderParam;
 using namespace pxr;
+
+// AOVs specific to this renderer.
+// sampleCount: number of samples taken by each pixel (float32).
+// albedo: reflectance at the first hit (float32 vec3).
+// tileTime: milliseconds spent on the render tile of each pixel, a heatmap of the cost (float32).
+#define HD_USTC_CG_AOV_TOKENS (sampleCount)(albedo)(tileTime)
+
+TF_DECLARE_PUBLIC_TOKENS(Hd_USTC_CG_AovTokens, HD_USTC_CG_AOV_TOKENS);
+
 class Hd_USTC_CG_Renderer {
    public:
     explicit Hd_USTC_CG_Renderer(Hd_USTC_CG_RenderParam* render_param);
@@ -18,6 +29,13 @@ class Hd_USTC_CG_Renderer {
     virtual void Render(HdRenderThread* render_thread);
     virtual void Clear();
     void SetScene(RTCScene scene);
+    // Samples per pixel of a render pass (the convergedSamplesPerPixel render setting).
+    void SetSamplesToConvergence(int samplesToConvergence);
+    // Integrator used by Render() (the renderMode render setting): 0 path tracing, 1 direct
+    // lighting only, 2 ambient occlusion.
+    void SetRenderMode(int renderMode);
+    // Occlusion rays per camera ray of the ambient occlusion mode.
+    void SetAmbientOcclusionSamples(int ambientOcclusionSamples);
 
     void MarkAovBuffersUnconverged();
 
@@ -25,6 +43,8 @@ class Hd_USTC_CG_Renderer {
 
    protected:
     void _RenderTiles(HdRenderThread* renderThread, size_t tileStart, size_t tileEnd);
+    // Log the counters of render_param->statistics.
+    void _PrintStatistics() const;
     static GfVec4f _GetClearColor(const VtValue& clearValue);
     RTCDevice _rtcDevice;
 
@@ -32,6 +52,9 @@ class Hd_USTC_CG_Renderer {
 
     bool _enableSceneColors;
     std::atomic<int> _completedSamples;
+    unsigned _samplesToConvergence;
+    int _renderMode = 0;
+    unsigned _ambientOcclusionSamples;
 
     Hd_USTC_CG_RenderParam* render_param;
     // A callback that interprets embree error codes and injects them into
@@ -48,6 +71,8 @@ class Hd_USTC_CG_Renderer {
     bool _aovBindingsValid = false;
 
     const Hd_USTC_CG_Camera* camera_ = nullptr;
+    // Tile costs measured by a pass, used to schedule the next one.
+    Hd_USTC_CG_TileScheduler _tileScheduler;
 
     bool _ValidateAovBindings();
 };
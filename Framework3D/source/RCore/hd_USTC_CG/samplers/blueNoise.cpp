@@ -0,0 +1,29 @@
+#include "blueNoise.h"
+
+#include <cmath>
+
+#include "utils/pcg.hpp"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+float BlueNoiseSampler::Get1D()
+{
+    uint64_t dimension_hash = HashCombine(seed, dimension / 2);
+    uint32_t group_seed = uint32_t(dimension_hash);
+    unsigned dim = dimension % 2;
+    ++dimension;
+
+    float u = UIntToUnitFloat(ShuffledScrambledSobol(sample_index, dim, group_seed));
+
+    // R2 sequence over the pixel grid, from the plastic constant. The pattern is shifted per
+    // dimension so dimensions don't share it.
+    constexpr double a1 = 0.754877666246692760;
+    constexpr double a2 = 0.569840290998053265;
+    double shift = UIntToUnitFloat(uint32_t(HashCombine(dimension_hash, dim)));
+    double offset = u + shift + pixel[0] * a1 + pixel[1] * a2;
+
+    return std::min(float(offset - std::floor(offset)), OneMinusEpsilon);
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
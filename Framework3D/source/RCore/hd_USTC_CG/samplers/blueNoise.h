@@ -0,0 +1,22 @@
+#pragma once
+#include "USTC_CG.h"
+#include "sobol.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Sobol points shared by all pixels, shifted (Cranley-Patterson rotation) by a per-pixel
+ * offset from the R2 lattice. Neighbouring pixels get offsets far apart, which pushes the error
+ * towards high frequencies, similar to a blue-noise mask but without a precomputed texture.
+ */
+class BlueNoiseSampler final : public SobolSampler {
+   public:
+    BlueNoiseSampler(unsigned spp, uint64_t seed) : SobolSampler(spp, seed)
+    {
+    }
+
+    float Get1D() override;
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,20 @@
+#include "independent.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+void IndependentSampler::StartPixelSample(const GfVec2i& pixel, unsigned sample_index)
+{
+    PixelSampler::StartPixelSample(pixel, sample_index);
+    rng.SetSequence(HashCombine(uint32_t(pixel[0]), uint32_t(pixel[1])), MixBits(seed));
+    // Leave room for 2^16 dimensions per sample.
+    rng.Advance(uint64_t(sample_index) << 16);
+}
+
+float IndependentSampler::Get1D()
+{
+    ++dimension;
+    return rng.NextFloat();
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,26 @@
+#pragma once
+#include "USTC_CG.h"
+#include "pixelSampler.h"
+#include "utils/pcg.hpp"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Uniform random numbers without any stratification. Each pixel owns a PCG stream, and
+ * each sample starts at a fixed offset of it.
+ */
+class IndependentSampler final : public PixelSampler {
+   public:
+    IndependentSampler(unsigned spp, uint64_t seed) : PixelSampler(spp, seed)
+    {
+    }
+
+    void StartPixelSample(const GfVec2i& pixel, unsigned sample_index) override;
+    float Get1D() override;
+
+   private:
+    PCG32 rng;
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
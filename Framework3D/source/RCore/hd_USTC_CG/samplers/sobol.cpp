@@ -0,0 +1,86 @@
+#include "sobol.h"
+
+#include "utils/pcg.hpp"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+struct SobolDirections {
+    uint32_t v[2][32];
+};
+
+// Direction numbers of the first two dimensions: the van der Corput sequence, and the one built
+// from the primitive polynomial x + 1.
+static constexpr SobolDirections MakeSobolDirections()
+{
+    SobolDirections d{};
+    for (int i = 0; i < 32; ++i) {
+        d.v[0][i] = 1u << (31 - i);
+    }
+    d.v[1][0] = 1u << 31;
+    for (int i = 1; i < 32; ++i) {
+        d.v[1][i] = d.v[1][i - 1] ^ (d.v[1][i - 1] >> 1);
+    }
+    return d;
+}
+
+static constexpr SobolDirections sobol_directions = MakeSobolDirections();
+
+static uint32_t SobolSample(uint32_t index, unsigned dim)
+{
+    uint32_t x = 0;
+    for (int bit = 0; index != 0; index >>= 1, ++bit) {
+        if (index & 1) {
+            x ^= sobol_directions.v[dim][bit];
+        }
+    }
+    return x;
+}
+
+static uint32_t ReverseBits(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Laine-Karras style permutation; each bit only depends on the bits below it.
+static uint32_t LaineKarrasPermutation(uint32_t x, uint32_t seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+// Owen scrambling in base 2: each bit is flipped depending on the bits above it.
+static uint32_t NestedUniformScramble(uint32_t x, uint32_t seed)
+{
+    x = ReverseBits(x);
+    x = LaineKarrasPermutation(x, seed);
+    x = ReverseBits(x);
+    return x;
+}
+
+uint32_t SobolSampler::ShuffledScrambledSobol(uint32_t index, unsigned dim, uint32_t seed)
+{
+    index = NestedUniformScramble(index, seed);
+    uint32_t x = SobolSample(index, dim);
+    return NestedUniformScramble(x, uint32_t(HashCombine(seed, dim)));
+}
+
+float SobolSampler::Get1D()
+{
+    uint64_t pixel_hash = HashCombine(HashCombine(seed, uint32_t(pixel[0])), uint32_t(pixel[1]));
+    uint32_t group_seed = uint32_t(HashCombine(pixel_hash, dimension / 2));
+    unsigned dim = dimension % 2;
+    ++dimension;
+
+    return UIntToUnitFloat(ShuffledScrambledSobol(sample_index, dim, group_seed));
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
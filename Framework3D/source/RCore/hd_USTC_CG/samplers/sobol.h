@@ -0,0 +1,27 @@
+#pragma once
+#include "USTC_CG.h"
+#include "pixelSampler.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Owen-scrambled Sobol points, following Burley's "Practical Hash-based Owen Scrambling".
+ * Dimensions are drawn in pairs from the 2D Sobol sequence, so every pair is a (0, 2)-net for
+ * power of two spp. Each pair (and each pixel) shuffles the sample order and scrambles the points
+ * with its own seed, which decorrelates the pairs.
+ */
+class SobolSampler : public PixelSampler {
+   public:
+    SobolSampler(unsigned spp, uint64_t seed) : PixelSampler(spp, seed)
+    {
+    }
+
+    float Get1D() override;
+
+   protected:
+    // Scrambled value of the given Sobol dimension (0 or 1) for the sample index.
+    static uint32_t ShuffledScrambledSobol(uint32_t index, unsigned dim, uint32_t seed);
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,52 @@
+#include "stratified.h"
+
+#include "utils/pcg.hpp"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+// Kensler's hash based permutation: the i-th element of a random permutation of [0, l), selected
+// by p, without storing the permutation.
+static uint32_t PermutationElement(uint32_t i, uint32_t l, uint32_t p)
+{
+    uint32_t w = l - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do {
+        i ^= p;
+        i *= 0xe170893d;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929eb3f;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935fa69;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3df;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= l);
+    return (i + p) % l;
+}
+
+float StratifiedSampler::Get1D()
+{
+    uint64_t pixel_hash = HashCombine(HashCombine(seed, uint32_t(pixel[0])), uint32_t(pixel[1]));
+    uint64_t dimension_hash = HashCombine(pixel_hash, dimension);
+    ++dimension;
+
+    uint32_t stratum = PermutationElement(sample_index % spp, spp, uint32_t(dimension_hash));
+    float jitter = UIntToUnitFloat(uint32_t(HashCombine(dimension_hash, sample_index)));
+    return std::min((stratum + jitter) / spp, OneMinusEpsilon);
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,22 @@
+#pragma once
+#include "USTC_CG.h"
+#include "pixelSampler.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Each dimension is split into spp strata, and the samples of a pixel visit them in a
+ * hashed random order (Latin hypercube sampling). Every dimension is thus stratified on its own,
+ * whatever the number of samples.
+ */
+class StratifiedSampler final : public PixelSampler {
+   public:
+    StratifiedSampler(unsigned spp, uint64_t seed) : PixelSampler(spp, seed)
+    {
+    }
+
+    float Get1D() override;
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
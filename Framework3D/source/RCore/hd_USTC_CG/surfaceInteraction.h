@@ -17,10 +17,18 @@ class SurfaceInteraction {
     GfVec2f barycentric;
     GfVec3f shadingNormal;
     GfVec2f texcoord;
+    // Width of the ray footprint in uv space, 0 when unknown.
+    float uvFootprint = 0;
 
-    Color Sample(GfVec3f& dir, float& pdf, const std::function<float()>& function) const;
+    // All directions are in world space.
+    Color Sample(
+        GfVec3f& dir,
+        float& pdf,
+        PixelSampler& function,
+        bool* is_delta = nullptr) const;
     Color Eval(GfVec3f wi) const;
-    float Pdf(GfVec3f wi, GfVec3f wo) const;
+    float Pdf(GfVec3f wi) const;
+    Color Albedo() const;
 
     void PrepareTransforms();
     // This is for transforming vector! It would be different for transforming points.
@@ -35,12 +43,15 @@ class SurfaceInteraction {
     GfMatrix3f worldToTangent;
 };
 
-inline Color
-SurfaceInteraction::Sample(GfVec3f& dir, float& pdf, const std::function<float()>& function) const
+inline Color SurfaceInteraction::Sample(
+    GfVec3f& dir,
+    float& pdf,
+    PixelSampler& function,
+    bool* is_delta) const
 {
     GfVec3f sampled_dir;
     auto wo = WorldToTangent(this->wo);
-    const auto color = material->Sample(wo, sampled_dir, pdf, texcoord, function);
+    const auto color = material->Sample(wo, sampled_dir, pdf, texcoord, uvFootprint, function, is_delta);
     dir = TangentToWorld(sampled_dir);
     return color;
 }
@@ -48,12 +59,17 @@ SurfaceInteraction::Sample(GfVec3f& dir, float& pdf, const std::function<float()
 inline Color SurfaceInteraction::Eval(GfVec3f wi) const
 {
     auto wo = WorldToTangent(this->wo);
-    return material->Eval(wi, wo, texcoord);
+    return material->Eval(WorldToTangent(wi), wo, texcoord, uvFootprint);
 }
 
-inline float SurfaceInteraction::Pdf(GfVec3f wi, GfVec3f wo) const
+inline float SurfaceInteraction::Pdf(GfVec3f wi) const
 {
-    return material->Pdf(wi, wo, texcoord);
+    return material->Pdf(WorldToTangent(wi), WorldToTangent(this->wo), texcoord, uvFootprint);
+}
+
+inline Color SurfaceInteraction::Albedo() const
+{
+    return material->Albedo(texcoord, uvFootprint);
 }
 
 inline void SurfaceInteraction::PrepareTransforms()
@@ -1,9 +1,12 @@
 #pragma once
+#include <memory>
+
 #include "USTC_CG.h"
 #include "pxr/base/gf/vec2f.h"
 #include "pxr/base/gf/vec4f.h"
 #include "pxr/usd/sdf/assetPath.h"
 #include "surfaceInteraction.h"
+#include "textureCache.h"
 
 USTC_CG_NAMESPACE_OPEN_SCOPE
 using namespace pxr;
@@ -14,24 +17,33 @@ class Texture2D {
 
     bool isValid()
     {
-        return texture != nullptr;
+        return image != nullptr;
     }
 
     // Texture Interface
-    GfVec4f Evaluate(const GfVec2f& uv) const;
+    // footprint is the width of the lookup in uv space, which selects the mip level.
+    GfVec4f Evaluate(const GfVec2f& uv, float footprint = 0) const;
     ~Texture2D();
 
     unsigned component_conut() const
     {
-        return _component_count;
+        return image ? image->component_count() : 0;
     }
 
-   private:
-    unsigned _component_count;
+    int width() const
+    {
+        return image ? image->width() : 0;
+    }
 
+    int height() const
+    {
+        return image ? image->height() : 0;
+    }
+
+   private:
     SdfAssetPath textureFileName;
-    HioImageSharedPtr texture = nullptr;
-    HioImage::StorageSpec storageSpec;
+    // Shared with every other texture reading the same file.
+    std::shared_ptr<const MipmappedImage> image = nullptr;
 };
 
 USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,310 @@
+#include "textureCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Utils/Logging/Logging.h"
+#include "config.h"
+#include "pxr/base/gf/half.h"
+#include "pxr/base/tf/diagnostic.h"
+#include "pxr/base/work/loops.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+static float _SRGBToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float _LinearToSRGB(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static const float* _SRGBTable()
+{
+    static const auto table = [] {
+        std::vector<float> t(256);
+        for (int i = 0; i < 256; ++i) {
+            t[i] = _SRGBToLinear(i / 255.0f);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+static uint8_t _Quantize(float c)
+{
+    return uint8_t(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+std::shared_ptr<MipmappedImage> MipmappedImage::Load(
+    const std::string& path,
+    HioImage::SourceColorSpace colorSpace)
+{
+    auto image = HioImage::OpenForReading(path, 0, 0, colorSpace);
+    if (!image) {
+        return nullptr;
+    }
+
+    HioImage::StorageSpec storageSpec;
+    storageSpec.width = image->GetWidth();
+    storageSpec.height = image->GetHeight();
+    storageSpec.format = image->GetFormat();
+    std::vector<uint8_t> staging(
+        size_t(storageSpec.width) * storageSpec.height * image->GetBytesPerPixel());
+    storageSpec.data = staging.data();
+    if (staging.empty() || !image->Read(storageSpec)) {
+        return nullptr;
+    }
+
+    auto result = std::make_shared<MipmappedImage>();
+    const HioType type = HioGetHioType(storageSpec.format);
+    result->components = std::min<unsigned>(HioGetComponentCount(storageSpec.format), 4);
+    switch (type) {
+        case HioTypeUnsignedByte: break;
+        case HioTypeUnsignedByteSRGB: result->srgb = true; break;
+        case HioTypeUnsignedShort:
+        case HioTypeHalfFloat:
+        case HioTypeFloat: result->hdr = true; break;
+        default:
+            TF_WARN(
+                "Texture %s has unsupported format %d", path.c_str(), int(storageSpec.format));
+            return nullptr;
+    }
+
+    const int width = storageSpec.width;
+    const int height = storageSpec.height;
+    const unsigned sourceComponents = HioGetComponentCount(storageSpec.format);
+    result->levels.resize(1);
+    Level& level = result->levels[0];
+    result->_AllocateLevel(level, width, height);
+
+    WorkParallelForN(height, [&](size_t begin, size_t end) {
+        for (int y = int(begin); y < int(end); ++y) {
+            for (int x = 0; x < width; ++x) {
+                const size_t src = (size_t(y) * width + x) * sourceComponents;
+                const size_t dst = level.Offset(x, y) * result->components;
+                for (unsigned c = 0; c < result->components; ++c) {
+                    switch (type) {
+                        case HioTypeUnsignedByte:
+                        case HioTypeUnsignedByteSRGB: level.ldr[dst + c] = staging[src + c]; break;
+                        case HioTypeUnsignedShort:
+                            level.hdr[dst + c] =
+                                reinterpret_cast<const uint16_t*>(staging.data())[src + c] /
+                                65535.0f;
+                            break;
+                        case HioTypeHalfFloat: {
+                            GfHalf half;
+                            half.setBits(reinterpret_cast<const uint16_t*>(staging.data())[src + c]);
+                            level.hdr[dst + c] = half;
+                            break;
+                        }
+                        case HioTypeFloat:
+                            level.hdr[dst + c] =
+                                reinterpret_cast<const float*>(staging.data())[src + c];
+                            break;
+                        default: break;
+                    }
+                }
+            }
+        }
+    });
+
+    result->_BuildMipLevels();
+    return result;
+}
+
+void MipmappedImage::_AllocateLevel(Level& level, int width, int height) const
+{
+    level.width = width;
+    level.height = height;
+    level.tiles_x = (width + TileSize - 1) / TileSize;
+    const int tiles_y = (height + TileSize - 1) / TileSize;
+    const size_t size = size_t(level.tiles_x) * tiles_y * TileSize * TileSize * components;
+    if (hdr) {
+        level.hdr.assign(size, 0.0f);
+    }
+    else {
+        level.ldr.assign(size, 0);
+    }
+}
+
+GfVec4f MipmappedImage::_Fetch(const Level& level, int x, int y) const
+{
+    GfVec4f value(1.0f);
+    const size_t offset = level.Offset(x, y) * components;
+    for (unsigned c = 0; c < components; ++c) {
+        if (hdr) {
+            value[c] = level.hdr[offset + c];
+        }
+        else if (srgb && c < 3) {
+            value[c] = _SRGBTable()[level.ldr[offset + c]];
+        }
+        else {
+            value[c] = level.ldr[offset + c] / 255.0f;
+        }
+    }
+    return value;
+}
+
+void MipmappedImage::_Store(Level& level, int x, int y, const GfVec4f& value) const
+{
+    const size_t offset = level.Offset(x, y) * components;
+    for (unsigned c = 0; c < components; ++c) {
+        if (hdr) {
+            level.hdr[offset + c] = value[c];
+        }
+        else if (srgb && c < 3) {
+            level.ldr[offset + c] = _Quantize(_LinearToSRGB(value[c]));
+        }
+        else {
+            level.ldr[offset + c] = _Quantize(value[c]);
+        }
+    }
+}
+
+void MipmappedImage::_BuildMipLevels()
+{
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const int width = std::max(levels.back().width / 2, 1);
+        const int height = std::max(levels.back().height / 2, 1);
+        levels.emplace_back();
+        const Level& finer = levels[levels.size() - 2];
+        Level& level = levels.back();
+        _AllocateLevel(level, width, height);
+
+        // Box filter, in linear space.
+        WorkParallelForN(height, [&](size_t begin, size_t end) {
+            for (int y = int(begin); y < int(end); ++y) {
+                const int y0 = std::min(2 * y, finer.height - 1);
+                const int y1 = std::min(2 * y + 1, finer.height - 1);
+                for (int x = 0; x < width; ++x) {
+                    const int x0 = std::min(2 * x, finer.width - 1);
+                    const int x1 = std::min(2 * x + 1, finer.width - 1);
+                    GfVec4f sum = _Fetch(finer, x0, y0) + _Fetch(finer, x1, y0) +
+                                  _Fetch(finer, x0, y1) + _Fetch(finer, x1, y1);
+                    _Store(level, x, y, sum / 4.0f);
+                }
+            }
+        });
+    }
+}
+
+static int _Wrap(int i, int n)
+{
+    i %= n;
+    return i < 0 ? i + n : i;
+}
+
+GfVec4f MipmappedImage::_Bilinear(const Level& level, const GfVec2f& uv) const
+{
+    // Texel centers are at half-integer positions.
+    const float x = uv[0] * level.width - 0.5f;
+    const float y = uv[1] * level.height - 0.5f;
+    const int x0 = int(std::floor(x));
+    const int y0 = int(std::floor(y));
+    const float s = x - x0;
+    const float t = y - y0;
+
+    const int xa = _Wrap(x0, level.width), xb = _Wrap(x0 + 1, level.width);
+    const int ya = _Wrap(y0, level.height), yb = _Wrap(y0 + 1, level.height);
+
+    return _Fetch(level, xa, ya) * (1 - s) * (1 - t) + _Fetch(level, xb, ya) * s * (1 - t) +
+           _Fetch(level, xa, yb) * (1 - s) * t + _Fetch(level, xb, yb) * s * t;
+}
+
+GfVec4f MipmappedImage::Evaluate(const GfVec2f& uv, float footprint) const
+{
+    if (levels.empty()) {
+        return GfVec4f(0.0f);
+    }
+
+    const GfVec2f wrapped(uv[0] - std::floor(uv[0]), uv[1] - std::floor(uv[1]));
+
+    const float texels = footprint * std::max(width(), height());
+    if (texels <= 1.0f) {
+        return _Bilinear(levels[0], wrapped);
+    }
+    const float lod = std::log2(texels);
+    const int last = int(levels.size()) - 1;
+    if (lod >= float(last)) {
+        return _Bilinear(levels[last], wrapped);
+    }
+
+    // Trilinear: blend the two levels around the footprint.
+    const int level = int(lod);
+    const float t = lod - float(level);
+    return _Bilinear(levels[level], wrapped) * (1 - t) +
+           _Bilinear(levels[level + 1], wrapped) * t;
+}
+
+size_t MipmappedImage::memory_usage() const
+{
+    size_t size = 0;
+    for (const auto& level : levels) {
+        size += level.ldr.size() + level.hdr.size() * sizeof(float);
+    }
+    return size;
+}
+
+TextureCache& TextureCache::GetInstance()
+{
+    static TextureCache instance;
+    return instance;
+}
+
+std::shared_ptr<const MipmappedImage> TextureCache::Acquire(
+    const SdfAssetPath& path,
+    HioImage::SourceColorSpace colorSpace)
+{
+    const std::string& file =
+        path.GetResolvedPath().empty() ? path.GetAssetPath() : path.GetResolvedPath();
+    Key key(file, int(colorSpace));
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        lru.splice(lru.begin(), lru, it->second.lru_position);
+        return it->second.image;
+    }
+
+    auto image = MipmappedImage::Load(file, colorSpace);
+    if (!image) {
+        logging(path.GetAssetPath() + " not loaded", Info);
+        return nullptr;
+    }
+    logging(path.GetAssetPath() + " successfully loaded", Info);
+
+    lru.push_front(key);
+    entries[key] = { image, lru.begin() };
+    total_memory += image->memory_usage();
+
+    _Evict(size_t(Hd_USTC_CG_Config::GetInstance().textureCacheSize) << 20);
+    return image;
+}
+
+void TextureCache::_Evict(size_t capacity)
+{
+    for (auto it = lru.end(); it != lru.begin() && total_memory > capacity;) {
+        --it;
+        auto entry = entries.find(*it);
+        // Images still held by a material or a light can't be released.
+        if (entry->second.image.use_count() > 1) {
+            continue;
+        }
+        total_memory -= entry->second.image->memory_usage();
+        entries.erase(entry);
+        it = lru.erase(it);
+    }
+}
+
+size_t TextureCache::memory_usage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return total_memory;
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
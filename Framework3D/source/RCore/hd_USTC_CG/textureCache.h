@@ -0,0 +1,116 @@
+#pragma once
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "USTC_CG.h"
+#include "pxr/base/gf/vec2f.h"
+#include "pxr/base/gf/vec4f.h"
+#include "pxr/imaging/hio/image.h"
+#include "pxr/pxr.h"
+#include "pxr/usd/sdf/assetPath.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Mip pyramid of an image, converted once at load time. 8-bit images stay 8-bit (sRGB ones
+ * are decoded with a table at lookup), everything else becomes float. Each level is stored in
+ * 8x8 texel tiles, so that a bilinear lookup touches one or two cache lines.
+ */
+class MipmappedImage {
+   public:
+    static std::shared_ptr<MipmappedImage> Load(
+        const std::string& path,
+        HioImage::SourceColorSpace colorSpace);
+
+    /**
+     * \param uv texture coordinate, repeated outside of [0, 1)
+     * \param footprint width of the lookup in uv space. 0 samples the finest level bilinearly,
+     * larger values blend the two closest levels.
+     * \return the linear value. Missing components are 1.
+     */
+    GfVec4f Evaluate(const GfVec2f& uv, float footprint = 0) const;
+
+    int width() const
+    {
+        return levels.empty() ? 0 : levels[0].width;
+    }
+    int height() const
+    {
+        return levels.empty() ? 0 : levels[0].height;
+    }
+    unsigned component_count() const
+    {
+        return components;
+    }
+    size_t memory_usage() const;
+
+   private:
+    static constexpr int TileSize = 8;
+
+    struct Level {
+        int width;
+        int height;
+        int tiles_x;
+        std::vector<uint8_t> ldr;
+        std::vector<float> hdr;
+
+        size_t Offset(int x, int y) const
+        {
+            return (size_t(y / TileSize) * tiles_x + x / TileSize) * TileSize * TileSize +
+                   (y % TileSize) * TileSize + x % TileSize;
+        }
+    };
+
+    void _AllocateLevel(Level& level, int width, int height) const;
+    GfVec4f _Fetch(const Level& level, int x, int y) const;
+    void _Store(Level& level, int x, int y, const GfVec4f& value) const;
+    GfVec4f _Bilinear(const Level& level, const GfVec2f& uv) const;
+    void _BuildMipLevels();
+
+    unsigned components = 0;
+    bool hdr = false;
+    bool srgb = false;
+    std::vector<Level> levels;
+};
+
+/**
+ * \brief Process-wide cache of the images used as textures, keyed by asset path and color space,
+ * so that a file shared by several materials or lights is loaded once. Images nobody uses any more
+ * stay cached until the total memory exceeds the budget of Hd_USTC_CG_Config, and are then evicted
+ * least recently used first.
+ */
+class TextureCache {
+   public:
+    static TextureCache& GetInstance();
+
+    // Returns nullptr if the image can't be read.
+    std::shared_ptr<const MipmappedImage> Acquire(
+        const SdfAssetPath& path,
+        HioImage::SourceColorSpace colorSpace);
+
+    size_t memory_usage() const;
+
+   private:
+    TextureCache() = default;
+
+    using Key = std::pair<std::string, int>;
+    struct Entry {
+        std::shared_ptr<const MipmappedImage> image;
+        std::list<Key>::iterator lru_position;
+    };
+
+    void _Evict(size_t capacity);
+
+    mutable std::mutex mutex;
+    std::map<Key, Entry> entries;
+    // Most recently used first.
+    std::list<Key> lru;
+    size_t total_memory = 0;
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,161 @@
+#include "tileScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <numeric>
+
+#include "pxr/base/work/dispatcher.h"
+#include "pxr/base/work/threadLimits.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+// Tiles are split until no part costs more than this fraction of the share of a worker.
+static constexpr unsigned kSplitsPerWorker = 4;
+// Parts are not split below this size (per axis).
+static constexpr unsigned kMinItemSize = 2;
+
+void Hd_USTC_CG_TileScheduler::BeginPass(const std::vector<WorkItem>& tiles)
+{
+    if (tiles != _tiles) {
+        _tiles = tiles;
+        _costs.assign(tiles.size(), 0.0);
+    }
+    _passTimes = std::vector<std::atomic<uint64_t>>(tiles.size());
+    _passSamples = std::vector<std::atomic<uint64_t>>(tiles.size());
+}
+
+unsigned Hd_USTC_CG_TileScheduler::GetWorkerCount() const
+{
+    return std::max(WorkGetConcurrencyLimit(), 1u);
+}
+
+float Hd_USTC_CG_TileScheduler::GetTileTime(unsigned tile) const
+{
+    return float(_passTimes[tile].load() / 1e6);
+}
+
+void Hd_USTC_CG_TileScheduler::_Split(
+    const WorkItem& item,
+    double cost,
+    double split_cost,
+    std::vector<WorkItem>& items)
+{
+    const unsigned width = item.x1 - item.x0;
+    const unsigned height = item.y1 - item.y0;
+    if (cost <= split_cost || (width < 2 * kMinItemSize && height < 2 * kMinItemSize)) {
+        items.push_back(item);
+        return;
+    }
+
+    // Halve the longer side; two levels make quadrants.
+    WorkItem first = item, second = item;
+    if (width >= height) {
+        first.x1 = second.x0 = item.x0 + width / 2;
+    }
+    else {
+        first.y1 = second.y0 = item.y0 + height / 2;
+    }
+    _Split(first, cost / 2, split_cost, items);
+    _Split(second, cost / 2, split_cost, items);
+}
+
+void Hd_USTC_CG_TileScheduler::Run(
+    unsigned samples,
+    const std::function<void(const WorkItem&, unsigned)>& fn,
+    const std::function<bool()>& stop)
+{
+    const unsigned workers = GetWorkerCount();
+
+    // Tiles that weren't measured yet are assumed to cost the average of the others.
+    double measured = 0;
+    size_t measured_count = 0;
+    for (double cost : _costs) {
+        if (cost > 0) {
+            measured += cost;
+            ++measured_count;
+        }
+    }
+    const double default_cost = measured_count ? measured / measured_count : 1.0;
+    std::vector<double> costs(_tiles.size());
+    for (size_t tile = 0; tile < _tiles.size(); ++tile) {
+        costs[tile] = _costs[tile] > 0 ? _costs[tile] : default_cost;
+    }
+    const double total = std::accumulate(costs.begin(), costs.end(), 0.0);
+    const double split_cost = total / (workers * kSplitsPerWorker);
+
+    // Most expensive first; ties keep the tile order so that the schedule is reproducible.
+    std::vector<unsigned> order(_tiles.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(
+        order.begin(), order.end(), [&](unsigned a, unsigned b) { return costs[a] > costs[b]; });
+    std::vector<WorkItem> items;
+    items.reserve(_tiles.size());
+    for (unsigned tile : order) {
+        _Split(_tiles[tile], costs[tile], split_cost, items);
+    }
+
+    // Deal the items round robin, so that every queue also goes from expensive to cheap.
+    struct Queue {
+        std::mutex mutex;
+        std::deque<WorkItem> items;
+    };
+    std::vector<Queue> queues(workers);
+    for (size_t i = 0; i < items.size(); ++i) {
+        queues[i % workers].items.push_back(items[i]);
+    }
+
+    // Own work is taken from the front; stolen work from the back of the other queues.
+    auto next = [&](unsigned worker, WorkItem& item) {
+        for (unsigned i = 0; i < workers; ++i) {
+            Queue& queue = queues[(worker + i) % workers];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.items.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                item = queue.items.front();
+                queue.items.pop_front();
+            }
+            else {
+                item = queue.items.back();
+                queue.items.pop_back();
+            }
+            return true;
+        }
+        return false;
+    };
+
+    WorkDispatcher dispatcher;
+    for (unsigned worker = 0; worker < workers; ++worker) {
+        dispatcher.Run([&, worker] {
+            WorkItem item;
+            while (!stop() && next(worker, item)) {
+                auto start = std::chrono::steady_clock::now();
+                fn(item, worker);
+                auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+                _passTimes[item.tile] += uint64_t(time);
+                _passSamples[item.tile] +=
+                    uint64_t(item.x1 - item.x0) * (item.y1 - item.y0) * samples;
+            }
+        });
+    }
+    dispatcher.Wait();
+
+    // The next passes are ordered by the cost of a sample of the whole tile.
+    for (size_t tile = 0; tile < _tiles.size(); ++tile) {
+        uint64_t pixel_samples = _passSamples[tile];
+        if (pixel_samples == 0) {
+            continue;
+        }
+        const WorkItem& bounds = _tiles[tile];
+        double pixels = double(bounds.x1 - bounds.x0) * (bounds.y1 - bounds.y0);
+        _costs[tile] = double(_passTimes[tile]) / pixel_samples * pixels;
+    }
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
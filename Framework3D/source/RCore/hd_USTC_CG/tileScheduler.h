@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "USTC_CG.h"
+#include "pxr/pxr.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Spreads the tiles of a render pass over the worker threads.
+ *
+ * The time spent on every tile is measured and kept for the next passes, which start with the
+ * tiles that were the most expensive. Tiles much more expensive than the others (glass, caustics)
+ * are split so that they don't keep a single thread busy at the end of the pass. The work is dealt
+ * to one queue per worker; a worker that runs out takes the cheapest work left in the others.
+ *
+ * Which thread renders a pixel doesn't change the image, since the samplers only depend on the
+ * pixel and sample index.
+ */
+class Hd_USTC_CG_TileScheduler {
+   public:
+    // Pixels [x0, x1) x [y0, y1) of a tile, or of a part of it.
+    struct WorkItem {
+        unsigned tile;
+        unsigned x0, y0, x1, y1;
+
+        bool operator==(const WorkItem& other) const = default;
+    };
+
+    // Start a pass over the given tiles, indexed by WorkItem::tile. The costs measured in the
+    // previous passes are kept as long as the tiles stay the same.
+    void BeginPass(const std::vector<WorkItem>& tiles);
+
+    // Call fn(item, worker) on all worker threads until every pixel of the tiles went through it
+    // once, or stop() returns true. worker is in [0, GetWorkerCount()), and no two calls with the
+    // same worker run at the same time. samples is the number of samples fn takes per pixel, to
+    // compare the costs of passes that take different numbers.
+    void Run(
+        unsigned samples,
+        const std::function<void(const WorkItem&, unsigned)>& fn,
+        const std::function<bool()>& stop);
+
+    unsigned GetWorkerCount() const;
+    // Milliseconds spent on a tile since BeginPass().
+    float GetTileTime(unsigned tile) const;
+
+   private:
+    // Split item into quadrants until their estimated cost is below split_cost.
+    static void _Split(
+        const WorkItem& item,
+        double cost,
+        double split_cost,
+        std::vector<WorkItem>& items);
+
+    std::vector<WorkItem> _tiles;
+    // Estimated nanoseconds per sample of each tile, 0 until measured.
+    std::vector<double> _costs;
+    // Nanoseconds spent and pixel samples taken on each tile in this pass.
+    std::vector<std::atomic<uint64_t>> _passTimes;
+    std::vector<std::atomic<uint64_t>> _passSamples;
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,383 @@
+// Renderer benchmark: renders the reference scenes of benchmarkScenes.h at a fixed seed and sample
+// count, and reports where the time goes, the ray throughput and the error against reference
+// images.
+//
+// A reference is the same scene rendered at the same seed with --reference-spp samples per pixel.
+// Missing references are rendered (outside of the measured time) and stored, so the first run
+// creates them and later builds are compared against them; --update-references renders them
+// again, e.g. after a change that is meant to alter the images.
+//
+//   hd_USTC_CG_benchmark --spp 64 --references bench/references
+//   hd_USTC_CG_benchmark --spp 64 --references bench/references --max-rmse 0.02
+//
+// Ray rates are taken over the trace time only, the sample rate over the whole render.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmarkScenes.h"
+#include "offlineRenderer.h"
+#include "pxr/base/gf/half.h"
+#include "pxr/base/tf/errorMark.h"
+#include "pxr/base/tf/fileUtils.h"
+#include "pxr/base/tf/getenv.h"
+#include "pxr/base/tf/setenv.h"
+#include "pxr/base/tf/stringUtils.h"
+#include "pxr/imaging/hio/image.h"
+#include "pxr/imaging/hio/types.h"
+#include "renderParam.h"
+
+using namespace USTC_CG;
+using namespace pxr;
+
+static void _PrintUsage(const char* program)
+{
+    std::cerr
+        << "Usage: " << program << " [options] [scene names...]\n"
+        << "  --scenes <dir>          Where the reference scenes are written (default\n"
+        << "                          hd_USTC_CG_benchmark).\n"
+        << "  --references <dir>      Reference images to compute the RMSE against (default\n"
+        << "                          <scenes>/references). Missing ones are rendered and\n"
+        << "                          stored there.\n"
+        << "  --reference-spp <n>     Samples per pixel of the references (default 1024).\n"
+        << "  --update-references     Render all the references again.\n"
+        << "  --output <dir>          Also write the renders to <dir>/<scene>.exr.\n"
+        << "  --width <n>             Image width (default 640).\n"
+        << "  --height <n>            Image height (default 360).\n"
+        << "  --spp <n>               Samples per pixel (default 64).\n"
+        << "  --seed <n>              Sampler seed (default 0).\n"
+        << "  --csv <file>            Also write the results as CSV.\n"
+        << "  --max-rmse <x>          Fail if the RMSE of any scene is above x.\n";
+}
+
+// Reads a float image, top row first. Returns false if it can't be read or is not float RGB(A).
+static bool _ReadImage(
+    const std::string& filename,
+    int& width,
+    int& height,
+    std::vector<GfVec4f>& pixels)
+{
+    HioImageSharedPtr image = HioImage::OpenForReading(filename);
+    if (!image) {
+        return false;
+    }
+    width = image->GetWidth();
+    height = image->GetHeight();
+    const HioFormat format = image->GetFormat();
+    const int channels = HioGetComponentCount(format);
+    const HioType type = HioGetHioType(format);
+    if ((type != HioTypeFloat && type != HioTypeHalfFloat) || channels < 3) {
+        TF_RUNTIME_ERROR("'%s' is not a float RGB(A) image", filename.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> data(size_t(width) * height * HioGetDataSizeOfFormat(format));
+    HioImage::StorageSpec storage;
+    storage.width = width;
+    storage.height = height;
+    storage.format = format;
+    storage.flipped = false;
+    storage.data = data.data();
+    if (!image->Read(storage)) {
+        return false;
+    }
+
+    pixels.assign(size_t(width) * height, GfVec4f(0, 0, 0, 1));
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        for (int c = 0; c < std::min(channels, 4); ++c) {
+            const size_t index = i * channels + c;
+            pixels[i][c] = type == HioTypeFloat ? reinterpret_cast<const float*>(data.data())[index]
+                                                : float(reinterpret_cast<const GfHalf*>(
+                                                      data.data())[index]);
+        }
+    }
+    return true;
+}
+
+// Root mean square error of the RGB channels.
+static double _RMSE(const std::vector<GfVec4f>& image, const std::vector<GfVec4f>& reference)
+{
+    double sum = 0;
+    for (size_t i = 0; i < image.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            const double difference = double(image[i][c]) - reference[i][c];
+            sum += difference * difference;
+        }
+    }
+    return std::sqrt(sum / std::max<size_t>(image.size() * 3, 1));
+}
+
+// Opens a benchmark scene through its camera. Returns false if it can't be loaded.
+static bool _OpenScene(
+    Hd_USTC_CG_OfflineRenderer& renderer,
+    const Hd_USTC_CG_BenchmarkScene& scene,
+    int width,
+    int height,
+    int spp)
+{
+    renderer.SetResolution(width, height);
+    if (!renderer.Open(scene.path) || !renderer.SetCameraPath(SdfPath("/camera"))) {
+        return false;
+    }
+    renderer.SetSamplesPerPixel(spp);
+    return true;
+}
+
+struct BenchmarkResult {
+    std::string scene;
+    double wall_ms = 0;
+    double sync_ms = 0;
+    double prototype_bvh_ms = 0;
+    double top_level_bvh_ms = 0;
+    double trace_ms = 0;
+    uint64_t camera_rays = 0;
+    uint64_t rays = 0;
+    // Negative when the reference could not be read or rendered.
+    double rmse = -1;
+};
+
+int main(int argc, char* argv[])
+{
+    TfErrorMark mark;
+
+    std::string scene_dir = "hd_USTC_CG_benchmark";
+    std::string reference_dir;
+    std::string output_dir;
+    std::string csv;
+    bool update_references = false;
+    int width = 640, height = 360, spp = 64, seed = 0, reference_spp = 1024;
+    double max_rmse = -1;
+    std::vector<std::string> only;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "--scenes" && has_value) {
+                scene_dir = argv[++i];
+            }
+            else if (arg == "--references" && has_value) {
+                reference_dir = argv[++i];
+            }
+            else if (arg == "--reference-spp" && has_value) {
+                reference_spp = std::stoi(argv[++i]);
+            }
+            else if (arg == "--update-references") {
+                update_references = true;
+            }
+            else if (arg == "--output" && has_value) {
+                output_dir = argv[++i];
+            }
+            else if (arg == "--width" && has_value) {
+                width = std::stoi(argv[++i]);
+            }
+            else if (arg == "--height" && has_value) {
+                height = std::stoi(argv[++i]);
+            }
+            else if (arg == "--spp" && has_value) {
+                spp = std::stoi(argv[++i]);
+            }
+            else if (arg == "--seed" && has_value) {
+                seed = std::stoi(argv[++i]);
+            }
+            else if (arg == "--csv" && has_value) {
+                csv = argv[++i];
+            }
+            else if (arg == "--max-rmse" && has_value) {
+                max_rmse = std::stod(argv[++i]);
+            }
+            else if (arg == "-h" || arg == "--help") {
+                _PrintUsage(argv[0]);
+                return EXIT_SUCCESS;
+            }
+            else if (arg[0] != '-') {
+                only.push_back(arg);
+            }
+            else {
+                std::cerr << "Unknown argument '" << arg << "'\n";
+                _PrintUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        catch (const std::exception&) {
+            std::cerr << "Invalid value for '" << arg << "'\n";
+            return EXIT_FAILURE;
+        }
+    }
+    if (width <= 0 || height <= 0 || spp <= 0 || reference_spp <= 0 || seed < 0) {
+        _PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (reference_dir.empty()) {
+        reference_dir = scene_dir + "/references";
+    }
+
+    // Hd_USTC_CG_Config reads the environment once, before the first render. The seed is always
+    // fixed; adaptive sampling and denoising change what is measured, so they are off unless asked
+    // for explicitly.
+    TfSetenv("HDEMBREE_RANDOM_SEED", std::to_string(seed));
+    for (const char* setting : { "HDEMBREE_ADAPTIVE_ERROR_THRESHOLD", "HDEMBREE_DENOISE" }) {
+        if (TfGetenv(setting).empty()) {
+            TfSetenv(setting, "0");
+        }
+    }
+
+    std::vector<Hd_USTC_CG_BenchmarkScene> scenes = Hd_USTC_CG_WriteBenchmarkScenes(scene_dir);
+    if (scenes.empty()) {
+        return EXIT_FAILURE;
+    }
+    if (!only.empty()) {
+        scenes.erase(
+            std::remove_if(
+                scenes.begin(),
+                scenes.end(),
+                [&](const Hd_USTC_CG_BenchmarkScene& scene) {
+                    return std::find(only.begin(), only.end(), scene.name) == only.end();
+                }),
+            scenes.end());
+    }
+    for (const std::string& dir : { reference_dir, output_dir }) {
+        if (!dir.empty() && !TfIsDir(dir) && !TfMakeDirs(dir)) {
+            TF_RUNTIME_ERROR("Could not create '%s'", dir.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool failed = false;
+    std::vector<BenchmarkResult> results;
+    for (const Hd_USTC_CG_BenchmarkScene& scene : scenes) {
+        // A renderer per scene, so that the counters and BVH build times are the scene's own.
+        Hd_USTC_CG_OfflineRenderer renderer;
+        if (!_OpenScene(renderer, scene, width, height, spp)) {
+            failed = true;
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        renderer.Render(UsdTimeCode::Default());
+        const double wall_ms = std::chrono::duration<double, std::milli>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+
+        const Hd_USTC_CG_RenderStatistics& statistics = *renderer.GetStatistics();
+        BenchmarkResult result;
+        result.scene = scene.name;
+        result.wall_ms = wall_ms;
+        result.prototype_bvh_ms = statistics.prototypeBuildTime.load() / 1000.0;
+        result.top_level_bvh_ms = statistics.topLevelBuildTime.load() / 1000.0;
+        result.trace_ms = statistics.traceTime.load() / 1000.0;
+        // Whatever is not BVH builds or tracing: scene sync, render thread hand-offs and resolve.
+        result.sync_ms = std::max(
+            wall_ms - result.prototype_bvh_ms - result.top_level_bvh_ms - result.trace_ms, 0.0);
+        result.camera_rays = statistics.cameraRays.load();
+        result.rays = statistics.rays.load();
+
+        const std::string reference = reference_dir + "/" + scene.name + ".exr";
+        if (update_references || !TfIsFile(reference)) {
+            // Rendered after the measured render, so that it doesn't warm any cache for it. The
+            // seed is the same, so the reference only depends on the build and the settings.
+            Hd_USTC_CG_OfflineRenderer reference_renderer;
+            if (!_OpenScene(reference_renderer, scene, width, height, reference_spp)) {
+                failed = true;
+            }
+            else {
+                reference_renderer.Render(UsdTimeCode::Default());
+                failed |= !reference_renderer.Write(reference);
+                result.rmse = _RMSE(renderer.GetColor(), reference_renderer.GetColor());
+            }
+        }
+        else {
+            int reference_width, reference_height;
+            std::vector<GfVec4f> reference_pixels;
+            if (!_ReadImage(reference, reference_width, reference_height, reference_pixels)) {
+                failed = true;
+            }
+            else if (reference_width != width || reference_height != height) {
+                TF_RUNTIME_ERROR(
+                    "'%s' is %dx%d, but the render is %dx%d, use --update-references",
+                    reference.c_str(),
+                    reference_width,
+                    reference_height,
+                    width,
+                    height);
+                failed = true;
+            }
+            else {
+                result.rmse = _RMSE(renderer.GetColor(), reference_pixels);
+            }
+        }
+        failed |= max_rmse >= 0 && result.rmse > max_rmse;
+        if (!output_dir.empty()) {
+            failed |= !renderer.Write(output_dir + "/" + scene.name + ".exr");
+        }
+        results.push_back(result);
+    }
+
+    const double pixels = double(width) * height;
+    std::printf(
+        "%dx%d, %d spp, seed %d, references at %d spp\n\n"
+        "%-10s %9s %9s %9s %9s %9s %12s %12s %12s %10s\n",
+        width,
+        height,
+        spp,
+        seed,
+        reference_spp,
+        "scene",
+        "wall ms",
+        "sync ms",
+        "blas ms",
+        "tlas ms",
+        "trace ms",
+        "Mcamera/s",
+        "Mrays/s",
+        "Msamples/s",
+        "RMSE");
+    for (const BenchmarkResult& result : results) {
+        const double trace_s = std::max(result.trace_ms, 1e-3) / 1000;
+        std::printf(
+            "%-10s %9.1f %9.1f %9.1f %9.1f %9.1f %12.3f %12.3f %12.3f %10s\n",
+            result.scene.c_str(),
+            result.wall_ms,
+            result.sync_ms,
+            result.prototype_bvh_ms,
+            result.top_level_bvh_ms,
+            result.trace_ms,
+            result.camera_rays / trace_s * 1e-6,
+            result.rays / trace_s * 1e-6,
+            pixels * spp / (result.wall_ms / 1000) * 1e-6,
+            result.rmse < 0 ? "-" : TfStringPrintf("%.5f", result.rmse).c_str());
+    }
+
+    if (!csv.empty()) {
+        std::ofstream file(csv);
+        file << "scene,width,height,spp,seed,wall_ms,sync_ms,prototype_bvh_ms,top_level_bvh_ms,"
+                "trace_ms,camera_rays,rays,rmse\n";
+        for (const BenchmarkResult& result : results) {
+            file << TfStringPrintf(
+                "%s,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%llu,%llu,%s\n",
+                result.scene.c_str(),
+                width,
+                height,
+                spp,
+                seed,
+                result.wall_ms,
+                result.sync_ms,
+                result.prototype_bvh_ms,
+                result.top_level_bvh_ms,
+                result.trace_ms,
+                (unsigned long long)result.camera_rays,
+                (unsigned long long)result.rays,
+                result.rmse < 0 ? "" : TfStringPrintf("%.6f", result.rmse).c_str());
+        }
+        failed |= !file;
+    }
+
+    return failed || !mark.IsClean() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
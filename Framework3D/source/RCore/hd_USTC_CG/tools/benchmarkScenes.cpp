@@ -0,0 +1,508 @@
+#include "benchmarkScenes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/gf/quath.h"
+#include "pxr/base/gf/range3f.h"
+#include "pxr/base/gf/rotation.h"
+#include "pxr/base/gf/vec4f.h"
+#include "pxr/base/tf/diagnostic.h"
+#include "pxr/base/tf/fileUtils.h"
+#include "pxr/base/tf/stringUtils.h"
+#include "pxr/imaging/hio/image.h"
+#include "pxr/usd/sdf/types.h"
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/camera.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/pointInstancer.h"
+#include "pxr/usd/usdGeom/primvarsAPI.h"
+#include "pxr/usd/usdGeom/xformCommonAPI.h"
+#include "pxr/usd/usdLux/distantLight.h"
+#include "pxr/usd/usdLux/domeLight.h"
+#include "pxr/usd/usdLux/rectLight.h"
+#include "pxr/usd/usdLux/sphereLight.h"
+#include "pxr/usd/usdShade/material.h"
+#include "pxr/usd/usdShade/materialBindingAPI.h"
+#include "pxr/usd/usdShade/shader.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+namespace {
+
+struct MeshData {
+    VtVec3fArray points;
+    VtVec3fArray normals;
+    VtVec2fArray st;
+    VtIntArray counts;
+    VtIntArray indices;
+};
+
+// Fixed sequence of numbers in [0, 1), so that the scenes are the same on every platform.
+class SceneRandom {
+   public:
+    explicit SceneRandom(uint32_t seed) : state_(seed)
+    {
+    }
+
+    float operator()()
+    {
+        state_ = state_ * 1664525u + 1013904223u;
+        return float(state_ >> 8) / float(1u << 24);
+    }
+
+   private:
+    uint32_t state_;
+};
+
+}  // namespace
+
+// A quad facing the side from which p0, p1, p2, p3 turn counterclockwise.
+static void _AppendQuad(
+    MeshData& mesh,
+    const GfVec3f& p0,
+    const GfVec3f& p1,
+    const GfVec3f& p2,
+    const GfVec3f& p3,
+    float uv_scale = 1)
+{
+    const int base = int(mesh.points.size());
+    const GfVec3f normal = GfCross(p1 - p0, p3 - p0).GetNormalized();
+    const GfVec3f corners[4] = { p0, p1, p2, p3 };
+    const GfVec2f uvs[4] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+    for (int i = 0; i < 4; ++i) {
+        mesh.points.push_back(corners[i]);
+        mesh.normals.push_back(normal);
+        mesh.st.push_back(uvs[i] * uv_scale);
+        mesh.indices.push_back(base + i);
+    }
+    mesh.counts.push_back(4);
+}
+
+static void _AppendBox(
+    MeshData& mesh,
+    const GfVec3f& center,
+    const GfVec3f& half_size,
+    float rotate_y = 0)
+{
+    const GfMatrix4d transform =
+        GfMatrix4d().SetRotate(GfRotation(GfVec3d(0, 1, 0), rotate_y)) *
+        GfMatrix4d().SetTranslate(GfVec3d(center));
+    for (int axis = 0; axis < 3; ++axis) {
+        for (float sign : { -1.0f, 1.0f }) {
+            // (u, v, axis) is right handed for the +axis face, and swapped for the -axis one.
+            int u = (axis + 1) % 3, v = (axis + 2) % 3;
+            if (sign < 0) {
+                std::swap(u, v);
+            }
+            GfVec3f face(0), du(0), dv(0);
+            face[axis] = sign * half_size[axis];
+            du[u] = half_size[u];
+            dv[v] = half_size[v];
+            _AppendQuad(
+                mesh,
+                GfVec3f(transform.Transform(face - du - dv)),
+                GfVec3f(transform.Transform(face + du - dv)),
+                GfVec3f(transform.Transform(face + du + dv)),
+                GfVec3f(transform.Transform(face - du + dv)));
+        }
+    }
+}
+
+static void _AppendSphere(
+    MeshData& mesh,
+    const GfVec3f& center,
+    float radius,
+    int rings = 32,
+    int segments = 64)
+{
+    const int base = int(mesh.points.size());
+    for (int i = 0; i <= rings; ++i) {
+        const float theta = float(M_PI) * i / rings;
+        for (int j = 0; j <= segments; ++j) {
+            const float phi = 2 * float(M_PI) * j / segments;
+            const GfVec3f normal(
+                std::sin(theta) * std::cos(phi), std::cos(theta), -std::sin(theta) * std::sin(phi));
+            mesh.points.push_back(center + radius * normal);
+            mesh.normals.push_back(normal);
+            mesh.st.push_back(GfVec2f(float(j) / segments, 1 - float(i) / rings));
+        }
+    }
+    // The quads touching the poles are degenerate on one side, which is harmless.
+    for (int i = 0; i < rings; ++i) {
+        for (int j = 0; j < segments; ++j) {
+            const int a = base + i * (segments + 1) + j;
+            const int b = a + segments + 1;
+            mesh.indices.push_back(a);
+            mesh.indices.push_back(b);
+            mesh.indices.push_back(b + 1);
+            mesh.indices.push_back(a + 1);
+            mesh.counts.push_back(4);
+        }
+    }
+}
+
+static UsdGeomMesh _DefineMesh(
+    const UsdStageRefPtr& stage,
+    const SdfPath& path,
+    const MeshData& data,
+    const UsdShadeMaterial& material)
+{
+    UsdGeomMesh mesh = UsdGeomMesh::Define(stage, path);
+    mesh.CreatePointsAttr(VtValue(data.points));
+    mesh.CreateNormalsAttr(VtValue(data.normals));
+    mesh.SetNormalsInterpolation(UsdGeomTokens->vertex);
+    mesh.CreateFaceVertexCountsAttr(VtValue(data.counts));
+    mesh.CreateFaceVertexIndicesAttr(VtValue(data.indices));
+    mesh.CreateSubdivisionSchemeAttr(VtValue(UsdGeomTokens->none));
+
+    GfRange3f bounds;
+    for (const GfVec3f& point : data.points) {
+        bounds.UnionWith(point);
+    }
+    mesh.CreateExtentAttr(VtValue(VtVec3fArray{ bounds.GetMin(), bounds.GetMax() }));
+
+    UsdGeomPrimvarsAPI(mesh)
+        .CreatePrimvar(TfToken("st"), SdfValueTypeNames->TexCoord2fArray, UsdGeomTokens->vertex)
+        .Set(data.st);
+    if (material) {
+        UsdShadeMaterialBindingAPI::Apply(mesh.GetPrim()).Bind(material);
+    }
+    return mesh;
+}
+
+// A UsdPreviewSurface, with the diffuse color read from a texture if one is given.
+static UsdShadeMaterial _DefineMaterial(
+    const UsdStageRefPtr& stage,
+    const SdfPath& path,
+    const GfVec3f& diffuse_color,
+    float roughness,
+    float metallic,
+    const std::string& texture = std::string())
+{
+    UsdShadeMaterial material = UsdShadeMaterial::Define(stage, path);
+    UsdShadeShader surface = UsdShadeShader::Define(stage, path.AppendChild(TfToken("surface")));
+    surface.CreateIdAttr(VtValue(TfToken("UsdPreviewSurface")));
+    surface.CreateInput(TfToken("roughness"), SdfValueTypeNames->Float).Set(roughness);
+    surface.CreateInput(TfToken("metallic"), SdfValueTypeNames->Float).Set(metallic);
+    UsdShadeInput diffuse =
+        surface.CreateInput(TfToken("diffuseColor"), SdfValueTypeNames->Color3f);
+
+    if (texture.empty()) {
+        diffuse.Set(diffuse_color);
+    }
+    else {
+        UsdShadeShader reader =
+            UsdShadeShader::Define(stage, path.AppendChild(TfToken("stReader")));
+        reader.CreateIdAttr(VtValue(TfToken("UsdPrimvarReader_float2")));
+        reader.CreateInput(TfToken("varname"), SdfValueTypeNames->Token).Set(TfToken("st"));
+        reader.CreateOutput(TfToken("result"), SdfValueTypeNames->Float2);
+
+        UsdShadeShader image =
+            UsdShadeShader::Define(stage, path.AppendChild(TfToken("diffuseTexture")));
+        image.CreateIdAttr(VtValue(TfToken("UsdUVTexture")));
+        image.CreateInput(TfToken("file"), SdfValueTypeNames->Asset).Set(SdfAssetPath(texture));
+        image.CreateInput(TfToken("sourceColorSpace"), SdfValueTypeNames->Token)
+            .Set(TfToken("sRGB"));
+        image.CreateInput(TfToken("wrapS"), SdfValueTypeNames->Token).Set(TfToken("repeat"));
+        image.CreateInput(TfToken("wrapT"), SdfValueTypeNames->Token).Set(TfToken("repeat"));
+        image.CreateInput(TfToken("st"), SdfValueTypeNames->Float2)
+            .ConnectToSource(reader.ConnectableAPI(), TfToken("result"));
+        image.CreateOutput(TfToken("rgb"), SdfValueTypeNames->Float3);
+        diffuse.ConnectToSource(image.ConnectableAPI(), TfToken("rgb"));
+    }
+
+    material.CreateSurfaceOutput().ConnectToSource(surface.ConnectableAPI(), TfToken("surface"));
+    return material;
+}
+
+static void _DefineCamera(const UsdStageRefPtr& stage, const GfVec3d& eye, const GfVec3d& target)
+{
+    UsdGeomCamera camera = UsdGeomCamera::Define(stage, SdfPath("/camera"));
+    camera.CreateFocalLengthAttr(VtValue(35.0f));
+    camera.CreateHorizontalApertureAttr(VtValue(36.0f));
+    camera.CreateVerticalApertureAttr(VtValue(20.25f));
+    GfMatrix4d view;
+    view.SetLookAt(eye, target, GfVec3d(0, 1, 0));
+    camera.AddTransformOp().Set(view.GetInverse());
+}
+
+static UsdStageRefPtr _NewStage()
+{
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomSetStageUpAxis(stage, UsdGeomTokens->y);
+    return stage;
+}
+
+static bool _WriteChecker(const std::string& filename)
+{
+    const int size = 256, squares = 8;
+    std::vector<uint8_t> pixels(size * size * 4);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const bool odd = ((x * squares / size) + (y * squares / size)) % 2;
+            uint8_t* pixel = &pixels[(y * size + x) * 4];
+            pixel[0] = odd ? 230 : 40;
+            pixel[1] = odd ? 220 : 60;
+            pixel[2] = odd ? 200 : 90;
+            pixel[3] = 255;
+        }
+    }
+
+    HioImageSharedPtr image = HioImage::OpenForWriting(filename);
+    HioImage::StorageSpec storage;
+    storage.width = size;
+    storage.height = size;
+    storage.format = HioFormatUNorm8Vec4srgb;
+    storage.flipped = false;
+    storage.data = pixels.data();
+    return image && image->Write(storage);
+}
+
+// Latitude-longitude sky: a gradient from the horizon to the zenith, a dark ground, and a sun.
+static bool _WriteSky(const std::string& filename)
+{
+    const int width = 512, height = 256;
+    const GfVec3f zenith(0.25f, 0.45f, 1.0f), horizon(1.0f, 0.9f, 0.75f);
+    const GfVec3f ground(0.2f, 0.18f, 0.16f);
+    const GfVec2f sun(0.3f, 0.22f);
+    std::vector<GfVec4f> pixels(width * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const float u = (x + 0.5f) / width, v = (y + 0.5f) / height;
+            GfVec3f color = v < 0.5f ? horizon + (zenith - horizon) * (1 - 2 * v) : ground;
+            if ((GfVec2f(u, v) - sun).GetLength() < 0.01f) {
+                color = GfVec3f(200.0f, 180.0f, 150.0f);
+            }
+            pixels[y * width + x] = GfVec4f(color[0], color[1], color[2], 1);
+        }
+    }
+
+    HioImageSharedPtr image = HioImage::OpenForWriting(filename);
+    HioImage::StorageSpec storage;
+    storage.width = width;
+    storage.height = height;
+    storage.format = HioFormatFloat32Vec4;
+    storage.flipped = false;
+    storage.data = pixels.data();
+    return image && image->Write(storage);
+}
+
+static UsdStageRefPtr _CornellScene()
+{
+    UsdStageRefPtr stage = _NewStage();
+    auto white = _DefineMaterial(stage, SdfPath("/materials/white"), GfVec3f(0.73f), 0.8f, 0);
+    auto red =
+        _DefineMaterial(stage, SdfPath("/materials/red"), GfVec3f(0.65f, 0.05f, 0.05f), 0.8f, 0);
+    auto green =
+        _DefineMaterial(stage, SdfPath("/materials/green"), GfVec3f(0.12f, 0.45f, 0.15f), 0.8f, 0);
+    auto mirror = _DefineMaterial(stage, SdfPath("/materials/mirror"), GfVec3f(0.9f), 0, 1);
+
+    // The room spans [-1, 1] x [0, 2] x [-1, 1] and is open towards +z, where the camera is.
+    MeshData walls;
+    _AppendQuad(walls, { -1, 0, -1 }, { -1, 0, 1 }, { 1, 0, 1 }, { 1, 0, -1 });
+    _AppendQuad(walls, { -1, 2, -1 }, { 1, 2, -1 }, { 1, 2, 1 }, { -1, 2, 1 });
+    _AppendQuad(walls, { -1, 0, -1 }, { 1, 0, -1 }, { 1, 2, -1 }, { -1, 2, -1 });
+    _DefineMesh(stage, SdfPath("/room/walls"), walls, white);
+
+    MeshData left, right;
+    _AppendQuad(left, { -1, 0, -1 }, { -1, 2, -1 }, { -1, 2, 1 }, { -1, 0, 1 });
+    _AppendQuad(right, { 1, 0, -1 }, { 1, 0, 1 }, { 1, 2, 1 }, { 1, 2, -1 });
+    _DefineMesh(stage, SdfPath("/room/left"), left, red);
+    _DefineMesh(stage, SdfPath("/room/right"), right, green);
+
+    MeshData boxes, sphere;
+    _AppendBox(boxes, { -0.35f, 0.6f, -0.35f }, { 0.3f, 0.6f, 0.3f }, 18);
+    _AppendBox(boxes, { 0.4f, 0.3f, 0.35f }, { 0.3f, 0.3f, 0.3f }, -18);
+    _AppendSphere(sphere, { 0.4f, 0.9f, 0.35f }, 0.3f);
+    _DefineMesh(stage, SdfPath("/room/boxes"), boxes, white);
+    _DefineMesh(stage, SdfPath("/room/sphere"), sphere, mirror);
+
+    // Rect lights emit towards -z; turn it to face the floor.
+    UsdLuxRectLight light = UsdLuxRectLight::Define(stage, SdfPath("/lights/ceiling"));
+    light.CreateWidthAttr(VtValue(0.5f));
+    light.CreateHeightAttr(VtValue(0.5f));
+    light.CreateIntensityAttr(VtValue(30.0f));
+    light.CreateColorAttr(VtValue(GfVec3f(1.0f, 0.85f, 0.6f)));
+    UsdGeomXformCommonAPI(light.GetPrim()).SetTranslate(GfVec3d(0, 1.99, 0));
+    UsdGeomXformCommonAPI(light.GetPrim()).SetRotate(GfVec3f(-90, 0, 0));
+
+    _DefineCamera(stage, GfVec3d(0, 1, 3.9), GfVec3d(0, 1, 0));
+    return stage;
+}
+
+static UsdStageRefPtr _DomeScene()
+{
+    UsdStageRefPtr stage = _NewStage();
+    auto checker =
+        _DefineMaterial(stage, SdfPath("/materials/checker"), GfVec3f(1), 0.8f, 0, "./checker.png");
+    auto metal =
+        _DefineMaterial(stage, SdfPath("/materials/metal"), GfVec3f(0.95f, 0.7f, 0.4f), 0.3f, 1);
+    auto mirror = _DefineMaterial(stage, SdfPath("/materials/mirror"), GfVec3f(0.9f), 0, 1);
+    auto plastic =
+        _DefineMaterial(stage, SdfPath("/materials/plastic"), GfVec3f(0.7f, 0.1f, 0.1f), 0.5f, 0);
+
+    MeshData ground;
+    _AppendQuad(ground, { -10, 0, -10 }, { -10, 0, 10 }, { 10, 0, 10 }, { 10, 0, -10 }, 10);
+    _DefineMesh(stage, SdfPath("/geometry/ground"), ground, checker);
+
+    const UsdShadeMaterial sphere_materials[] = { checker, metal, mirror, plastic, checker };
+    for (int i = 0; i < 5; ++i) {
+        MeshData sphere;
+        _AppendSphere(sphere, { -2.4f + 1.2f * i, 0.5f, 0 }, 0.5f);
+        _DefineMesh(
+            stage,
+            SdfPath(TfStringPrintf("/geometry/sphere_%d", i)),
+            sphere,
+            sphere_materials[i]);
+    }
+
+    UsdLuxDomeLight dome = UsdLuxDomeLight::Define(stage, SdfPath("/lights/sky"));
+    dome.CreateTextureFileAttr(VtValue(SdfAssetPath("./sky.exr")));
+    dome.CreateIntensityAttr(VtValue(1.0f));
+
+    _DefineCamera(stage, GfVec3d(0, 1.5, 6), GfVec3d(0, 0.6, 0));
+    return stage;
+}
+
+static UsdStageRefPtr _ManyLightsScene()
+{
+    UsdStageRefPtr stage = _NewStage();
+    auto floor = _DefineMaterial(stage, SdfPath("/materials/floor"), GfVec3f(0.5f), 0.9f, 0);
+    auto diffuse = _DefineMaterial(stage, SdfPath("/materials/diffuse"), GfVec3f(0.8f), 0.8f, 0);
+    auto metal = _DefineMaterial(stage, SdfPath("/materials/metal"), GfVec3f(0.9f), 0.25f, 1);
+
+    MeshData ground;
+    _AppendQuad(ground, { -8, 0, -8 }, { -8, 0, 8 }, { 8, 0, 8 }, { 8, 0, -8 });
+    _DefineMesh(stage, SdfPath("/geometry/ground"), ground, floor);
+
+    MeshData diffuse_spheres, metal_spheres;
+    for (int i = 0; i < 7; ++i) {
+        for (int j = 0; j < 7; ++j) {
+            _AppendSphere(
+                (i + j) % 3 ? diffuse_spheres : metal_spheres,
+                { -3.6f + 1.2f * i, 0.35f, -3.6f + 1.2f * j },
+                0.35f,
+                16,
+                32);
+        }
+    }
+    _DefineMesh(stage, SdfPath("/geometry/diffuseSpheres"), diffuse_spheres, diffuse);
+    _DefineMesh(stage, SdfPath("/geometry/metalSpheres"), metal_spheres, metal);
+
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            const int index = i * 8 + j;
+            UsdLuxSphereLight light = UsdLuxSphereLight::Define(
+                stage, SdfPath(TfStringPrintf("/lights/light_%02d", index)));
+            light.CreateRadiusAttr(VtValue(0.05f));
+            light.CreateIntensityAttr(VtValue(20.0f));
+            // Walk around the hue circle.
+            const float hue = index / 64.0f * 2 * float(M_PI);
+            light.CreateColorAttr(VtValue(GfVec3f(
+                0.5f + 0.5f * std::cos(hue),
+                0.5f + 0.5f * std::cos(hue - 2.094f),
+                0.5f + 0.5f * std::cos(hue + 2.094f))));
+            UsdGeomXformCommonAPI(light.GetPrim())
+                .SetTranslate(GfVec3d(-5.25 + 1.5 * i, 2.2, -5.25 + 1.5 * j));
+        }
+    }
+
+    _DefineCamera(stage, GfVec3d(0, 5, 9), GfVec3d(0, 0, 0));
+    return stage;
+}
+
+static UsdStageRefPtr _InstancedScene()
+{
+    UsdStageRefPtr stage = _NewStage();
+    auto floor = _DefineMaterial(stage, SdfPath("/materials/floor"), GfVec3f(0.6f), 0.9f, 0);
+    auto clay =
+        _DefineMaterial(stage, SdfPath("/materials/clay"), GfVec3f(0.8f, 0.5f, 0.35f), 0.7f, 0);
+    auto metal = _DefineMaterial(stage, SdfPath("/materials/metal"), GfVec3f(0.9f), 0.3f, 1);
+
+    MeshData ground;
+    _AppendQuad(ground, { -40, 0, -40 }, { -40, 0, 40 }, { 40, 0, 40 }, { 40, 0, -40 });
+    _DefineMesh(stage, SdfPath("/geometry/ground"), ground, floor);
+
+    UsdGeomPointInstancer instancer =
+        UsdGeomPointInstancer::Define(stage, SdfPath("/geometry/instancer"));
+    MeshData sphere, box;
+    _AppendSphere(sphere, { 0, 0.5f, 0 }, 0.5f, 16, 32);
+    _AppendBox(box, { 0, 0.5f, 0 }, { 0.5f, 0.5f, 0.5f });
+    const SdfPath prototypes = instancer.GetPath().AppendChild(TfToken("prototypes"));
+    _DefineMesh(stage, prototypes.AppendChild(TfToken("sphere")), sphere, metal);
+    _DefineMesh(stage, prototypes.AppendChild(TfToken("box")), box, clay);
+    instancer.CreatePrototypesRel().AddTarget(prototypes.AppendChild(TfToken("sphere")));
+    instancer.CreatePrototypesRel().AddTarget(prototypes.AppendChild(TfToken("box")));
+
+    const int grid = 64;
+    SceneRandom random(7);
+    VtIntArray proto_indices;
+    VtVec3fArray positions, scales;
+    VtQuathArray orientations;
+    for (int i = 0; i < grid; ++i) {
+        for (int j = 0; j < grid; ++j) {
+            const float scale = 0.3f + 0.2f * random();
+            proto_indices.push_back(random() < 0.5f ? 0 : 1);
+            positions.push_back(GfVec3f(
+                (i - grid / 2 + random() * 0.5f) * 1.0f,
+                0,
+                (j - grid / 2 + random() * 0.5f) * 1.0f));
+            scales.push_back(GfVec3f(scale));
+            orientations.push_back(
+                GfQuath(GfRotation(GfVec3d(0, 1, 0), 360.0 * random()).GetQuat()));
+        }
+    }
+    instancer.CreateProtoIndicesAttr(VtValue(proto_indices));
+    instancer.CreatePositionsAttr(VtValue(positions));
+    instancer.CreateScalesAttr(VtValue(scales));
+    instancer.CreateOrientationsAttr(VtValue(orientations));
+
+    UsdLuxDistantLight sun = UsdLuxDistantLight::Define(stage, SdfPath("/lights/sun"));
+    sun.CreateAngleAttr(VtValue(0.53f));
+    sun.CreateIntensityAttr(VtValue(3.0f));
+    UsdGeomXformCommonAPI(sun.GetPrim()).SetRotate(GfVec3f(-50, 30, 0));
+    UsdLuxDomeLight sky = UsdLuxDomeLight::Define(stage, SdfPath("/lights/sky"));
+    sky.CreateColorAttr(VtValue(GfVec3f(0.4f, 0.5f, 0.7f)));
+    sky.CreateIntensityAttr(VtValue(0.5f));
+
+    _DefineCamera(stage, GfVec3d(0, 12, 40), GfVec3d(0, 0, 0));
+    return stage;
+}
+
+std::vector<Hd_USTC_CG_BenchmarkScene> Hd_USTC_CG_WriteBenchmarkScenes(
+    const std::string& directory)
+{
+    if (!TfIsDir(directory) && !TfMakeDirs(directory)) {
+        TF_RUNTIME_ERROR("Could not create '%s'", directory.c_str());
+        return {};
+    }
+    if (!_WriteChecker(directory + "/checker.png") || !_WriteSky(directory + "/sky.exr")) {
+        TF_RUNTIME_ERROR("Could not write the benchmark textures to '%s'", directory.c_str());
+        return {};
+    }
+
+    const std::pair<const char*, UsdStageRefPtr (*)()> builders[] = {
+        { "cornell", _CornellScene },
+        { "dome", _DomeScene },
+        { "lights", _ManyLightsScene },
+        { "instanced", _InstancedScene },
+    };
+    std::vector<Hd_USTC_CG_BenchmarkScene> scenes;
+    for (const auto& [name, build] : builders) {
+        Hd_USTC_CG_BenchmarkScene scene{ name, directory + "/" + name + ".usda" };
+        if (!build()->GetRootLayer()->Export(scene.path)) {
+            TF_RUNTIME_ERROR("Could not write '%s'", scene.path.c_str());
+            return {};
+        }
+        scenes.push_back(scene);
+    }
+    return scenes;
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "USTC_CG.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+
+struct Hd_USTC_CG_BenchmarkScene {
+    std::string name;
+    // Path of the written stage. Every scene has a camera at /camera.
+    std::string path;
+};
+
+/**
+ * \brief Write the reference scenes of the benchmark, and the textures they use, to a directory:
+ *
+ * - cornell: a Cornell box lit by a rect light, with a mirror sphere and two boxes.
+ * - dome: textured spheres on a textured ground, lit by an HDR sky dome.
+ * - lights: a field of spheres under 64 small colored sphere lights.
+ * - instanced: 4096 point-instanced spheres and boxes under a distant light and a dome.
+ *
+ * The scenes are generated rather than stored so that they are always the same, whatever the
+ * checkout. Returns an empty list if they couldn't be written.
+ */
+std::vector<Hd_USTC_CG_BenchmarkScene> Hd_USTC_CG_WriteBenchmarkScenes(
+    const std::string& directory);
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,344 @@
+#include "offlineRenderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/gf/rotation.h"
+#include "pxr/base/tf/hashmap.h"
+#include "pxr/base/tf/pathUtils.h"
+#include "pxr/base/tf/stringUtils.h"
+#include "pxr/imaging/hd/camera.h"
+#include "pxr/imaging/hd/renderBuffer.h"
+#include "pxr/imaging/hd/renderDelegate.h"
+#include "pxr/imaging/hd/renderIndex.h"
+#include "pxr/imaging/hd/rprimCollection.h"
+#include "pxr/imaging/hd/sceneDelegate.h"
+#include "pxr/imaging/hdx/renderTask.h"
+#include "pxr/imaging/hio/image.h"
+#include "pxr/usd/usdGeom/bboxCache.h"
+#include "pxr/usd/usdGeom/camera.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usdImaging/usdImaging/delegate.h"
+#include "renderParam.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Scene delegate of the prims the offline renderer adds next to the stage: the render
+ * task, its render buffer and the free camera. It just hands back the values it was given.
+ */
+class Hd_USTC_CG_OfflineTaskDelegate : public HdSceneDelegate {
+   public:
+    Hd_USTC_CG_OfflineTaskDelegate(HdRenderIndex* render_index, const SdfPath& delegate_id)
+        : HdSceneDelegate(render_index, delegate_id)
+    {
+    }
+
+    void SetValue(const SdfPath& id, const TfToken& key, const VtValue& value)
+    {
+        values_[id][key] = value;
+    }
+    void SetTransform(const SdfPath& id, const GfMatrix4d& transform)
+    {
+        transforms_[id] = transform;
+    }
+    void SetRenderBufferDescriptor(const SdfPath& id, const HdRenderBufferDescriptor& descriptor)
+    {
+        buffer_descriptors_[id] = descriptor;
+    }
+
+    VtValue Get(const SdfPath& id, const TfToken& key) override
+    {
+        auto it = values_.find(id);
+        if (it == values_.end()) {
+            return VtValue();
+        }
+        auto value = it->second.find(key);
+        return value != it->second.end() ? value->second : VtValue();
+    }
+
+    GfMatrix4d GetTransform(const SdfPath& id) override
+    {
+        auto it = transforms_.find(id);
+        return it != transforms_.end() ? it->second : GfMatrix4d(1);
+    }
+
+    VtValue GetCameraParamValue(const SdfPath& id, const TfToken& key) override
+    {
+        return Get(id, key);
+    }
+
+    HdRenderBufferDescriptor GetRenderBufferDescriptor(const SdfPath& id) override
+    {
+        return buffer_descriptors_[id];
+    }
+
+    TfTokenVector GetTaskRenderTags(const SdfPath& task_id) override
+    {
+        VtValue tags = Get(task_id, HdTokens->renderTags);
+        return tags.IsHolding<TfTokenVector>() ? tags.UncheckedGet<TfTokenVector>()
+                                               : TfTokenVector();
+    }
+
+   private:
+    using ValueMap = TfHashMap<TfToken, VtValue, TfToken::HashFunctor>;
+    TfHashMap<SdfPath, ValueMap, SdfPath::Hash> values_;
+    TfHashMap<SdfPath, GfMatrix4d, SdfPath::Hash> transforms_;
+    TfHashMap<SdfPath, HdRenderBufferDescriptor, SdfPath::Hash> buffer_descriptors_;
+};
+
+// The free camera has a 50mm lens on a 24mm high film back (in the tenths of scene units hydra
+// cameras use).
+static constexpr float kFreeCameraFocalLength = 5.0f;
+static constexpr float kFreeCameraVerticalAperture = 2.4f;
+
+static uint8_t _EncodeSRGB(float value)
+{
+    value = std::clamp(value, 0.0f, 1.0f);
+    value = value <= 0.0031308f ? 12.92f * value : 1.055f * std::pow(value, 1 / 2.4f) - 0.055f;
+    return uint8_t(value * 255.0f + 0.5f);
+}
+
+Hd_USTC_CG_OfflineRenderer::Hd_USTC_CG_OfflineRenderer()
+    : render_task_id_("/Hd_USTC_CG_Offline/renderTask"),
+      color_buffer_id_("/Hd_USTC_CG_Offline/colorBuffer"),
+      free_camera_id_("/Hd_USTC_CG_Offline/freeCamera")
+{
+}
+
+Hd_USTC_CG_OfflineRenderer::~Hd_USTC_CG_OfflineRenderer()
+{
+    // The scene delegates remove their prims from the render index, which must outlive them, and
+    // the render delegate goes last.
+    scene_delegate_.reset();
+    task_delegate_.reset();
+    render_index_.reset();
+    if (render_delegate_) {
+        plugin_.DeleteRenderDelegate(render_delegate_);
+    }
+}
+
+bool Hd_USTC_CG_OfflineRenderer::Open(const std::string& stage_path)
+{
+    stage_ = UsdStage::Open(stage_path);
+    if (!stage_) {
+        TF_RUNTIME_ERROR("Could not open stage '%s'", stage_path.c_str());
+        return false;
+    }
+
+    render_delegate_ = plugin_.CreateRenderDelegate();
+    render_index_.reset(HdRenderIndex::New(render_delegate_, HdDriverVector()));
+
+    scene_delegate_ =
+        std::make_unique<UsdImagingDelegate>(render_index_.get(), SdfPath::AbsoluteRootPath());
+    scene_delegate_->Populate(stage_->GetPseudoRoot());
+
+    task_delegate_ = std::make_unique<Hd_USTC_CG_OfflineTaskDelegate>(
+        render_index_.get(), SdfPath("/Hd_USTC_CG_Offline"));
+
+    render_index_->InsertBprim(
+        HdPrimTypeTokens->renderBuffer, task_delegate_.get(), color_buffer_id_);
+    render_index_->InsertSprim(HdPrimTypeTokens->camera, task_delegate_.get(), free_camera_id_);
+    render_index_->InsertTask<HdxRenderTask>(task_delegate_.get(), render_task_id_);
+
+    UsdTimeCode time = stage_->HasAuthoredTimeCodeRange()
+                           ? UsdTimeCode(stage_->GetStartTimeCode())
+                           : UsdTimeCode::Default();
+    UsdGeomBBoxCache bbox_cache(time, { UsdGeomTokens->default_, UsdGeomTokens->render }, true);
+    stage_bounds_ = bbox_cache.ComputeWorldBound(stage_->GetPseudoRoot()).ComputeAlignedRange();
+    if (stage_bounds_.IsEmpty()) {
+        stage_bounds_ = GfRange3d(GfVec3d(-1), GfVec3d(1));
+    }
+
+    camera_id_ = free_camera_id_;
+    task_delegate_->SetValue(
+        render_task_id_,
+        HdTokens->collection,
+        VtValue(HdRprimCollection(HdTokens->geometry, HdReprSelector(HdReprTokens->smoothHull))));
+    task_delegate_->SetValue(
+        render_task_id_,
+        HdTokens->renderTags,
+        VtValue(TfTokenVector{ HdRenderTagTokens->geometry }));
+    _UpdateRenderTask();
+    _UpdateFreeCamera();
+    return true;
+}
+
+void Hd_USTC_CG_OfflineRenderer::SetResolution(int width, int height)
+{
+    width_ = std::max(width, 1);
+    height_ = std::max(height, 1);
+    if (render_index_) {
+        _UpdateRenderTask();
+        _UpdateFreeCamera();
+    }
+}
+
+void Hd_USTC_CG_OfflineRenderer::SetSamplesPerPixel(int spp)
+{
+    if (render_delegate_) {
+        render_delegate_->SetRenderSetting(
+            HdRenderSettingsTokens->convergedSamplesPerPixel, VtValue(std::max(spp, 1)));
+    }
+}
+
+bool Hd_USTC_CG_OfflineRenderer::SetCameraPath(const SdfPath& camera_path)
+{
+    if (camera_path.IsEmpty()) {
+        camera_id_ = free_camera_id_;
+    }
+    else {
+        if (!UsdGeomCamera(stage_->GetPrimAtPath(camera_path))) {
+            TF_RUNTIME_ERROR("'%s' is not a camera", camera_path.GetText());
+            return false;
+        }
+        camera_id_ = scene_delegate_->ConvertCachePathToIndexPath(camera_path);
+    }
+    _UpdateRenderTask();
+    return true;
+}
+
+void Hd_USTC_CG_OfflineRenderer::SetFreeCameraAngle(double degrees)
+{
+    free_camera_angle_ = degrees;
+    if (render_index_) {
+        _UpdateFreeCamera();
+    }
+}
+
+void Hd_USTC_CG_OfflineRenderer::_UpdateRenderTask()
+{
+    task_delegate_->SetRenderBufferDescriptor(
+        color_buffer_id_,
+        HdRenderBufferDescriptor{ GfVec3i(width_, height_, 1), HdFormatFloat32Vec4, false });
+    render_index_->GetChangeTracker().MarkBprimDirty(
+        color_buffer_id_, HdRenderBuffer::DirtyDescription);
+
+    HdRenderPassAovBinding binding;
+    binding.aovName = HdAovTokens->color;
+    binding.renderBufferId = color_buffer_id_;
+    binding.clearValue = VtValue(GfVec4f(0.0f, 0.0f, 0.0f, 1.0f));
+
+    HdxRenderTaskParams params;
+    params.camera = camera_id_;
+    params.viewport = GfVec4d(0, 0, width_, height_);
+    params.aovBindings.push_back(binding);
+    task_delegate_->SetValue(render_task_id_, HdTokens->params, VtValue(params));
+    render_index_->GetChangeTracker().MarkTaskDirty(render_task_id_, HdChangeTracker::DirtyParams);
+}
+
+void Hd_USTC_CG_OfflineRenderer::_UpdateFreeCamera()
+{
+    const bool z_up = UsdGeomGetStageUpAxis(stage_) == UsdGeomTokens->z;
+    const GfVec3d up = z_up ? GfVec3d(0, 0, 1) : GfVec3d(0, 1, 0);
+    // Look at the stage from the front, slightly from above.
+    const GfVec3d front = z_up ? GfVec3d(0, -1, 0.35) : GfVec3d(0, 0.35, 1);
+    const GfVec3d direction =
+        GfRotation(up, free_camera_angle_).TransformDir(front).GetNormalized();
+
+    // Back off until the bounding sphere of the stage fits in the narrower field of view.
+    const double aspect = double(width_) / height_;
+    const double half_fov = std::atan(
+        kFreeCameraVerticalAperture * std::min(aspect, 1.0) / 2 / kFreeCameraFocalLength);
+    const GfVec3d center = stage_bounds_.GetMidpoint();
+    const double radius = stage_bounds_.GetSize().GetLength() / 2;
+    const double distance = radius / std::sin(half_fov);
+
+    GfMatrix4d view;
+    view.SetLookAt(center + direction * distance, center, up);
+    task_delegate_->SetTransform(free_camera_id_, view.GetInverse());
+
+    task_delegate_->SetValue(
+        free_camera_id_, HdCameraTokens->projection, VtValue(HdCamera::Perspective));
+    task_delegate_->SetValue(
+        free_camera_id_, HdCameraTokens->focalLength, VtValue(kFreeCameraFocalLength));
+    task_delegate_->SetValue(
+        free_camera_id_,
+        HdCameraTokens->horizontalAperture,
+        VtValue(float(kFreeCameraVerticalAperture * aspect)));
+    task_delegate_->SetValue(
+        free_camera_id_, HdCameraTokens->verticalAperture, VtValue(kFreeCameraVerticalAperture));
+    task_delegate_->SetValue(
+        free_camera_id_,
+        HdCameraTokens->clippingRange,
+        VtValue(GfRange1f(
+            float(std::max(distance - radius, distance * 1e-3)), float(distance + radius))));
+    task_delegate_->SetValue(
+        free_camera_id_, HdCameraTokens->windowPolicy, VtValue(CameraUtilFit));
+    render_index_->GetChangeTracker().MarkSprimDirty(free_camera_id_, HdCamera::AllDirty);
+}
+
+void Hd_USTC_CG_OfflineRenderer::Render(UsdTimeCode time)
+{
+    scene_delegate_->SetTime(time);
+
+    HdTaskSharedPtrVector tasks = { render_index_->GetTask(render_task_id_) };
+    auto render_task = std::static_pointer_cast<HdxRenderTask>(tasks[0]);
+    // The render delegate renders on its own thread; keep executing until it is done.
+    engine_.Execute(render_index_.get(), &tasks);
+    while (!render_task->IsConverged()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        engine_.Execute(render_index_.get(), &tasks);
+    }
+
+    auto buffer = static_cast<HdRenderBuffer*>(
+        render_index_->GetBprim(HdPrimTypeTokens->renderBuffer, color_buffer_id_));
+    buffer->Resolve();
+
+    // The buffer stores the bottom row first.
+    const auto* data = static_cast<const GfVec4f*>(buffer->Map());
+    color_.resize(size_t(width_) * height_);
+    for (int y = 0; y < height_; ++y) {
+        std::copy_n(
+            data + size_t(height_ - 1 - y) * width_, width_, color_.begin() + size_t(y) * width_);
+    }
+    buffer->Unmap();
+}
+
+const Hd_USTC_CG_RenderStatistics* Hd_USTC_CG_OfflineRenderer::GetStatistics() const
+{
+    if (!render_delegate_) {
+        return nullptr;
+    }
+    return &static_cast<Hd_USTC_CG_RenderParam*>(render_delegate_->GetRenderParam())->statistics;
+}
+
+bool Hd_USTC_CG_OfflineRenderer::Write(const std::string& filename) const
+{
+    HioImageSharedPtr image = HioImage::OpenForWriting(filename);
+    if (!image) {
+        TF_RUNTIME_ERROR("Could not open '%s' for writing", filename.c_str());
+        return false;
+    }
+
+    HioImage::StorageSpec storage;
+    storage.width = width_;
+    storage.height = height_;
+    storage.flipped = false;
+
+    std::vector<uint8_t> ldr;
+    const std::string extension = TfStringToLower(TfGetExtension(filename));
+    if (extension == "exr" || extension == "hdr") {
+        storage.format = HioFormatFloat32Vec4;
+        storage.data = const_cast<GfVec4f*>(color_.data());
+    }
+    else {
+        ldr.resize(color_.size() * 4);
+        for (size_t i = 0; i < color_.size(); ++i) {
+            for (int c = 0; c < 3; ++c) {
+                ldr[i * 4 + c] = _EncodeSRGB(color_[i][c]);
+            }
+            ldr[i * 4 + 3] = uint8_t(std::clamp(color_[i][3], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+        storage.format = HioFormatUNorm8Vec4srgb;
+        storage.data = ldr.data();
+    }
+    return image->Write(storage);
+}
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,103 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "USTC_CG.h"
+#include "pxr/base/gf/range3d.h"
+#include "pxr/base/gf/vec4f.h"
+#include "pxr/imaging/hd/engine.h"
+#include "pxr/pxr.h"
+#include "pxr/usd/sdf/path.h"
+#include "pxr/usd/usd/stage.h"
+#include "rendererPlugin.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+class HdRenderIndex;
+class HdRenderDelegate;
+class UsdImagingDelegate;
+PXR_NAMESPACE_CLOSE_SCOPE
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+class Hd_USTC_CG_OfflineTaskDelegate;
+struct Hd_USTC_CG_RenderStatistics;
+
+/**
+ * \brief Renders a USD stage with Hd_USTC_CG_RenderDelegate without a window: the stage goes
+ * through UsdImagingDelegate, and a single HdxRenderTask renders the color AOV into a float32
+ * render buffer, which is read back when the render converges. Everything runs on the CPU.
+ */
+class Hd_USTC_CG_OfflineRenderer {
+   public:
+    Hd_USTC_CG_OfflineRenderer();
+    ~Hd_USTC_CG_OfflineRenderer();
+
+    // Returns false if the stage can't be opened.
+    bool Open(const std::string& stage_path);
+
+    UsdStageRefPtr GetStage() const
+    {
+        return stage_;
+    }
+
+    void SetResolution(int width, int height);
+    void SetSamplesPerPixel(int spp);
+    // Render through a camera prim of the stage. The empty path selects a free camera framing the
+    // whole stage. Returns false if the prim is not a camera.
+    bool SetCameraPath(const SdfPath& camera_path);
+    // Angle (in degrees) of the free camera around the up axis of the stage, for turntables.
+    void SetFreeCameraAngle(double degrees);
+
+    // Render the stage at a time until the image converges.
+    void Render(UsdTimeCode time);
+
+    // Linear RGBA of the last render, top row first.
+    const std::vector<GfVec4f>& GetColor() const
+    {
+        return color_;
+    }
+    int GetWidth() const
+    {
+        return width_;
+    }
+    int GetHeight() const
+    {
+        return height_;
+    }
+
+    // Counters of the render delegate, accumulated over every render since Open(). Null before
+    // Open().
+    const Hd_USTC_CG_RenderStatistics* GetStatistics() const;
+
+    // Write the last render. Float formats (exr, hdr) keep the linear values, others are stored as
+    // 8 bit sRGB.
+    bool Write(const std::string& filename) const;
+
+   private:
+    void _UpdateRenderTask();
+    void _UpdateFreeCamera();
+
+    HdEngine engine_;
+    Hd_USTC_CG_RendererPlugin plugin_;
+    HdRenderDelegate* render_delegate_ = nullptr;
+    std::unique_ptr<HdRenderIndex> render_index_;
+    std::unique_ptr<UsdImagingDelegate> scene_delegate_;
+    std::unique_ptr<Hd_USTC_CG_OfflineTaskDelegate> task_delegate_;
+    UsdStageRefPtr stage_;
+
+    SdfPath render_task_id_;
+    SdfPath color_buffer_id_;
+    SdfPath free_camera_id_;
+    SdfPath camera_id_;
+
+    int width_ = 960;
+    int height_ = 540;
+    // Bounds of the stage the free camera frames.
+    GfRange3d stage_bounds_;
+    double free_camera_angle_ = 0;
+
+    std::vector<GfVec4f> color_;
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
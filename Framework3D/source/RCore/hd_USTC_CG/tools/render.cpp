@@ -0,0 +1,169 @@
+// Headless renderer: renders frames of a USD stage with Hd_USTC_CG_RenderDelegate and writes them
+// to image files, without a window or a GPU.
+//
+//   hd_USTC_CG_render scene.usd --camera /cameras/main --frames 1:48 -o frames/shot.####.exr
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "offlineRenderer.h"
+#include "pxr/base/tf/errorMark.h"
+#include "pxr/base/tf/stringUtils.h"
+
+using namespace USTC_CG;
+using namespace pxr;
+
+static void _PrintUsage(const char* program)
+{
+    std::cerr
+        << "Usage: " << program << " <stage> [options]\n"
+        << "  -o, --output <file>   Output image (default render.exr). A run of '#' is replaced\n"
+        << "                        by the zero padded frame number.\n"
+        << "  --camera <path>       Camera prim to render through (default: a free camera\n"
+        << "                        framing the whole stage).\n"
+        << "  --width <n>           Image width (default 960).\n"
+        << "  --height <n>          Image height (default 540).\n"
+        << "  --spp <n>             Samples per pixel (default HDEMBREE_SAMPLES_TO_CONVERGENCE).\n"
+        << "  --frames <a>[:<b>[:<step>]]\n"
+        << "                        Frames to render (default: the start time of the stage).\n"
+        << "  --turntable           Orbit the free camera once around the stage over the frames.\n";
+}
+
+// Replace the first run of '#' with the frame number, or insert one before the extension when
+// rendering a sequence to a name without it.
+static std::string _FrameFileName(const std::string& pattern, double frame, bool sequence)
+{
+    size_t begin = pattern.find('#');
+    if (begin == std::string::npos) {
+        if (!sequence) {
+            return pattern;
+        }
+        size_t dot = pattern.rfind('.');
+        std::string name = dot == std::string::npos ? pattern : pattern.substr(0, dot);
+        std::string extension = dot == std::string::npos ? "" : pattern.substr(dot);
+        return _FrameFileName(name + ".####" + extension, frame, sequence);
+    }
+    size_t end = pattern.find_first_not_of('#', begin);
+    end = end == std::string::npos ? pattern.size() : end;
+
+    int width = int(end - begin);
+    std::string number = frame == std::floor(frame) ? TfStringPrintf("%0*d", width, int(frame))
+                                                    : TfStringPrintf("%0*.3f", width, frame);
+    return pattern.substr(0, begin) + number + pattern.substr(end);
+}
+
+int main(int argc, char* argv[])
+{
+    TfErrorMark mark;
+
+    std::string stage_path;
+    std::string output = "render.exr";
+    std::string camera;
+    int width = 960, height = 540, spp = 0;
+    std::string frames;
+    bool turntable = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if ((arg == "-o" || arg == "--output") && has_value) {
+                output = argv[++i];
+            }
+            else if (arg == "--camera" && has_value) {
+                camera = argv[++i];
+            }
+            else if (arg == "--width" && has_value) {
+                width = std::stoi(argv[++i]);
+            }
+            else if (arg == "--height" && has_value) {
+                height = std::stoi(argv[++i]);
+            }
+            else if (arg == "--spp" && has_value) {
+                spp = std::stoi(argv[++i]);
+            }
+            else if (arg == "--frames" && has_value) {
+                frames = argv[++i];
+            }
+            else if (arg == "--turntable") {
+                turntable = true;
+            }
+            else if (arg == "-h" || arg == "--help") {
+                _PrintUsage(argv[0]);
+                return EXIT_SUCCESS;
+            }
+            else if (stage_path.empty() && arg[0] != '-') {
+                stage_path = arg;
+            }
+            else {
+                std::cerr << "Unknown argument '" << arg << "'\n";
+                _PrintUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        catch (const std::exception&) {
+            std::cerr << "Invalid value for '" << arg << "'\n";
+            return EXIT_FAILURE;
+        }
+    }
+    if (stage_path.empty() || width <= 0 || height <= 0) {
+        _PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Hd_USTC_CG_OfflineRenderer renderer;
+    renderer.SetResolution(width, height);
+    if (!renderer.Open(stage_path) || !renderer.SetCameraPath(SdfPath(camera))) {
+        return EXIT_FAILURE;
+    }
+    if (spp > 0) {
+        renderer.SetSamplesPerPixel(spp);
+    }
+
+    // Frame range.
+    UsdStageRefPtr stage = renderer.GetStage();
+    double first = stage->HasAuthoredTimeCodeRange() ? stage->GetStartTimeCode() : 0;
+    double last = first, step = 1;
+    bool sequence = false;
+    if (!frames.empty()) {
+        std::vector<std::string> range = TfStringSplit(frames, ":");
+        try {
+            first = last = std::stod(range[0]);
+            if (range.size() > 1) {
+                last = std::stod(range[1]);
+            }
+            if (range.size() > 2) {
+                step = std::stod(range[2]);
+            }
+        }
+        catch (const std::exception&) {
+            std::cerr << "Invalid frame range '" << frames << "'\n";
+            return EXIT_FAILURE;
+        }
+        if (step <= 0 || last < first) {
+            std::cerr << "Invalid frame range '" << frames << "'\n";
+            return EXIT_FAILURE;
+        }
+        sequence = last > first;
+    }
+    const bool animated = !frames.empty() || stage->HasAuthoredTimeCodeRange();
+    const int frame_count = int(std::floor((last - first) / step + 1e-6)) + 1;
+
+    for (int i = 0; i < frame_count; ++i) {
+        double frame = first + i * step;
+        if (turntable) {
+            renderer.SetFreeCameraAngle(360.0 * i / frame_count);
+        }
+        renderer.Render(animated ? UsdTimeCode(frame) : UsdTimeCode::Default());
+
+        std::string filename = _FrameFileName(output, frame, sequence);
+        if (!renderer.Write(filename)) {
+            return EXIT_FAILURE;
+        }
+        std::cout << "Wrote " << filename << std::endl;
+    }
+
+    return mark.IsClean() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "USTC_CG.h"
+#include "pxr/base/gf/vec2f.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+using namespace pxr;
+
+/**
+ * \brief Piecewise-constant distribution on [0, 1), sampled by inverting its CDF.
+ */
+class Distribution1D {
+   public:
+    Distribution1D() = default;
+    Distribution1D(const float* f, size_t n) : func(f, f + n), cdf(n + 1)
+    {
+        cdf[0] = 0;
+        for (size_t i = 1; i < n + 1; ++i) {
+            cdf[i] = cdf[i - 1] + func[i - 1] / float(n);
+        }
+        funcInt = cdf[n];
+        // A zero function can't be normalized. Fall back to uniform sampling.
+        for (size_t i = 1; i < n + 1; ++i) {
+            cdf[i] = funcInt == 0 ? float(i) / float(n) : cdf[i] / funcInt;
+        }
+    }
+
+    size_t Count() const
+    {
+        return func.size();
+    }
+
+    /**
+     * \param u uniform random number in [0, 1)
+     * \param pdf density of the returned value
+     * \param offset index of the piece the returned value lies in
+     * \return sampled value in [0, 1)
+     */
+    float SampleContinuous(float u, float& pdf, size_t& offset) const
+    {
+        // The last cdf entry not greater than u.
+        offset = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        offset = std::clamp<size_t>(offset, 1, Count()) - 1;
+
+        float du = u - cdf[offset];
+        if (cdf[offset + 1] - cdf[offset] > 0) {
+            du /= cdf[offset + 1] - cdf[offset];
+        }
+        pdf = funcInt > 0 ? func[offset] / funcInt : 1.0f;
+        return std::min((float(offset) + du) / float(Count()), 1.0f - 1e-7f);
+    }
+
+    std::vector<float> func;
+    std::vector<float> cdf;
+    float funcInt = 0;
+};
+
+/**
+ * \brief Piecewise-constant distribution on [0, 1)^2. f is stored row by row, nu values per row;
+ * a sample picks a row from the marginal distribution and then a column from that row.
+ */
+class Distribution2D {
+   public:
+    Distribution2D(const float* f, size_t nu, size_t nv)
+    {
+        conditional.reserve(nv);
+        std::vector<float> marginalFunc(nv);
+        for (size_t v = 0; v < nv; ++v) {
+            conditional.emplace_back(&f[v * nu], nu);
+            marginalFunc[v] = conditional[v].funcInt;
+        }
+        marginal = Distribution1D(marginalFunc.data(), nv);
+    }
+
+    GfVec2f SampleContinuous(const GfVec2f& u, float& pdf) const
+    {
+        float pdfs[2];
+        size_t v, offset;
+        float d1 = marginal.SampleContinuous(u[1], pdfs[1], v);
+        float d0 = conditional[v].SampleContinuous(u[0], pdfs[0], offset);
+        pdf = pdfs[0] * pdfs[1];
+        return { d0, d1 };
+    }
+
+    float Pdf(const GfVec2f& p) const
+    {
+        size_t iu = std::clamp<int>(int(p[0] * conditional[0].Count()), 0, conditional[0].Count() - 1);
+        size_t iv = std::clamp<int>(int(p[1] * marginal.Count()), 0, marginal.Count() - 1);
+        if (marginal.funcInt == 0) {
+            return 1.0f;
+        }
+        return conditional[iv].func[iu] / marginal.funcInt;
+    }
+
+   private:
+    std::vector<Distribution1D> conditional;
+    Distribution1D marginal;
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,89 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+#include "USTC_CG.h"
+
+USTC_CG_NAMESPACE_OPEN_SCOPE
+
+// Largest float below 1, so that random floats stay in [0, 1).
+constexpr float OneMinusEpsilon = 0x1.fffffep-1f;
+
+inline float UIntToUnitFloat(uint32_t v)
+{
+    return std::min(v * 0x1p-32f, OneMinusEpsilon);
+}
+
+// 64-bit finalizer of MurmurHash3, good enough to decorrelate pixels, samples and dimensions.
+inline uint64_t MixBits(uint64_t v)
+{
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdull;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ull;
+    v ^= v >> 33;
+    return v;
+}
+
+inline uint64_t HashCombine(uint64_t seed, uint64_t v)
+{
+    return MixBits(seed ^ (v + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)));
+}
+
+/**
+ * \brief The PCG32 generator by Melissa O'Neill. Each sequence index selects an independent
+ * stream, and Advance() skips ahead in O(log n).
+ */
+class PCG32 {
+   public:
+    PCG32() = default;
+    PCG32(uint64_t sequence_index, uint64_t seed)
+    {
+        SetSequence(sequence_index, seed);
+    }
+
+    void SetSequence(uint64_t sequence_index, uint64_t seed)
+    {
+        state = 0u;
+        inc = (sequence_index << 1u) | 1u;
+        NextUInt();
+        state += seed;
+        NextUInt();
+    }
+
+    uint32_t NextUInt()
+    {
+        uint64_t old_state = state;
+        state = old_state * mult + inc;
+        uint32_t xor_shifted = uint32_t(((old_state >> 18u) ^ old_state) >> 27u);
+        uint32_t rot = uint32_t(old_state >> 59u);
+        return (xor_shifted >> rot) | (xor_shifted << ((~rot + 1u) & 31));
+    }
+
+    float NextFloat()
+    {
+        return UIntToUnitFloat(NextUInt());
+    }
+
+    void Advance(uint64_t delta)
+    {
+        uint64_t cur_mult = mult, cur_plus = inc, acc_mult = 1u, acc_plus = 0u;
+        while (delta > 0) {
+            if (delta & 1) {
+                acc_mult *= cur_mult;
+                acc_plus = acc_plus * cur_mult + cur_plus;
+            }
+            cur_plus = (cur_mult + 1) * cur_plus;
+            cur_mult *= cur_mult;
+            delta /= 2;
+        }
+        state = acc_mult * state + acc_plus;
+    }
+
+   private:
+    static constexpr uint64_t mult = 0x5851f42d4c957f2dull;
+    uint64_t state = 0x853c49e6748fea9bull;
+    uint64_t inc = 0xda3e39cb94b95bdbull;
+};
+
+USTC_CG_NAMESPACE_CLOSE_SCOPE
@@ -1,3 +1,4 @@
+#pragma once
 #include "USTC_CG.h"
 #include "pxr/base/gf/math.h"
 
@@ -18,12 +19,20 @@ inline GfVec3f CosineWeightedDirection(const GfVec2f& uniform_float, float& pdf)
     return dir;
 }
 
+// GGX normal distribution D(h), with cosTheta the cosine between h and the normal.
 inline float GGX(float cosTheta, float alpha)
 {
     float alphaSqr = alpha * alpha;
-    float cosThetaSqr = cosTheta * cosTheta;
-    return alphaSqr /
-           (M_PI * cosThetaSqr * cosThetaSqr * (alphaSqr + cosThetaSqr) * (alphaSqr + cosThetaSqr));
+    float d = cosTheta * cosTheta * (alphaSqr - 1.0f) + 1.0f;
+    return alphaSqr / (M_PI * d * d);
+}
+
+// Smith masking term of GGX for a single direction.
+inline float SmithG1(float cosTheta, float alpha)
+{
+    float alphaSqr = alpha * alpha;
+    return 2.0f * cosTheta /
+           (cosTheta + sqrtf(alphaSqr + (1.0f - alphaSqr) * cosTheta * cosTheta));
 }
 
 inline GfVec3f GGXWeightedDirection(const GfVec2f& uniform_float, float roughness, float& pdf)
@@ -38,7 +47,8 @@ inline GfVec3f GGXWeightedDirection(const GfVec2f& uniform_float, float roughnes
     float y = sinTheta * sin(phi);
     float z = cosTheta;
 
-    pdf = GGX(cosTheta, alpha);
+    // This samples the half vector, with pdf D(h) * cos(theta_h).
+    pdf = GGX(cosTheta, alpha) * cosTheta;
 
     return GfVec3f(x, y, z);
 }